@@ -0,0 +1,77 @@
+#include "bench.h"
+
+volatile uint64_t bench_sink = 0;
+
+//--------------------------------------------------------------------
+
+int bench_selected(const char *name, bench_t *bench) {
+  return !bench->filter || strstr(name, bench->filter) != NULL;
+}
+
+//--------------------------------------------------------------------
+
+static int bench_cmp(const void *a, const void *b) {
+  double da = *(const double *) a, db = *(const double *) b;
+  return da < db ? -1 : (da > db);
+}
+
+//--------------------------------------------------------------------
+
+void bench_run(const char *name, bench_func_t func, void *ctx, bench_t *bench) {
+  if (!bench_selected(name, bench) || bench->num_results >= BENCH_MAX_RESULTS) return;
+
+  long round_nsec = bench->quick ? BENCH_ROUND_NSEC / 10 : BENCH_ROUND_NSEC;
+
+  // warm up and calibrate, doubling until a round is long enough
+  size_t n = 1;
+  uint64_t elapsed;
+  while (1) {
+    uint64_t start = bench_nsec();
+    func(ctx, n);
+    elapsed = bench_nsec() - start;
+    if (elapsed >= round_nsec / 4) break;
+    n *= 2;
+  }
+  n = (size_t) ((double) n * round_nsec / (elapsed ? elapsed : 1)) + 1;
+
+  double ns[BENCH_NUM_ROUNDS];
+  for (int r = 0; r < BENCH_NUM_ROUNDS; r++) {
+    uint64_t start = bench_nsec();
+    func(ctx, n);
+    ns[r] = (double) (bench_nsec() - start) / n;
+  }
+  qsort(ns, BENCH_NUM_ROUNDS, sizeof(double), bench_cmp);
+
+  bench_result_t *result = &bench->results[bench->num_results++];
+  snprintf(result->name, sizeof(result->name), "%s", name);
+  result->ns_per_op = ns[BENCH_NUM_ROUNDS / 2];
+  result->min_ns_per_op = ns[0];
+  result->ops = n;
+
+  printf("%-32s %12.1f ns/op  (min %.1f, %lu ops/round)\n", name,
+	 result->ns_per_op, result->min_ns_per_op, n);
+  fflush(stdout);
+}
+
+//--------------------------------------------------------------------
+
+void bench_write_json(const char *filename, bench_t *bench) {
+  FILE *f = strcmp(filename, "-") ? fopen(filename, "w") : stdout;
+  if (!f) {
+    fprintf(stderr, "Could not create %s\n", filename);
+    exit(EXIT_FAILURE);
+  }
+
+  fprintf(f, "{\n");
+  for (int i = 0; i < bench->num_results; i++) {
+    bench_result_t *r = &bench->results[i];
+    fprintf(f, "  \"micro.%s\": {\"ns_per_op\": %.2f, \"min_ns_per_op\": %.2f}%s\n",
+	    r->name, r->ns_per_op, r->min_ns_per_op, i + 1 < bench->num_results ? "," : "");
+  }
+  fprintf(f, "}\n");
+
+  if (f != stdout) fclose(f);
+}
+
+//--------------------------------------------------------------------
+//--------------------------------------------------------------------
@@ -0,0 +1,87 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+//--------------------------------------------------------------------
+// Microbenchmarks: every kernel is set up once on synthetic data (or
+// on the SA index given with --index), then run in rounds of n
+// operations. The number of operations per round is calibrated to
+// BENCH_ROUND_NSEC and the reported ns/op is the median of the rounds,
+// so a noisy neighbour shifts the result less than the mean would.
+//--------------------------------------------------------------------
+
+#define BENCH_ROUND_NSEC   200000000L
+#define BENCH_NUM_ROUNDS   7
+#define BENCH_MAX_RESULTS  64
+
+//--------------------------------------------------------------------
+
+// runs n operations over the data set up by the kernel
+typedef void (*bench_func_t)(void *ctx, size_t n);
+
+typedef struct bench_result {
+  char name[64];
+  double ns_per_op;
+  double min_ns_per_op;
+  size_t ops;
+} bench_result_t;
+
+typedef struct bench {
+  char *filter;
+  int quick;
+  char *index_dirname;
+
+  int num_results;
+  bench_result_t results[BENCH_MAX_RESULTS];
+} bench_t;
+
+//--------------------------------------------------------------------
+
+static inline uint64_t bench_nsec() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+// deterministic data, the same on every run
+static inline uint32_t bench_rand(uint32_t *seed) {
+  *seed ^= *seed << 13;
+  *seed ^= *seed >> 17;
+  *seed ^= *seed << 5;
+  return *seed;
+}
+
+// keeps the compiler from dropping a result
+extern volatile uint64_t bench_sink;
+
+//--------------------------------------------------------------------
+
+// whether the kernel is selected by --filter
+int bench_selected(const char *name, bench_t *bench);
+
+void bench_run(const char *name, bench_func_t func, void *ctx, bench_t *bench);
+
+void bench_write_json(const char *filename, bench_t *bench);
+
+//--------------------------------------------------------------------
+
+// every kernel sets its data up, calls bench_run and frees the data
+void bench_search(bench_t *bench);
+void bench_doscadfun(bench_t *bench);
+void bench_smith_waterman(bench_t *bench);
+void bench_cal_mng_update(bench_t *bench);
+void bench_convert_to_bam(bench_t *bench);
+void bench_recal_add_base(bench_t *bench);
+void bench_alig_scores(bench_t *bench);
+void bench_adapter_find(bench_t *bench);
+void bench_nt_kernels(bench_t *bench);
+
+//--------------------------------------------------------------------
+//--------------------------------------------------------------------
+
+#endif // BENCH_H
@@ -0,0 +1,663 @@
+#include "bench.h"
+
+#include "bioformats/bam/bam_file.h"
+
+#include "sw_server.h"
+#include "adapter.h"
+#include "dna/sa_mapper_stage.h"
+#include "tools/bam/aligner/alig.h"
+#include "tools/bam/recalibrate/bam_recal_library.h"
+#include "aux/aux_nt_simd.h"
+
+#define BENCH_NUM_QUERIES      1024
+#define BENCH_READ_LENGTH      100
+
+static const char bench_nt[4] = { 'A', 'C', 'G', 'T' };
+
+//--------------------------------------------------------------------
+
+static void bench_random_seq(char *seq, size_t len, uint32_t *seed) {
+  for (size_t i = 0; i < len; i++) {
+    seq[i] = bench_nt[bench_rand(seed) & 3];
+  }
+  seq[len] = '\0';
+}
+
+// copies seq changing about one base out of every 1/rate
+static void bench_mutate_seq(char *dst, const char *seq, size_t len,
+			     uint32_t rate, uint32_t *seed) {
+  for (size_t i = 0; i < len; i++) {
+    dst[i] = (bench_rand(seed) % rate) ? seq[i] : bench_nt[bench_rand(seed) & 3];
+  }
+  dst[len] = '\0';
+}
+
+//--------------------------------------------------------------------
+// search_prefix and search_suffix, reads taken from the SA index
+// genome (the only kernels that need --index)
+//--------------------------------------------------------------------
+
+typedef struct search_ctx {
+  sa_index3_t *sa_index;
+  char *queries[BENCH_NUM_QUERIES];
+} search_ctx_t;
+
+static void bench_search_prefix_func(void *ctx, size_t n) {
+  search_ctx_t *c = (search_ctx_t *) ctx;
+  size_t low, high, num = 0;
+  for (size_t i = 0; i < n; i++) {
+    num += search_prefix(c->queries[i % BENCH_NUM_QUERIES], &low, &high, c->sa_index, 0);
+  }
+  bench_sink += num;
+}
+
+static void bench_search_suffix_func(void *ctx, size_t n) {
+  search_ctx_t *c = (search_ctx_t *) ctx;
+  size_t low, high, suffix_len, num = 0;
+  for (size_t i = 0; i < n; i++) {
+    num += search_suffix(c->queries[i % BENCH_NUM_QUERIES], c->sa_index->k_value,
+			 MAX_NUM_SUFFIXES, c->sa_index, &low, &high, &suffix_len);
+  }
+  bench_sink += num;
+}
+
+void bench_search(bench_t *bench) {
+  if (!bench_selected("search_prefix", bench) && !bench_selected("search_suffix", bench)) return;
+
+  if (!bench->index_dirname) {
+    printf("%-32s skipped, no --index given\n", "search_prefix/search_suffix");
+    return;
+  }
+
+  search_ctx_t ctx;
+  ctx.sa_index = sa_index3_new(bench->index_dirname);
+  sa_genome3_t *genome = ctx.sa_index->genome;
+
+  // reads without Ns, so that every search finds its position
+  uint32_t seed = 17;
+  for (int i = 0; i < BENCH_NUM_QUERIES; i++) {
+    ctx.queries[i] = (char *) malloc(BENCH_READ_LENGTH + 1);
+    while (1) {
+      size_t pos = ((size_t) bench_rand(&seed) << 16 ^ bench_rand(&seed))
+	% (genome->length - BENCH_READ_LENGTH);
+      memcpy(ctx.queries[i], genome->S + pos, BENCH_READ_LENGTH);
+      ctx.queries[i][BENCH_READ_LENGTH] = '\0';
+      if (!memchr(ctx.queries[i], 'N', BENCH_READ_LENGTH)) break;
+    }
+  }
+
+  bench_run("search_prefix", bench_search_prefix_func, &ctx, bench);
+  bench_run("search_suffix", bench_search_suffix_func, &ctx, bench);
+
+  for (int i = 0; i < BENCH_NUM_QUERIES; i++) {
+    free(ctx.queries[i]);
+  }
+  sa_index3_free(ctx.sa_index);
+}
+
+//--------------------------------------------------------------------
+// doscadfun, a read flank against its reference with a few mismatches,
+// as the mini-SW of the suffix extensions
+//--------------------------------------------------------------------
+
+typedef struct doscadfun_ctx {
+  char *reads[BENCH_NUM_QUERIES];
+  char *refs[BENCH_NUM_QUERIES];
+  int read_lens[BENCH_NUM_QUERIES];
+  alig_out_t alig_out;
+} doscadfun_ctx_t;
+
+static void bench_doscadfun_func(void *ctx, size_t n) {
+  doscadfun_ctx_t *c = (doscadfun_ctx_t *) ctx;
+  float score = 0.0f;
+  for (size_t i = 0; i < n; i++) {
+    int j = i % BENCH_NUM_QUERIES;
+    alig_out_init(&c->alig_out);
+    score += doscadfun(c->reads[j], c->read_lens[j], c->refs[j], c->read_lens[j] + 5,
+		       MISMATCH_PERC, &c->alig_out);
+  }
+  bench_sink += (uint64_t) score;
+}
+
+void bench_doscadfun(bench_t *bench) {
+  if (!bench_selected("doscadfun", bench)) return;
+
+  doscadfun_ctx_t ctx;
+  cigar_init(&ctx.alig_out.cigar);
+
+  uint32_t seed = 23;
+  for (int i = 0; i < BENCH_NUM_QUERIES; i++) {
+    int len = 30 + bench_rand(&seed) % 11;
+    ctx.read_lens[i] = len;
+    ctx.refs[i] = (char *) malloc(len + 6);
+    ctx.reads[i] = (char *) malloc(len + 1);
+    bench_random_seq(ctx.refs[i], len + 5, &seed);
+    bench_mutate_seq(ctx.reads[i], ctx.refs[i], len, 20, &seed);
+  }
+
+  bench_run("doscadfun", bench_doscadfun_func, &ctx, bench);
+
+  for (int i = 0; i < BENCH_NUM_QUERIES; i++) {
+    free(ctx.reads[i]);
+    free(ctx.refs[i]);
+  }
+  cigar_clean(&ctx.alig_out.cigar);
+}
+
+//--------------------------------------------------------------------
+// smith_waterman_mqmr, batches of reads against their reference
+// regions, one op is one alignment
+//--------------------------------------------------------------------
+
+#define BENCH_SW_DEPTH  16
+
+typedef struct sw_ctx {
+  char *q[BENCH_NUM_QUERIES];
+  char *r[BENCH_NUM_QUERIES];
+  sw_optarg_t sw_optarg;
+} sw_ctx_t;
+
+static void bench_smith_waterman_func(void *ctx, size_t n) {
+  sw_ctx_t *c = (sw_ctx_t *) ctx;
+  float score = 0.0f;
+  for (size_t i = 0; i < n; i += BENCH_SW_DEPTH) {
+    int j = i % BENCH_NUM_QUERIES;
+    sw_multi_output_t *output = sw_multi_output_new(BENCH_SW_DEPTH);
+    smith_waterman_mqmr(&c->q[j], &c->r[j], BENCH_SW_DEPTH, &c->sw_optarg, 1, output);
+    score += output->score_p[0];
+    sw_multi_output_free(output);
+  }
+  bench_sink += (uint64_t) score;
+}
+
+void bench_smith_waterman(bench_t *bench) {
+  if (!bench_selected("smith_waterman_mqmr", bench)) return;
+
+  sw_ctx_t ctx;
+  sw_optarg_init(10, 0.5, 5, -4, &ctx.sw_optarg);
+
+  uint32_t seed = 29;
+  for (int i = 0; i < BENCH_NUM_QUERIES; i++) {
+    ctx.r[i] = (char *) malloc(BENCH_READ_LENGTH + 21);
+    ctx.q[i] = (char *) malloc(BENCH_READ_LENGTH + 1);
+    bench_random_seq(ctx.r[i], BENCH_READ_LENGTH + 20, &seed);
+    bench_mutate_seq(ctx.q[i], ctx.r[i] + 10, BENCH_READ_LENGTH, 25, &seed);
+  }
+
+  bench_run("smith_waterman_mqmr", bench_smith_waterman_func, &ctx, bench);
+
+  for (int i = 0; i < BENCH_NUM_QUERIES; i++) {
+    free(ctx.q[i]);
+    free(ctx.r[i]);
+  }
+}
+
+//--------------------------------------------------------------------
+// cal_mng_update, seeds of a read (close in the genome, so that they
+// are merged into CALs) on a synthetic genome, cleared as in the
+// mapper after every read
+//--------------------------------------------------------------------
+
+#define BENCH_NUM_CHROMS       4
+#define BENCH_SEEDS_PER_READ  20
+
+typedef struct cal_mng_ctx {
+  sa_genome3_t *genome;
+  cal_mng_t *cal_mng;
+  fastq_read_t *read;
+  uint32_t seed;
+} cal_mng_ctx_t;
+
+static void bench_cal_mng_update_func(void *ctx, size_t n) {
+  cal_mng_ctx_t *c = (cal_mng_ctx_t *) ctx;
+  size_t g_start = 0;
+  for (size_t i = 0; i < n; i++) {
+    if (i % BENCH_SEEDS_PER_READ == 0) {
+      cal_mng_clear(c->cal_mng);
+      g_start = bench_rand(&c->seed) % 1000000;
+    }
+    size_t r_start = bench_rand(&c->seed) % (BENCH_READ_LENGTH - 20);
+    seed_t *seed = seed_new(r_start, r_start + 19,
+			    g_start + r_start, g_start + r_start + 19);
+    seed->chromosome_id = bench_rand(&c->seed) % BENCH_NUM_CHROMS;
+    seed->strand = bench_rand(&c->seed) & 1;
+    cal_mng_update(seed, c->read, c->cal_mng);
+  }
+  cal_mng_clear(c->cal_mng);
+}
+
+void bench_cal_mng_update(bench_t *bench) {
+  if (!bench_selected("cal_mng_update", bench)) return;
+
+  size_t *chrom_lengths = (size_t *) malloc(BENCH_NUM_CHROMS * sizeof(size_t));
+  char **chrom_names = (char **) malloc(BENCH_NUM_CHROMS * sizeof(char *));
+  for (int i = 0; i < BENCH_NUM_CHROMS; i++) {
+    chrom_lengths[i] = 2000000;
+    chrom_names[i] = (char *) malloc(16);
+    sprintf(chrom_names[i], "%i", i + 1);
+  }
+
+  char seq[BENCH_READ_LENGTH + 1];
+  uint32_t seed = 31;
+  bench_random_seq(seq, BENCH_READ_LENGTH, &seed);
+
+  cal_mng_ctx_t ctx;
+  ctx.genome = sa_genome3_new(BENCH_NUM_CHROMS * 2000000, BENCH_NUM_CHROMS,
+			      chrom_lengths, NULL, chrom_names, NULL);
+  ctx.cal_mng = cal_mng_new(ctx.genome);
+  ctx.read = fastq_read_new("bench", seq, seq);
+  ctx.seed = seed;
+
+  bench_run("cal_mng_update", bench_cal_mng_update_func, &ctx, bench);
+
+  fastq_read_free(ctx.read);
+  cal_mng_free(ctx.cal_mng);
+  sa_genome3_free(ctx.genome);
+}
+
+//--------------------------------------------------------------------
+// convert_to_bam, a 100bp mapped read, as the writers
+//--------------------------------------------------------------------
+
+typedef struct convert_ctx {
+  char seq[BENCH_READ_LENGTH + 1];
+  char qual[BENCH_READ_LENGTH + 1];
+} convert_ctx_t;
+
+static void bench_convert_to_bam_func(void *ctx, size_t n) {
+  convert_ctx_t *c = (convert_ctx_t *) ctx;
+  for (size_t i = 0; i < n; i++) {
+    alignment_t *alignment = alignment_new();
+    alignment_init_single_end(strdup("bench_read"), strdup(c->seq), strdup(c->qual),
+			      i & 1, 0, 100000 + i % 1000, strdup("50M2D50M"), 3, 60,
+			      1, 0, 0, NULL, alignment);
+    bam1_t *bam1 = convert_to_bam(alignment, 33);
+    bench_sink += bam1->data_len;
+    bam_destroy1(bam1);
+    alignment_free(alignment);
+  }
+}
+
+void bench_convert_to_bam(bench_t *bench) {
+  if (!bench_selected("convert_to_bam", bench)) return;
+
+  convert_ctx_t ctx;
+  uint32_t seed = 37;
+  bench_random_seq(ctx.seq, BENCH_READ_LENGTH, &seed);
+  for (int i = 0; i < BENCH_READ_LENGTH; i++) {
+    ctx.qual[i] = '#' + bench_rand(&seed) % 40;
+  }
+  ctx.qual[BENCH_READ_LENGTH] = '\0';
+
+  bench_run("convert_to_bam", bench_convert_to_bam_func, &ctx, bench);
+}
+
+//--------------------------------------------------------------------
+// recal_add_base, the counters of the recalibration data collection
+//--------------------------------------------------------------------
+
+typedef struct recal_ctx {
+  recal_info_t data;
+  char quals[BENCH_NUM_QUERIES];
+  char dinucs[BENCH_NUM_QUERIES];
+  char misses[BENCH_NUM_QUERIES];
+} recal_ctx_t;
+
+static void bench_recal_add_base_func(void *ctx, size_t n) {
+  recal_ctx_t *c = (recal_ctx_t *) ctx;
+  for (size_t i = 0; i < n; i++) {
+    int j = i % BENCH_NUM_QUERIES;
+    recal_add_base(&c->data, c->quals[j], i % BENCH_READ_LENGTH, c->dinucs[j], c->misses[j]);
+  }
+  bench_sink += c->data.total_bases;
+}
+
+void bench_recal_add_base(bench_t *bench) {
+  if (!bench_selected("recal_add_base", bench)) return;
+
+  recal_ctx_t ctx;
+  recal_init_info(BENCH_READ_LENGTH, &ctx.data);
+
+  uint32_t seed = 41;
+  for (int i = 0; i < BENCH_NUM_QUERIES; i++) {
+    ctx.quals[i] = MIN_QUALITY_TO_STAT + bench_rand(&seed) % 35;
+    ctx.dinucs[i] = bench_rand(&seed) % NUM_DINUC;
+    ctx.misses[i] = (bench_rand(&seed) % 50) == 0;
+  }
+
+  bench_run("recal_add_base", bench_recal_add_base_func, &ctx, bench);
+
+  recal_destroy_info(&ctx.data);
+}
+
+//--------------------------------------------------------------------
+// alig_get_scores_from_read, reads with mismatches (so that every
+// haplotype is tried) scored against a region with four indels
+//--------------------------------------------------------------------
+
+#define BENCH_NUM_HAPLOS       4
+#define BENCH_REF_LENGTH     400
+#define BENCH_REF_POSITION  100000
+
+typedef struct alig_ctx {
+  alig_context_t context;
+  alig_scratch_t scratch;
+  bam1_t *reads[BENCH_NUM_QUERIES];
+  aux_indel_t haplos[BENCH_NUM_HAPLOS];
+  uint32_t v_scores[BENCH_NUM_HAPLOS + 1];
+  size_t v_positions[BENCH_NUM_HAPLOS + 1];
+} alig_ctx_t;
+
+static void bench_alig_scores_func(void *ctx, size_t n) {
+  alig_ctx_t *c = (alig_ctx_t *) ctx;
+  for (size_t i = 0; i < n; i++) {
+    memset(c->v_scores, 0xFF, sizeof(c->v_scores));
+    memset(c->v_positions, 0xFF, sizeof(c->v_positions));
+    alig_get_scores_from_read(c->reads[i % BENCH_NUM_QUERIES], &c->context, &c->scratch,
+			      c->v_scores, c->v_positions);
+    bench_sink += c->v_scores[0];
+  }
+}
+
+void bench_alig_scores(bench_t *bench) {
+  if (!bench_selected("alig_get_scores_from_read", bench)) return;
+
+  alig_ctx_t ctx;
+  memset(&ctx.context, 0, sizeof(alig_context_t));
+  memset(&ctx.scratch, 0, sizeof(alig_scratch_t));
+  ctx.scratch.aux_cigar = (uint32_t *) malloc(MAX_CIGAR_LENGTH * sizeof(uint32_t));
+  ctx.scratch.read_left_cigar = (uint32_t *) malloc(MAX_CIGAR_LENGTH * sizeof(uint32_t));
+
+  uint32_t seed = 43;
+  char *ref = (char *) malloc(BENCH_REF_LENGTH + 1);
+  bench_random_seq(ref, BENCH_REF_LENGTH, &seed);
+  ctx.context.reference.reference = ref;
+  ctx.context.reference.position = BENCH_REF_POSITION;
+  ctx.context.reference.length = BENCH_REF_LENGTH;
+
+  ctx.context.haplo_list = array_list_new(BENCH_NUM_HAPLOS, 1.25f, COLLECTION_MODE_ASYNCHRONIZED);
+  for (int i = 0; i < BENCH_NUM_HAPLOS; i++) {
+    ctx.haplos[i].indel = ((1 + i % 3) << BAM_CIGAR_SHIFT) + (i & 1 ? BAM_CDEL : BAM_CINS);
+    ctx.haplos[i].ref_pos = BENCH_REF_POSITION + 150 + 25 * i;
+    array_list_insert(&ctx.haplos[i], ctx.context.haplo_list);
+  }
+
+  char seq[BENCH_READ_LENGTH + 1], qual[BENCH_READ_LENGTH + 1];
+  for (int i = 0; i < BENCH_READ_LENGTH; i++) {
+    qual[i] = '#' + 10 + bench_rand(&seed) % 30;
+  }
+  qual[BENCH_READ_LENGTH] = '\0';
+  for (int i = 0; i < BENCH_NUM_QUERIES; i++) {
+    size_t disp = 100 + bench_rand(&seed) % 150;
+    bench_mutate_seq(seq, ref + disp, BENCH_READ_LENGTH, 30, &seed);
+    alignment_t *alignment = alignment_new();
+    alignment_init_single_end(strdup("bench_read"), strdup(seq), strdup(qual), 0, 0,
+			      BENCH_REF_POSITION + disp, strdup("100M"), 1, 60,
+			      1, 0, 0, NULL, alignment);
+    ctx.reads[i] = convert_to_bam(alignment, 33);
+    alignment_free(alignment);
+  }
+
+  bench_run("alig_get_scores_from_read", bench_alig_scores_func, &ctx, bench);
+
+  for (int i = 0; i < BENCH_NUM_QUERIES; i++) {
+    bam_destroy1(ctx.reads[i]);
+  }
+  array_list_free(ctx.context.haplo_list, NULL);
+  free(ref);
+  free(ctx.scratch.read_seq);
+  free(ctx.scratch.read_seq_ref);
+  free(ctx.scratch.quals_seq);
+  free(ctx.scratch.aux_cigar);
+  free(ctx.scratch.read_left_cigar);
+}
+
+//--------------------------------------------------------------------
+// adapter_find, reads with an adapter (one in four), at a random
+// position, between clean ones, both strands as cut_adapter does
+//--------------------------------------------------------------------
+
+#define BENCH_ADAPTERS  "AGATCGGAAGAGC,CTGTCTCTTATA"
+
+typedef struct adapter_ctx {
+  adapter_set_t adapters;
+  char *reads[BENCH_NUM_QUERIES];
+  char *revcomps[BENCH_NUM_QUERIES];
+} adapter_ctx_t;
+
+static void bench_adapter_find_func(void *ctx, size_t n) {
+  adapter_ctx_t *c = (adapter_ctx_t *) ctx;
+  int end, num = 0;
+  for (size_t i = 0; i < n; i++) {
+    int j = i % BENCH_NUM_QUERIES;
+    if (adapter_find(&c->adapters, c->reads[j], BENCH_READ_LENGTH, &end) < 0) {
+      num += adapter_find(&c->adapters, c->revcomps[j], BENCH_READ_LENGTH, &end);
+    }
+  }
+  bench_sink += num;
+}
+
+void bench_adapter_find(bench_t *bench) {
+  if (!bench_selected("adapter_find", bench)) return;
+
+  adapter_ctx_t ctx;
+  char adapters[] = BENCH_ADAPTERS;
+  adapter_set_init(adapters, &ctx.adapters);
+
+  uint32_t seed = 47;
+  for (int i = 0; i < BENCH_NUM_QUERIES; i++) {
+    ctx.reads[i] = (char *) malloc(BENCH_READ_LENGTH + 1);
+    ctx.revcomps[i] = (char *) malloc(BENCH_READ_LENGTH + 1);
+    bench_random_seq(ctx.reads[i], BENCH_READ_LENGTH, &seed);
+    if (i % 4 == 0) {
+      int pos = 30 + bench_rand(&seed) % (BENCH_READ_LENGTH - 30);
+      int len = BENCH_READ_LENGTH - pos;
+      memcpy(ctx.reads[i] + pos, "AGATCGGAAGAGC", (len < 13 ? len : 13));
+    }
+    for (int k = 0; k < BENCH_READ_LENGTH; k++) {
+      char nt = ctx.reads[i][BENCH_READ_LENGTH - 1 - k];
+      ctx.revcomps[i][k] = (nt == 'A' ? 'T' : nt == 'C' ? 'G' : nt == 'G' ? 'C' : 'A');
+    }
+    ctx.revcomps[i][BENCH_READ_LENGTH] = '\0';
+  }
+
+  bench_run("adapter_find", bench_adapter_find_func, &ctx, bench);
+
+  for (int i = 0; i < BENCH_NUM_QUERIES; i++) {
+    free(ctx.reads[i]);
+    free(ctx.revcomps[i]);
+  }
+}
+
+//--------------------------------------------------------------------
+// per-read preprocessing: reverse-complementary and the SA prefix
+// values at every offset of both strands, char by char through the
+// lookup tables (as fastq_read_revcomp and compute_prefix_value) and
+// with the aux_nt_simd.h kernels; and the BAM 4-bit sequences
+//--------------------------------------------------------------------
+
+#define BENCH_PREP_LENGTH  150
+#define BENCH_PREP_K        18
+
+typedef struct nt_ctx {
+  char *reads[BENCH_NUM_QUERIES];
+  uint8_t *bam_seqs[BENCH_NUM_QUERIES];
+  char revcomp[BENCH_PREP_LENGTH + 1];
+  size_t values[2 * BENCH_PREP_LENGTH];
+} nt_ctx_t;
+
+static void bench_read_prep_scalar_func(void *ctx, size_t n) {
+  extern char convert_ASCII[128];
+  nt_ctx_t *c = (nt_ctx_t *) ctx;
+  size_t num = 0;
+  for (size_t i = 0; i < n; i++) {
+    char *read = c->reads[i % BENCH_NUM_QUERIES];
+    for (int j = BENCH_PREP_LENGTH - 1, k = 0; j >= 0; j--, k++) {
+      c->revcomp[k] = convert_ASCII[(unsigned char) read[j]];
+    }
+    for (int j = 0; j + BENCH_PREP_K <= BENCH_PREP_LENGTH; j++) {
+      num += compute_prefix_value(read + j, BENCH_PREP_K);
+      num += compute_prefix_value(c->revcomp + j, BENCH_PREP_K);
+    }
+  }
+  bench_sink += num;
+}
+
+static void bench_read_prep_simd_func(void *ctx, size_t n) {
+  nt_ctx_t *c = (nt_ctx_t *) ctx;
+  size_t num = 0, num_values;
+  for (size_t i = 0; i < n; i++) {
+    char *read = c->reads[i % BENCH_NUM_QUERIES];
+    simd_nt_revcomp(read, BENCH_PREP_LENGTH, c->revcomp);
+    num_values = simd_nt_kmers(read, BENCH_PREP_LENGTH, BENCH_PREP_K, c->values);
+    simd_nt_kmers(c->revcomp, BENCH_PREP_LENGTH, BENCH_PREP_K, c->values + num_values);
+    num += c->values[i % num_values];
+  }
+  bench_sink += num;
+}
+
+static void bench_bam_unpack_scalar_func(void *ctx, size_t n) {
+  static const char nt16[16] = "NACNGNNNTNNNNNNN";
+  nt_ctx_t *c = (nt_ctx_t *) ctx;
+  for (size_t i = 0; i < n; i++) {
+    uint8_t *bam_seq = c->bam_seqs[i % BENCH_NUM_QUERIES];
+    for (int j = 0; j < BENCH_PREP_LENGTH; j++) {
+      c->revcomp[j] = nt16[bam1_seqi(bam_seq, j)];
+    }
+  }
+  bench_sink += c->revcomp[0];
+}
+
+static void bench_bam_unpack_simd_func(void *ctx, size_t n) {
+  nt_ctx_t *c = (nt_ctx_t *) ctx;
+  for (size_t i = 0; i < n; i++) {
+    simd_bam_unpack(c->bam_seqs[i % BENCH_NUM_QUERIES], BENCH_PREP_LENGTH, c->revcomp);
+  }
+  bench_sink += c->revcomp[0];
+}
+
+// every aux_nt_simd.h kernel against a char by char reference, for all
+// the lengths around the 16 and 32-base blocks; it exits on a mismatch
+#define BENCH_NT_CHECK_LENGTH  64
+
+static void bench_nt_check_failed(const char *kernel, size_t len) {
+  fprintf(stderr, "SIMD kernel %s differs from the scalar reference for length %lu\n",
+	  kernel, len);
+  exit(EXIT_FAILURE);
+}
+
+static void bench_nt_check() {
+  static const char bases[] = "ACGTacgtNnRX";
+  static const char nt16[16] = "NACNGNNNTNNNNNNN";
+  char seq[BENCH_NT_CHECK_LENGTH + 1], out[BENCH_NT_CHECK_LENGTH + 1], ref[BENCH_NT_CHECK_LENGTH + 1];
+  uint8_t packed[BENCH_NT_CHECK_LENGTH + 16], ref_packed[BENCH_NT_CHECK_LENGTH + 16];
+  size_t values[BENCH_NT_CHECK_LENGTH];
+  uint32_t seed = 59;
+
+  for (int round = 0; round < 16; round++) {
+    for (size_t len = 0; len <= BENCH_NT_CHECK_LENGTH; len++) {
+      // mixed case and ambiguous bases, or ACGT only for the 2-bit kernels
+      for (size_t i = 0; i < len; i++) {
+	seq[i] = bases[bench_rand(&seed) % (round % 2 ? 4 : sizeof(bases) - 1)];
+      }
+      seq[len] = '\0';
+
+      // reverse-complementary, upper case and N for the rest
+      for (size_t i = 0; i < len; i++) {
+	char nt = seq[len - 1 - i] & 0xDF;
+	ref[i] = (nt == 'A' ? 'T' : nt == 'C' ? 'G' : nt == 'G' ? 'C' : nt == 'T' ? 'A' : 'N');
+      }
+      simd_nt_revcomp(seq, len, out);
+      if (memcmp(out, ref, len)) bench_nt_check_failed("simd_nt_revcomp", len);
+      memcpy(out, seq, len);
+      simd_nt_revcomp_inplace(out, len);
+      if (memcmp(out, ref, len)) bench_nt_check_failed("simd_nt_revcomp_inplace", len);
+
+      // 2-bit codes and packs, upper case ACGT give 1, 2, 3, the rest 0
+      memset(ref_packed, 0, sizeof(ref_packed));
+      for (size_t i = 0; i < len; i++) {
+	uint8_t code = (seq[i] == 'C' ? 1 : seq[i] == 'G' ? 2 : seq[i] == 'T' ? 3 : 0);
+	ref[i] = code;
+	ref_packed[i / 4] |= code << (6 - 2 * (i % 4));
+      }
+      simd_nt_encode(seq, len, packed);
+      if (memcmp(packed, ref, len)) bench_nt_check_failed("simd_nt_encode", len);
+      simd_nt_pack(seq, len, packed);
+      if (memcmp(packed, ref_packed, (len + 3) / 4)) bench_nt_check_failed("simd_nt_pack", len);
+      simd_nt_unpack(ref_packed, len, out);
+      for (size_t i = 0; i < len; i++) {
+	if (out[i] != "ACGT"[(uint8_t) ref[i]]) bench_nt_check_failed("simd_nt_unpack", len);
+      }
+
+      // k-mer values, as compute_prefix_value
+      for (int k = 1; k <= 32 && (size_t) k <= len; k += 7) {
+	size_t num_values = simd_nt_kmers(seq, len, k, values);
+	if (num_values != len - k + 1) bench_nt_check_failed("simd_nt_kmers", len);
+	for (size_t i = 0; i < num_values; i++) {
+	  size_t value = 0;
+	  for (int j = 0; j < k; j++) value = (value << 2) | (uint8_t) ref[i + j];
+	  if (values[i] != value) bench_nt_check_failed("simd_nt_kmers", len);
+	}
+      }
+
+      // BAM 4-bit codes, any case, the rest 15
+      memset(ref_packed, 0, sizeof(ref_packed));
+      for (size_t i = 0; i < len; i++) {
+	char nt = seq[i] & 0xDF;
+	uint8_t code = (nt == 'A' ? 1 : nt == 'C' ? 2 : nt == 'G' ? 4 : nt == 'T' ? 8 : 15);
+	ref_packed[i / 2] |= code << (i % 2 ? 0 : 4);
+      }
+      simd_bam_pack(seq, len, packed);
+      if (memcmp(packed, ref_packed, (len + 1) / 2)) bench_nt_check_failed("simd_bam_pack", len);
+      simd_bam_unpack(ref_packed, len, out);
+      for (size_t i = 0; i < len; i++) {
+	if (out[i] != nt16[(ref_packed[i / 2] >> (i % 2 ? 0 : 4)) & 0x0F]) {
+	  bench_nt_check_failed("simd_bam_unpack", len);
+	}
+      }
+    }
+  }
+}
+
+void bench_nt_kernels(bench_t *bench) {
+  if (!bench_selected("read_prep_scalar", bench) && !bench_selected("read_prep_simd", bench) &&
+      !bench_selected("bam_unpack_scalar", bench) && !bench_selected("bam_unpack_simd", bench)) return;
+
+  bench_nt_check();
+
+  // as hpg-aligner and the SA index do
+  extern char convert_ASCII[128];
+  convert_ASCII['A'] = 'T';
+  convert_ASCII['C'] = 'G';
+  convert_ASCII['G'] = 'C';
+  convert_ASCII['T'] = 'A';
+  convert_ASCII['N'] = 'N';
+  PREFIX_TABLE_NT_VALUE['A'] = 0;
+  PREFIX_TABLE_NT_VALUE['N'] = 0;
+  PREFIX_TABLE_NT_VALUE['C'] = 1;
+  PREFIX_TABLE_NT_VALUE['G'] = 2;
+  PREFIX_TABLE_NT_VALUE['T'] = 3;
+
+  nt_ctx_t *ctx = (nt_ctx_t *) malloc(sizeof(nt_ctx_t));
+  uint32_t seed = 53;
+  for (int i = 0; i < BENCH_NUM_QUERIES; i++) {
+    ctx->reads[i] = (char *) malloc(BENCH_PREP_LENGTH + 1);
+    bench_random_seq(ctx->reads[i], BENCH_PREP_LENGTH, &seed);
+    ctx->bam_seqs[i] = (uint8_t *) malloc((BENCH_PREP_LENGTH + 1) / 2);
+    simd_bam_pack(ctx->reads[i], BENCH_PREP_LENGTH, ctx->bam_seqs[i]);
+  }
+
+  bench_run("read_prep_scalar", bench_read_prep_scalar_func, ctx, bench);
+  bench_run("read_prep_simd", bench_read_prep_simd_func, ctx, bench);
+  bench_run("bam_unpack_scalar", bench_bam_unpack_scalar_func, ctx, bench);
+  bench_run("bam_unpack_simd", bench_bam_unpack_simd_func, ctx, bench);
+
+  for (int i = 0; i < BENCH_NUM_QUERIES; i++) {
+    free(ctx->reads[i]);
+    free(ctx->bam_seqs[i]);
+  }
+  free(ctx);
+}
+
+//--------------------------------------------------------------------
+//--------------------------------------------------------------------
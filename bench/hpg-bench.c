@@ -0,0 +1,62 @@
+#include "bench.h"
+
+#include "commons/log.h"
+
+//--------------------------------------------------------------------
+// hpg-bench [--filter <name>] [--quick] [--index <sa index dir>] [--json <file>]
+//
+// Runs the microbenchmarks of the mapping kernels, see bench.h;
+// the end-to-end runs are driven by bench/run_bench.py
+//--------------------------------------------------------------------
+
+static void usage(char *prog) {
+  printf("Usage: %s [--filter <name>] [--quick] [--index <sa index dir>] [--json <file>]\n", prog);
+  printf("\t--filter <name>  only the kernels whose name contains <name>\n");
+  printf("\t--quick          shorter rounds, for smoke tests\n");
+  printf("\t--index <dir>    SA index used by search_prefix and search_suffix\n");
+  printf("\t--json <file>    writes the results as JSON ('-' for stdout)\n");
+}
+
+//--------------------------------------------------------------------
+
+int main(int argc, char *argv[]) {
+  bench_t bench;
+  memset(&bench, 0, sizeof(bench_t));
+  char *json_filename = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--filter") && i + 1 < argc) {
+      bench.filter = argv[++i];
+    } else if (!strcmp(argv[i], "--quick")) {
+      bench.quick = 1;
+    } else if (!strcmp(argv[i], "--index") && i + 1 < argc) {
+      bench.index_dirname = argv[++i];
+    } else if (!strcmp(argv[i], "--json") && i + 1 < argc) {
+      json_filename = argv[++i];
+    } else {
+      usage(argv[0]);
+      exit(strcmp(argv[i], "--help") ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+  }
+
+  log_level = LOG_FATAL_LEVEL;
+
+  bench_search(&bench);
+  bench_doscadfun(&bench);
+  bench_smith_waterman(&bench);
+  bench_cal_mng_update(&bench);
+  bench_convert_to_bam(&bench);
+  bench_recal_add_base(&bench);
+  bench_alig_scores(&bench);
+  bench_adapter_find(&bench);
+  bench_nt_kernels(&bench);
+
+  if (json_filename) {
+    bench_write_json(json_filename, &bench);
+  }
+
+  return 0;
+}
+
+//--------------------------------------------------------------------
+//--------------------------------------------------------------------
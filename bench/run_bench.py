@@ -0,0 +1,188 @@
+#!/usr/bin/env python
+#
+# Benchmark suite: end-to-end runs of hpg-aligner (DNA single-end,
+# DNA paired-end and RNA) on the simulated data of simulate.py, plus
+# the microbenchmarks of hpg-bench. The results are written as JSON:
+#
+#   "dna_se": {"reads_per_sec": ..., "wall_sec": ..., "max_rss_kb": ...}
+#   "micro.doscadfun": {"ns_per_op": ..., "min_ns_per_op": ...}
+#
+# and compared with the baseline (bench/baseline.json, written with
+# --update-baseline on the reference machine): the script fails when
+# any throughput is lower, or time/memory higher, than the baseline by
+# more than the tolerance.
+#
+#   scons && scons bench
+#   python bench/run_bench.py                     # compares
+#   python bench/run_bench.py --update-baseline   # new baseline
+#
+
+from __future__ import print_function
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import time
+
+BENCH_DIR = os.path.dirname(os.path.abspath(__file__))
+ROOT_DIR = os.path.dirname(BENCH_DIR)
+
+# metric -> True if higher is better
+METRICS = {
+    'reads_per_sec': True,
+    'wall_sec': False,
+    'max_rss_kb': False,
+    'ns_per_op': False,
+}
+
+
+def run(cmd, log):
+    """Runs cmd, returns (wall seconds, peak RSS in KB of the child)."""
+    print('  ' + ' '.join(cmd))
+    sys.stdout.flush()
+    start = time.time()
+    with open(log, 'w') as f:
+        proc = subprocess.Popen(cmd, stdout=f, stderr=subprocess.STDOUT)
+        _, status, usage = os.wait4(proc.pid, 0)
+    wall = time.time() - start
+    if status != 0:
+        sys.exit('Error: %s failed (status %d), see %s' % (cmd[0], status, log))
+    return wall, usage.ru_maxrss
+
+
+def count_reads(fastq):
+    with open(fastq) as f:
+        return sum(1 for _ in f) // 4
+
+
+def compare(results, baseline, tolerance):
+    regressions = 0
+    for name in sorted(results):
+        if name not in baseline:
+            continue
+        for metric, higher_is_better in sorted(METRICS.items()):
+            if metric not in results[name] or metric not in baseline[name]:
+                continue
+            new, old = results[name][metric], baseline[name][metric]
+            if not old:
+                continue
+            change = (new - old) / float(old)
+            worse = -change if higher_is_better else change
+            flag = ''
+            if worse > tolerance:
+                flag = '  REGRESSION'
+                regressions += 1
+            print('%-36s %-14s %14.2f %14.2f %+8.1f%%%s'
+                  % (name, metric, old, new, change * 100, flag))
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description='HPG Aligner benchmark suite')
+    parser.add_argument('--bin-dir', default=os.path.join(ROOT_DIR, 'bin'))
+    parser.add_argument('--work-dir', default=os.path.join(BENCH_DIR, 'work'))
+    parser.add_argument('-t', '--threads', type=int, default=4)
+    parser.add_argument('--num-reads', type=int, default=50000)
+    parser.add_argument('--quick', action='store_true',
+                        help='fewer reads and shorter microbenchmark rounds')
+    parser.add_argument('--no-micro', action='store_true')
+    parser.add_argument('--no-e2e', action='store_true')
+    parser.add_argument('-o', '--output', default=None,
+                        help='results file [<work-dir>/results.json]')
+    parser.add_argument('--baseline', default=os.path.join(BENCH_DIR, 'baseline.json'))
+    parser.add_argument('--update-baseline', action='store_true')
+    parser.add_argument('--tolerance', type=float, default=0.10,
+                        help='relative change allowed before failing [0.10]')
+    args = parser.parse_args()
+
+    if args.quick:
+        args.num_reads = min(args.num_reads, 5000)
+
+    aligner = os.path.join(args.bin_dir, 'hpg-aligner')
+    bench = os.path.join(args.bin_dir, 'hpg-bench')
+    work = args.work_dir
+    data = os.path.join(work, 'data-%d' % args.num_reads)
+    sa_index = os.path.join(work, 'sa-index')
+    bwt_index = os.path.join(work, 'bwt-index')
+    results = {}
+
+    # data and indexes are reused between runs
+    if not os.path.exists(os.path.join(data, 'rna.fq')):
+        print('Simulating data in %s' % data)
+        subprocess.check_call([sys.executable, os.path.join(BENCH_DIR, 'simulate.py'),
+                               '-o', data, '--num-reads', str(args.num_reads)])
+    genome = os.path.join(data, 'genome.fa')
+
+    if not args.no_e2e or not args.no_micro:
+        if not os.path.exists(os.path.join(sa_index, 'params.txt')):
+            print('Building SA index')
+            if not os.path.isdir(sa_index):
+                os.makedirs(sa_index)
+            run([aligner, 'build-sa-index', '-g', genome, '-i', sa_index],
+                os.path.join(work, 'build-sa-index.log'))
+
+    if not args.no_e2e:
+        if not os.path.isdir(bwt_index):
+            print('Building BWT index')
+            os.makedirs(bwt_index)
+            run([aligner, 'build-bwt-index', '-g', genome, '-i', bwt_index],
+                os.path.join(work, 'build-bwt-index.log'))
+
+        runs = [
+            ('dna_se', ['dna', '-i', sa_index, '-f', os.path.join(data, 'dna_1.fq')]),
+            ('dna_pe', ['dna', '-i', sa_index, '-f', os.path.join(data, 'dna_1.fq'),
+                        '-j', os.path.join(data, 'dna_2.fq')]),
+            ('rna', ['rna', '-i', bwt_index, '-f', os.path.join(data, 'rna.fq')]),
+        ]
+        print('End-to-end runs, %d threads' % args.threads)
+        for name, cmd in runs:
+            outdir = os.path.join(work, 'out-' + name)
+            wall, rss = run([aligner] + cmd + ['-o', outdir, '-t', str(args.threads)],
+                            os.path.join(work, name + '.log'))
+            num_reads = count_reads(cmd[4]) * (2 if name == 'dna_pe' else 1)
+            results[name] = {
+                'reads_per_sec': round(num_reads / wall, 1),
+                'wall_sec': round(wall, 3),
+                'max_rss_kb': rss,
+            }
+            print('  %-8s %10.1f reads/s %8.2f s %10d KB' % (name, num_reads / wall, wall, rss))
+
+    if not args.no_micro:
+        print('Microbenchmarks')
+        micro = os.path.join(work, 'micro.json')
+        cmd = [bench, '--index', sa_index, '--json', micro]
+        if args.quick:
+            cmd.append('--quick')
+        subprocess.check_call(cmd)
+        with open(micro) as f:
+            results.update(json.load(f))
+
+    output = args.output or os.path.join(work, 'results.json')
+    with open(output, 'w') as f:
+        json.dump(results, f, indent=2, sort_keys=True)
+    print('Results written to %s' % output)
+
+    if args.update_baseline:
+        with open(args.baseline, 'w') as f:
+            json.dump(results, f, indent=2, sort_keys=True)
+        print('Baseline written to %s' % args.baseline)
+        return 0
+
+    if not os.path.exists(args.baseline):
+        print('No baseline (%s), run with --update-baseline to create it' % args.baseline)
+        return 0
+
+    with open(args.baseline) as f:
+        baseline = json.load(f)
+    print('\n%-36s %-14s %14s %14s %9s' % ('benchmark', 'metric', 'baseline', 'current', 'change'))
+    regressions = compare(results, baseline, args.tolerance)
+    if regressions:
+        print('\n%d regression(s) over %.0f%%' % (regressions, args.tolerance * 100))
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,130 @@
+#!/usr/bin/env python
+#
+# Synthetic genome and simulated reads for the benchmarks, the same
+# files for the same seed:
+#
+#   genome.fa                 random chromosomes (GC ~ 41%)
+#   dna_1.fq, dna_2.fq        paired-end reads (dna_1.fq alone for SE)
+#   rna.fq                    reads from spliced transcripts
+#
+# Reads carry about 1% of mismatches and a few small indels, the read
+# name keeps its origin (chromosome, position, strand).
+#
+
+from __future__ import print_function
+
+import argparse
+import os
+import random
+
+COMPLEMENT = {'A': 'T', 'C': 'G', 'G': 'C', 'T': 'A', 'N': 'N'}
+
+
+def revcomp(seq):
+    return ''.join(COMPLEMENT[c] for c in reversed(seq))
+
+
+def random_seq(rng, length):
+    return ''.join(rng.choice('AAATTTCCGG') for _ in range(length))
+
+
+def mutate(rng, seq, read_length, error_rate):
+    out = []
+    i = 0
+    while len(out) < read_length and i < len(seq):
+        r = rng.random()
+        if r < error_rate:
+            out.append(rng.choice('ACGT'.replace(seq[i], '')))
+        elif r < error_rate * 1.05:
+            # insertion
+            out.append(rng.choice('ACGT'))
+            continue
+        elif r < error_rate * 1.10:
+            # deletion
+            i += 1
+            continue
+        else:
+            out.append(seq[i])
+        i += 1
+    return ''.join(out)
+
+
+def quality(rng, length):
+    return ''.join(chr(33 + max(2, min(40, int(rng.gauss(32, 5))))) for _ in range(length))
+
+
+def write_read(f, name, seq, qual):
+    f.write('@%s\n%s\n+\n%s\n' % (name, seq, qual))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Simulated data for the benchmarks')
+    parser.add_argument('-o', '--outdir', required=True)
+    parser.add_argument('--num-chroms', type=int, default=4)
+    parser.add_argument('--chrom-length', type=int, default=2000000)
+    parser.add_argument('--num-reads', type=int, default=50000)
+    parser.add_argument('--read-length', type=int, default=100)
+    parser.add_argument('--insert-size', type=int, default=300)
+    parser.add_argument('--error-rate', type=float, default=0.01)
+    parser.add_argument('--seed', type=int, default=1)
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    if not os.path.isdir(args.outdir):
+        os.makedirs(args.outdir)
+
+    chroms = []
+    with open(os.path.join(args.outdir, 'genome.fa'), 'w') as f:
+        for c in range(args.num_chroms):
+            seq = random_seq(rng, args.chrom_length)
+            chroms.append(seq)
+            f.write('>%d\n' % (c + 1))
+            for i in range(0, len(seq), 60):
+                f.write(seq[i:i + 60] + '\n')
+
+    rl = args.read_length
+    ins = args.insert_size
+
+    # DNA, pairs facing each other
+    with open(os.path.join(args.outdir, 'dna_1.fq'), 'w') as f1, \
+         open(os.path.join(args.outdir, 'dna_2.fq'), 'w') as f2:
+        for n in range(args.num_reads):
+            c = rng.randrange(args.num_chroms)
+            pos = rng.randrange(len(chroms[c]) - ins - rl)
+            fragment = chroms[c][pos:pos + ins]
+            strand = rng.randrange(2)
+            if strand:
+                fragment = revcomp(fragment)
+            r1 = mutate(rng, fragment + 'A' * rl, rl, args.error_rate)
+            r2 = mutate(rng, revcomp(fragment) + 'A' * rl, rl, args.error_rate)
+            name = 'dna_%d_%d_%d_%d' % (n, c + 1, pos + 1, strand)
+            write_read(f1, name + '/1', r1, quality(rng, len(r1)))
+            write_read(f2, name + '/2', r2, quality(rng, len(r2)))
+
+    # RNA, transcripts of three exons with introns of 100bp to 5kb
+    transcripts = []
+    for t in range(200):
+        c = rng.randrange(args.num_chroms)
+        pos = rng.randrange(len(chroms[c]) - 20000)
+        exons = []
+        for e in range(3):
+            length = rng.randrange(80, 300)
+            exons.append(chroms[c][pos:pos + length])
+            pos += length + rng.randrange(100, 5000)
+        transcripts.append(''.join(exons))
+
+    with open(os.path.join(args.outdir, 'rna.fq'), 'w') as f:
+        for n in range(args.num_reads):
+            t = rng.randrange(len(transcripts))
+            seq = transcripts[t]
+            pos = rng.randrange(len(seq) - rl)
+            fragment = seq[pos:pos + rl + 10]
+            strand = rng.randrange(2)
+            if strand:
+                fragment = revcomp(fragment)
+            r = mutate(rng, fragment, rl, args.error_rate)
+            write_read(f, 'rna_%d_t%d_%d_%d' % (n, t, pos, strand), r, quality(rng, len(r)))
+
+
+if __name__ == '__main__':
+    main()
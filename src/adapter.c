@@ -1,244 +1,304 @@
 #include "adapter.h"
-#include "bioformats/fastq/fastq_read.h"
 
-#define ADAPTER_PREFIX 5
+#include <math.h>
+#include <stdint.h>
+
+#ifdef __SSE2__
+#include <x86intrin.h>
+#endif
 
 //--------------------------------------------------------------------
 
-typedef struct adapter_match {
-  int match;
-  int adapter_start;
-  int adapter_end;
-  int seq_start;
-  int seq_end;
-  int num_mismatches;
-  int length;
-} adapter_match_t;
-
-adapter_match_t *adapter_match_new() {
-  adapter_match_t *p = (adapter_match_t *) calloc(1, sizeof(adapter_match_t));
-  return p;
+void adapter_set_init(char *adapters, adapter_set_t *set) {
+  set->num_adapters = 0;
+
+  char *p = adapters, *comma;
+  while (p && *p && set->num_adapters < ADAPTER_MAX_ADAPTERS) {
+    comma = strchr(p, ',');
+    int len = (comma ? (int) (comma - p) : (int) strlen(p));
+    if (len > 0) {
+      set->sequences[set->num_adapters] = p;
+      set->lengths[set->num_adapters] = len;
+      set->num_adapters++;
+    }
+    p = (comma ? comma + 1 : NULL);
+  }
 }
 
-void adapter_match_free(adapter_match_t *p) {
-  if (p) free(p);
+//--------------------------------------------------------------------
+// kernels
+//--------------------------------------------------------------------
+
+// mismatches between a and b, it stops once there are more than
+// max_mismatches
+static inline int adapter_mismatches(const char *a, const char *b, int len, int max_mismatches) {
+  int i = 0, mismatches = 0;
+
+#ifdef __AVX2__
+  for (; i + 32 <= len; i += 32) {
+    __m256i v_eq = _mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i const *)(a + i)),
+				     _mm256_loadu_si256((__m256i const *)(b + i)));
+    mismatches += 32 - __builtin_popcount((uint32_t) _mm256_movemask_epi8(v_eq));
+    if (mismatches > max_mismatches) return mismatches;
+  }
+#endif
+
+#ifdef __SSE2__
+  for (; i + 16 <= len; i += 16) {
+    __m128i v_eq = _mm_cmpeq_epi8(_mm_loadu_si128((__m128i const *)(a + i)),
+				  _mm_loadu_si128((__m128i const *)(b + i)));
+    mismatches += 16 - __builtin_popcount((uint32_t) _mm_movemask_epi8(v_eq));
+    if (mismatches > max_mismatches) return mismatches;
+  }
+#endif
+
+  for (; i < len; i++) {
+    if (a[i] != b[i]) mismatches++;
+  }
+  return mismatches;
 }
 
-void adapter_match_init(adapter_match_t *p) {
-  //  assert(p != NULL);
-  p->match = 0;
-  p->num_mismatches = 0;
-  p->length = 0;
+//--------------------------------------------------------------------
+
+// whether the adapter, with its k-mer prefix at pos, matches the rest
+// of the sequence (or of the adapter)
+static inline int adapter_match_at(char *adapter, int adapter_length, int k,
+				   char *sequence, int length, int pos, int *end) {
+  if (k > 2 && memcmp(sequence + pos + 1, adapter + 1, k - 2)) return 0;
+
+  int len = (adapter_length < length - pos ? adapter_length : length - pos) - k;
+  int max_mismatches = (int) round(ADAPTER_ERROR_RATIO * len);
+  if (adapter_mismatches(sequence + pos + k, adapter + k, len, max_mismatches) > max_mismatches) return 0;
+
+  *end = pos + k + len - 1;
+  return 1;
 }
 
-void adapter_match_display(char *msg, adapter_match_t *p) {
-  //  assert(p != NULL);
-  if (p->match) {
-    printf("%smatched (%i) at adapter [%i - %i] and sequence [%i - %i] (num. mismatches = %i)\n",
-	   msg, p->length, p->adapter_start, p->adapter_end, p->seq_start, p->seq_end, p->num_mismatches);
-  } else {
-    printf("%sno matched (length = %i, num. mismatches = %i)\n", msg, p->length, p->num_mismatches);
+//--------------------------------------------------------------------
+
+// leftmost match of a single adapter before limit, or -1
+static int adapter_find_one(char *adapter, int adapter_length,
+			    char *sequence, int length, int limit, int *end) {
+  int k = (adapter_length < ADAPTER_PREFIX ? adapter_length : ADAPTER_PREFIX);
+  int last = length - k;
+  if (limit > last + 1) limit = last + 1;
+
+  int pos = 0;
+
+  // candidates: first and last bases of the k-mer, for a block of
+  // positions at once
+#ifdef __AVX2__
+  {
+    const __m256i v_first = _mm256_set1_epi8(adapter[0]);
+    const __m256i v_last = _mm256_set1_epi8(adapter[k - 1]);
+    for (; pos + k - 1 + 32 <= length && pos < limit; pos += 32) {
+      uint32_t mask = _mm256_movemask_epi8(
+	_mm256_and_si256(_mm256_cmpeq_epi8(v_first, _mm256_loadu_si256((__m256i const *)(sequence + pos))),
+			 _mm256_cmpeq_epi8(v_last, _mm256_loadu_si256((__m256i const *)(sequence + pos + k - 1)))));
+      while (mask) {
+	int p = pos + __builtin_ctz(mask);
+	if (p >= limit) return -1;
+	if (adapter_match_at(adapter, adapter_length, k, sequence, length, p, end)) return p;
+	mask &= mask - 1;
+      }
+    }
+  }
+#endif
+
+#ifdef __SSE2__
+  {
+    const __m128i v_first = _mm_set1_epi8(adapter[0]);
+    const __m128i v_last = _mm_set1_epi8(adapter[k - 1]);
+    for (; pos + k - 1 + 16 <= length && pos < limit; pos += 16) {
+      uint32_t mask = _mm_movemask_epi8(
+	_mm_and_si128(_mm_cmpeq_epi8(v_first, _mm_loadu_si128((__m128i const *)(sequence + pos))),
+		      _mm_cmpeq_epi8(v_last, _mm_loadu_si128((__m128i const *)(sequence + pos + k - 1)))));
+      while (mask) {
+	int p = pos + __builtin_ctz(mask);
+	if (p >= limit) return -1;
+	if (adapter_match_at(adapter, adapter_length, k, sequence, length, p, end)) return p;
+	mask &= mask - 1;
+      }
+    }
   }
+#endif
+
+  for (; pos < limit; pos++) {
+    if (sequence[pos] == adapter[0] && sequence[pos + k - 1] == adapter[k - 1] &&
+	adapter_match_at(adapter, adapter_length, k, sequence, length, pos, end)) {
+      return pos;
+    }
+  }
+  return -1;
 }
 
 //--------------------------------------------------------------------
 
-void match_adapter(char *adapter, int adapter_length, 
-		   char *sequence, int sequence_length,
-		   float ratio_error, adapter_match_t *match) {
-
-  int i, j, len, pos, num_mismatches;
-  char *p, *seq = sequence;
-  char prefix[ADAPTER_PREFIX + 1];
-  memcpy(prefix, adapter, ADAPTER_PREFIX);
-  prefix[ADAPTER_PREFIX] = 0;
-  //  printf("\t\tprefix = %s\n", prefix);
-
-  match->match = 0;
-  match->num_mismatches = 0;
-  
-  while ((p = strstr(seq, prefix)) != NULL) {
-    pos = p - sequence;
-    len = 0;
-    num_mismatches = 0;
-    for (i = pos + ADAPTER_PREFIX, j = ADAPTER_PREFIX; 
-	 i < sequence_length && j < adapter_length; 
-	 i++, j++) {
-      if (sequence[i] != adapter[j]) {
-	num_mismatches++;
-      }
-      len++;
+int adapter_find(adapter_set_t *adapters, char *sequence, int length, int *end) {
+  int pos, best = -1, best_end = -1, limit = length;
+
+  for (int i = 0; i < adapters->num_adapters; i++) {
+    pos = adapter_find_one(adapters->sequences[i], adapters->lengths[i],
+			   sequence, length, limit, end);
+    if (pos >= 0) {
+      best = pos;
+      best_end = *end;
+      limit = pos;
     }
-    match->length = ADAPTER_PREFIX + len;
-    match->num_mismatches = num_mismatches;
-    if (num_mismatches <= round(ratio_error * len)) {
-      match->match = 1;
-      match->adapter_start = 0;
-      match->adapter_end = j - 1;
-      match->seq_start = pos;
-      match->seq_end = i - 1;
-      break;
+  }
+  if (best >= 0) {
+    *end = best_end;
+    return best;
+  }
+
+  // partial adapters, shorter than the k-mer, at the 3' end
+  for (pos = length - ADAPTER_PREFIX + 1; pos <= length - ADAPTER_MIN_OVERLAP; pos++) {
+    if (pos < 0) continue;
+    for (int i = 0; i < adapters->num_adapters; i++) {
+      if (adapters->lengths[i] >= length - pos &&
+	  !memcmp(sequence + pos, adapters->sequences[i], length - pos)) {
+	*end = length - 1;
+	return pos;
+      }
     }
-    seq = p + 1;
   }
+  return -1;
 }
 
+//--------------------------------------------------------------------
+// trimming
 //--------------------------------------------------------------------
 
-void cut_adapter(char *adapter, int adapter_length, fastq_read_t *read) {
+static inline char *adapter_strndup(const char *s, int n) {
+  char *p = (char *) malloc(n + 1);
+  memcpy(p, s, n);
+  p[n] = 0;
+  return p;
+}
+
+// removes the last n bases of the read (and the first ones of its
+// reverse-complementary)
+static void adapter_clip_3(int n, fastq_read_t *read) {
+  int len = read->length - n;
+
+  read->adapter = adapter_strndup(read->sequence + len, n);
+  read->adapter_quality = adapter_strndup(read->quality + len, n);
+  read->adapter_revcomp = adapter_strndup(read->revcomp, n);
+  read->adapter_length = n;
+  read->adapter_strand = 0;
+
+  read->sequence[len] = 0;
+  read->quality[len] = 0;
+  memmove(read->revcomp, read->revcomp + n, len);
+  read->revcomp[len] = 0;
+  read->length = len;
+}
+
+// removes the first n bases of the read (and the last ones of its
+// reverse-complementary)
+static void adapter_clip_5(int n, fastq_read_t *read) {
+  int len = read->length - n;
 
-  int pos;
-  adapter_match_t *match = adapter_match_new();
+  read->adapter = adapter_strndup(read->sequence, n);
+  read->adapter_quality = adapter_strndup(read->quality, n);
+  read->adapter_revcomp = adapter_strndup(read->revcomp + len, n);
+  read->adapter_length = -n;
+  read->adapter_strand = 0;
+
+  memmove(read->sequence, read->sequence + n, len);
+  read->sequence[len] = 0;
+  memmove(read->quality, read->quality + n, len);
+  read->quality[len] = 0;
+  read->revcomp[len] = 0;
+  read->length = len;
+}
+
+//--------------------------------------------------------------------
+
+void cut_adapter(adapter_set_t *adapters, fastq_read_t *read) {
+  int start, end;
+  int len = read->length;
+  int head = len / 3, tail = len - (len / 3);
 
   // search adapter in the 'forward' sequence
-  //printf("seq    : %s (adapter %s)\n", read->sequence, adapter);
-  match_adapter(adapter, adapter_length, read->sequence, read->length, 0.1f, match);
-  //adapter_match_display("\t\t", match);
-  if (match->match) {
-    read->adapter_strand = 0;
-    pos = read->length - (read->length / 3);
-    //fastq_read_display(read);
-    //printf("trimming adapter...\n");
-    if (match->seq_start > pos || match->seq_end > pos) {
-
-      // set adapter sequence and quality
-      read->adapter_length = read->length - match->seq_start;
-      read->adapter = (char *) malloc(read->adapter_length + 1);
-      strcpy(read->adapter, &read->sequence[match->seq_start]);
-      read->adapter[read->adapter_length] = 0;
-
-      read->adapter_quality = (char *) malloc(read->adapter_length + 1);
-      strcpy(read->adapter_quality, &read->quality[match->seq_start]);
-      read->adapter_quality[read->adapter_length] = 0;
-
-      // update sequence, quality and length
-      read->sequence[match->seq_start] = 0;
-      read->quality[match->seq_start] = 0;
-      read->length -= read->adapter_length;
-
-      // update reverse-complementary (adapter and sequence)
-      read->adapter_revcomp = (char *) malloc(read->adapter_length + 1);
-      strncpy(read->adapter_revcomp, read->revcomp, read->adapter_length);
-      read->adapter_revcomp[read->adapter_length] = 0;
-
-      strcpy(read->revcomp, &read->revcomp[read->adapter_length]);
-      read->revcomp[read->length] = 0;
-
-    } else {
-      pos = read->length / 3;
-      if (match->seq_start < pos || match->seq_end < pos) {
-	// set adapter sequence and quality
-	read->adapter_length = match->seq_end + 1;
-	read->adapter = (char *) malloc(read->adapter_length + 1);
-	strncpy(read->adapter, read->sequence, read->adapter_length);
-	read->adapter[read->adapter_length] = 0;
-
-	read->adapter_quality = (char *) malloc(read->adapter_length + 1);
-	strncpy(read->adapter_quality, read->quality, read->adapter_length);
-	read->adapter_quality[read->adapter_length] = 0;
-	
-	// update sequence, quality and length
-	read->length -= read->adapter_length;
-	strcpy(read->sequence, &read->sequence[read->adapter_length]);
-	read->sequence[read->length] = 0;
-	strcpy(read->quality, &read->quality[read->adapter_length]);
-	read->quality[read->length] = 0;
-	
-	// update reverse-complementary (adapter and sequence)
-	read->adapter_revcomp = (char *) malloc(read->adapter_length + 1);
-	strcpy(read->adapter_revcomp, &read->revcomp[read->length]);
-	read->adapter_revcomp[read->adapter_length] = 0;
-
-	read->revcomp[read->length] = 0;
-
-	read->adapter_length *= (-1);
-      } else {
-	//	printf("Not implemented yet!!\n");
-	//	abort();
-      }
+  if ((start = adapter_find(adapters, read->sequence, len, &end)) >= 0) {
+    if (start > tail || end > tail) {
+      if (start > 0) adapter_clip_3(len - start, read);
+    } else if (start < head || end < head) {
+      if (end < len - 1) adapter_clip_5(end + 1, read);
     }
-    //fastq_read_display(read);      
-  } else {
-    // search adapter in the reverse-complementary sequence
-    //printf("revcomp: %s (adapter %s)\n", read->revcomp, adapter);
-    match_adapter(adapter, adapter_length, read->revcomp, read->length, 0.1f, match);
-    //adapter_match_display("\t\t", match);
-    if (match->match) {
-      read->adapter_strand = 1;
-      pos = read->length - (read->length / 3);
-      //fastq_read_display(read);
-      //printf("trimming adapter...\n");
-      if (match->seq_start > pos || match->seq_end > pos) {
-	
-	// set adapter sequence and quality
-	read->adapter_length = read->length - match->seq_start;
-	read->adapter_revcomp = (char *) malloc(read->adapter_length + 1);
-	strcpy(read->adapter_revcomp, &read->revcomp[match->seq_start]);
-	read->adapter_revcomp[read->adapter_length] = 0;
-
-	read->adapter_quality = (char *) malloc(read->adapter_length + 1);
-	strcpy(read->adapter_quality, &read->quality[match->seq_start]);
-	read->adapter_quality[read->adapter_length] = 0;
-	
-	// update sequence, quality and length
-	read->revcomp[match->seq_start] = 0;
-	read->length -= read->adapter_length;
-	
-	// update its reverse-complementary (adapter and sequence)
-	read->adapter = (char *) malloc(read->adapter_length + 1);
-	strncpy(read->adapter, read->sequence, read->adapter_length);
-	read->adapter[read->adapter_length] = 0;
-
-	strcpy(read->sequence, &read->sequence[read->adapter_length]);
-	read->sequence[read->length] = 0;
-	strcpy(read->quality, &read->quality[read->adapter_length]);
-	read->quality[read->length] = 0;
-	
-      } else {
-	pos = read->length / 3;
-	if (match->seq_start < pos || match->seq_end < pos) {
-	  // set adapter sequence and quality
-	  read->adapter_length = match->seq_end + 1;
-	  read->adapter_revcomp = (char *) malloc(read->adapter_length + 1);
-	  strncpy(read->adapter_revcomp, read->revcomp, read->adapter_length);
-	  read->adapter_revcomp[read->adapter_length] = 0;
-
-	  read->adapter_quality = (char *) malloc(read->adapter_length + 1);
-	  strncpy(read->adapter_quality, read->quality, read->adapter_length);
-	  read->adapter_quality[read->adapter_length] = 0;
-	  
-	  // update sequence, quality and length
-	  read->length -= read->adapter_length;
-	  strcpy(read->revcomp, &read->revcomp[read->adapter_length]);
-	  read->revcomp[read->length] = 0;
-	  
-	  // update its reverse-complementary (adapter and sequence)
-	  read->adapter = (char *) malloc(read->adapter_length + 1);
-	  strcpy(read->adapter, &read->sequence[read->length]);
-	  read->adapter[read->adapter_length] = 0;
-
-	  read->sequence[read->length] = 0;
-	  read->quality[read->length] = 0;
-	  
-	  read->adapter_length *= (-1);
-	} else {
-	  //	  printf("Not implemented yet!!\n");
-	  //	  abort();
-	}
-      }
-      //fastq_read_display(read);      
-    } else {
-      /*
-      printf("*******************\n");
-      printf("*******************\n");
-      printf("*************** >>>>>>> no matched <<<<<<< *****************!!\n");
-      printf("*******************\n");
-      printf("*******************\n");
-      */
+    return;
+  }
+
+  // search adapter in the reverse-complementary sequence, its 3' end
+  // is the 5' end of the read
+  if ((start = adapter_find(adapters, read->revcomp, len, &end)) >= 0) {
+    if (start > tail || end > tail) {
+      if (start > 0) adapter_clip_5(len - start, read);
+    } else if (start < head || end < head) {
+      if (end < len - 1) adapter_clip_3(end + 1, read);
+    }
+  }
+}
+
+//--------------------------------------------------------------------
+
+// whether the tail of a read starts as an adapter, on ADAPTER_MIN_OVERLAP
+// bases at least: shorter tails match by chance
+static int adapter_tail_matches(adapter_set_t *adapters, char *tail, int len) {
+  if (len < ADAPTER_MIN_OVERLAP) return 0;
+  if (len > ADAPTER_PREFIX) len = ADAPTER_PREFIX;
+  for (int i = 0; i < adapters->num_adapters; i++) {
+    int n = (len < adapters->lengths[i] ? len : adapters->lengths[i]);
+    if (!memcmp(tail, adapters->sequences[i], n)) return 1;
+  }
+  return 0;
+}
+
+// insert size of mates shorter than the reads: the first bases of
+// read1 are the reverse-complementary of the first ones of read2, i.e.
+// the end of read2's revcomp; 0 if they do not overlap so
+static int adapter_mates_overlap(adapter_set_t *adapters, fastq_read_t *read1, fastq_read_t *read2) {
+  int len = (read1->length < read2->length ? read1->length : read2->length);
+
+  for (int insert = len - 1; insert >= ADAPTER_MIN_INSERT; insert--) {
+    int max_mismatches = (int) round(ADAPTER_ERROR_RATIO * insert);
+    if (adapter_mismatches(read1->sequence, read2->revcomp + read2->length - insert,
+			   insert, max_mismatches) > max_mismatches) continue;
+
+    if (adapter_tail_matches(adapters, read1->sequence + insert, read1->length - insert) ||
+	adapter_tail_matches(adapters, read2->sequence + insert, read2->length - insert)) {
+      return insert;
+    }
+  }
+  return 0;
+}
+
+//--------------------------------------------------------------------
+
+void cut_adapters_batch(adapter_set_t *adapters, int paired, array_list_t *reads) {
+  size_t num_reads = array_list_size(reads);
+
+  for (size_t i = 0; i < num_reads; i++) {
+    cut_adapter(adapters, array_list_get(i, reads));
+  }
+
+  if (!paired) return;
+
+  // adapters too short to be found in the reads, but left out of the
+  // overlap of the mates
+  fastq_read_t *read1, *read2;
+  for (size_t i = 0; i + 1 < num_reads; i += 2) {
+    read1 = array_list_get(i, reads);
+    read2 = array_list_get(i + 1, reads);
+    if (read1->adapter || read2->adapter) continue;
+
+    int insert = adapter_mates_overlap(adapters, read1, read2);
+    if (insert) {
+      if (read1->length > insert) adapter_clip_3(read1->length - insert, read1);
+      if (read2->length > insert) adapter_clip_3(read2->length - insert, read2);
     }
   }
-  
-  adapter_match_free(match);
 }
 
 //--------------------------------------------------------------------
@@ -1,14 +1,54 @@
-#ifdef _ADAPTER_H
+#ifndef _ADAPTER_H
 #define _ADAPTER_H
 
 #include <string.h>
 #include <stdlib.h>
 
+#include "containers/array_list.h"
 #include "bioformats/fastq/fastq_read.h"
 
 //--------------------------------------------------------------------
+// Adapter trimming: the adapters (-a, comma-separated) are searched in
+// every read of the batch, on both strands, before seeding. A match
+// starts with an exact k-mer of ADAPTER_PREFIX bases (compared 16/32
+// positions at a time) and allows ADAPTER_ERROR_RATIO mismatches in
+// the rest; at the 3' end, partial adapters down to ADAPTER_MIN_OVERLAP
+// bases match exactly. In paired-end mode, mates whose insert is
+// shorter than the reads (the reads run into the adapters) are trimmed
+// from their overlap too.
+//
+// The trimmed bases are kept in the read adapter fields (always in the
+// forward strand, adapter_length < 0 for the 5' end), the writers add
+// them back as soft clipping.
+//--------------------------------------------------------------------
+
+#define ADAPTER_PREFIX         5
+#define ADAPTER_MIN_OVERLAP    3
+#define ADAPTER_MIN_INSERT     20
+#define ADAPTER_ERROR_RATIO    0.1f
+#define ADAPTER_MAX_ADAPTERS   16
+
+//--------------------------------------------------------------------
+
+typedef struct adapter_set {
+  int num_adapters;
+  char *sequences[ADAPTER_MAX_ADAPTERS];
+  int lengths[ADAPTER_MAX_ADAPTERS];
+} adapter_set_t;
+
+// adapters from a comma-separated list, pointing into it (no copies)
+void adapter_set_init(char *adapters, adapter_set_t *set);
+
+//--------------------------------------------------------------------
+
+// leftmost adapter match in the sequence: returns its start (and its
+// last base in end), or -1
+int adapter_find(adapter_set_t *adapters, char *sequence, int length, int *end);
+
+void cut_adapter(adapter_set_t *adapters, fastq_read_t *read);
 
-void cut_adapter(char *adapter, int adapter_length, fastq_read_t *read);
+// reads of a batch, mates one after the other when paired
+void cut_adapters_batch(adapter_set_t *adapters, int paired, array_list_t *reads);
 
 //--------------------------------------------------------------------
 //--------------------------------------------------------------------
@@ -3,9 +3,6 @@
 
 //#include "extrae_user_events.h" 
 
-#define CHUNK_SHIFT   10
-
-//5 //10
 //--------------------------------------------------------------------------------------
 
 array_list_t *breakpoint_list = NULL;
@@ -578,8 +575,28 @@ cigar_code_t *generate_cigar_code(char *query_map, char *ref_map, unsigned int m
 				  unsigned int query_start, unsigned int ref_start,
 				  unsigned int query_len, unsigned int ref_len,
 				  int *distance, int ref_type) {
-  
-  cigar_code_t *p = cigar_code_new();
+  cigar_packed_t packed;
+  cigar_code_t *p;
+
+  cigar_packed_init(&packed);
+  generate_cigar_packed(query_map, ref_map, map_len, query_start, ref_start,
+			query_len, ref_len, distance, ref_type, &packed);
+  p = cigar_packed_to_cigar_code(&packed);
+  cigar_packed_clean(&packed);
+
+  init_cigar_string(p);
+
+  return p;
+}
+
+//--------------------------------------------------------------------------------------
+
+void generate_cigar_packed(char *query_map, char *ref_map, unsigned int map_len,
+			   unsigned int query_start, unsigned int ref_start,
+			   unsigned int query_len, unsigned int ref_len,
+			   int *distance, int ref_type, cigar_packed_t *p) {
+
+  cigar_packed_clear(p);
 
 
 
@@ -606,27 +623,27 @@ cigar_code_t *generate_cigar_code(char *query_map, char *ref_map, unsigned int m
     if (ref_type == FIRST_SW) {
       //Normal Case
       if (query_start <= 5) {
-	cigar_code_append_op(cigar_op_new(query_start, 'M'), p);
+	cigar_packed_append_op(query_start, 'M', p);
       } else {
-	cigar_code_append_op(cigar_op_new(query_start, 'H'), p);
+	cigar_packed_append_op(query_start, 'H', p);
 	dist += query_start;
       }
     } else {
       //Middle or last ref
       if (ref_start == 0) {
-	cigar_code_append_op(cigar_op_new(query_start, 'I'), p);
+	cigar_packed_append_op(query_start, 'I', p);
 	dist += query_start;
       } else {
 	if (ref_start == query_start) {
-	  cigar_code_append_op(cigar_op_new(query_start, 'M'), p);
+	  cigar_packed_append_op(query_start, 'M', p);
 	} else {
 	  if (ref_start > query_start) {
-	    cigar_code_append_op(cigar_op_new(ref_start - query_start, 'D'), p);
-	    cigar_code_append_op(cigar_op_new(query_start, 'M'), p);
+	    cigar_packed_append_op(ref_start - query_start, 'D', p);
+	    cigar_packed_append_op(query_start, 'M', p);
 	    dist += (ref_start - query_start);
 	  } else {
-	    cigar_code_append_op(cigar_op_new(query_start - ref_start, 'I'), p);
-	    cigar_code_append_op(cigar_op_new(ref_start, 'M'), p);
+	    cigar_packed_append_op(query_start - ref_start, 'I', p);
+	    cigar_packed_append_op(ref_start, 'M', p);
 	    dist += (query_start - ref_start);
 	  } 
 	}
@@ -634,7 +651,7 @@ cigar_code_t *generate_cigar_code(char *query_map, char *ref_map, unsigned int m
     }
   } else if (ref_start > 0) {
     if (ref_type != FIRST_SW) {
-      cigar_code_append_op(cigar_op_new(ref_start, 'D'), p);
+      cigar_packed_append_op(ref_start, 'D', p);
       dist += ref_start;
     } 
   }
@@ -652,7 +669,7 @@ cigar_code_t *generate_cigar_code(char *query_map, char *ref_map, unsigned int m
       value++;
     }
     if (value > 0) {
-      cigar_code_append_op(cigar_op_new(value, 'S'), p);
+      cigar_packed_append_op(value, 'S', p);
     } 
   } else if (query_map[0] == '-') {
     if (ref_map[0] == '-') {
@@ -690,7 +707,7 @@ cigar_code_t *generate_cigar_code(char *query_map, char *ref_map, unsigned int m
     if (transition != status) {
       // insert operation in cigar string
       operation = select_op(status);
-      cigar_code_append_op(cigar_op_new(number_op, operation), p);
+      cigar_packed_append_op(number_op, operation, p);
       number_op = 1;
       status = transition;
     } else {
@@ -716,20 +733,20 @@ cigar_code_t *generate_cigar_code(char *query_map, char *ref_map, unsigned int m
       //printf("(Soft %c!=%c)", output_p->mapped_ref_p[i][cigar_soft], output_p->mapped_seq_p[i][cigar_soft]);
     }
     
-    cigar_code_append_op(cigar_op_new(number_op - value, operation), p);
+    cigar_packed_append_op(number_op - value, operation, p);
     
     if (value > 0) {
       number_op -= value;
-      cigar_code_append_op(cigar_op_new(value, 'S'), p);
+      cigar_packed_append_op(value, 'S', p);
     }
   } else {
-    cigar_code_append_op(cigar_op_new(number_op, operation), p);
+    cigar_packed_append_op(number_op, operation, p);
   }
 
   //printf("%d+%d < %d\n", length - deletions_tot, start_seq, seq_orig_len);
   //last_h = ((map_len - deletions_tot) + query_start);
   //if (last_h < query_len) {
-  //cigar_code_append_op(cigar_op_new(query_len - last_h, 'H'), p);
+  //cigar_packed_append_op(query_len - last_h, 'H', p);
   //}
   //printf("IN-->SW CIGAR %s\n", new_cigar_code_string(p));
   //printf("deletions_tot = %i, insertions_tot = %i\n", deletions_tot, insertions_tot);
@@ -746,32 +763,32 @@ cigar_code_t *generate_cigar_code(char *query_map, char *ref_map, unsigned int m
     //printf("last_h = %i\n", last_h);
     if (ref_type == LAST_SW) {
       //Normal Case
-      //cigar_code_append_op(cigar_op_new(query_start, 'H'), p);
+      //cigar_packed_append_op(query_start, 'H', p);
       if (query_start <= 5) {
-	cigar_code_append_op(cigar_op_new(last_h, 'M'), p);
+	cigar_packed_append_op(last_h, 'M', p);
       } else {
-	cigar_code_append_op(cigar_op_new(last_h, 'H'), p);
+	cigar_packed_append_op(last_h, 'H', p);
 	dist += last_h;
       }
 
     } else {
       //Middle or first ref
       if (map_ref_len == ref_len) {
-	cigar_code_append_op(cigar_op_new(last_h, 'I'), p);
+	cigar_packed_append_op(last_h, 'I', p);
 	dist += last_h;
       } else {
 	last_h_aux = ref_len - map_ref_len;
 	//printf("last_h_aux = %i\n", last_h_aux);
 	if (last_h_aux == last_h) {
-	  cigar_code_append_op(cigar_op_new(last_h, 'M'), p);
+	  cigar_packed_append_op(last_h, 'M', p);
 	} else {	  
 	  if (last_h_aux > last_h) {
-	    cigar_code_append_op(cigar_op_new(last_h_aux - last_h, 'D'), p);
-	    cigar_code_append_op(cigar_op_new(last_h, 'M'), p);
+	    cigar_packed_append_op(last_h_aux - last_h, 'D', p);
+	    cigar_packed_append_op(last_h, 'M', p);
 	    dist += (last_h_aux - last_h);
 	  } else {
-	    cigar_code_append_op(cigar_op_new(last_h - last_h_aux, 'I'), p);
-	    cigar_code_append_op(cigar_op_new(last_h_aux, 'M'), p);
+	    cigar_packed_append_op(last_h - last_h_aux, 'I', p);
+	    cigar_packed_append_op(last_h_aux, 'M', p);
 	    dist += (last_h - last_h_aux);
 	  } 
 	}
@@ -780,19 +797,230 @@ cigar_code_t *generate_cigar_code(char *query_map, char *ref_map, unsigned int m
   } else if (map_ref_len < ref_len) {
     if (ref_type != LAST_SW) {
       dist += (ref_len - map_ref_len);
-      cigar_code_append_op(cigar_op_new(ref_len - map_ref_len, 'D'), p);
+      cigar_packed_append_op(ref_len - map_ref_len, 'D', p);
     }
   }
   
   //printf("%d-%d\n", length, *number_op_tot);
   *distance = dist;
 
-  init_cigar_string(p);
   p->distance = dist;
+}
+
+
+//--------------------------------------------------------------------------------------
+//        P A C K E D   C I G A R   I M P L E M E N T A T I O N
+//--------------------------------------------------------------------------------------
 
+const char CIGAR_PACKED_OP_NAMES[] = "MIDNSHP=X";
+
+//--------------------------------------------------------------------------------------
+
+cigar_packed_t *cigar_packed_new() {
+  cigar_packed_t *p = (cigar_packed_t *) malloc(sizeof(cigar_packed_t));
+  cigar_packed_init(p);
   return p;
 }
 
+void cigar_packed_free(cigar_packed_t *p) {
+  if (p) {
+    cigar_packed_clean(p);
+    free(p);
+  }
+}
+
+//--------------------------------------------------------------------------------------
+
+void cigar_packed_reserve(int num_ops, cigar_packed_t *p) {
+  if (num_ops <= p->max_ops) { return; }
+
+  int max_ops = p->max_ops * 2;
+  if (max_ops < num_ops) { max_ops = num_ops; }
+
+  if (!p->heap_ops) {
+    p->heap_ops = (uint32_t *) malloc(max_ops * sizeof(uint32_t));
+    memcpy(p->heap_ops, p->inline_ops, p->num_ops * sizeof(uint32_t));
+  } else {
+    p->heap_ops = (uint32_t *) realloc(p->heap_ops, max_ops * sizeof(uint32_t));
+  }
+  p->max_ops = max_ops;
+}
+
+void cigar_packed_copy(cigar_packed_t *dst, cigar_packed_t *src) {
+  cigar_packed_reserve(src->num_ops, dst);
+  memcpy(cigar_packed_ops(dst), cigar_packed_ops(src), src->num_ops * sizeof(uint32_t));
+  dst->num_ops = src->num_ops;
+  dst->distance = src->distance;
+}
+
+//--------------------------------------------------------------------------------------
+
+int cigar_packed_append_op(int number, char name, cigar_packed_t *p) {
+  int code = cigar_packed_op_code(name);
+  uint32_t *ops = cigar_packed_ops(p);
+
+  if (code < 0) { return -1; }
+
+  if (p->num_ops > 0 && (ops[p->num_ops - 1] & CIGAR_PACKED_MASK) == code) {
+    ops[p->num_ops - 1] += (uint32_t)number << CIGAR_PACKED_SHIFT;
+    return 0;
+  }
+
+  cigar_packed_reserve(p->num_ops + 1, p);
+  cigar_packed_ops(p)[p->num_ops++] = ((uint32_t)number << CIGAR_PACKED_SHIFT) | code;
+  return 0;
+}
+
+int cigar_packed_insert_first_op(int number, char name, cigar_packed_t *p) {
+  int code = cigar_packed_op_code(name);
+  uint32_t *ops = cigar_packed_ops(p);
+
+  if (code < 0) { return -1; }
+
+  if (p->num_ops > 0 && (ops[0] & CIGAR_PACKED_MASK) == code) {
+    ops[0] += (uint32_t)number << CIGAR_PACKED_SHIFT;
+    return 0;
+  }
+
+  cigar_packed_reserve(p->num_ops + 1, p);
+  ops = cigar_packed_ops(p);
+  memmove(&ops[1], ops, p->num_ops * sizeof(uint32_t));
+  ops[0] = ((uint32_t)number << CIGAR_PACKED_SHIFT) | code;
+  p->num_ops++;
+  return 0;
+}
+
+void cigar_packed_concat(cigar_packed_t *src, cigar_packed_t *dst) {
+  uint32_t *src_ops = cigar_packed_ops(src), *dst_ops = cigar_packed_ops(dst);
+  int first = 0;
+
+  if (src->num_ops == 0) { return; }
+
+  if (dst->num_ops > 0 && 
+      (dst_ops[dst->num_ops - 1] & CIGAR_PACKED_MASK) == (src_ops[0] & CIGAR_PACKED_MASK)) {
+    dst_ops[dst->num_ops - 1] += src_ops[0] & ~CIGAR_PACKED_MASK;
+    first = 1;
+  }
+
+  cigar_packed_reserve(dst->num_ops + src->num_ops - first, dst);
+  memcpy(&cigar_packed_ops(dst)[dst->num_ops], &src_ops[first], 
+	 (src->num_ops - first) * sizeof(uint32_t));
+  dst->num_ops += src->num_ops - first;
+  dst->distance += src->distance;
+}
+
+//--------------------------------------------------------------------------------------
+
+int cigar_packed_read_coverage(cigar_packed_t *p) {
+  uint32_t *ops = cigar_packed_ops(p);
+  int coverage = 0;
+  for (int i = 0; i < p->num_ops; i++) {
+    char name = cigar_packed_op_name(ops[i]);
+    if (name == 'M' || name == 'I') {
+      coverage += cigar_packed_op_len(ops[i]);
+    }
+  }
+  return coverage;
+}
+
+int cigar_packed_genome_coverage(cigar_packed_t *p) {
+  uint32_t *ops = cigar_packed_ops(p);
+  int coverage = 0;
+  for (int i = 0; i < p->num_ops; i++) {
+    char name = cigar_packed_op_name(ops[i]);
+    if (name == 'M' || name == 'D') {
+      coverage += cigar_packed_op_len(ops[i]);
+    }
+  }
+  return coverage;
+}
+
+int cigar_packed_nt_length(cigar_packed_t *p) {
+  uint32_t *ops = cigar_packed_ops(p);
+  int len = 0;
+  for (int i = 0; i < p->num_ops; i++) {
+    char name = cigar_packed_op_name(ops[i]);
+    if (name == 'M' || name == 'I' || name == '=') {
+      len += cigar_packed_op_len(ops[i]);
+    }
+  }
+  return len;
+}
+
+//--------------------------------------------------------------------------------------
+
+int cigar_packed_from_string(char *cigar_str, cigar_packed_t *p) {
+  int number = 0;
+
+  cigar_packed_clear(p);
+  for (char *c = cigar_str; *c; c++) {
+    if (*c >= '0' && *c <= '9') {
+      number = number * 10 + (*c - '0');
+    } else {
+      if (cigar_packed_append_op(number, *c, p)) { return 0; }
+      number = 0;
+    }
+  }
+
+  return p->num_ops;
+}
+
+//Returns the string length, or -1 when it does not fit in max_len
+int cigar_packed_to_string(cigar_packed_t *p, char *str, size_t max_len) {
+  uint32_t *ops = cigar_packed_ops(p);
+  char digits[12];
+  size_t len = 0;
+  int number, d;
+
+  for (int i = 0; i < p->num_ops; i++) {
+    number = cigar_packed_op_len(ops[i]);
+    d = 0;
+    do {
+      digits[d++] = '0' + (number % 10);
+      number /= 10;
+    } while (number);
+
+    if (len + d + 2 > max_len) { return -1; }
+    while (d) { str[len++] = digits[--d]; }
+    str[len++] = cigar_packed_op_name(ops[i]);
+  }
+  str[len] = '\0';
+
+  return len;
+}
+
+void cigar_packed_to_bam(cigar_packed_t *p, uint32_t *bam_cigar) {
+  memcpy(bam_cigar, cigar_packed_ops(p), p->num_ops * sizeof(uint32_t));
+}
+
+//--------------------------------------------------------------------------------------
+
+void cigar_packed_from_cigar_code(cigar_code_t *cigar_code, cigar_packed_t *p) {
+  int num_ops = cigar_code_get_num_ops(cigar_code);
+
+  cigar_packed_clear(p);
+  cigar_packed_reserve(num_ops, p);
+  for (int i = 0; i < num_ops; i++) {
+    cigar_op_t *op = array_list_get(i, cigar_code->ops);
+    cigar_packed_append_op(op->number, op->name, p);
+  }
+  p->distance = cigar_code->distance;
+}
+
+cigar_code_t *cigar_packed_to_cigar_code(cigar_packed_t *p) {
+  cigar_code_t *cigar_code = cigar_code_new();
+
+  uint32_t *ops = cigar_packed_ops(p);
+
+  for (int i = 0; i < p->num_ops; i++) {
+    array_list_insert(cigar_op_new(cigar_packed_op_len(ops[i]), 
+				   cigar_packed_op_name(ops[i])), 
+		      cigar_code->ops);
+  }
+  cigar_code->distance = p->distance;
+
+  return cigar_code;
+}
 
 //--------------------------------------------------------------------------------------
 //        M E T A E X O N   S T R U C T U R E S   I M P L E M E N T A T I O N
@@ -938,753 +1166,289 @@ void metaexon_set_callback(void *data, size_t start, size_t end) {
 
 
 //-----------------------------------------------------------------------------
-
-linked_list_item_t *__metaexon_insert(linked_list_t* list_p,
-				      linked_list_item_t *list_item,
-				      size_t start, 
-				      size_t end, 
-				      size_t max_distance,
-				      array_list_t *delete_items) {
-  unsigned char actualization = 0;
-  metaexon_t *item, *item_aux, *new_item_p;
-
-  
-  
-  //size_t start = new_start;
-  //size_t end   = new_end;
-  
-  linked_list_iterator_t* itr = linked_list_iterator_new_by_item(list_p, list_item);
-  linked_list_item_t *target_item, *item_free;
-
-  if (linked_list_size(list_p) <= 0) {
-    item = metaexon_new(start, end);
-    linked_list_insert(item, list_p);
-    target_item = list_p->first;
-    //final_list_item = list_p->first;
-  } else {
-    item = (metaexon_t *)linked_list_iterator_curr(itr);
-    while (item != NULL) {
-      if (start < item->start) {
-	if (end + max_distance < item->start) {
-	  /*********************************************
-	   *    Case 1: New item insert before item.   *
-           *                                           *
-           *        new item     item                  *
-           *       |-------| |--------|                *
-           ********************************************/
-	  new_item_p = metaexon_new(start, end);
-	  linked_list_iterator_insert(new_item_p, itr);
-	  linked_list_iterator_prev(itr);
-	  //target_item = linked_list_iterator_list_item_curr(itr);
-	  //metaexon = new_item_p;
-	} else {
-	  /********************************************
-           *  Case 2: Actualization item start        *
-           *           new item                       *
-           *          |-------|   item                *
-           *                   |--------|             *                            
-           ********************************************/
-	  item->start = start;
-	  //metaexon = item;
-	  if (end > item->end) {
-	    /**************************************************
-             *  Case 3: Actualization item start and item end *
-             *          new item                              *
-             *         |------------|                         *
-             *              item                              *    
-             *           |--------|                           *                                    
-             **************************************************/
-	    item->end = end;
-	    actualization = 1;
-	    //metaexon = item;
-	  }
-	  // metaexon = item;
-	}
-	target_item = linked_list_iterator_list_item_curr(itr);
-	break;
-      } else {
-	if (end <= item->end) {
-	  /**************************************************                                       
-           *  Case 4: The new item don't insert in the list *                             
-           *              item                              * 
-           *         |-------------|                        * 
-           *             new item                           * 
-           *            |--------|                          * 
-           **************************************************/
-	  //metaexon = item;
-	  target_item = linked_list_iterator_list_item_curr(itr);
-	  break;
-	} else if (item->end + max_distance >= start) {
-	  /********************************************                                              
-           *  Case 5: Actualization item end          *
-           *            item                          *                                              
-           *          |-------| new item              *                                            
-           *                 |--------|               *                                              
-           ********************************************/
-	  item->end = end;
-	  actualization = 1;
-	  target_item = linked_list_iterator_list_item_curr(itr);
-	  //metaexon = item;
-	  break;
-	}
-      } // end else
-      //continue loop...
-      item = linked_list_iterator_next(itr);
-      //item = linked_list_iterator_curr(itr);      
-
-    } // end while
-
-    if (item == NULL) {
-      /******************************************************* 
-       * Case 5: Insert new item at the end of the list      * 
-       *                 item    new item                    * 
-       *              |-------| |--------|                   *    
-       *******************************************************/
-      new_item_p = metaexon_new(start, end);
-      linked_list_insert_last(new_item_p, list_p);
-      target_item = list_p->last;
-      //metaexon = new_item_p;
-    }
-
-    //printf("Insert OK! and now actualization\n");
-    if (actualization == 1) {
-      linked_list_iterator_next(itr);
-      item_aux = linked_list_iterator_curr(itr);
-      
-      while (item_aux != NULL) {
-	if (item->end + max_distance < item_aux->start) {
-	  break;
-	} else {
-	  if (item->end < item_aux->end) {
-	    item->end = item_aux->end;
-	  }
-	  item_free = linked_list_iterator_remove_2(itr);
-	  if (item_free) {
-	    array_list_insert(item_free, delete_items);
-	  }
-	  //if (item_free) { metaexon_free(item_free); }
-	  item_aux = linked_list_iterator_curr(itr);
-	}                                                                                             
-      }
-    }
-
-  }//end first else
-
-  linked_list_iterator_free(itr);
-
-  return target_item;
-}
-
+//  Per-chromosome interval index. Metaexons are kept disjoint (inserts merge
+//  everything closer than min_intron_size), so sorting by start also sorts by
+//  end and both search and insert are binary searches over the array.
 //-----------------------------------------------------------------------------
 
-metaexons_t *metaexons_new(unsigned int num_chromosomes, size_t *chr_size) {
-  metaexons_t *metaexons = (metaexons_t *)malloc(sizeof(metaexons_t));
-  //unsigned int num_chromosomes = genome->num_chromosomes;
-  size_t num_chunks;
-  size_t tot_chunks = 0;
+static inline void metaexon_index_rdlock(metaexon_index_t *index) {
+  if (pthread_rwlock_tryrdlock(&index->lock)) {
+    thread_stats_inc(ST_METAEXON_READ_WAITS);
+    pthread_rwlock_rdlock(&index->lock);
+  }
+}
 
-  metaexons->num_chromosomes =  num_chromosomes;
-  //metaexons->chunk_size      =  10;
-  metaexons->num_chunks      =  (size_t *)calloc(num_chromosomes, sizeof(size_t));
-  metaexons->mutex           =  (pthread_mutex_t *)calloc(num_chromosomes, sizeof(pthread_mutex_t));
-  metaexons->metaexons_list  =  (linked_list_t **)calloc(num_chromosomes, sizeof(linked_list_t *));
-  metaexons->bypass_pointer  =  (metaexon_pair_t **)calloc(num_chromosomes, sizeof(metaexon_pair_t *));
+static inline void metaexon_index_wrlock(metaexon_index_t *index) {
+  if (pthread_rwlock_trywrlock(&index->lock)) {
+    thread_stats_inc(ST_METAEXON_WRITE_WAITS);
+    pthread_rwlock_wrlock(&index->lock);
+  }
+}
 
-  //metaexons->metaexons_x  =  (linked_list_t ***)calloc(num_chromosomes, sizeof(linked_list_t **));
+// First metaexon whose end (plus max_distance) reaches start
+static inline size_t metaexon_index_lower_bound(metaexon_index_t *index,
+						size_t start, size_t max_distance) {
+  size_t lo = 0, hi = index->num_items, mid;
 
-  //(linked_list_t *)calloc(num_chromosomes, sizeof(linked_list_t));
-  for (unsigned int i = 0; i < num_chromosomes; i++) {
-    num_chunks = chr_size[i] >> CHUNK_SHIFT;
-    if (chr_size[i] % (int)pow(2, CHUNK_SHIFT) > 0) {
-      num_chunks++;
+  while (lo < hi) {
+    mid = (lo + hi) >> 1;
+    if (index->items[mid]->end + max_distance < start) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
     }
-    metaexons->metaexons_list[i] =  linked_list_new(COLLECTION_MODE_ASYNCHRONIZED);
-    metaexons->bypass_pointer[i] = (metaexon_pair_t *)calloc(num_chunks, sizeof(metaexon_pair_t));
-
-    //metaexons->metaexons_x[i]  =  (linked_list_t **)calloc(num_chunks, sizeof(linked_list_t *));
-    //for (unsigned int j = 0; j < num_chunks; j++) {
-    //metaexons->bypass_pointer[i][j] = (linked_list_item_t **)calloc(2, sizeof(linked_list_item_t *));
-    //metaexons->metaexons_x[i][j]  =  linked_list_new(COLLECTION_MODE_ASYNCHRONIZED);
-    //}
-
-    metaexons->num_chunks[i]     = num_chunks;
-    tot_chunks                  += num_chunks;
+  }
 
-    pthread_mutex_init(&metaexons->mutex[i], NULL);
+  return lo;
+}
 
+static void metaexon_index_insert_at(size_t pos, metaexon_t *metaexon,
+				     metaexon_index_t *index) {
+  if (index->num_items >= index->max_items) {
+    index->max_items = index->max_items ? index->max_items * 2 : 1024;
+    index->items = (metaexon_t **)realloc(index->items, 
+					  index->max_items * sizeof(metaexon_t *));
   }
-  
-  //printf("Tot chunks = %i \n", tot_chunks);
-
-  return metaexons;
 
+  memmove(&index->items[pos + 1], &index->items[pos], 
+	  (index->num_items - pos) * sizeof(metaexon_t *));
+  index->items[pos] = metaexon;
+  index->num_items++;
 }
 
-/*
+//-----------------------------------------------------------------------------
 
 metaexons_t *metaexons_new(unsigned int num_chromosomes, size_t *chr_size) {
   metaexons_t *metaexons = (metaexons_t *)malloc(sizeof(metaexons_t));
-  //unsigned int num_chromosomes = genome->num_chromosomes;
-  size_t num_chunks;
-  size_t tot_chunks = 0;
 
-  metaexons->num_chromosomes =  num_chromosomes;
-  metaexons->metaexons_list  =  (skip_list_t **)calloc(num_chromosomes, sizeof(skip_list_t *));
-  metaexons->mutex           =  (pthread_mutex_t *)calloc(num_chromosomes, sizeof(pthread_mutex_t));
+  metaexons->num_chromosomes = num_chromosomes;
+  if (posix_memalign((void **)&metaexons->index, sizeof(metaexon_index_t),
+		     num_chromosomes * sizeof(metaexon_index_t))) {
+    LOG_FATAL("Not enough memory to allocate the metaexons index\n");
+  }
+  memset(metaexons->index, 0, num_chromosomes * sizeof(metaexon_index_t));
 
   for (unsigned int i = 0; i < num_chromosomes; i++) {
-
-    metaexons->metaexons_list[i] =  skip_list_new(10,
-						  COLLECTION_MODE_ASYNCHRONIZED,
-						  metaexon_free_callback,
-						  metaexon_set_callback,
-						  metaexon_merge_breaks,
-						  NULL,
-						  NULL);
-    pthread_mutex_init(&metaexons->mutex[i], NULL);
+    pthread_rwlock_init(&metaexons->index[i].lock, NULL);
   }
   
-  
   return metaexons;
 
 }
-*/
 
+//-----------------------------------------------------------------------------
 
 void metaexons_free(metaexons_t *metaexons) {
   for (int i = 0; i < metaexons->num_chromosomes; i++) {
-    linked_list_free(metaexons->metaexons_list[i], (void *)metaexon_free);
-    free(metaexons->bypass_pointer[i]);
+    metaexon_index_t *index = &metaexons->index[i];
+    for (size_t j = 0; j < index->num_items; j++) {
+      metaexon_free(index->items[j]);
+    }
+    if (index->items) { free(index->items); }
+    pthread_rwlock_destroy(&index->lock);
   }
 
-  free(metaexons->num_chunks);
-  free(metaexons->mutex);
-  free(metaexons->metaexons_list);
-  free(metaexons->bypass_pointer);
-  
+  free(metaexons->index);
   free(metaexons);
 
 }
 
+//-----------------------------------------------------------------------------
 
-/*
-void metaexons_free(metaexons_t *metaexons) {
-  if (metaexons) {
-    for (int i = 0; i < metaexons->num_chromosomes; i++) {
-      skip_list_free(metaexons->metaexons_list[i]);
-    }
-    
-    free(metaexons->metaexons_list);
-    free(metaexons->mutex);
-    free(metaexons);
-  }
+void metaexons_read_lock(unsigned int chromosome, metaexons_t *metaexons) {
+  metaexon_index_rdlock(&metaexons->index[chromosome]);
 }
-*/
-
-
-
-int metaexon_search(unsigned int strand, 
-		    unsigned int chromosome,
-		    size_t start, size_t end,
-		    metaexon_t **metaexon_found,	    
-		    metaexons_t *metaexons) {
-  /*
-  extern size_t search_calls;
-  extern size_t insert_calls;
-  extern pthread_mutex_t mutex_calls;
-  
-  struct timeval t_end, t_start;
-  double time = 0.0;
-  extern double time_search;
-  extern double time_insert;
-
-  start_timer(t_start);
-  */
-  int chunk_start = start >> CHUNK_SHIFT; //metaexons->chunk_size;
-  int chunk_end   = end   >> CHUNK_SHIFT; //metaexons->chunk_size;
-  linked_list_iterator_t itr;
 
-  *metaexon_found = NULL;
-  
-  //printf("Search [%i:%lu-%lu], [%i-%i]\n", chromosome, start, end,
-  //	 chunk_start, chunk_end);
+void metaexons_read_unlock(unsigned int chromosome, metaexons_t *metaexons) {
+  pthread_rwlock_unlock(&metaexons->index[chromosome].lock);
+}
 
-  //pthread_mutex_lock(&metaexons->mutex[chromosome]);
+//-----------------------------------------------------------------------------
 
-  //Search the first reference
-  int chk = chunk_start;
-  linked_list_item_t *list_item;
+int metaexon_search_unlocked(unsigned int strand, 
+			     unsigned int chromosome,
+			     size_t start, size_t end,
+			     metaexon_t **metaexon_found,	    
+			     metaexons_t *metaexons) {
+  metaexon_index_t *index = &metaexons->index[chromosome];
   metaexon_t *metaexon;
+  size_t lo = 0, hi, mid;
 
-  while (chk <= chunk_end && 
-	 !metaexons->bypass_pointer[chromosome][chk].first) { chk++; }
-
-  if (chk <= chunk_end && metaexons->bypass_pointer[chromosome][chk].first) {
-    list_item = metaexons->bypass_pointer[chromosome][chk].first;
+  *metaexon_found = NULL;
 
-    linked_list_iterator_init_by_item(metaexons->metaexons_list[chromosome], list_item, &itr);   
+  thread_stats_inc(ST_METAEXON_SEARCHES);
 
-    metaexon = linked_list_iterator_curr(&itr); 
-   
-    while (metaexon) {
-      if (start <= metaexon->end && end >= metaexon->start) {
-	//Found! We have good luck!
-	*metaexon_found = metaexon;	
-      } else if (start <= metaexon->end) {
-	break;
-      }
-      metaexon = linked_list_iterator_next(&itr);
+  //Last metaexon starting before the end of the region
+  hi = index->num_items;
+  while (lo < hi) {
+    mid = (lo + hi) >> 1;
+    if (index->items[mid]->start <= end) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
     }
   }
-  
-  //stop_timer(t_start, t_end, time);
 
-  //pthread_mutex_unlock(&metaexons->mutex[chromosome]);  
+  if (lo > 0) {
+    metaexon = index->items[lo - 1];
+    if (start <= metaexon->end) {
+      *metaexon_found = metaexon;
+    }
+  }
 
-  //linked_list_iterator_free(itr);
-  /*
-  pthread_mutex_lock(&(mutex_calls));
-  search_calls++;
-  time_search += time;
-  pthread_mutex_unlock(&(mutex_calls));
-  */
   return *metaexon_found == NULL ? 0 : 1;
   
 }
 
+//-----------------------------------------------------------------------------
 
-/*
 int metaexon_search(unsigned int strand, 
 		    unsigned int chromosome,
 		    size_t start, size_t end,
 		    metaexon_t **metaexon_found,	    
 		    metaexons_t *metaexons) {
+  metaexon_index_t *index = &metaexons->index[chromosome];
+  int found;
 
-  extern size_t search_calls;
-  extern size_t insert_calls;
-  extern pthread_mutex_t mutex_calls;
-  
-  struct timeval t_end, t_start;
-  double time = 0.0;
-  extern double time_search;
-  extern double time_insert;
+  metaexon_index_rdlock(index);
+  found = metaexon_search_unlocked(strand, chromosome, start, end,
+				   metaexon_found, metaexons);
+  pthread_rwlock_unlock(&index->lock);
 
-  //Extrae_event(6000019, 5);
-  
-  skip_list_item_t *skip_item;
-  start_timer(t_start); 
-  skip_item = skip_list_get_first_overlapped_item(metaexons->metaexons_list[chromosome], 
-						  start, end);
-  stop_timer(t_start, t_end, time);
-
-  *metaexon_found = (skip_item) ? (skip_item)->data : NULL;
-  
-  //Extrae_event(6000019, 0);   
-
-  pthread_mutex_lock(&(mutex_calls));
-  search_calls++;
-  time_search += time;
-  pthread_mutex_unlock(&(mutex_calls));
-  
-  return *metaexon_found == NULL ? 0 : 1;
+  return found;
   
 }
-*/
 
-/*
+//-----------------------------------------------------------------------------
+
 int metaexon_insert(unsigned int strand, unsigned int chromosome,
 		     size_t start, size_t end, int min_intron_size, 
 		     unsigned char type, void *info_break, 
 		     metaexons_t *metaexons) {
-  //Calculating start chunk and end chunk
-  //assert(chromosome <= 25);
-
-  if (end < start) { 
-    printf("META-ERR: %lu - %lu\n", start, end); 
+  if (end < start) {
+    printf("META-ERR: %lu - %lu\n", start, end);
     exit(-1);
   }
 
-  //assert(start < end);
+  metaexon_index_t *index = &metaexons->index[chromosome];
+  size_t max_distance = min_intron_size;
+  metaexon_t *metaexon, *metaexon_aux;
+  metaexon_t *delete_items[16];
+  size_t num_delete = 0;
+  size_t pos, next;
+  int db_type = strand;
 
-  int ck_start = start >> CHUNK_SHIFT;
-  int ck_end   = end  >> CHUNK_SHIFT;
-  int new_ck_start, new_ck_end;
+  thread_stats_inc(ST_METAEXON_INSERTS);
 
-  int ck;
-  metaexon_t *metaexon, *metaexon_ref;
-  int db_type = strand;
-  linked_list_item_t *list_item = NULL, *list_item_ref = NULL;
-  int loop_start, loop_end;
-  array_list_t *delete_items = array_list_new(50, 1.25f, COLLECTION_MODE_ASYNCHRONIZED);
-
-  extern double time_timer0;
-  extern double time_timer1;
-  extern double time_timer2;
-  extern double time_timer3;
-
-  struct timeval time_free_s, time_free_e;
-  //-------->Timer0
-  //start_timer(time_free_s);
-  pthread_mutex_lock(&metaexons->mutex[chromosome]);
-  //stop_timer(time_free_s, time_free_e, time_timer0);
-  //-------->End Timer0
-
-  //-------->Timer1
-  //start_timer(time_free_s);
-  for (ck = ck_start; ck <= ck_end; ck++) {
-    if (metaexons->bypass_pointer[chromosome][ck].first) {
-      //You have found a reference. Insert metaexon
-      //printf("chr:%i, chunk :%i \n", chromosome, ck);
-      list_item     = metaexons->bypass_pointer[chromosome][ck].first;
-      list_item_ref = __metaexon_insert(metaexons->metaexons_list[chromosome],
-					list_item, start, end,
-					min_intron_size,
-					delete_items);
-      metaexon_ref = (metaexon_t *)list_item_ref->item;
-      new_ck_start = metaexon_ref->start >> CHUNK_SHIFT;
-      new_ck_end   = metaexon_ref->end >> CHUNK_SHIFT;
-
-      loop_start = new_ck_start;
-      loop_end   = new_ck_end;
-      if (metaexons->bypass_pointer[chromosome][new_ck_start].first) {
-	loop_start++;
-	//printf("\tStar chunk actualization %i\n", new_ck_start);
-	
-	list_item = metaexons->bypass_pointer[chromosome][new_ck_start].first;
-	assert(list_item != NULL);
-	metaexon  = (metaexon_t *)list_item->item;
-	if (metaexon_ref->start <= metaexon->start) {
-	  metaexons->bypass_pointer[chromosome][new_ck_start].first = list_item_ref;
+  metaexon_index_wrlock(index);
+
+  pos = metaexon_index_lower_bound(index, start, max_distance);
+
+  if (pos == index->num_items || 
+      (start < index->items[pos]->start && end + max_distance < index->items[pos]->start)) {
+    /*********************************************
+     *    New item, nothing close to merge with  *
+     *                                           *
+     *        new item     item                  *
+     *       |-------| |--------|                *
+     ********************************************/
+    metaexon = metaexon_new(start, end);
+    metaexon_index_insert_at(pos, metaexon, index);
+  } else {
+    /*********************************************
+     *    Actualization item start and/or end    *
+     *                                           *
+     *          new item                         *
+     *         |------------|                    *
+     *              item                         *
+     *           |--------|                      *
+     ********************************************/
+    metaexon = index->items[pos];
+    if (start < metaexon->start) {
+      metaexon->start = start;
+    }
+
+    if (end > metaexon->end) {
+      metaexon->end = end;
+
+      //The new end can reach the next metaexons, merge them
+      next = pos + 1;
+      while (next < index->num_items) {
+	metaexon_aux = index->items[next];
+	if (metaexon->end + max_distance < metaexon_aux->start) {
+	  break;
 	}
-	
-	list_item = metaexons->bypass_pointer[chromosome][new_ck_start].last;
-	assert(list_item != NULL);
-	metaexon  = (metaexon_t *)list_item->item;
-	if (metaexon_ref->end >= metaexon->end) {
-	  metaexons->bypass_pointer[chromosome][new_ck_start].last = list_item_ref;
-	}	
-      }
-      
-      if (new_ck_start != new_ck_end && metaexons->bypass_pointer[chromosome][new_ck_end].first) {
-	loop_end--;
-	//printf("\tStar end actualization %i\n", new_ck_end);
-	list_item = metaexons->bypass_pointer[chromosome][new_ck_end].first;
-	assert(list_item);
-	metaexon  = (metaexon_t *)list_item->item;
-
-	if (metaexon_ref->start <= metaexon->start) {
-	  metaexons->bypass_pointer[chromosome][new_ck_end].first = list_item_ref;
+	if (metaexon->end < metaexon_aux->end) {
+	  metaexon->end = metaexon_aux->end;
+	}
+	if (num_delete < 16) {
+	  delete_items[num_delete++] = metaexon_aux;
+	} else {
+	  metaexon_free(metaexon_aux);
 	}
-	
-	list_item = metaexons->bypass_pointer[chromosome][new_ck_end].last;
-	assert(list_item);
-	metaexon  = (metaexon_t *)list_item->item;
-	//printf(" %lu >= %lu ??\n", metaexon_ref->start, metaexon->start);
-	if (metaexon_ref->end >= metaexon->end) {
-	  metaexons->bypass_pointer[chromosome][new_ck_end].last = list_item_ref;
-	}	
+	next++;
       }
       
-      for (int ck2 = loop_start; ck2 <= loop_end; ck2++) {
-	metaexons->bypass_pointer[chromosome][ck2].first = list_item_ref;
-	metaexons->bypass_pointer[chromosome][ck2].last = list_item_ref;
-      }      
-      break;
-    }
-  } //end for
-
-  //stop_timer(time_free_s, time_free_e, time_timer1);
-  //-------->End Timer1
-
-  //-------->Timer2
-  //start_timer(time_free_s);
-  if (!list_item) {
-    //printf("List item not insert :( ...\n");
-    int ck_s = ck_start - 1;
-    int ck_e = ck_end + 1;
-    for (int i = 0; i < metaexons->num_chunks[chromosome]; i++) {
-      if (ck_s - i >= 0 && 
-	  metaexons->bypass_pointer[chromosome][ck_s - i].last ) {
-	//printf("chunk 2: %i \n", ck_s - i);
-	list_item     = metaexons->bypass_pointer[chromosome][ck_s - i].last; 
-	list_item_ref = __metaexon_insert(metaexons->metaexons_list[chromosome],
-					  list_item, start, end,
-					  min_intron_size,
-					  delete_items);      	
-	break;
+      if (next > pos + 1) {
+	memmove(&index->items[pos + 1], &index->items[next],
+		(index->num_items - next) * sizeof(metaexon_t *));
+	index->num_items -= next - pos - 1;
       }
-      if (ck_e + i < metaexons->num_chunks[chromosome] &&
-	  metaexons->bypass_pointer[chromosome][ck_e + i].first) {
-	//printf("chunk 2: %i \n", ck_e + i);
-	list_item     = metaexons->bypass_pointer[chromosome][ck_e + i].first;
-	list_item_ref = __metaexon_insert(metaexons->metaexons_list[chromosome],
-					  list_item, start, end,
-					  min_intron_size,
-					  delete_items);
-	break;
-      }
-    }
-
-    if (!list_item) {
-      //printf("chunk 3: NO\n");
-      list_item_ref = __metaexon_insert(metaexons->metaexons_list[chromosome],
-					list_item, start, end,
-					min_intron_size,
-					delete_items);
-    }
-
-    metaexon_ref = (metaexon_t *)list_item_ref->item;
-    new_ck_start = metaexon_ref->start >> CHUNK_SHIFT;
-    new_ck_end   = metaexon_ref->end >> CHUNK_SHIFT;
-
-    for (int ck = new_ck_start; ck <= new_ck_end; ck++) {
-      metaexons->bypass_pointer[chromosome][ck].first = list_item_ref;
-      metaexons->bypass_pointer[chromosome][ck].last  = list_item_ref;
     }
-
   }
-  //stop_timer(time_free_s, time_free_e, time_timer2);
-  //-------->End Timer2
 
   if (info_break) {
-    metaexon_insert_break(info_break, type, metaexon_ref, db_type);    
+    metaexon_insert_break(info_break, type, metaexon, db_type);
   }
 
-  pthread_mutex_unlock(&metaexons->mutex[chromosome]);
+  pthread_rwlock_unlock(&index->lock);
 
-  //-------->Timer3
-  //start_timer(time_free_s);
-  for (int i = array_list_size(delete_items) - 1; i >= 0; i--) {
-    list_item = array_list_get(i, delete_items);
-    linked_list_item_free(list_item, (void (*)(void *))metaexon_free);
+  for (size_t i = 0; i < num_delete; i++) {
+    metaexon_free(delete_items[i]);
   }
 
-  array_list_free(delete_items, (void *)NULL);
-  //stop_timer(time_free_s, time_free_e, time_timer3);
-  //-------->End Timer3
-
   return db_type;
 
 }
-*/
 
-/*
-int metaexon_insert(unsigned int strand, unsigned int chromosome,
-		    size_t start, size_t end, int min_intron_size, 
-		    unsigned char type, void *info_break, 
-		    metaexons_t *metaexons) {
-
-  extern size_t search_calls;
-  extern size_t insert_calls;
-  extern pthread_mutex_t mutex_calls;
-  
-  struct timeval t_stop, t_start;
-  double time = 0.0;
-  extern double time_search;
-  extern double time_insert;
-
-  metaexon_t *metaexon;
-  
-  metaexon = metaexon_new(start, end);
+//-----------------------------------------------------------------------------
 
-  //Extrae_event(6000019, 4);   
-  pthread_mutex_lock(&(metaexons->mutex[chromosome]));
-  //Extrae_event(6000019, 0);   
+void metaexons_print_chr(metaexons_t *metaexons, int chr) {
+  metaexon_index_t *index = &metaexons->index[chr];
   
-  //Extrae_event(6000019, 6);   
-  start_timer(t_start); 
-  skip_list_insert_item(metaexons->metaexons_list[chromosome], metaexon, start, end, min_intron_size);
-  stop_timer(t_start, t_stop, time);
-  //Extrae_event(6000019, 0);
-
-  if (info_break) {
-    metaexon_insert_break(info_break, type, metaexon, strand);
+  printf("CHROMOSOME %i (%lu metaexons):\n", chr + 1, index->num_items);
+  for (size_t i = 0; i < index->num_items; i++) {
+    printf("\t[%lu-%lu] L:%i R:%i\n", index->items[i]->start, index->items[i]->end,
+	   index->items[i]->left_closed, index->items[i]->right_closed);
   }
-
-  pthread_mutex_unlock(&(metaexons->mutex[chromosome]));
-
-
-  pthread_mutex_lock(&(mutex_calls));
-  insert_calls++;
-  time_insert += time;
-  pthread_mutex_unlock(&(mutex_calls));
-
-  return 1;
-
 }
-*/
 
-
-int metaexon_insert(unsigned int strand, unsigned int chromosome,
-		     size_t start, size_t end, int min_intron_size, 
-		     unsigned char type, void *info_break, 
-		     metaexons_t *metaexons) {
-
-    //assert(chromosome <= 25);
-  /*
-  extern size_t search_calls;
-  extern size_t insert_calls;
-  extern pthread_mutex_t mutex_calls;
-  
-  struct timeval t_stop, t_start;
-  double time = 0.0;
-  extern double time_search;
-  extern double time_insert;
-  */
-  if (end < start) {
-    printf("META-ERR: %lu - %lu\n", start, end);
-    exit(-1);
+void metaexons_print(metaexons_t *metaexons) {
+  for (int i = 0; i < metaexons->num_chromosomes; i++) {
+    metaexons_print_chr(metaexons, i);
   }
+}
 
-    //assert(start < end);
-
-    int ck_start = start >> CHUNK_SHIFT;
-    int ck_end = end >> CHUNK_SHIFT;
-    int ck;
-    metaexon_t *metaexon, *metaexon_ref;
-    int db_type = strand;
-    linked_list_item_t *list_item = NULL, *list_item_ref = NULL;
-    int loop_start, loop_end;
-    array_list_t *delete_items = array_list_new(50, 1.25f, COLLECTION_MODE_ASYNCHRONIZED);
-
-    pthread_mutex_lock(&metaexons->mutex[chromosome]);
-
-    //start_timer(t_start);
-
-    for (ck = ck_start; ck <= ck_end; ck++) {
-      if (metaexons->bypass_pointer[chromosome][ck].first) {
-	//You have found a reference. Insert metaexon
-	//printf("chr:%i, chunk :%i \n", chromosome, ck);
-	list_item = metaexons->bypass_pointer[chromosome][ck].first;
-	list_item_ref = __metaexon_insert(metaexons->metaexons_list[chromosome],
-					  list_item, start, end,
-					  min_intron_size,
-					  delete_items);
-	metaexon_ref = (metaexon_t *)list_item_ref->item;
-	ck_start = metaexon_ref->start >> CHUNK_SHIFT;
-	ck_end = metaexon_ref->end >> CHUNK_SHIFT;
-
-	loop_start = ck_start;
-	loop_end = ck_end;
-	if (metaexons->bypass_pointer[chromosome][ck_start].first) {
-	  loop_start++;
-	  //printf("\tStar chunk actualization %i\n", ck_start);
-
-	  list_item = metaexons->bypass_pointer[chromosome][ck_start].first;
-	  assert(list_item != NULL);
-	  metaexon = (metaexon_t *)list_item->item;
-	  if (metaexon_ref->start <= metaexon->start) {
-	    metaexons->bypass_pointer[chromosome][ck_start].first = list_item_ref;
-	  }
-
-	  list_item = metaexons->bypass_pointer[chromosome][ck_start].last;
-	  assert(list_item != NULL);
-	  metaexon = (metaexon_t *)list_item->item;
-	  if (metaexon_ref->end >= metaexon->end) {
-	    metaexons->bypass_pointer[chromosome][ck_start].last = list_item_ref;
-	  }
-	}
-      
-	if (ck_start != ck_end && metaexons->bypass_pointer[chromosome][ck_end].first) {
-	  loop_end--;
-	  //printf("\tStar end actualization %i\n", ck_end);
-	  list_item = metaexons->bypass_pointer[chromosome][ck_end].first;
-	  assert(list_item);
-	  metaexon = (metaexon_t *)list_item->item;
-
-	  if (metaexon_ref->start <= metaexon->start) {
-	    metaexons->bypass_pointer[chromosome][ck_end].first = list_item_ref;
-	  }
-
-	  list_item = metaexons->bypass_pointer[chromosome][ck_end].last;
-	  assert(list_item);
-	  metaexon = (metaexon_t *)list_item->item;
-	  //printf(" %lu >= %lu ??\n", metaexon_ref->start, metaexon->start);
-	  if (metaexon_ref->end >= metaexon->end) {
-	    metaexons->bypass_pointer[chromosome][ck_end].last = list_item_ref;
-	  }
-	}
-      
-	for (int ck2 = loop_start; ck2 <= loop_end; ck2++) {
-	  metaexons->bypass_pointer[chromosome][ck2].first = list_item_ref;
-	  metaexons->bypass_pointer[chromosome][ck2].last = list_item_ref;
-	}
-      
-	break;
-      }
-    }
-  
-    if (!list_item) {
-      //printf("List item not insert :( ...\n");
-      int ck_s = ck_start - 1;
-      int ck_e = ck_end + 1;
-      for (int i = 0; i < metaexons->num_chunks[chromosome]; i++) {
-	if (ck_s - i >= 0 &&
-	    metaexons->bypass_pointer[chromosome][ck_s - i].last ) {
-	  //printf("chunk 2: %i \n", ck_s - i);
-	  list_item = metaexons->bypass_pointer[chromosome][ck_s - i].last;
-	  list_item_ref = __metaexon_insert(metaexons->metaexons_list[chromosome],
-					    list_item, start, end,
-					    min_intron_size,
-					    delete_items);
-	  break;
-	}
-	if (ck_e + i < metaexons->num_chunks[chromosome] &&
-	    metaexons->bypass_pointer[chromosome][ck_e + i].first) {
-	  //printf("chunk 2: %i \n", ck_e + i);
-	  list_item = metaexons->bypass_pointer[chromosome][ck_e + i].first;
-	  list_item_ref = __metaexon_insert(metaexons->metaexons_list[chromosome],
-					    list_item, start, end,
-					    min_intron_size,
-					    delete_items);
-	  break;
-	}
-      }
-
-      if (!list_item) {
-	//printf("chunk 3: NO\n");
-	list_item_ref = __metaexon_insert(metaexons->metaexons_list[chromosome],
-					  list_item, start, end,
-					  min_intron_size,
-					  delete_items);
-      }
-
-      metaexon_ref = (metaexon_t *)list_item_ref->item;
-      //ck_start = metaexon_ref->start >> CHUNK_SHIFT;
-      //ck_end = metaexon_ref->end >> CHUNK_SHIFT;
-
-      for (int ck = ck_start; ck <= ck_end; ck++) {
-	metaexons->bypass_pointer[chromosome][ck].first = list_item_ref;
-	metaexons->bypass_pointer[chromosome][ck].last = list_item_ref;
-      }
-
-    }
-
-    if (info_break) {
-      metaexon_insert_break(info_break, type, metaexon_ref, db_type);
-    }
-
-    pthread_mutex_unlock(&metaexons->mutex[chromosome]);
-
-    for (int i = array_list_size(delete_items) - 1; i >= 0; i--) {
-      list_item = array_list_get(i, delete_items);
-      //metaexon = (metaexon_t *)list_item->item;
-      //metaexon_merge_breaks(metaexon, metaexon_ref);
-      
-      linked_list_item_free(list_item, (void *)metaexon_free);
-    }
-
-    array_list_free(delete_items, (void *)NULL);
-
-    /*
-    stop_timer(t_start, t_stop, time);
+//-----------------------------------------------------------------------------
 
-    pthread_mutex_lock(&(mutex_calls));
-    insert_calls++;
-    time_insert += time;
-    pthread_mutex_unlock(&(mutex_calls));
-    */
+void metaexons_print_stats(FILE *fd, metaexons_t *metaexons) {
+  size_t num_items = 0;
+  size_t search_calls = thread_stats_get(ST_METAEXON_SEARCHES);
+  size_t insert_calls = thread_stats_get(ST_METAEXON_INSERTS);
+  size_t read_waits = thread_stats_get(ST_METAEXON_READ_WAITS);
+  size_t write_waits = thread_stats_get(ST_METAEXON_WRITE_WAITS);
 
-    return db_type;
+  for (int i = 0; i < metaexons->num_chromosomes; i++) {
+    num_items += metaexons->index[i].num_items;
+  }
 
+  fprintf(fd, "\n= M E T A E X O N S    S T A T I S T I C S\n");
+  fprintf(fd, "--------------------------------------------------------------\n");
+  fprintf(fd, " Total metaexons                         :  %lu\n", num_items);
+  fprintf(fd, " Total searches                          :  %lu\n", search_calls);
+  fprintf(fd, " Total inserts                           :  %lu\n", insert_calls);
+  fprintf(fd, " Contended read locks                    :  %lu\n", read_waits);
+  fprintf(fd, " Contended write locks                   :  %lu (%.2f%%)\n", write_waits, 
+	  insert_calls ? (float)(write_waits * 100) / (float)insert_calls : 0.0f);
+  fprintf(fd, "--------------------------------------------------------------\n");
 }
@@ -1,6 +1,9 @@
 #ifndef BREAKPOINT_H
 #define BREAKPOINT_H
 
+#include <pthread.h>
+#include <stdint.h>
+
 #include "containers/array_list.h"
 #include "containers/linked_list.h"
 //#include "containers/skip_list.h"
@@ -9,6 +12,8 @@
 #include "bioformats/bam/alignment.h"
 #include "bioformats/fastq/fastq_read.h"
 
+#include "statistics.h"
+
 //--------------------------------------------------------------------------------------
 
 #define FIRST_SW  0
@@ -91,6 +96,120 @@ int cigar_code_validate_(fastq_read_t *fq_read, cigar_code_t *p);
 void cigar_code_update(cigar_code_t *p);
 
 
+//====================================================================================
+//  Packed CIGAR, BAM layout: op length << 4 | op code (MIDNSHP=X)
+//====================================================================================
+
+#define CIGAR_PACKED_INLINE_OPS 12
+#define CIGAR_PACKED_SHIFT       4
+#define CIGAR_PACKED_MASK      0xf
+
+extern const char CIGAR_PACKED_OP_NAMES[];
+
+//Ops are kept in the inline buffer until they do not fit, only long
+//spliced CIGARs pay a heap allocation (heap_ops, NULL while inline).
+//A struct copy shares heap_ops with its source, copies must go through
+//cigar_packed_copy.
+typedef struct cigar_packed {
+  int distance;
+  int num_ops;
+  int max_ops;
+  uint32_t *heap_ops;
+  uint32_t inline_ops[CIGAR_PACKED_INLINE_OPS];
+} cigar_packed_t;
+
+static inline void cigar_packed_init(cigar_packed_t *p) {
+  p->distance = 0;
+  p->num_ops = 0;
+  p->max_ops = CIGAR_PACKED_INLINE_OPS;
+  p->heap_ops = NULL;
+}
+
+static inline void cigar_packed_clean(cigar_packed_t *p) {
+  if (p->heap_ops) {
+    free(p->heap_ops);
+  }
+  cigar_packed_init(p);
+}
+
+static inline void cigar_packed_clear(cigar_packed_t *p) {
+  p->distance = 0;
+  p->num_ops = 0;
+}
+
+static inline uint32_t *cigar_packed_ops(cigar_packed_t *p) {
+  return p->heap_ops ? p->heap_ops : p->inline_ops;
+}
+
+static inline int cigar_packed_get_num_ops(cigar_packed_t *p) {
+  return p->num_ops;
+}
+
+static inline int cigar_packed_op_len(uint32_t op) {
+  return op >> CIGAR_PACKED_SHIFT;
+}
+
+static inline char cigar_packed_op_name(uint32_t op) {
+  return CIGAR_PACKED_OP_NAMES[op & CIGAR_PACKED_MASK];
+}
+
+//BAM code of an op name, -1 for anything but MIDNSHP=X
+static inline int cigar_packed_op_code(char name) {
+  switch (name) {
+  case 'M': return 0;
+  case 'I': return 1;
+  case 'D': return 2;
+  case 'N': return 3;
+  case 'S': return 4;
+  case 'H': return 5;
+  case 'P': return 6;
+  case '=': return 7;
+  case 'X': return 8;
+  default: return -1;
+  }
+}
+
+static inline void cigar_packed_get_op(int index, int *number, char *name, 
+				       cigar_packed_t *p) {
+  uint32_t op = cigar_packed_ops(p)[index];
+  *number = cigar_packed_op_len(op);
+  *name = cigar_packed_op_name(op);
+}
+
+cigar_packed_t *cigar_packed_new();
+void cigar_packed_free(cigar_packed_t *p);
+
+void cigar_packed_reserve(int num_ops, cigar_packed_t *p);
+void cigar_packed_copy(cigar_packed_t *dst, cigar_packed_t *src);
+
+//Both return 0, or -1 (and leave p as it was) for an unknown op name
+int cigar_packed_append_op(int number, char name, cigar_packed_t *p);
+int cigar_packed_insert_first_op(int number, char name, cigar_packed_t *p);
+void cigar_packed_concat(cigar_packed_t *src, cigar_packed_t *dst);
+
+int cigar_packed_read_coverage(cigar_packed_t *p);
+int cigar_packed_genome_coverage(cigar_packed_t *p);
+int cigar_packed_nt_length(cigar_packed_t *p);
+
+int cigar_packed_from_string(char *cigar_str, cigar_packed_t *p);
+int cigar_packed_to_string(cigar_packed_t *p, char *str, size_t max_len);
+
+//Raw BAM CIGAR, it is a copy of the ops
+void cigar_packed_to_bam(cigar_packed_t *p, uint32_t *bam_cigar);
+
+//Bridges while rna_server and sa_rna_mapper move from cigar_code_t
+void cigar_packed_from_cigar_code(cigar_code_t *cigar_code, cigar_packed_t *p);
+cigar_code_t *cigar_packed_to_cigar_code(cigar_packed_t *p);
+
+//generate_cigar_code into p (cleared first), without an allocation per op;
+//generate_cigar_code is this plus cigar_packed_to_cigar_code
+void generate_cigar_packed(char *query_map, char *ref_map, unsigned int map_len,
+			   unsigned int query_start, unsigned int ref_start,
+			   unsigned int query_len, unsigned int ref_len,
+			   int *distance, int ref_type, cigar_packed_t *p);
+
+//-----------------------------------------------------------------------------------
+
 //char *cigar_code_find_and_report_sj(size_t start_map, cigar_code_t *cigar_code, 
 //				    int chromosome, int strand, avls_list_t *avls_list,
 //				    metaexons_t *metaexons, genome_t *genome, fastq_read_t *read);
@@ -165,21 +284,20 @@ void metaexon_free(metaexon_t *metaexon);
 
 //--------------------------------------------------------------------------------------
 
-typedef struct metaexon_pair {
-  linked_list_item_t *first;
-  linked_list_item_t *last;  
-} metaexon_pair_t;
+//Sorted, disjoint metaexons of one chromosome. Searches run concurrently
+//under the read lock, inserts take the write lock of their chromosome only.
+//Searches, inserts and lock waits are counted in the thread_stats slots,
+//not here, so the lock line is only written by the lock itself.
+typedef struct metaexon_index {
+  pthread_rwlock_t   lock;
+  size_t             num_items;
+  size_t             max_items;
+  metaexon_t         **items;
+} __attribute__((aligned(64))) metaexon_index_t;
 
 typedef struct metaexons {
-  //unsigned int       chunk_shift;
   unsigned int       num_chromosomes;
-  size_t             *num_chunks;
-  pthread_mutex_t    *mutex;
-  linked_list_t      **metaexons_list;  
-  //skip_list_t        **metaexons_list;  
-  metaexon_pair_t    **bypass_pointer;
-  
-  //linked_list_t      ***metaexons_x;  
+  metaexon_index_t   *index;
 } metaexons_t;
 
 
@@ -195,19 +313,29 @@ int metaexon_insert(unsigned int strand, unsigned int chromosome,
                      size_t metaexon_start, size_t metaexon_end, int min_intron_size,
                      unsigned char type, void *info_break, metaexons_t *metaexons);
 
-int metaexon_insert_2(unsigned int strand, unsigned int chromosome,
-		      size_t metaexon_start, size_t metaexon_end, int min_intron_size,
-		      unsigned char type, void *info_break, metaexons_t *metaexons);
-
 //Return if the position is between metaexon coords
 int metaexon_search(unsigned int strand, unsigned int chromosome,
 		    size_t start, size_t end, metaexon_t **metaexon_found,
 		    metaexons_t *metaexons);
 
+//As metaexon_search, for callers already holding the chromosome read lock:
+//taking it again would deadlock as soon as a writer is waiting
+int metaexon_search_unlocked(unsigned int strand, unsigned int chromosome,
+			     size_t start, size_t end, metaexon_t **metaexon_found,
+			     metaexons_t *metaexons);
+
 void metaexons_print(metaexons_t *metaexons);
 
 void metaexons_print_chr(metaexons_t *metaexons, int chr);
 
+void metaexons_print_stats(FILE *fd, metaexons_t *metaexons);
+
+//Hold the chromosome read lock while using the breaks of a metaexon
+//returned by metaexon_search, inserts can not modify them meanwhile
+void metaexons_read_lock(unsigned int chromosome, metaexons_t *metaexons);
+
+void metaexons_read_unlock(unsigned int chromosome, metaexons_t *metaexons);
+
 //--------------------------------------------------------------------------------------
 //--------------------------------------------------------------------------------------
 
@@ -364,7 +364,6 @@ int apply_bwt_rna(bwt_server_input_t* input, batch_t *batch) {
   size_t num_anchors;
 
   extern pthread_mutex_t mutex_sp;
-  extern st_bwt_t st_bwt;
   //pthread_mutex_lock(&mutex_sp);
   //extern size_t total_reads;
   //total_reads += num_reads;
@@ -407,9 +406,7 @@ int apply_bwt_rna(bwt_server_input_t* input, batch_t *batch) {
 	//Read Map, Metaexon Actualization
 	array_list_set_flag(ALIGNMENTS_FOUND, list);
 
-	pthread_mutex_lock(&mutex_sp);
-	st_bwt.map_bwt++;
-	pthread_mutex_unlock(&mutex_sp);
+	thread_stats_inc(ST_MAP_BWT);
 
 	for (int i = 0; i < num_mappings; i++) {
 	  alignment_t *alignment = array_list_get(i, list);
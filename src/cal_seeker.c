@@ -128,7 +128,7 @@ void fill_gaps(mapping_batch_t *mapping_batch, sw_optarg_t *sw_optarg,
 	  size_t len = end - start + 1;
 	  //	  printf(":::::::::: %lu - %lu = %i ::::::::::::\n", end, start, len );
 	  char *ref = (char *) malloc((len + 1) * sizeof(char));
-	  genome_read_sequence_by_chr_index(ref, 0, cal->chromosome_id - 1, 
+	  reference_read_sequence(ref, 0, cal->chromosome_id - 1, 
 					    &start, &end, genome);
 	  ref[len] = '\0';
 	  //
@@ -225,7 +225,7 @@ void fill_gaps(mapping_batch_t *mapping_batch, sw_optarg_t *sw_optarg,
 	      first = -1;
 	      last = -1;
 	      ref = (char *) malloc((gap_genome_len + 5) * sizeof(char));
-	      genome_read_sequence_by_chr_index(ref, 0, cal->chromosome_id - 1, 
+	      reference_read_sequence(ref, 0, cal->chromosome_id - 1, 
 						&start, &end, genome);
 	      // handle strand -
 	      if (cal->strand) {
@@ -277,7 +277,7 @@ void fill_gaps(mapping_batch_t *mapping_batch, sw_optarg_t *sw_optarg,
 	      size_t genome_end = gap_genome_end + right_flank;// + 1;
 	      int gap_genome_len_ex = genome_end - genome_start + 1;
 	      ref = (char *) malloc((gap_genome_len_ex + 1) * sizeof(char));;
-	      genome_read_sequence_by_chr_index(ref, 0, cal->chromosome_id - 1, 
+	      reference_read_sequence(ref, 0, cal->chromosome_id - 1, 
 						&genome_start, &genome_end, genome);	      
 	      ref[gap_genome_len_ex] = '\0';
 
@@ -362,7 +362,7 @@ void fill_gaps(mapping_batch_t *mapping_batch, sw_optarg_t *sw_optarg,
 	  first = -1;
 	  last = -1;
 	  ref = (char *) malloc((gap_genome_len + 1) * sizeof(char));;
-	  genome_read_sequence_by_chr_index(ref, 0, cal->chromosome_id - 1, 
+	  reference_read_sequence(ref, 0, cal->chromosome_id - 1, 
 					    &start, &end, genome);
 	  // handle strand -
 	  if (cal->strand) {
@@ -415,7 +415,7 @@ void fill_gaps(mapping_batch_t *mapping_batch, sw_optarg_t *sw_optarg,
 	    size_t genome_end = gap_genome_end + right_flank;// + 1;
 	    int gap_genome_len_ex = genome_end - genome_start + 1;
 	    ref = (char *) malloc((gap_genome_len_ex + 1) * sizeof(char));;
-	    genome_read_sequence_by_chr_index(ref, 0, cal->chromosome_id - 1, 
+	    reference_read_sequence(ref, 0, cal->chromosome_id - 1, 
 					      &genome_start, &genome_end, genome);
 	    query[gap_genome_len_ex] = '\0';
 
@@ -685,7 +685,7 @@ void fill_end_gaps(mapping_batch_t *mapping_batch, sw_optarg_t *sw_optarg,
 	end = gap_genome_end;// + 1;
 	gap_genome_len = end - start + 1;
 	ref = (char *) malloc((gap_genome_len + 1) * sizeof(char));
-	genome_read_sequence_by_chr_index(ref, 0, cal->chromosome_id - 1, 
+	reference_read_sequence(ref, 0, cal->chromosome_id - 1, 
 					  &start, &end, genome);
 	ref[gap_genome_len] = '\0';
 	
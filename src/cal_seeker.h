@@ -3,6 +3,7 @@
 
 #include "buffers.h"
 #include "aligners/bwt/bwt.h"
+#include "reference_genome.h"
 #include "pair_server.h"
 
 #define MAX_CALS 200
@@ -6,15 +6,6 @@ extern int num_dup_reads;
 extern int num_total_dup_reads;
 #endif
 
-extern size_t num_mapped_reads;
-extern size_t num_unmapped_reads;
-extern size_t num_multihit_reads;
-extern size_t num_total_mappings;
-extern size_t num_unmapped_reads_by_invalid_cal;
-extern size_t num_unmapped_reads_by_cigar_length;
-
-#define UNMAPPED_BAM "unmapped.bam"
-
 //--------------------------------------------------------------------
 // main 
 //--------------------------------------------------------------------
@@ -24,20 +15,65 @@ sa_genome3_t *global_genome = NULL;
 
 #include "adapter.h"
 
-int bam_sort_core(int is_by_qname, const char *fn, const char *prefix, size_t max_mem);
+
+sa_index3_t *dna_aligner_load_index(char *sa_dirname) {
+	struct timeval stop, start;
+	printf("\n");
+	printf("-----------------------------------------------------------------\n");
+	printf("Loading SA tables...\n");
+	gettimeofday(&start, NULL);
+	sa_index3_t *sa_index = sa_index3_new(sa_dirname);
+	gettimeofday(&stop, NULL);
+	printf("End of loading SA tables in %0.2f min. Done!!\n",
+			((stop.tv_sec - start.tv_sec) + (stop.tv_usec - start.tv_usec) / 1000000.0f) / 60.0f);
+
+	return sa_index;
+}
+
+//--------------------------------------------------------------------
+
+static void dna_aligner_display_stats(struct timeval *start, struct timeval *stop,
+				      char *out_filename, stats_t *stats) {
+	printf("End of mapping in %0.2f min. Done!!\n",
+			((stop->tv_sec - start->tv_sec) + (stop->tv_usec - start->tv_usec) / 1000000.0f)/60.0f);
+	printf("-----------------------------------------------------------------\n");
+	printf("Output file : %s\n", out_filename);
+	printf("\n");
+	size_t num_mapped_reads = thread_stats_get(ST_MAPPED_READS);
+	size_t num_unmapped_reads = thread_stats_get(ST_UNMAPPED_READS);
+	printf("Num. reads : %lu\nNum. mapped reads : %lu (%0.2f %%)\nNum. unmapped reads: %lu (%0.2f %%)\n",
+			num_mapped_reads + num_unmapped_reads,
+			num_mapped_reads, 100.0f * num_mapped_reads / (num_mapped_reads + num_unmapped_reads),
+			num_unmapped_reads, 100.0f * num_unmapped_reads / (num_mapped_reads + num_unmapped_reads));
+	printf("\n");
+	printf("Num. mappings : %lu\n", thread_stats_get(ST_TOTAL_MAPPINGS));
+	printf("Num. multihit reads: %lu\n", thread_stats_get(ST_MULTIHIT_READS));
+	thread_stats_display_mappings(stdout);
+	printf("-----------------------------------------------------------------\n");
+
+	if (stats) {
+		printf("Num. mappings not processed:\n");
+		printf("\tBy secondary mappings: %d \n", stats->secondary_reads);
+		printf("\tBy unpaired mappings : %d \n", stats->alone_reads);
+		printf("-----------------------------------------------------------------\n");
+	}
+}
+
+//--------------------------------------------------------------------
 
 void dna_aligner(options_t *options) {
+	sa_index3_t *sa_index = dna_aligner_load_index(options->bwt_dirname);
+	dna_aligner_run(options, sa_index);
+	sa_index3_free(sa_index);
+}
+
+//--------------------------------------------------------------------
+
+void dna_aligner_run(options_t *options, sa_index3_t *sa_index) {
 	for (int i = 0; i < NUM_COUNTERS; i++) {
 		counters[i] = 0;
 	}
 
-	#ifdef _TIMING
-	init_func_names();
-	for (int i = 0; i < NUM_TIMING; i++) {
-		func_times[i] = 0;
-	}
-	#endif
-
 	// set input parameters
 	char *sa_dirname = options->bwt_dirname;
 
@@ -71,33 +107,10 @@ void dna_aligner(options_t *options) {
 
 	// display options
 	display_options(options, NULL);
+	metrics_set_output(out_filename);
 
-	// load SA index
 	struct timeval stop, start;
-	printf("\n");
-	printf("-----------------------------------------------------------------\n");
-	printf("Loading SA tables...\n");
-	gettimeofday(&start, NULL);
-	sa_index3_t *sa_index = sa_index3_new(sa_dirname);
 	global_genome = sa_index->genome;
-	gettimeofday(&stop, NULL);
-	printf("End of loading SA tables in %0.2f min. Done!!\n",
-			((stop.tv_sec - start.tv_sec) + (stop.tv_usec - start.tv_usec) / 1000000.0f) / 60.0f);
-
-	// preparing input FastQ file
-	fastq_batch_reader_input_t reader_input;
-
-	// preparing output BAM file
-	batch_writer_input_t writer_input;
-	batch_writer_input_init(out_filename, NULL, NULL, NULL, NULL, &writer_input);
-	if (bam_format) {
-		bam_header_t *bam_header = create_bam_header(options, sa_index->genome);
-		writer_input.bam_file = bam_fopen_mode(out_filename, bam_header, "w");
-		bam_fwrite_header(bam_header, writer_input.bam_file);
-	} else {
-		writer_input.bam_file = (bam_file_t *) fopen(out_filename, "w");
-		write_sam_header(options, sa_index->genome, (FILE *) writer_input.bam_file);
-	}
 
 	char *fq_list1 = options->in_filename, *fq_list2 = options->in_filename2;
 	char token[2] = ",";
@@ -134,97 +147,145 @@ void dna_aligner(options_t *options) {
 		LOG_FATAL("Diferent number of files in paired-end/mate-pair mode");
 	}
 
-	char *file1, *file2;
-	for (int f = 0; f < num_files1; f++) {
-		file1 = array_list_get(f, files_fq1);
+	// FastQ input: the files (or pairs of files) are opened now, with
+	// their read groups for the headers
+	sa_fq_sources_t *sources = NULL;
+	if (options->input_format != BAM_FORMAT && options->input_format != SAM_FORMAT) {
+		sources = sa_fq_sources_new(files_fq1, files_fq2, options);
+	}
+
+	// preparing output BAM file
+	batch_writer_input_t writer_input;
+	batch_writer_input_init(out_filename, NULL, NULL, NULL, NULL, &writer_input);
+	if (bam_format) {
+		int sort = (options->realignment || options->recalibration);
+		bam_header_t *bam_header = create_bam_header(options, sa_index->genome,
+							     sort ? "coordinate" : "unsorted");
+		if (sort) {
+			// post-processing needs a sorted BAM, sort while writing
+			writer_input.bam_file = NULL;
+			sa_bam_sorter = bam_sorter_new(bam_header, out_filename, BAM_SORTER_BY_COORD,
+					       BAM_SORTER_DEFAULT_MEM, options->num_cpu_threads);
+		} else {
+			writer_input.bam_file = bam_fopen_mode(out_filename, bam_header, "w");
+			bam_fwrite_header(bam_header, writer_input.bam_file);
+		}
+	} else {
+		writer_input.bam_file = (bam_file_t *) fopen(out_filename, "w");
+		write_sam_header(options, sa_index->genome, (FILE *) writer_input.bam_file);
+	}
+
+	extern size_t fd_read_bytes, fd_total_bytes;
+	struct stat st;
+
+	workflow_stage_function_t stage_functions[1];
+	char *stage_labels[1] = {"SA mapper"};
+	if (options->pair_mode == SINGLE_END_MODE) {
+		stage_functions[0] = sa_single_mapper;
+	} else {
+		stage_functions[0] = sa_pair_mapper;
+	}
+
+	if (sources) {
+		//--------------------------------------------------------------------------------------
+		// all the FastQ files in a single workflow, the reader takes their batches in turn
+		//
+		fd_read_bytes = 0;
+		fd_total_bytes = 0;
+		if (!options->gzip) {
+			for (int f = 0; f < num_files1; f++) {
+				if (stat(array_list_get(f, files_fq1), &st) == 0) fd_total_bytes += st.st_size;
+				if (num_files2 && stat(array_list_get(f, files_fq2), &st) == 0) fd_total_bytes += st.st_size;
+			}
+		}
+
+		sa_wf_batch_t *wf_batch = sa_wf_batch_new(options, (void *)sa_index, &writer_input, NULL, NULL);
+		sa_wf_input_t *wf_input = sa_wf_input_new(bam_format, &sources->readers[0], wf_batch);
+		wf_input->data = sources;
 
-		if (num_files2) {
-			file2 = array_list_get(f, files_fq2);
+		workflow_t *wf = workflow_new();
+		workflow_set_stages(1, stage_functions, stage_labels, wf);
+		workflow_set_producer(sa_fq_multi_reader, "FastQ reader", wf);
+		if (bam_format) {
+			workflow_set_consumer((workflow_consumer_function_t *)sa_bam_writer, "BAM writer", wf);
 		} else {
-			file2 = NULL;
+			workflow_set_consumer((workflow_consumer_function_t *)sa_sam_writer, "SAM writer", wf);
 		}
 
-		fastq_batch_reader_input_init(file1, file2,
+		printf("-----------------------------------------------------------------\n");
+		printf("Starting mapping...\n");
+		gettimeofday(&start, NULL);
+		metrics_set_workflow("mapping", 1, stage_labels, wf);
+		workflow_run_with(num_threads, wf_input, wf);
+		metrics_set_workflow(NULL, 0, NULL, NULL);
+		gettimeofday(&stop, NULL);
+
+		sa_fq_sources_free(sources);
+
+		dna_aligner_display_stats(&start, &stop, out_filename, NULL);
+
+		// free memory
+		sa_wf_input_free(wf_input);
+		sa_wf_batch_free(wf_batch);
+		workflow_free(wf);
+		//
+		// end of workflow management
+		//--------------------------------------------------------------------------------------
+	}
+
+	// BAM input: a workflow per file, the mates are paired while reading
+	char *file1;
+	fastq_batch_reader_input_t reader_input;
+	for (int f = 0; !sources && f < num_files1; f++) {
+		file1 = array_list_get(f, files_fq1);
+
+		fastq_batch_reader_input_init(file1, NULL,
 				options->pair_mode,
 				batch_size,
 				NULL, options->gzip,
 				&reader_input);
 
-		if (options->input_format == BAM_FORMAT) {
-			// BAM input files
-			reader_input.fq_file1 = (fastq_file_t*) bam_fopen(file1);
-			if (options->input_format == BAM_FORMAT) {
-				if (is_pair(file1)) {
-					options->pair_mode = PAIRED_END_MODE;
-				} else {
-					options->pair_mode = SINGLE_END_MODE;
-				}
-			}
-		}else {
-			if (options->pair_mode == SINGLE_END_MODE) {
-				if (options->gzip) {
-					reader_input.fq_gzip_file1 = fastq_gzopen(file1);
-				} else {
-					reader_input.fq_file1 = fastq_fopen(file1);
-				}
-			} else {
-				if (options->gzip) {
-					reader_input.fq_gzip_file1 = fastq_gzopen(file1);
-					reader_input.fq_gzip_file2 = fastq_gzopen(file2);
-				} else {
-					reader_input.fq_file1 = fastq_fopen(file1);
-					reader_input.fq_file2 = fastq_fopen(file2);
-				}
-			}
+		if (options->input_format == SAM_FORMAT) {
+			printf ("Sam format not implementated");
+			continue;
 		}
 
+		bam_file_t *bam_file = bam_fopen(file1);
+		reader_input.fq_file1 = (fastq_file_t *) bam_file;
+		if (is_pair(file1)) {
+			options->pair_mode = PAIRED_END_MODE;
+			stage_functions[0] = sa_pair_mapper;
+		} else {
+			options->pair_mode = SINGLE_END_MODE;
+			stage_functions[0] = sa_single_mapper;
+		}
 
-		bam_file_t *fnomapped = NULL;
+		fd_read_bytes = 0;
+		fd_total_bytes = 0;
 		stats_t *stats = sa_stats_new(0,0,0);
-		khash_t(ID) *h = kh_init(ID);
-		if (options->input_format == BAM_FORMAT) {
-			if (options->pair_mode == PAIRED_END_MODE){
-				bam_header_t *bam_header = create_bam_header(options, sa_index->genome);
-				fnomapped = bam_fopen_mode(UNMAPPED_BAM, bam_header, "w");
-				bam_fwrite_header(bam_header, fnomapped);//write the header in fnomapped
-			}
-		}
 
 		//--------------------------------------------------------------------------------------
 		// workflow management
 		//
 		sa_wf_batch_t *wf_batch = sa_wf_batch_new(options, (void *)sa_index, &writer_input, NULL, NULL);
 		sa_wf_input_t *wf_input = sa_wf_input_new(bam_format, &reader_input, wf_batch);
-
+		wf_input->stats = stats;
 
 		// create and initialize workflow
 		workflow_t *wf = workflow_new();
 
-		workflow_stage_function_t stage_functions[1];
-		char *stage_labels[1] = {"SA mapper"};
-		if (options->pair_mode == SINGLE_END_MODE) {
-			stage_functions[0] = sa_single_mapper;
-		} else {
-			stage_functions[0] = sa_pair_mapper;
-		}
 		workflow_set_stages(1, stage_functions, stage_labels, wf);
 
 		// optional producer and consumer functions
-		if (options->input_format == BAM_FORMAT) {
-			wf_input->idx = NULL;
-			wf_input->hash = h;
-			wf_input->stats = stats;
-			wf_input->data = fnomapped;
-			if (options->pair_mode == PAIRED_END_MODE) {
-				workflow_set_producer(&sa_bam_reader_pairendV3, "BAM reader", wf);
-			} else {
-				workflow_set_producer(&sa_bam_reader_single, "BAM reader", wf);
-			}
-		} else if (options->input_format == SAM_FORMAT) {
-			printf ("Sam format not implementated");
-			// workflow_set_producer(sa_sam_reader, "SAM reader", wf);
+		sa_bam_mates_t *mates = NULL;
+		if (options->pair_mode == PAIRED_END_MODE) {
+			char spill_prefix[strlen(out_filename) + 16];
+			sprintf(spill_prefix, "%s.mates", out_filename);
+			mates = sa_bam_mates_new(bam_file, spill_prefix, stats);
+			wf_input->data = mates;
+			workflow_set_producer(sa_bam_mates_reader, "BAM reader", wf);
 		} else {
-			workflow_set_producer(sa_fq_reader, "FastQ reader", wf);
+			workflow_set_producer(sa_bam_reader_single, "BAM reader", wf);
 		}
 
 		if (bam_format) {
@@ -236,130 +297,26 @@ void dna_aligner(options_t *options) {
 		printf("-----------------------------------------------------------------\n");
 		printf("Starting mapping...\n");
 		gettimeofday(&start, NULL);
+		metrics_set_workflow("mapping", 1, stage_labels, wf);
 		workflow_run_with(num_threads, wf_input, wf);
+		metrics_set_workflow(NULL, 0, NULL, NULL);
 		gettimeofday(&stop, NULL);
 
-		#ifdef _TIMING
-		char func_name[1024];
-		double total_func_times = 0;
-		for (int i = 0; i < NUM_TIMING; i++) {
-			if (i != FUNC_SEARCH_PREFIX && i != FUNC_SEARCH_SA
-					&& i < FUNC_INIT_CALS_FROM_SUFFIXES || i > FUNC_CAL_MNG_INSERT) {
-				total_func_times += func_times[i];
-			}
-		}
-		printf("Timing in seconds:\n");
-		for (int i = 0; i < NUM_TIMING; i++) {
-			if (i == FUNC_SEARCH_PREFIX || i == FUNC_SEARCH_SA ||
-					(i >= FUNC_INIT_CALS_FROM_SUFFIXES && i <= FUNC_CAL_MNG_INSERT)) {
-				printf("\t");
+		if (mates) {
+			if (mates->num_spilled) {
+				printf("Mates paired through temporary files: %lu\n", mates->num_spilled);
 			}
-			printf("\t%0.2f %%\t%0.4f\tof %0.4f\t%s\n",
-					100.0 * func_times[i] / total_func_times, func_times[i], total_func_times, func_names[i]);
+			sa_bam_mates_free(mates);
 		}
-		#endif
-
+		bam_fclose(bam_file);
 
-
-		if ((options->input_format == BAM_FORMAT) ||
-				(options->input_format == SAM_FORMAT)) {
-			// close the unmapped file
-			bam_fclose(fnomapped);
-			bam_fclose((bam_file_t *)reader_input.fq_file1);
-
-
-			if (options->pair_mode == PAIRED_END_MODE) {
-				// sort the bam
-				fnomapped = bam_fopen(UNMAPPED_BAM);
-
-				// free the previous wf_input
-				sa_wf_input_free(wf_input);
-				wf_input = sa_wf_input_new(bam_format, &reader_input, wf_batch);
-				wf_input->idx = NULL;
-				wf_input->data = fnomapped;
-				wf_input->stats = stats;
-
-				// free the previous workflow and create the new one
-				workflow_free(wf);
-				wf = workflow_new();
-				workflow_set_stages(1, stage_functions, stage_labels, wf);
-				workflow_set_producer(sa_bam_reader_unmapped, "BAM reader", wf);
-
-				if (bam_format) {
-					workflow_set_consumer((workflow_consumer_function_t *)sa_bam_writer, "BAM writer", wf);
-				} else {
-					workflow_set_consumer((workflow_consumer_function_t *)sa_sam_writer, "SAM writer", wf);
-				}
-
-				workflow_run_with(num_threads, wf_input, wf);
-				gettimeofday(&stop, NULL);
-
-				// close files and remove tmp files
-				bam_fclose(fnomapped);
-				remove(UNMAPPED_BAM);
-
-				//check the khash table
-				khiter_t k;
-				for (k = kh_begin(h); k != kh_end(h); ++k){
-
-					if (kh_exist(h, k)){
-						array_list_t *remaininglist = kh_val(h,k);
-						for (size_t s =0; s< array_list_size(remaininglist); s++){
-							bam1_t *bam1;
-							bam1= array_list_get(s,remaininglist);
-							printf("There are a conflict read, check the read %s \n", bam1_qname(bam1));
-							bam_destroy1(bam1);
-						}
-						free (remaininglist);
-					}
-				}
-				//free the table
-				kh_destroy(ID, h);
-			}
-		} else if (options->gzip) {
-			if (options->pair_mode == SINGLE_END_MODE) {
-				fastq_gzclose(reader_input.fq_gzip_file1);
-			} else {
-				fastq_gzclose(reader_input.fq_gzip_file1);
-				fastq_gzclose(reader_input.fq_gzip_file2);
-			}
-		} else {
-			if (options->pair_mode == SINGLE_END_MODE) {
-				fastq_fclose(reader_input.fq_file1);
-			} else {
-				fastq_fclose(reader_input.fq_file1);
-				fastq_fclose(reader_input.fq_file2);
-			}
-		}
-
-		// display stats
-		printf("End of mapping in %0.2f min. Done!!\n",
-				((stop.tv_sec - start.tv_sec) + (stop.tv_usec - start.tv_usec) / 1000000.0f)/60.0f);
-		printf("-----------------------------------------------------------------\n");
-		printf("Output file : %s\n", out_filename);
-		printf("\n");
-		printf("Num. reads : %lu\nNum. mapped reads : %lu (%0.2f %%)\nNum. unmapped reads: %lu (%0.2f %%)\n",
-				num_mapped_reads + num_unmapped_reads,
-				num_mapped_reads, 100.0f * num_mapped_reads / (num_mapped_reads + num_unmapped_reads),
-				num_unmapped_reads, 100.0f * num_unmapped_reads / (num_mapped_reads + num_unmapped_reads));
-		printf("\n");
-		printf("Num. mappings : %lu\n", num_total_mappings);
-		printf("Num. multihit reads: %lu\n", num_multihit_reads);
-		printf("-----------------------------------------------------------------\n");
-
-		if ((options->input_format == BAM_FORMAT) ||
-				(options->input_format == SAM_FORMAT)) {
-			printf("Num. mappings not processed:\n");
-			printf("\tBy secondary mappings: %d \n", stats->secondary_reads);
-			printf("\tBy unpaired mappings : %d \n", stats->alone_reads);
-			printf("-----------------------------------------------------------------\n");
-		}
+		dna_aligner_display_stats(&start, &stop, out_filename, stats);
 
 		// free memory
 		sa_wf_input_free(wf_input);
 		sa_wf_batch_free(wf_batch);
 		workflow_free(wf);
-		if (stats) sa_stats_free(stats);
+		sa_stats_free(stats);
 
 		//
 		// end of workflow management
@@ -369,10 +326,17 @@ void dna_aligner(options_t *options) {
 	// free memory
 	array_list_free(files_fq1, (void *) free);
 	array_list_free(files_fq2, (void *) free);
-	if (sa_index) sa_index3_free(sa_index);
 
 	//closing files
-	if (bam_format) {
+	if (sa_bam_sorter) {
+		printf("-----------------------------------------------------------------\n");
+		printf("Sorting mappings...\n");
+		metrics_set_workflow("sorting", 0, NULL, NULL);
+		bam_sorter_finish(out_filename, sa_bam_sorter);
+		bam_sorter_free(sa_bam_sorter);
+		sa_bam_sorter = NULL;
+		printf("Done!\n");
+	} else if (bam_format) {
 		bam_fclose(writer_input.bam_file);
 	} else {
 		fclose((FILE *) writer_input.bam_file);
@@ -390,29 +354,15 @@ void dna_aligner(options_t *options) {
 		}
 		#endif
 	}
-	char *aux = out_filename;
 	char realig_filename[len], recal_filename[len];
-	if (options->realignment) {
-		// first, sort
-		printf("-----------------------------------------------------------------\n");
-		printf("Sorting before re-aligning...\n");
-		char sorted_filename[len];
-		sorted_filename[0] = 0;
-		strcat(sorted_filename, (options->output_name ? options->output_name : "."));
-		strcat(sorted_filename, "/");
-		if (options->prefix_name) {
-			strcat(sorted_filename, options->prefix_name);
-			strcat(sorted_filename, "_");
-		}
-		strcat(sorted_filename, "sorted_");
-		strcat(sorted_filename, OUTPUT_FILENAME);
+	char ref_filename[strlen(sa_dirname) + 100];
+	ref_filename[0] = 0;
+	strcpy(ref_filename, sa_dirname);
+	strcat(ref_filename, "/dna_compression.bin");
 
-		// run sort
-		bam_sort_core(0, out_filename, sorted_filename, 500000000);
-		printf("Done!\n");
-
-		// and then, re-align
-		strcat(sorted_filename, ".bam");
+	// the mapping output is already sorted, realignment and recalibration
+	// data collection share a single pass when both are requested
+	if (options->realignment) {
 		printf("-----------------------------------------------------------------\n");
 		printf("Realigning...\n");
 		realig_filename[0] = 0;
@@ -425,19 +375,6 @@ void dna_aligner(options_t *options) {
 		strcat(realig_filename, "realigned_");
 		strcat(realig_filename, OUTPUT_FILENAME);
 		strcat(realig_filename, ".bam");
-
-		char ref_filename[strlen(sa_dirname) + 100];
-		ref_filename[0] = 0;
-		strcpy(ref_filename, sa_dirname);
-		strcat(ref_filename, "/dna_compression.bin");
-
-		printf("sorted_filename = %s\n", sorted_filename);
-		printf("ref_filename = %s\n", ref_filename);
-		printf("realig_filename = %s\n", realig_filename);
-
-		alig_bam_file(sorted_filename, ref_filename, realig_filename, NULL);
-		aux = realig_filename;
-		printf("Realigned file     : %s\n", realig_filename);
 	}
 
 	if (options->recalibration) {
@@ -457,13 +394,21 @@ void dna_aligner(options_t *options) {
 			strcat(recal_filename, OUTPUT_FILENAME);
 			strcat(recal_filename, ".bam");
 		}
+	}
 
-		char ref_filename[strlen(sa_dirname) + 100];
-		ref_filename[0] = 0;
-		strcpy(ref_filename, sa_dirname);
-		strcat(ref_filename, "/dna_compression.bin");
+	if (options->realignment || options->recalibration) {
+		metrics_set_workflow("post-processing", 0, NULL, NULL);
+	}
 
-		recal_bam_file(RECALIBRATE_COLLECT | RECALIBRATE_RECALIBRATE, aux, ref_filename,
+	if (options->realignment && options->recalibration) {
+		printf("Recalibrating...\n");
+		alig_recal_bam_file(out_filename, ref_filename, NULL, NULL, recal_filename, 500, NULL);
+		printf("Recalibrated file  : %s\n", recal_filename);
+	} else if (options->realignment) {
+		alig_bam_file(out_filename, ref_filename, realig_filename, NULL);
+		printf("Realigned file     : %s\n", realig_filename);
+	} else if (options->recalibration) {
+		recal_bam_file(RECALIBRATE_COLLECT | RECALIBRATE_RECALIBRATE, out_filename, ref_filename,
 				NULL, NULL, recal_filename, 500, NULL);
 		printf("Recalibrated file  : %s\n", recal_filename);
 	}
@@ -3,6 +3,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/stat.h>
 
 #include "htslib/hts.h"
 
@@ -11,6 +12,7 @@
 
 #include "options.h"
 #include "batch_writer.h"
+#include "metrics.h"
 
 #include "tools/bam/bfwork/bam_file_ops.h"
 
@@ -20,6 +22,7 @@
 #include "dna/sa_dna_commons.h"
 #include "dna/doscadfun.h"
 #include "dna/sa_io_stages.h"
+#include "dna/sa_bam_mates.h"
 #include "dna/sa_mapper_stage.h"
 
 
@@ -27,6 +30,10 @@
 
 void dna_aligner(options_t *options);
 
+// the SA index is loaded once for every run by the aligner server
+sa_index3_t *dna_aligner_load_index(char *sa_dirname);
+void dna_aligner_run(options_t *options, sa_index3_t *sa_index);
+
 //--------------------------------------------------------------------
 //--------------------------------------------------------------------
 #endif // DNA_ALIGNER_H
@@ -0,0 +1,348 @@
+#include "sa_bam_mates.h"
+
+#include "aux/aux_nt_simd.h"
+
+//--------------------------------------------------------------------
+
+fastq_read_t *sa_bam_to_fastq(bam1_t *bam1, sa_bam_buffers_t *buffers) {
+	int len = bam1->core.l_qseq;
+
+	if (len + 1 > buffers->length) {
+		buffers->length = 2 * (len + 1);
+		buffers->sequence = (char *) realloc(buffers->sequence, buffers->length);
+		buffers->quality = (char *) realloc(buffers->quality, buffers->length);
+	}
+
+	uint8_t *seq = bam1_seq(bam1);
+	uint8_t *qual = bam1_qual(bam1);
+	char *sequence = buffers->sequence;
+	char *quality = buffers->quality;
+
+	// 4-bit bases, anything but ACGT is an N for the mapper
+	simd_bam_unpack(seq, len, sequence);
+
+	// reads mapped on the reverse strand are stored reverse-complemented,
+	// back to the strand they were sequenced in
+	if (bam1->core.flag & BAM_FREVERSE) {
+		simd_nt_revcomp_inplace(sequence, len);
+		for (int i = 0, j = len - 1; i < len; i++, j--) {
+			quality[j] = qual[i] + 33;
+		}
+	} else {
+		for (int i = 0; i < len; i++) {
+			quality[i] = qual[i] + 33;
+		}
+	}
+	sequence[len] = 0;
+	quality[len] = 0;
+
+	return fastq_read_new(bam1_qname(bam1), sequence, quality);
+}
+
+//--------------------------------------------------------------------
+
+static int sa_bam_sort_order(bam_header_t *header) {
+	if (!header || !header->text || strncmp(header->text, "@HD", 3)) {
+		return SA_BAM_UNSORTED;
+	}
+
+	char *end = strchr(header->text, '\n');
+	int len = (end ? end - header->text : strlen(header->text));
+	char hd[len + 1];
+	memcpy(hd, header->text, len);
+	hd[len] = 0;
+
+	if (strstr(hd, "\tSO:queryname") || strstr(hd, "\tGO:query")) {
+		return SA_BAM_QUERYNAME;
+	} else if (strstr(hd, "\tSO:coordinate")) {
+		return SA_BAM_COORDINATE;
+	}
+	return SA_BAM_UNSORTED;
+}
+
+//--------------------------------------------------------------------
+
+sa_bam_mates_t *sa_bam_mates_new(bam_file_t *bam_file, char *spill_prefix, stats_t *stats) {
+	sa_bam_mates_t *p = (sa_bam_mates_t *) calloc(1, sizeof(sa_bam_mates_t));
+
+	p->bam_file = bam_file;
+	p->sort_order = sa_bam_sort_order(bam_file->bam_header_p);
+	p->stats = stats;
+	p->pending = kh_init(mates);
+	p->spill_prefix = strdup(spill_prefix);
+
+	return p;
+}
+
+//--------------------------------------------------------------------
+
+static void sa_bam_mates_drop_pending(sa_bam_mates_t *p) {
+	sa_bam_mate_t *mate, *next;
+	for (mate = p->head; mate; mate = next) {
+		next = mate->next;
+		bam_destroy1(mate->bam1);
+		free(mate);
+	}
+	p->stats->alone_reads += p->num_pending;
+
+	kh_clear(mates, p->pending);
+	p->head = NULL;
+	p->tail = NULL;
+	p->num_pending = 0;
+}
+
+//--------------------------------------------------------------------
+
+static inline char *sa_bam_mates_bucket_name(int bucket, sa_bam_mates_t *p) {
+	char *name = (char *) malloc(strlen(p->spill_prefix) + 32);
+	sprintf(name, "%s.%i.bam", p->spill_prefix, bucket);
+	return name;
+}
+
+//--------------------------------------------------------------------
+
+void sa_bam_mates_free(sa_bam_mates_t *p) {
+	if (p) {
+		sa_bam_mates_drop_pending(p);
+		kh_destroy(mates, p->pending);
+
+		// buckets left by an interrupted run
+		for (int b = 0; b < SA_BAM_MATES_BUCKETS; b++) {
+			if (p->buckets[b]) bam_close(p->buckets[b]);
+		}
+		if (p->bucket_fd) bam_close(p->bucket_fd);
+		if (p->num_spilled) {
+			for (int b = p->curr_bucket; b < SA_BAM_MATES_BUCKETS; b++) {
+				char *name = sa_bam_mates_bucket_name(b, p);
+				remove(name);
+				free(name);
+			}
+		}
+
+		free(p->spill_prefix);
+		if (p->buffers.sequence) free(p->buffers.sequence);
+		if (p->buffers.quality) free(p->buffers.quality);
+		free(p);
+	}
+}
+
+//--------------------------------------------------------------------
+// pending list
+//--------------------------------------------------------------------
+
+static inline void sa_bam_mates_unlink(sa_bam_mate_t *mate, sa_bam_mates_t *p) {
+	if (mate->prev) mate->prev->next = mate->next; else p->head = mate->next;
+	if (mate->next) mate->next->prev = mate->prev; else p->tail = mate->prev;
+	p->num_pending--;
+}
+
+//--------------------------------------------------------------------
+
+static void sa_bam_mates_spill_record(bam1_t *bam1, sa_bam_mates_t *p) {
+	if (!p->num_spilled) {
+		for (int b = 0; b < SA_BAM_MATES_BUCKETS; b++) {
+			char *name = sa_bam_mates_bucket_name(b, p);
+			// temporary, uncompressed
+			if ((p->buckets[b] = bam_open(name, "wu")) == NULL) {
+				LOG_FATAL_F("Could not create the temporary file %s\n", name);
+			}
+			free(name);
+		}
+	}
+
+	int bucket = kh_str_hash_func(bam1_qname(bam1)) % SA_BAM_MATES_BUCKETS;
+	if (bam_write1(p->buckets[bucket], bam1) < 0) {
+		LOG_FATAL("Could not write a temporary BAM record, disk full?\n");
+	}
+	p->num_spilled++;
+}
+
+//--------------------------------------------------------------------
+
+// the oldest pending records to the buckets
+static void sa_bam_mates_spill(size_t num_records, sa_bam_mates_t *p) {
+	sa_bam_mate_t *mate;
+	khiter_t k;
+
+	while (num_records-- && (mate = p->head)) {
+		k = kh_get(mates, p->pending, bam1_qname(mate->bam1));
+		kh_del(mates, p->pending, k);
+		sa_bam_mates_unlink(mate, p);
+
+		sa_bam_mates_spill_record(mate->bam1, p);
+		bam_destroy1(mate->bam1);
+		free(mate);
+	}
+}
+
+//--------------------------------------------------------------------
+
+// in a coordinate-sorted BAM, a record whose mate is on another
+// chromosome waits too long; if the mate was earlier and it is not
+// pending, it was spilled
+static inline int sa_bam_mates_must_spill(bam1_t *bam1, sa_bam_mates_t *p) {
+	if (p->sort_order != SA_BAM_COORDINATE || bam1->core.tid < 0 || bam1->core.mtid < 0) {
+		return 0;
+	}
+	return (bam1->core.mtid != bam1->core.tid || bam1->core.mpos < bam1->core.pos);
+}
+
+//--------------------------------------------------------------------
+
+// pairs the record with its pending mate (both go to the batch, mate
+// 1 first) or leaves it waiting; the record is taken in this case, and
+// a new one is left in *bam1. Returns the size added to the batch
+static int sa_bam_mates_add(bam1_t **bam1, int collating, array_list_t *reads, sa_bam_mates_t *p) {
+	bam1_t *b = *bam1;
+	khiter_t k = kh_get(mates, p->pending, bam1_qname(b));
+
+	if (k != kh_end(p->pending)) {
+		sa_bam_mate_t *mate = kh_val(p->pending, k);
+		kh_del(mates, p->pending, k);
+		sa_bam_mates_unlink(mate, p);
+
+		bam1_t *first = b, *second = mate->bam1;
+		if ((first->core.flag & BAM_FREAD2) || (second->core.flag & BAM_FREAD1)) {
+			first = mate->bam1;
+			second = b;
+		}
+		array_list_insert(sa_bam_to_fastq(first, &p->buffers), reads);
+		array_list_insert(sa_bam_to_fastq(second, &p->buffers), reads);
+		int size = first->core.l_qname + 2 * first->core.l_qseq
+			+ second->core.l_qname + 2 * second->core.l_qseq;
+
+		bam_destroy1(mate->bam1);
+		free(mate);
+		return size;
+	}
+
+	if (!collating && sa_bam_mates_must_spill(b, p)) {
+		sa_bam_mates_spill_record(b, p);
+		return 0;
+	}
+
+	// waits for its mate, its name is the key
+	sa_bam_mate_t *mate = (sa_bam_mate_t *) malloc(sizeof(sa_bam_mate_t));
+	mate->bam1 = b;
+	mate->next = NULL;
+	mate->prev = p->tail;
+	if (p->tail) p->tail->next = mate; else p->head = mate;
+	p->tail = mate;
+	p->num_pending++;
+
+	int ret;
+	k = kh_put(mates, p->pending, bam1_qname(b), &ret);
+	kh_val(p->pending, k) = mate;
+
+	*bam1 = bam_init1();
+	return 0;
+}
+
+//--------------------------------------------------------------------
+
+static void sa_bam_mates_input_done(sa_bam_mates_t *p) {
+	p->input_done = 1;
+
+	if (p->num_spilled) {
+		// their mates may be in the buckets
+		sa_bam_mates_spill(p->num_pending, p);
+		for (int b = 0; b < SA_BAM_MATES_BUCKETS; b++) {
+			bam_close(p->buckets[b]);
+			p->buckets[b] = NULL;
+		}
+	} else {
+		sa_bam_mates_drop_pending(p);
+	}
+}
+
+//--------------------------------------------------------------------
+// producer
+//--------------------------------------------------------------------
+
+void *sa_bam_mates_reader(void *input) {
+	sa_wf_input_t *wf_input = (sa_wf_input_t *) input;
+	uint64_t prof_time = profiler_start(PROF_READER);
+
+	sa_wf_batch_t *new_wf_batch = NULL;
+	sa_wf_batch_t *curr_wf_batch = wf_input->wf_batch;
+
+	int batch_size = wf_input->fq_reader_input->batch_size;
+	array_list_t *reads = array_list_new(batch_size, 1.25f, COLLECTION_MODE_ASYNCHRONIZED);
+
+	sa_bam_mates_t *p = (sa_bam_mates_t *) wf_input->data;
+	stats_t *stats = p->stats;
+
+	int size = 0, total_reads = 0;
+	bam1_t *bam1 = bam_init1();
+
+	// streaming the input
+	while (!p->input_done && size < batch_size) {
+		if (bam_read1(p->bam_file->bam_fd, bam1) <= 0) {
+			sa_bam_mates_input_done(p);
+			break;
+		}
+
+		total_reads++;
+		if (bam1->core.flag & (BAM_FSECONDARY | BAM_FSUPPLEMENTARY)) {
+			stats->secondary_reads++;
+		} else if (!(bam1->core.flag & BAM_FPAIRED)) {
+			stats->alone_reads++;
+		} else {
+			size += sa_bam_mates_add(&bam1, 0, reads, p);
+			if (p->num_pending > SA_BAM_MATES_WINDOW) {
+				sa_bam_mates_spill(SA_BAM_MATES_WINDOW / 2, p);
+			}
+		}
+	}
+
+	// then the spilled records, a bucket at a time
+	while (p->input_done && p->num_spilled && p->curr_bucket < SA_BAM_MATES_BUCKETS
+	       && size < batch_size) {
+		if (!p->bucket_fd) {
+			char *name = sa_bam_mates_bucket_name(p->curr_bucket, p);
+			if ((p->bucket_fd = bam_open(name, "r")) == NULL) {
+				LOG_FATAL_F("Could not open the temporary file %s\n", name);
+			}
+			free(name);
+		}
+
+		if (bam_read1(p->bucket_fd, bam1) > 0) {
+			size += sa_bam_mates_add(&bam1, 1, reads, p);
+		} else {
+			// what is left in the bucket has no mate
+			sa_bam_mates_drop_pending(p);
+			bam_close(p->bucket_fd);
+			p->bucket_fd = NULL;
+
+			char *name = sa_bam_mates_bucket_name(p->curr_bucket, p);
+			remove(name);
+			free(name);
+			p->curr_bucket++;
+		}
+	}
+	bam_destroy1(bam1);
+
+	size_t num_reads = array_list_size(reads);
+
+	if (num_reads == 0) {
+		array_list_free(reads, (void *) fastq_read_free);
+	} else {
+		sa_mapping_batch_t *sa_mapping_batch = sa_mapping_batch_new(reads);
+		sa_mapping_batch->bam_format = wf_input->bam_format;
+
+		new_wf_batch = sa_wf_batch_new(curr_wf_batch->options,
+				curr_wf_batch->sa_index,
+				curr_wf_batch->writer_input,
+				sa_mapping_batch,
+				NULL);
+	}
+
+	stats->total_reads += total_reads;
+
+	profiler_stop(PROF_READER, prof_time);
+
+	return new_wf_batch;
+}
+
+//--------------------------------------------------------------------
+//--------------------------------------------------------------------
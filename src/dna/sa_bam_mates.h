@@ -0,0 +1,100 @@
+#ifndef _SA_BAM_MATES_H
+#define _SA_BAM_MATES_H
+
+#include "bioformats/bam/bam_file.h"
+#include "bioformats/fastq/fastq_read.h"
+#include "containers/array_list.h"
+#include "containers/khash.h"
+
+#include "dna/sa_dna_commons.h"
+
+//--------------------------------------------------------------------
+// Mates of a paired-end BAM for re-mapping: the primary records are
+// paired by name while the BAM is streamed, with at most
+// SA_BAM_MATES_WINDOW records waiting for their mates in memory.
+//
+// Name-sorted or collated BAMs (@HD SO:queryname or GO:query) have the
+// mates next to each other, so the window stays almost empty. In a
+// coordinate-sorted BAM, mates far away from each other (other
+// chromosome, unmapped) fill the window; the oldest records are then
+// spilled into SA_BAM_MATES_BUCKETS temporary BAMs by name hash, and
+// each bucket is collated in memory once the input is over. Records
+// without mate are counted as alone reads.
+//--------------------------------------------------------------------
+
+#define SA_BAM_MATES_WINDOW    1000000
+#define SA_BAM_MATES_BUCKETS   64
+
+#ifndef BAM_FSUPPLEMENTARY
+#define BAM_FSUPPLEMENTARY     2048
+#endif
+
+//--------------------------------------------------------------------
+
+// sort order, from the @HD header line
+#define SA_BAM_UNSORTED        0
+#define SA_BAM_QUERYNAME       1
+#define SA_BAM_COORDINATE      2
+
+//--------------------------------------------------------------------
+
+// record waiting for its mate, in input order
+typedef struct sa_bam_mate {
+	bam1_t *bam1;
+	struct sa_bam_mate *prev;
+	struct sa_bam_mate *next;
+} sa_bam_mate_t;
+
+KHASH_MAP_INIT_STR(mates, sa_bam_mate_t *);
+
+//--------------------------------------------------------------------
+
+// conversion buffers, reused by every record
+typedef struct sa_bam_buffers {
+	int length;
+	char *sequence;
+	char *quality;
+} sa_bam_buffers_t;
+
+//--------------------------------------------------------------------
+
+typedef struct sa_bam_mates {
+	bam_file_t *bam_file;
+	int sort_order;
+	stats_t *stats;
+
+	// pending mates
+	khash_t(mates) *pending;
+	sa_bam_mate_t *head;
+	sa_bam_mate_t *tail;
+	size_t num_pending;
+
+	// spill buckets, created at the first overflow of the window
+	char *spill_prefix;
+	bamFile buckets[SA_BAM_MATES_BUCKETS];
+	size_t num_spilled;
+	int curr_bucket;
+	bamFile bucket_fd;
+	int input_done;
+
+	sa_bam_buffers_t buffers;
+} sa_bam_mates_t;
+
+//--------------------------------------------------------------------
+
+// temporary buckets are created as <spill_prefix>.<n>.bam
+sa_bam_mates_t *sa_bam_mates_new(bam_file_t *bam_file, char *spill_prefix, stats_t *stats);
+void sa_bam_mates_free(sa_bam_mates_t *p);
+
+// producer: batches of mates, one after the other (mate 1 first)
+void *sa_bam_mates_reader(void *input);
+
+//--------------------------------------------------------------------
+
+// BAM record to FastQ read (original strand), through the buffers
+fastq_read_t *sa_bam_to_fastq(bam1_t *bam1, sa_bam_buffers_t *buffers);
+
+//--------------------------------------------------------------------
+//--------------------------------------------------------------------
+
+#endif // _SA_BAM_MATES_H
@@ -10,47 +10,13 @@
 #include "pair_server.h"
 #include "containers/khash.h"
 #include "sa/sa_index3.h"
+#include "aux/aux_profiler.h"
+#include "dna/sa_read_arena.h"
 
 //--------------------------------------------------------------------
 
 #define NUM_COUNTERS 10
 extern int counters[NUM_COUNTERS];
-//KHASH_MAP_INIT_STR(ID, bam1_t *);
-KHASH_MAP_INIT_STR(ID, array_list_t *);
-//--------------------------------------------------------------------
-
-#ifdef _TIMING
-
-#define FUNC_SEARCH_SUFFIX             0
-#define FUNC_SEARCH_PREFIX             1
-#define FUNC_SEARCH_SA                 2
-#define FUNC_CALS_FROM_EXACT_READ      3
-#define FUNC_CALS_FROM_SUFFIXES        4
-#define FUNC_INIT_CALS_FROM_SUFFIXES   5
-#define FUNC_SET_POSITIONS             6
-#define FUNC_SET_REF_SEQUENCE          7
-#define FUNC_SKIP_SUFFIXES             8
-#define FUNC_MINI_SW_RIGHT_SIDE        9
-#define FUNC_MINI_SW_LEFT_SIDE        10
-#define FUNC_SEED_NEW                 11
-#define FUNC_SEED_LIST_INSERT         12
-#define FUNC_CAL_NEW                  13
-#define FUNC_CAL_MNG_INSERT           14
-#define FUNC_CAL_MNG_TO_LIST          15
-#define FUNC_FILTER_BY_READ_AREA      16
-#define FUNC_FILTER_BY_NUM_MISMATCHES 17
-#define FUNC_PRE_SW                   18
-#define FUNC_SW                       19
-#define FUNC_POST_SW                  20
-#define FUNC_OTHER                    21
-#define FUNC_CREATE_ALIGNMENTS        22
-
-
-#define NUM_TIMING (FUNC_CREATE_ALIGNMENTS + 1)
-double func_times[NUM_TIMING];
-char func_names[NUM_TIMING][1024];
-
-#endif
 
 //--------------------------------------------------------------------
 
@@ -73,16 +39,19 @@ typedef struct sa_mapping_batch {
   int pair_min_distance;
   int pair_max_distance;
 
-  #ifdef _TIMING
-  double func_times[NUM_TIMING];
-  #endif
-
   options_t *options;
 
   array_list_t *fq_reads;
   array_list_t **mapping_lists;
 
+  // storage of the reads when they were parsed into an arena, NULL
+  // when they were allocated one by one
+  sa_read_arena_t *arena;
+
   char *status;
+
+  // RG tag of the reads (input file), NULL for none
+  char *read_group;
 } sa_mapping_batch_t;
 
 //--------------------------------------------------------------------
@@ -110,12 +79,8 @@ static inline sa_mapping_batch_t *sa_mapping_batch_new(array_list_t *fq_reads) {
   }
 
   p->status = (char *) calloc(num_reads, sizeof(char));
-
-  #ifdef _TIMING
-  for (int i = 0; i < NUM_TIMING; i++) {
-    p->func_times[i] = 0;
-  }
-  #endif
+  p->read_group = NULL;
+  p->arena = NULL;
 
   return p;
 }  
@@ -124,7 +89,18 @@ static inline sa_mapping_batch_t *sa_mapping_batch_new(array_list_t *fq_reads) {
 
 static inline void sa_mapping_batch_free(sa_mapping_batch_t *p) {
   if (p) {
-    if (p->fq_reads) { array_list_free(p->fq_reads, (void *) fastq_read_free); }
+    if (p->arena) {
+      // only the clipped adapters are out of the arena
+      fastq_read_t *read;
+      for (size_t i = 0; i < p->arena->num_reads; i++) {
+	read = &p->arena->reads[i];
+	if (read->adapter) { free(read->adapter); }
+	if (read->adapter_quality) { free(read->adapter_quality); }
+	if (read->adapter_revcomp) { free(read->adapter_revcomp); }
+      }
+      if (p->fq_reads) { array_list_free(p->fq_reads, (void *) NULL); }
+      sa_read_arena_free(p->arena);
+    } else if (p->fq_reads) { array_list_free(p->fq_reads, (void *) fastq_read_free); }
     if (p->mapping_lists) { free(p->mapping_lists); }
     if (p->status) { free(p->status); }
     free(p);
@@ -208,7 +184,6 @@ typedef struct sa_wf_input {
   bam_index_t *idx;
   stats_t *stats;
   void *data;
-  khash_t(ID) *hash;
 } sa_wf_input_t;
 
 //--------------------------------------------------------------------
@@ -223,7 +198,6 @@ static inline sa_wf_input_t *sa_wf_input_new(int bam_format,
   p->idx = NULL;
   p->stats = NULL;
   p->data = NULL;
-  p->hash = NULL;
   return p;
 }
 
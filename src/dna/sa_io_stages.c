@@ -8,14 +8,8 @@
 // sa fq reader
 //--------------------------------------------------------------------
 
-void *sa_fq_reader(void *input) {
-	sa_wf_input_t *wf_input = (sa_wf_input_t *) input;
-
-	sa_wf_batch_t *new_wf_batch = NULL;
-	sa_wf_batch_t *curr_wf_batch = wf_input->wf_batch;
-
-	fastq_batch_reader_input_t *fq_reader_input = wf_input->fq_reader_input;
-	array_list_t *reads = array_list_new(fq_reader_input->batch_size, 1.25f, COLLECTION_MODE_ASYNCHRONIZED);
+static void sa_fq_read_batch(array_list_t *reads, fastq_batch_reader_input_t *fq_reader_input) {
+	extern size_t fd_read_bytes;
 
 	if (fq_reader_input->gzip) {
 		// Gzip fastq file
@@ -27,12 +21,27 @@ void *sa_fq_reader(void *input) {
 	} else {
 		// Fastq file
 		if (fq_reader_input->flags == SINGLE_END_MODE) {
-			fastq_fread_bytes_se(reads, fq_reader_input->batch_size, fq_reader_input->fq_file1);
+			fd_read_bytes += fastq_fread_bytes_se(reads, fq_reader_input->batch_size, fq_reader_input->fq_file1);
 		} else {
-			fastq_fread_bytes_aligner_pe(reads, fq_reader_input->batch_size,
+			fd_read_bytes += fastq_fread_bytes_aligner_pe(reads, fq_reader_input->batch_size,
 					fq_reader_input->fq_file1, fq_reader_input->fq_file2);
 		}
 	}
+}
+
+//--------------------------------------------------------------------
+
+void *sa_fq_reader(void *input) {
+	sa_wf_input_t *wf_input = (sa_wf_input_t *) input;
+	uint64_t prof_time = profiler_start(PROF_READER);
+
+	sa_wf_batch_t *new_wf_batch = NULL;
+	sa_wf_batch_t *curr_wf_batch = wf_input->wf_batch;
+
+	fastq_batch_reader_input_t *fq_reader_input = wf_input->fq_reader_input;
+	array_list_t *reads = array_list_new(fq_reader_input->batch_size, 1.25f, COLLECTION_MODE_ASYNCHRONIZED);
+
+	sa_fq_read_batch(reads, fq_reader_input);
 
 	size_t num_reads = array_list_size(reads);
 
@@ -49,10 +58,199 @@ void *sa_fq_reader(void *input) {
 				NULL);
 	}
 
+	profiler_stop(PROF_READER, prof_time);
+
 	return new_wf_batch;
 
 }
 
+//--------------------------------------------------------------------
+// sa fq multi-file reader
+//--------------------------------------------------------------------
+
+// read group from the file name, without directory and extensions
+static char *sa_read_group_from_filename(char *filename) {
+	char *base = strrchr(filename, '/');
+	char *rg = strdup(base ? base + 1 : filename);
+
+	char *exts[] = { ".gz", ".fastq", ".fq" };
+	size_t len = strlen(rg);
+	for (int i = 0; i < 3; i++) {
+		size_t ext_len = strlen(exts[i]);
+		if (len > ext_len && !strcmp(rg + len - ext_len, exts[i])) {
+			len -= ext_len;
+			rg[len] = 0;
+		}
+	}
+	return rg;
+}
+
+//--------------------------------------------------------------------
+
+sa_fq_sources_t *sa_fq_sources_new(array_list_t *files1, array_list_t *files2,
+				   options_t *options) {
+	int num_sources = array_list_size(files1);
+
+	sa_fq_sources_t *p = (sa_fq_sources_t *) calloc(1, sizeof(sa_fq_sources_t));
+	p->num_sources = num_sources;
+	p->num_active = num_sources;
+	p->curr = 0;
+	p->done = (char *) calloc(num_sources, sizeof(char));
+	p->readers = (fastq_batch_reader_input_t *) calloc(num_sources, sizeof(fastq_batch_reader_input_t));
+	p->buffers1 = (sa_fq_buffer_t **) calloc(num_sources, sizeof(sa_fq_buffer_t *));
+	p->buffers2 = (sa_fq_buffer_t **) calloc(num_sources, sizeof(sa_fq_buffer_t *));
+	p->read_groups = (char **) calloc(num_sources, sizeof(char *));
+
+	char *file1, *file2;
+	fastq_batch_reader_input_t *reader;
+	for (int f = 0; f < num_sources; f++) {
+		file1 = array_list_get(f, files1);
+		file2 = (array_list_size(files2) ? array_list_get(f, files2) : NULL);
+		reader = &p->readers[f];
+
+		fastq_batch_reader_input_init(file1, file2,
+				options->pair_mode,
+				options->batch_size,
+				NULL, options->gzip,
+				reader);
+
+		if (options->gzip) {
+			reader->fq_gzip_file1 = fastq_gzopen(file1);
+			if (options->pair_mode != SINGLE_END_MODE) {
+				reader->fq_gzip_file2 = fastq_gzopen(file2);
+			}
+		} else {
+			reader->fq_file1 = fastq_fopen(file1);
+			p->buffers1[f] = sa_fq_buffer_new(reader->fq_file1->fd);
+			if (options->pair_mode != SINGLE_END_MODE) {
+				reader->fq_file2 = fastq_fopen(file2);
+				p->buffers2[f] = sa_fq_buffer_new(reader->fq_file2->fd);
+			}
+		}
+
+		if (num_sources > 1) {
+			p->read_groups[f] = sa_read_group_from_filename(file1);
+			// unique, for lanes with the same file name in different directories
+			for (int i = 0; i < f; i++) {
+				if (!strcmp(p->read_groups[i], p->read_groups[f])) {
+					char *rg = (char *) malloc(strlen(p->read_groups[f]) + 16);
+					sprintf(rg, "%s.%i", p->read_groups[f], f + 1);
+					free(p->read_groups[f]);
+					p->read_groups[f] = rg;
+					break;
+				}
+			}
+		}
+	}
+
+	// the headers list the read groups
+	if (num_sources > 1) {
+		options->num_read_groups = num_sources;
+		options->read_groups = (char **) calloc(num_sources, sizeof(char *));
+		for (int f = 0; f < num_sources; f++) {
+			options->read_groups[f] = strdup(p->read_groups[f]);
+		}
+	}
+
+	return p;
+}
+
+//--------------------------------------------------------------------
+
+void sa_fq_sources_free(sa_fq_sources_t *p) {
+	if (p) {
+		fastq_batch_reader_input_t *reader;
+		for (int f = 0; f < p->num_sources; f++) {
+			reader = &p->readers[f];
+			if (reader->gzip) {
+				fastq_gzclose(reader->fq_gzip_file1);
+				if (reader->flags != SINGLE_END_MODE) fastq_gzclose(reader->fq_gzip_file2);
+			} else {
+				fastq_fclose(reader->fq_file1);
+				if (reader->flags != SINGLE_END_MODE) fastq_fclose(reader->fq_file2);
+			}
+			sa_fq_buffer_free(p->buffers1[f]);
+			sa_fq_buffer_free(p->buffers2[f]);
+			if (p->read_groups[f]) free(p->read_groups[f]);
+		}
+		free(p->readers);
+		free(p->buffers1);
+		free(p->buffers2);
+		free(p->read_groups);
+		free(p->done);
+		free(p);
+	}
+}
+
+//--------------------------------------------------------------------
+
+void *sa_fq_multi_reader(void *input) {
+	sa_wf_input_t *wf_input = (sa_wf_input_t *) input;
+	uint64_t prof_time = profiler_start(PROF_READER);
+
+	sa_wf_batch_t *new_wf_batch = NULL;
+	sa_wf_batch_t *curr_wf_batch = wf_input->wf_batch;
+
+	sa_fq_sources_t *sources = (sa_fq_sources_t *) wf_input->data;
+	size_t batch_size = curr_wf_batch->options->batch_size;
+	array_list_t *reads = array_list_new(batch_size, 1.25f, COLLECTION_MODE_ASYNCHRONIZED);
+	sa_read_arena_t *arena = NULL;
+
+	// next file with reads left, in turn
+	int source = -1;
+	while (sources->num_active > 0) {
+		source = sources->curr;
+		sources->curr = (source + 1) % sources->num_sources;
+		if (sources->done[source]) continue;
+
+		if (sources->buffers1[source]) {
+			// plain FastQ, parsed into the read arena
+			extern size_t fd_read_bytes;
+			arena = sa_read_arena_new(2 * batch_size);
+			if (sources->buffers2[source]) {
+				fd_read_bytes += sa_read_arena_fill_pe(batch_size, sources->buffers1[source],
+								       sources->buffers2[source], arena);
+			} else {
+				fd_read_bytes += sa_read_arena_fill_se(batch_size, sources->buffers1[source], arena);
+			}
+			sa_read_arena_to_list(arena, reads);
+			if (array_list_size(reads) > 0) break;
+
+			// empty arena, the next source may be gzip with its own reads
+			sa_read_arena_free(arena);
+			arena = NULL;
+		} else {
+			sa_fq_read_batch(reads, &sources->readers[source]);
+			if (array_list_size(reads) > 0) break;
+		}
+
+		sources->done[source] = 1;
+		sources->num_active--;
+	}
+
+	size_t num_reads = array_list_size(reads);
+
+	if (num_reads == 0) {
+		array_list_free(reads, (void *)fastq_read_free);
+		sa_read_arena_free(arena);
+	} else {
+		sa_mapping_batch_t *sa_mapping_batch = sa_mapping_batch_new(reads);
+		sa_mapping_batch->bam_format = wf_input->bam_format;
+		sa_mapping_batch->read_group = sources->read_groups[source];
+		sa_mapping_batch->arena = arena;
+
+		new_wf_batch = sa_wf_batch_new(curr_wf_batch->options,
+				curr_wf_batch->sa_index,
+				curr_wf_batch->writer_input,
+				sa_mapping_batch,
+				NULL);
+	}
+
+	profiler_stop(PROF_READER, prof_time);
+
+	return new_wf_batch;
+}
+
 //----------------------------------------------------------------------
 // BAM reader for single-end
 //
@@ -60,6 +258,7 @@ void *sa_fq_reader(void *input) {
 
 void *sa_bam_reader_single(void *input) {
 	sa_wf_input_t *wf_input = (sa_wf_input_t *) input;
+	uint64_t prof_time = profiler_start(PROF_READER);
 
 	sa_wf_batch_t *new_wf_batch = NULL;
 	sa_wf_batch_t *curr_wf_batch = wf_input->wf_batch;
@@ -77,36 +276,22 @@ void *sa_bam_reader_single(void *input) {
 	int size = 0;
 	int total_reads = 0;
 
-	fastq_read_t *read;
-	char *header, *sequence, *quality;
+	sa_bam_buffers_t buffers = { 0, NULL, NULL };
 
 	bam1 = bam_init1();
 	while ((size < batch_size) && (bam_read1(bam_file->bam_fd, bam1) > 0) ) {
 		// convert bam1_t to fastq_read_t
 		total_reads++;
-		if (!(bam1->core.flag & BAM_FSECONDARY)) {
-			header = strdup(bam1_qname(bam1));
-			sequence = calloc(sizeof(char), (int32_t)bam1->core.l_qseq + 1);
-			quality = calloc(sizeof(char), (int32_t)bam1->core.l_qseq + 1);
-
-			bam1_get_sequence(bam1, sequence);
-			if (bam1->core.flag & BAM_FREVERSE){
-				revcomp_seq(sequence);
-			}
-
-			bam1_get_quality(bam1, quality);
-
+		if (!(bam1->core.flag & (BAM_FSECONDARY | BAM_FSUPPLEMENTARY))) {
 			size += bam1->core.l_qname + 2 * bam1->core.l_qseq;
-			read = fastq_read_new(header, sequence, quality);
-			array_list_insert(read, reads);
-			free(header);
-			free(sequence);
-			free(quality);
+			array_list_insert(sa_bam_to_fastq(bam1, &buffers), reads);
 		} else {
 			stats->secondary_reads++;
 		}
 	} // end of while
 	bam_destroy1(bam1);
+	if (buffers.sequence) free(buffers.sequence);
+	if (buffers.quality) free(buffers.quality);
 
 	size_t num_reads = array_list_size(reads);
 
@@ -125,6 +310,8 @@ void *sa_bam_reader_single(void *input) {
 
 	stats->total_reads+=total_reads;
 
+	profiler_stop(PROF_READER, prof_time);
+
 	return new_wf_batch;
 }
 
@@ -137,6 +324,7 @@ void *sa_bam_reader_single(void *input) {
 
 void *sa_bam_reader_pairend(void *input) { 
 	sa_wf_input_t *wf_input = (sa_wf_input_t *) input;
+	uint64_t prof_time = profiler_start(PROF_READER);
 
 	sa_wf_batch_t *new_wf_batch = NULL;
 	sa_wf_batch_t *curr_wf_batch = wf_input->wf_batch;
@@ -283,337 +471,7 @@ void *sa_bam_reader_pairend(void *input) {
 
 	stats->total_reads+=total_reads;
 
-	return new_wf_batch;
-}
-
-/**********************************************************************************************************
-* sa_bam_reader_unmapped:  BAM reader for tmp unmapped reads
-* @param input -> sa_wf_input : input with all parameters(important param: wf_input->data;file for unmapped bams)
-* @return new_wf_batch : batch for the mapper
-**************************************************************************************************************/
-
-void *sa_bam_reader_unmapped(void *input) {
-
-	sa_wf_input_t *wf_input = (sa_wf_input_t *) input;
-
-	sa_wf_batch_t *new_wf_batch = NULL;
-	sa_wf_batch_t *curr_wf_batch = wf_input->wf_batch;
-
-	fastq_batch_reader_input_t *fq_reader_input = wf_input->fq_reader_input;
-
-	int batch_size = fq_reader_input->batch_size;
-	array_list_t *reads = array_list_new(batch_size, 1.25f, COLLECTION_MODE_ASYNCHRONIZED);
-
-	bam_file_t *fnomap = (bam_file_t *)wf_input->data;
-	stats_t *stats = (stats_t *)wf_input->stats;
-
-	bam1_t *bam1; // mate 1
-	bam1 = bam_init1();
-
-	bam1_t *bam2; // mate 2
-	bam2 = bam_init1();
-
-	int size = 0, found = 0;
-	char *header, *sequence, *quality;
-	fastq_read_t *read;
-
-	char *id2 = "Hola:)";
-
-	while ((bam_read1(fnomap->bam_fd, bam1) > 0) && (size < batch_size)) {
-
-		char *id1 = bam1_qname(bam1);
-		if (!strcmp(id1, id2)) {
-			// if is same were sending
-		} else if (bam1->core.flag & BAM_FUNMAP) {
-			found = 0;
-			while (bam_read1(fnomap->bam_fd, bam2) > 0) {
-				id2 = bam1_qname(bam2);
-				if (!strcmp(id1, id2)) {
-					// need are same
-					found = 1;
-					break;
-				} else {
-					printf("\n Corrupt Bam, missing a mate, there is a single read \n");
-					printf("\n The single read is:  %s \n", bam1_qname(bam1));
-					printf("\n ***Check your Bam***\n\n");
-					bam1 = bam2;
-					stats->alone_reads++;
-				}
-			}
-		} else {
-			found = 0;
-			while (bam_read1(fnomap->bam_fd, bam2) > 0) {
-				id2 = bam1_qname(bam2);
-				if (!strcmp(id1, id2) && (bam2->core.flag & BAM_FUNMAP)) {
-					found = 1;
-					break;
-				}
-			}
-		}
-		if (!found) {
-			printf("\n Corrupt Bam, missing a mate, there is a single read \n");
-			printf("\n The single read is:  %s \n", bam1_qname(bam1));
-			printf("\n ***Check your Bam***\n\n");
-			stats->alone_reads++;
-		} else {
-			// ckeck the mates
-			if ((bam1->core.flag & BAM_FREAD2) || (bam2->core.flag & BAM_FREAD1)) {
-
-				bam1_t *bamaux; // mate 1
-				bamaux = bam1;
-				bam1 = bam2;
-				bam2 = bamaux;
-			}
-
-			// convert bam1_t to fastq_read_t
-			header = strdup(bam1_qname(bam1));
-			sequence = calloc(sizeof(char), (int32_t) bam1->core.l_qseq + 1);
-			quality = calloc(sizeof(char), (int32_t) bam1->core.l_qseq + 1);
-
-			bam1_get_sequence(bam1, sequence);
-
-			//check if read is reverse
-			if (bam1->core.flag & BAM_FREVERSE){
-				revcomp_seq(sequence);
-			}
-
-			bam1_get_quality(bam1, quality);
-
-			size += bam1->core.l_qname + 2 * bam1->core.l_qseq;
-			read = fastq_read_new(header, sequence, quality);
-			array_list_insert(read, reads);
-
-			free(header);
-			free(sequence);
-			free(quality);
-
-			header = strdup(bam1_qname(bam2));
-			sequence = calloc(sizeof(char), (int32_t) bam2->core.l_qseq + 1);
-			quality = calloc(sizeof(char), (int32_t) bam2->core.l_qseq + 1);
-
-			bam1_get_sequence(bam2, sequence);
-
-			//check if read is reverse
-			if (bam2->core.flag & BAM_FREVERSE){
-				revcomp_seq(sequence);
-			}
-
-			bam1_get_quality(bam2, quality);
-
-			size += bam2->core.l_qname + 2 * bam2->core.l_qseq;
-			read = fastq_read_new(header, sequence, quality);
-			array_list_insert(read, reads);
-
-			free(header);
-			free(sequence);
-			free(quality);
-		}
-
-	} // end of while
-	bam_destroy1(bam1);
-	bam_destroy1(bam2);
-
-	size_t num_reads = array_list_size(reads);
-
-	if (num_reads == 0) {
-		array_list_free(reads, (void *)fastq_read_free);
-	} else {
-		sa_mapping_batch_t *sa_mapping_batch = sa_mapping_batch_new(reads);
-		sa_mapping_batch->bam_format = wf_input->bam_format;
-
-		new_wf_batch = sa_wf_batch_new(curr_wf_batch->options,
-				curr_wf_batch->sa_index,
-				curr_wf_batch->writer_input,
-				sa_mapping_batch,
-				NULL);
-	}
-
-	return new_wf_batch;
-}
-
-
-/**********************************************************************************************************
-* sa_bam_reader_pairendV3:  BAM reader Khash table version
-* @param input -> sa_wf_input : input with all parameters(important param: KHASH_MAP_INIT_STR(ID, bam1_t *);)
-* @return new_wf_batch : batch for the mapper
-**************************************************************************************************************/
-
-void *sa_bam_reader_pairendV3(void *input){
-
-	sa_wf_input_t *wf_input = (sa_wf_input_t *) input;
-
-	sa_wf_batch_t *new_wf_batch = NULL;
-	sa_wf_batch_t *curr_wf_batch = wf_input->wf_batch;
-
-	fastq_batch_reader_input_t *fq_reader_input = wf_input->fq_reader_input;
-
-	int batch_size = fq_reader_input->batch_size;
-	array_list_t *reads = array_list_new(batch_size, 1.25f, COLLECTION_MODE_ASYNCHRONIZED);
-
-	bam_file_t *bam_file = (bam_file_t *) fq_reader_input->fq_file1;
-
-	bam_file_t *fnomapped = (bam_file_t *)wf_input->data;
-	stats_t *stats = (stats_t *)wf_input->stats;
-	bam1_t *bam1; // mate 1
-	bam1 = bam_init1();
-
-	bam1_t *bam2 = NULL; // mate 2
-
-	khash_t(ID) *h = (khash_t(ID) *)wf_input->hash;
-	khiter_t k;
-	int  size = 0, total_reads = 0, found =0;
-
-	while ((size < batch_size) && (bam_read1(bam_file->bam_fd, bam1) > 0)) {
-
-
-		if( (!(bam1->core.flag & BAM_FUNMAP) || (!(bam1->core.flag & BAM_FMUNMAP)))
-				&& (!(bam1->core.flag & BAM_FSECONDARY))) {
-
-			//Check if the second is in the khash;
-
-			int ret, is_missing;
-			char *key = strdup(bam1_qname(bam1));
-
-			k = kh_get(ID, h, key);
-			is_missing = (k == kh_end(h));
-
-
-
-			// this key is already saved in the hash (by the mate or collision)
-			if (!is_missing) {
-
-				free(key);
-				array_list_t *lista = (array_list_t *) kh_val(h,k);
-				size_t size_lista = array_list_size(lista);
-				//printf("key %s is present in the hash\n", key);
-				found = 0;
-				size_t it = 0;
-				while(it <size_lista && !found){
-					bam2 = array_list_get(it, lista);
-
-					//The mate is present in the hash.
-					if((!strcmp(bam1_qname(bam1),bam1_qname(bam2)))&& (bam1->core.mpos == bam2->core.pos)){
-						if((bam1->core.flag & BAM_FREAD2)||(bam2->core.flag & BAM_FREAD1)){//check the correct strand
-							bam1_t *bamaux;
-							bamaux = bam1;
-							bam1 = bam2;
-							bam2 = bamaux;
-
-						}
-
-						char *header1 = strdup(bam1_qname(bam1));
-						char *sequence = calloc(sizeof(char), (int32_t)bam1->core.l_qseq + 1);
-						char *quality = calloc(sizeof(char), (int32_t)bam1->core.l_qseq + 1);
-
-						fastq_read_t *read;
-
-						bam1_get_sequence(bam1, sequence);
-
-						if (bam1->core.flag & BAM_FREVERSE){
-							revcomp_seq(sequence);
-						}
-
-						bam1_get_quality(bam1, quality);
-
-						size += bam1->core.l_qname + 2 * bam1->core.l_qseq;
-						read = fastq_read_new(header1, sequence, quality);
-						array_list_insert(read, reads);
-
-						free(header1);
-						free(sequence);
-						free(quality);
-
-
-						char *header2 = strdup(bam1_qname(bam2));
-						char *sequence2 = calloc(sizeof(char), (int32_t)bam2->core.l_qseq + 1);
-						char *quality2 = calloc(sizeof(char), (int32_t)bam2->core.l_qseq + 1);
-
-						bam1_get_sequence(bam2, sequence2);
-						if (bam2->core.flag  & BAM_FREVERSE){
-							revcomp_seq(sequence2);
-						}
-
-						bam1_get_quality(bam2, quality2);
-
-						size += bam2->core.l_qname + 2 * bam2->core.l_qseq;
-						read = fastq_read_new(header2, sequence2, quality2);
-						array_list_insert(read, reads);
-						free(header2);
-						free(sequence2);
-						free(quality2);
-						total_reads+=2;
-						array_list_remove_at(it, lista);//remove the mate in the collision list
-						if(array_list_size(lista) == 0){
-							array_list_free(lista, NULL);
-							free(kh_key(h,k)); // free the previously strdup
-							kh_del(ID, h, k);
-						}
-
-						bam_destroy1(bam2);
-						bam2 = NULL;
-
-						bam_destroy1(bam1);
-						bam1 = bam_init1();
-						found = 1;
-					}
-					it++;
-				}
-				if(!found){
-					array_list_insert(bam1, lista);
-
-					bam1 = bam_init1();
-				}
-			} else {
-				// key is missing, put it into the hash
-				array_list_t *desbordamiento = array_list_new(10, 1.25f, COLLECTION_MODE_ASYNCHRONIZED);
-				//Put the bam in the hash table
-				array_list_insert(bam1, desbordamiento);
-				k = kh_put(ID, h, key, &ret);
-				kh_value(h, k)= desbordamiento;
-				bam1 = bam_init1();
-			}
-
-		}else if(bam1->core.flag & BAM_FSECONDARY){
-			stats->secondary_reads++;
-			total_reads++;
-
-
-
-		}else {//If is not maped or the pair is not maped, save in no-maped file
-			total_reads++;
-			if(bam_fwrite(bam1,fnomapped) < 0){//wrong writting in the file
-				bam_destroy1(bam1);
-				bam_destroy1(bam2);
-				printf("Fail in file fnomap\n");
-				exit(-1);
-			}
-
-		}
-
-	} // end of while
-
-	bam_destroy1(bam1);
-	bam_destroy1(bam2);
-
-
-
-
-	size_t num_reads = array_list_size(reads);
-
-	if (num_reads == 0) {
-		array_list_free(reads, (void *)fastq_read_free);
-	} else {
-		sa_mapping_batch_t *sa_mapping_batch = sa_mapping_batch_new(reads);
-		sa_mapping_batch->bam_format = wf_input->bam_format;
-
-		new_wf_batch = sa_wf_batch_new(curr_wf_batch->options,
-				curr_wf_batch->sa_index,
-				curr_wf_batch->writer_input,
-				sa_mapping_batch,
-				NULL);
-	}
-
-	stats->total_reads+=total_reads;
+	profiler_stop(PROF_READER, prof_time);
 
 	return new_wf_batch;
 }
@@ -627,13 +485,6 @@ int num_dup_reads = 0;
 int num_total_dup_reads = 0;
 #endif
 
-size_t num_mapped_reads = 0;
-size_t num_unmapped_reads = 0;
-size_t num_total_mappings = 0;
-size_t num_multihit_reads = 0;
-size_t num_unmapped_reads_by_invalid_cal = 0;
-size_t num_unmapped_reads_by_cigar_length = 0;
-
 //--------------------------------------------------------------------
 // SAM writer
 //--------------------------------------------------------------------
@@ -644,6 +495,21 @@ void write_sam_header(options_t *options, sa_genome3_t *genome, FILE *f) {
   for (unsigned short int i = 0; i < genome->num_chroms; i++) {
     fprintf(f, "@SQ\tSN:%s\tLN:%lu\n", genome->chrom_names[i], genome->chrom_lengths[i]);
   }
+  for (int i = 0; i < options->num_read_groups; i++) {
+    fprintf(f, "@RG\tID:%s\tSM:%s\n", options->read_groups[i],
+	    (options->prefix_name ? options->prefix_name : "sample"));
+  }
+}
+
+//--------------------------------------------------------------------
+
+// optional fields common to all the records, and end of line
+static inline void sa_sam_end_record(char *read_group, FILE *f) {
+  if (read_group) {
+    fprintf(f, "\tRG:Z:%s\n", read_group);
+  } else {
+    fputc('\n', f);
+  }
 }
 
 //--------------------------------------------------------------------
@@ -657,11 +523,7 @@ int sa_sam_writer(void *data) {
     return 0;
   }
 
-  #ifdef _TIMING
-  for (int i = 0; i < NUM_TIMING; i++) {
-    func_times[i] += mapping_batch->func_times[i];
-  }
-  #endif
+  uint64_t prof_time = profiler_start(PROF_WRITER);
 
   int num_mismatches, num_cigar_ops;
   size_t flag, pnext = 0, tlen = 0;
@@ -677,6 +539,7 @@ int sa_sam_writer(void *data) {
 
   size_t num_reads, num_mappings;
   num_reads = mapping_batch->num_reads;
+  thread_stats_add(ST_TOTAL_READS, num_reads);
 
   if (mapping_batch->options->pair_mode != SINGLE_END_MODE) {
     // PAIR MODE
@@ -692,7 +555,8 @@ int sa_sam_writer(void *data) {
 
       mapping_list = mapping_batch->mapping_lists[i];
       num_mappings = array_list_size(mapping_list);
-      num_total_mappings += num_mappings;
+      thread_stats_add(ST_TOTAL_MAPPINGS, num_mappings);
+      thread_stats_add_mappings(num_mappings);
 
       #ifdef _VERBOSE
       if (num_mappings > 1) {
@@ -702,9 +566,9 @@ int sa_sam_writer(void *data) {
       #endif
       
       if (num_mappings > 0) {
-	num_mapped_reads++;
+	thread_stats_inc(ST_MAPPED_READS);
 	if (num_mappings > 1) {
-	  num_multihit_reads++;
+	  thread_stats_inc(ST_MULTIHIT_READS);
 	}
 	for (size_t j = 0; j < num_mappings; j++) {
 	  alig = (alignment_t *) array_list_get(j, mapping_list);
@@ -712,8 +576,9 @@ int sa_sam_writer(void *data) {
 	  // decoy management
 	  if (genome->chrom_flags[alig->chromosome] == DECOY_FLAG) {
 	    if (num_mappings == 1) {
-	      fprintf(out_file, "%s\t4\t*\t0\t0\t*\t*\t0\t0\t%s\t%s\tXD:Z:%s\n", 
+	      fprintf(out_file, "%s\t4\t*\t0\t0\t*\t*\t0\t0\t%s\t%s\tXD:Z:%s", 
 		      read->id, alig->sequence, alig->quality, genome->chrom_names[alig->chromosome]);
+	      sa_sam_end_record(mapping_batch->read_group, out_file);
 	    }
 	    // free alignment and continue
 	    alignment_free(alig); 
@@ -739,7 +604,7 @@ int sa_sam_writer(void *data) {
 	  if (alig->pc_optical_duplicate)                       flag += BAM_FDUP;
 	  if (alig->seq_strand)                                 flag += BAM_FREVERSE;
 
-	  fprintf(out_file, "%s\t%lu\t%s\t%i\t%i\t%s\t%s\t%i\t%i\t%s\t%s\t%s\n", 
+	  fprintf(out_file, "%s\t%lu\t%s\t%i\t%i\t%s\t%s\t%i\t%i\t%s\t%s%s%s", 
 		  read->id,
 		  flag,
 		  genome->chrom_names[alig->chromosome],
@@ -751,14 +616,16 @@ int sa_sam_writer(void *data) {
 		  alig->template_length,
 		  alig->sequence,
 		  alig->quality,
+		  (opt_fields == NULL || !*opt_fields ? "" : "\t"),
 		  (opt_fields == NULL ? "" : opt_fields)
 		  );
+	  sa_sam_end_record(mapping_batch->read_group, out_file);
 
 	  // free memory
 	  alignment_free(alig); 
 	} // end for num_mappings
       } else {
-	num_unmapped_reads++;
+	thread_stats_inc(ST_UNMAPPED_READS);
 
 	if (read->adapter) {
 	  len = read->length + abs(read->adapter_length);
@@ -789,11 +656,12 @@ int sa_sam_writer(void *data) {
 	  quality = read->quality;
 	}
 
-	fprintf(out_file, "%s\t4\t*\t0\t0\t*\t*\t0\t0\t%s\t%s\n", 
+	fprintf(out_file, "%s\t4\t*\t0\t0\t*\t*\t0\t0\t%s\t%s", 
 		read->id,
 		sequence,
 		quality
 		);
+	sa_sam_end_record(mapping_batch->read_group, out_file);
 
 	if (read->adapter) {
 	  free(sequence);
@@ -815,7 +683,8 @@ int sa_sam_writer(void *data) {
       read = (fastq_read_t *) array_list_get(i, read_list);
       mapping_list = mapping_batch->mapping_lists[i];
       num_mappings = array_list_size(mapping_list);
-      num_total_mappings += num_mappings;
+      thread_stats_add(ST_TOTAL_MAPPINGS, num_mappings);
+      thread_stats_add_mappings(num_mappings);
 
       #ifdef _VERBOSE
       if (num_mappings > 1) {
@@ -825,9 +694,9 @@ int sa_sam_writer(void *data) {
       #endif
       
       if (num_mappings > 0) {
-	num_mapped_reads++;
+	thread_stats_inc(ST_MAPPED_READS);
 	if (num_mappings > 1) {
-	  num_multihit_reads++;
+	  thread_stats_inc(ST_MULTIHIT_READS);
 	}
 
 	for (size_t j = 0; j < num_mappings; j++) {
@@ -886,8 +755,9 @@ int sa_sam_writer(void *data) {
 	  // decoy management
 	  if (genome->chrom_flags[cal->chromosome_id] == DECOY_FLAG) {
 	    if (num_mappings == 1) {
-	      fprintf(out_file, "%s\t4\t*\t0\t0\t*\t*\t0\t0\t%s\t%s\tXD:Z:%s\n", 
+	      fprintf(out_file, "%s\t4\t*\t0\t0\t*\t*\t0\t0\t%s\t%s\tXD:Z:%s", 
 		      read->id, sequence, quality, genome->chrom_names[cal->chromosome_id]);
+	      sa_sam_end_record(mapping_batch->read_group, out_file);
 	    }
 	    // go to free memory
 	    goto free_memory1;
@@ -906,7 +776,7 @@ int sa_sam_writer(void *data) {
 	  if (num_mappings > 1) {
 	    cal->mapq = 0;
 	  }
-	  fprintf(out_file, "%s\t%lu\t%s\t%lu\t%i\t%s\t%s\t%lu\t%lu\t%s\t%s\tAS:i:%i\tNM:i:%i\n", 
+	  fprintf(out_file, "%s\t%lu\t%s\t%lu\t%i\t%s\t%s\t%lu\t%lu\t%s\t%s\tAS:i:%i\tNM:i:%i", 
 		  read->id,
 		  flag,
 		  genome->chrom_names[cal->chromosome_id],
@@ -921,6 +791,7 @@ int sa_sam_writer(void *data) {
 		  (int) cal->score,
 		    num_mismatches
 		  );
+	  sa_sam_end_record(mapping_batch->read_group, out_file);
 
 	  // free memory
 	  free(cigar_M_string);
@@ -935,7 +806,7 @@ int sa_sam_writer(void *data) {
 	  }
 	}
       } else {
-	num_unmapped_reads++;
+	thread_stats_inc(ST_UNMAPPED_READS);
 
 	if (read->adapter) {
 	  // sequences and cigar
@@ -968,11 +839,12 @@ int sa_sam_writer(void *data) {
 	  quality = read->quality;
 	}
 	
-	fprintf(out_file, "%s\t4\t*\t0\t0\t*\t*\t0\t0\t%s\t%s\n", 
+	fprintf(out_file, "%s\t4\t*\t0\t0\t*\t*\t0\t0\t%s\t%s", 
 		read->id,
 		sequence,
 		quality
 		);
+	sa_sam_end_record(mapping_batch->read_group, out_file);
 
 	if (read->adapter) {
 	  free(sequence);
@@ -989,6 +861,8 @@ int sa_sam_writer(void *data) {
 
   if (wf_batch) sa_wf_batch_free(wf_batch);
 
+  profiler_stop(PROF_WRITER, prof_time);
+
   return 0;
 }
 
@@ -997,7 +871,8 @@ int sa_sam_writer(void *data) {
 // BAM writer
 //--------------------------------------------------------------------
 
-bam_header_t *create_bam_header(options_t *options, sa_genome3_t *genome) {
+bam_header_t *create_bam_header(options_t *options, sa_genome3_t *genome,
+				const char *sort_order) {
 
 	bam_header_t *bam_header = (bam_header_t *) calloc(1, sizeof(bam_header_t));
 
@@ -1011,10 +886,25 @@ bam_header_t *create_bam_header(options_t *options, sa_genome3_t *genome) {
 		bam_header->target_len[i] = genome->chrom_lengths[i];
 	}
 
-	char pg[1024];
-	sprintf(pg, "@HD\tVN:1.4\tSO:unsorted\n");
-	sprintf(pg, "@PG\tID:HPG-Aligner\tVN:%s\tCL:%s\n", HPG_ALIGNER_VERSION, options->cmdline);
-	bam_header->text = strdup(pg);
+	// @HD and @PG lines
+	char *cmdline = (options->cmdline ? options->cmdline : "");
+	size_t len = strlen(sort_order) + strlen(HPG_ALIGNER_VERSION) + strlen(cmdline) + 64;
+	char pg[len];
+	sprintf(pg, "@HD\tVN:1.4\tSO:%s\n", sort_order);
+	sprintf(pg + strlen(pg), "@PG\tID:HPG-Aligner\tVN:%s\tCL:%s\n", HPG_ALIGNER_VERSION, cmdline);
+
+	// read groups of the input files
+	char *sample = (options->prefix_name ? options->prefix_name : "sample");
+	len = strlen(pg) + 1;
+	for (int i = 0; i < options->num_read_groups; i++) {
+		len += strlen(options->read_groups[i]) + strlen(sample) + 16;
+	}
+	bam_header->text = (char *) malloc(len);
+	strcpy(bam_header->text, pg);
+	for (int i = 0; i < options->num_read_groups; i++) {
+		sprintf(bam_header->text + strlen(bam_header->text), "@RG\tID:%s\tSM:%s\n",
+			options->read_groups[i], sample);
+	}
 	bam_header->l_text = strlen(bam_header->text);
 
 	return bam_header;
@@ -1022,6 +912,30 @@ bam_header_t *create_bam_header(options_t *options, sa_genome3_t *genome) {
 
 //--------------------------------------------------------------------
 
+// when post-processing is requested the writer feeds the coordinate
+// sorter instead of the output file
+bam_sorter_t *sa_bam_sorter = NULL;
+
+static inline void sa_bam_output(alignment_t *alig, char *read_group, bam_file_t *out_file) {
+  uint64_t prof_time = profiler_start(PROF_CONVERT_TO_BAM);
+  bam1_t *bam1 = convert_to_bam(alig, 33);
+  if (read_group) {
+    bam_aux_append(bam1, "RG", 'Z', strlen(read_group) + 1, (uint8_t *) read_group);
+  }
+  profiler_stop(PROF_CONVERT_TO_BAM, prof_time);
+
+  if (sa_bam_sorter) {
+    bam_sorter_add(bam1, sa_bam_sorter);
+  } else {
+    prof_time = profiler_start(PROF_COMPRESSION);
+    bam_fwrite(bam1, out_file);
+    profiler_stop(PROF_COMPRESSION, prof_time);
+    bam_destroy1(bam1);
+  }
+}
+
+//--------------------------------------------------------------------
+
 int sa_bam_writer(void *data) {
   sa_wf_batch_t *wf_batch = (sa_wf_batch_t *) data;
   
@@ -1031,19 +945,12 @@ int sa_bam_writer(void *data) {
     return 0;
   }
 
-  #ifdef _TIMING
-  for (int i = 0; i < NUM_TIMING; i++) {
-    func_times[i] += mapping_batch->func_times[i];
-  }
-  #endif
-
   int len;
   char *sequence, *quality;
 
   fastq_read_t *read;
   array_list_t *read_list = mapping_batch->fq_reads;
 
-  bam1_t *bam1;
   alignment_t *alig;
   array_list_t *mapping_list;
   bam_file_t *out_file = wf_batch->writer_input->bam_file;
@@ -1052,11 +959,13 @@ int sa_bam_writer(void *data) {
 
   size_t num_reads, num_mappings;
   num_reads = mapping_batch->num_reads;
+  thread_stats_add(ST_TOTAL_READS, num_reads);
   for (size_t i = 0; i < num_reads; i++) {
     read = (fastq_read_t *) array_list_get(i, read_list);
     mapping_list = mapping_batch->mapping_lists[i];
     num_mappings = array_list_size(mapping_list);
-    num_total_mappings += num_mappings;
+    thread_stats_add(ST_TOTAL_MAPPINGS, num_mappings);
+    thread_stats_add_mappings(num_mappings);
 
     #ifdef _VERBOSE
     if (num_mappings > 1) {
@@ -1066,9 +975,9 @@ int sa_bam_writer(void *data) {
     #endif
 
     if (num_mappings > 0) {
-      num_mapped_reads++;
+      thread_stats_inc(ST_MAPPED_READS);
       if (num_mappings > 1) {
-	num_multihit_reads++;
+	thread_stats_inc(ST_MULTIHIT_READS);
       }
       for (size_t j = 0; j < num_mappings; j++) {
 	alig = (alignment_t *) array_list_get(j, mapping_list);
@@ -1079,10 +988,8 @@ int sa_bam_writer(void *data) {
 	    alignment_t *aux_alig = alignment_new();       
 	    alignment_init_single_end(strdup(read->id), strdup(alig->sequence), strdup(alig->quality),
 				      0, -1, -1, strdup(""), 0, 0, 0, 0, 0, NULL, aux_alig);
-	    bam1_t *aux_bam1 = convert_to_bam(aux_alig, 33);
-	    bam_fwrite(aux_bam1, out_file);
+	    sa_bam_output(aux_alig, mapping_batch->read_group, out_file);
 	    // free memory
-	    bam_destroy1(aux_bam1);
 	    alignment_free(aux_alig);
 	  }
 	  // free alignment and continue
@@ -1097,13 +1004,11 @@ int sa_bam_writer(void *data) {
 	  alig->map_quality = alig->mapq;
 	}
 
-	bam1 = convert_to_bam(alig, 33);
-	bam_fwrite(bam1, out_file);
-	bam_destroy1(bam1);
+	sa_bam_output(alig, mapping_batch->read_group, out_file);
 	alignment_free(alig);
       }
     } else {
-      num_unmapped_reads++;
+      thread_stats_inc(ST_UNMAPPED_READS);
 
       if (read->adapter) {
 	// sequences and cigar
@@ -1139,11 +1044,9 @@ int sa_bam_writer(void *data) {
       alignment_init_single_end(strdup(read->id), sequence, quality,
 				0, -1, -1, strdup(""), 0, 0, 0, 0, 0, NULL, alig);
       
-      bam1 = convert_to_bam(alig, 33);
-      bam_fwrite(bam1, out_file);
+      sa_bam_output(alig, mapping_batch->read_group, out_file);
         
       // free memory
-      bam_destroy1(bam1);
       alig->sequence = NULL;
       alig->quality = NULL;
       alignment_free(alig);
@@ -8,14 +8,38 @@
 #include "batch_writer.h"
 #include "containers/khash.h"
 #include "dna/sa_dna_commons.h"
+#include "dna/sa_bam_mates.h"
+#include "aux/aux_sort.h"
+
+//--------------------------------------------------------------------
+// several FastQ files (or pairs of files) mapped in a single workflow,
+// the reader takes a batch from every file in turn; with more than one
+// file, the reads of every file get its read group (RG tag); plain
+// FastQ files are parsed through their buffers into read arenas
+//--------------------------------------------------------------------
+
+typedef struct sa_fq_sources {
+  int num_sources;
+  int num_active;
+  int curr;
+  char *done;
+  fastq_batch_reader_input_t *readers;
+  sa_fq_buffer_t **buffers1;
+  sa_fq_buffer_t **buffers2;
+  char **read_groups;
+} sa_fq_sources_t;
+
+// opens the files, and sets the read groups into the options
+sa_fq_sources_t *sa_fq_sources_new(array_list_t *files1, array_list_t *files2,
+				   options_t *options);
+void sa_fq_sources_free(sa_fq_sources_t *p);
 
 //--------------------------------------------------------------------
 
 void *sa_fq_reader(void *input);
+void *sa_fq_multi_reader(void *input);
 void *sa_bam_reader_single(void *input);
 void *sa_bam_reader_pairend(void *input);
-void *sa_bam_reader_unmapped(void *input);
-void *sa_bam_reader_pairendV3(void *input);
 
 //--------------------------------------------------------------------
 
@@ -24,9 +48,13 @@ void write_sam_header(options_t *options, sa_genome3_t *genome, FILE *f);
 
 //--------------------------------------------------------------------
 
-bam_header_t *create_bam_header(options_t *options, sa_genome3_t *genome);
+// sort_order for the @HD line: "unsorted", "coordinate" or "queryname"
+bam_header_t *create_bam_header(options_t *options, sa_genome3_t *genome,
+				const char *sort_order);
 int sa_bam_writer(void *data);
 
+extern bam_sorter_t *sa_bam_sorter;
+
 //--------------------------------------------------------------------
 //--------------------------------------------------------------------
 
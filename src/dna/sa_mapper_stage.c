@@ -18,15 +18,9 @@
 // process_right_side & append_seed_linked_list
 //--------------------------------------------------------------------
 
-void cut_adapter(char *adapter, int adapter_length, fastq_read_t *read);
-
 int generate_cals_from_suffixes(int strand, fastq_read_t *read,
 				int read_pos, int suffix_len, size_t low, size_t high, 
-				sa_index3_t *sa_index, cal_mng_t *cal_mng
-                                #ifdef _TIMING
-				, sa_mapping_batch_t *mapping_batch
-                                #endif
-				);
+				sa_index3_t *sa_index, cal_mng_t *cal_mng);
 
 
 void process_right_side(seed_t *new_item, linked_list_t *seed_list) {
@@ -591,11 +585,7 @@ array_list_t *search_mate_cal_by_prefixes(seed_cal_t *cal, fastq_read_t *read,
 	if (start <= g_start_suf && end >= g_end_suf) {
 	  generate_cals_from_suffixes(1 - cal->strand, read, read_pos,
 				      sa_index->k_value, i, i,
-				      sa_index, cal_mng
-                                      #ifdef _TIMING
-				      , batch
-                                      #endif
-				      );
+				      sa_index, cal_mng);
 	}
       }
     }
@@ -939,19 +929,11 @@ void generate_cals_from_exact_read(int strand, fastq_read_t *read,
 
 int generate_cals_from_suffixes(int strand, fastq_read_t *read,
 				int read_pos, int suffix_len, size_t low, size_t high, 
-				sa_index3_t *sa_index, cal_mng_t *cal_mng
-                                #ifdef _TIMING
-				, sa_mapping_batch_t *mapping_batch
-                                #endif
-				) {
-
-  #ifdef _TIMING
-  struct timeval stop, start;
-  #endif
+				sa_index3_t *sa_index, cal_mng_t *cal_mng) {
 
-  #ifdef _TIMING
-  gettimeofday(&start, NULL);
-  #endif
+  uint64_t prof_time;
+
+  prof_time = profiler_start(PROF_INIT_CALS_FROM_SUFFIXES);
 
   size_t r_start_suf, r_end_suf, g_start_suf, g_end_suf;
   size_t r_start, r_end, r_len, g_start, g_end, g_len;
@@ -968,16 +950,10 @@ int generate_cals_from_suffixes(int strand, fastq_read_t *read,
   char *g_seq, *r_seq;
   r_seq = (strand ? read->revcomp : read->sequence);
   
-  #ifdef _TIMING
-  gettimeofday(&stop, NULL);
-  mapping_batch->func_times[FUNC_INIT_CALS_FROM_SUFFIXES] += 
-    ((stop.tv_sec - start.tv_sec) + (stop.tv_usec - start.tv_usec) / 1000000.0f);  
-  #endif
+  profiler_stop(PROF_INIT_CALS_FROM_SUFFIXES, prof_time);
 
   for (size_t suff = low; suff <= high; suff++) {
-    #ifdef _TIMING
-    gettimeofday(&start, NULL);
-    #endif
+    prof_time = profiler_start(PROF_SET_POSITIONS);
     chrom = (unsigned short int) sa_index->CHROM[suff];
 
     // extend suffix to right side
@@ -987,23 +963,13 @@ int generate_cals_from_suffixes(int strand, fastq_read_t *read,
     g_start_suf = sa_index->SA[suff] - sa_index->genome->chrom_offsets[chrom];
     g_end_suf = g_start_suf + suffix_len - 1;
 
-    #ifdef _TIMING
-    gettimeofday(&stop, NULL);
-    mapping_batch->func_times[FUNC_SET_POSITIONS] += 
-      ((stop.tv_sec - start.tv_sec) + (stop.tv_usec - start.tv_usec) / 1000000.0f);  
-    #endif
+    profiler_stop(PROF_SET_POSITIONS, prof_time);
 
     // skip suffixes, 
     // if found cal for this suffix, then next suffix
-    #ifdef _TIMING
-    gettimeofday(&start, NULL);
-    #endif
+    prof_time = profiler_start(PROF_SKIP_SUFFIXES);
     found_cal = cal_mng_find(strand, chrom, g_start_suf, g_end_suf, cal_mng);
-    #ifdef _TIMING
-    gettimeofday(&stop, NULL);
-    mapping_batch->func_times[FUNC_SKIP_SUFFIXES] += 
-      ((stop.tv_sec - start.tv_sec) + (stop.tv_usec - start.tv_usec) / 1000000.0f);  
-    #endif
+    profiler_stop(PROF_SKIP_SUFFIXES, prof_time);
     if (found_cal) continue;
 
 
@@ -1032,26 +998,14 @@ int generate_cals_from_suffixes(int strand, fastq_read_t *read,
 	g_len = g_start_suf;
       }
 
-      #ifdef _TIMING
-      gettimeofday(&start, NULL);
-      #endif
+      prof_time = profiler_start(PROF_SET_REF_SEQUENCE);
       g_seq = &sa_index->genome->S[g_start + sa_index->genome->chrom_offsets[chrom] + 1];
-      #ifdef _TIMING
-      gettimeofday(&stop, NULL);
-      mapping_batch->func_times[FUNC_SET_REF_SEQUENCE] += 
-	((stop.tv_sec - start.tv_sec) + (stop.tv_usec - start.tv_usec) / 1000000.0f);  
-      #endif
+      profiler_stop(PROF_SET_REF_SEQUENCE, prof_time);
 
-      #ifdef _TIMING
-      gettimeofday(&start, NULL);
-      #endif
+      prof_time = profiler_start(PROF_MINI_SW_LEFT_SIDE);
       score = doscadfun_inv(r_seq, r_len, g_seq, g_len, MISMATCH_PERC,
 			    &alig_out);
-      #ifdef _TIMING
-      gettimeofday(&stop, NULL);
-      mapping_batch->func_times[FUNC_MINI_SW_LEFT_SIDE] += 
-	((stop.tv_sec - start.tv_sec) + (stop.tv_usec - start.tv_usec) / 1000000.0f);  
-      #endif
+      profiler_stop(PROF_MINI_SW_LEFT_SIDE, prof_time);
       if (score > 0.0f) {
 	// update seed
 	seed->num_mismatches += alig_out.mismatch;
@@ -1083,26 +1037,14 @@ int generate_cals_from_suffixes(int strand, fastq_read_t *read,
       g_start = g_end_suf + 1;
       g_end = g_start + g_len;
 
-      #ifdef _TIMING
-      gettimeofday(&start, NULL);
-      #endif
+      prof_time = profiler_start(PROF_SET_REF_SEQUENCE);
       g_seq = &sa_index->genome->S[g_start + sa_index->genome->chrom_offsets[chrom]];
-      #ifdef _TIMING
-      gettimeofday(&stop, NULL);
-      mapping_batch->func_times[FUNC_SET_REF_SEQUENCE] += 
-	((stop.tv_sec - start.tv_sec) + (stop.tv_usec - start.tv_usec) / 1000000.0f);  
-      #endif
+      profiler_stop(PROF_SET_REF_SEQUENCE, prof_time);
 
-      #ifdef _TIMING
-      gettimeofday(&start, NULL);
-      #endif
+      prof_time = profiler_start(PROF_MINI_SW_RIGHT_SIDE);
       score = doscadfun(&r_seq[r_start], r_len, g_seq, g_len, MISMATCH_PERC,
 			&alig_out);
-      #ifdef _TIMING
-      gettimeofday(&stop, NULL);
-      mapping_batch->func_times[FUNC_MINI_SW_RIGHT_SIDE] += 
-	((stop.tv_sec - start.tv_sec) + (stop.tv_usec - start.tv_usec) / 1000000.0f);  
-      #endif
+      profiler_stop(PROF_MINI_SW_RIGHT_SIDE, prof_time);
       if (score > 0.0f) {
 	// update seed
 	seed->num_mismatches += alig_out.mismatch;
@@ -1123,17 +1065,11 @@ int generate_cals_from_suffixes(int strand, fastq_read_t *read,
     if (seed->read_end - seed->read_start + 1 > 20) {
       seed->strand = strand;
       seed->chromosome_id = chrom;
-      #ifdef _TIMING
-      gettimeofday(&start, NULL);
-      #endif
+      prof_time = profiler_start(PROF_CAL_MNG_INSERT);
 
       cal_mng_update(seed, read, cal_mng);
 
-      #ifdef _TIMING
-      gettimeofday(&stop, NULL);
-      mapping_batch->func_times[FUNC_CAL_MNG_INSERT] += 
-	((stop.tv_sec - start.tv_sec) + (stop.tv_usec - start.tv_usec) / 1000000.0f);  
-      #endif
+      profiler_stop(PROF_CAL_MNG_INSERT, prof_time);
     } else {
       // free seed
       seed_free(seed);
@@ -1154,9 +1090,7 @@ array_list_t *create_cals(int num_seeds, fastq_read_t *read,
 			  sa_mapping_batch_t *mapping_batch, 
 			  sa_index3_t *sa_index, cal_mng_t *cal_mng) {
 
-  #ifdef _TIMING
-  struct timeval stop, start;
-  #endif
+  uint64_t prof_time;
 
 
   size_t suffix_len, num_suffixes;
@@ -1164,9 +1098,7 @@ array_list_t *create_cals(int num_seeds, fastq_read_t *read,
 
   size_t low, high;
 
-  #ifdef _TIMING
-  gettimeofday(&start, NULL);
-  #endif
+  prof_time = profiler_start(PROF_OTHER);
 
   array_list_t *cal_list = array_list_new(1000, 1.25f, COLLECTION_MODE_ASYNCHRONIZED);
   cal_mng->min_read_area = read->length;
@@ -1189,11 +1121,7 @@ array_list_t *create_cals(int num_seeds, fastq_read_t *read,
   display_cmp_sequences(read, sa_index);
   #endif
 
-  #ifdef _TIMING
-  gettimeofday(&stop, NULL);
-  mapping_batch->func_times[FUNC_OTHER] += 
-    ((stop.tv_sec - start.tv_sec) + (stop.tv_usec - start.tv_usec) / 1000000.0f);  
-  #endif
+  profiler_stop(PROF_OTHER, prof_time);
 
   // first step, searching mappings in both strands
   // distance between seeds >= prefix value (sa_index->k_value)
@@ -1208,24 +1136,11 @@ array_list_t *create_cals(int num_seeds, fastq_read_t *read,
       printf("\tread pos. = %lu\n", read_pos);
       #endif
 
-      #ifdef _TIMING
-      gettimeofday(&start, NULL);
-      #endif
+      prof_time = profiler_start(PROF_SEARCH_SUFFIX);
       num_suffixes = search_suffix(&r_seq[read_pos], sa_index->k_value, 
 				   MAX_NUM_SUFFIXES, sa_index, 
-				   &low, &high, &suffix_len
-                                   #ifdef _TIMING
-				   , &prefix_time, &suffix_time
-                                   #endif
-				   );
-      #ifdef _TIMING
-      gettimeofday(&stop, NULL);
-      mapping_batch->func_times[FUNC_SEARCH_SUFFIX] += 
-	((stop.tv_sec - start.tv_sec) + (stop.tv_usec - start.tv_usec) / 1000000.0f);  
-
-      mapping_batch->func_times[FUNC_SEARCH_PREFIX] += prefix_time;
-      mapping_batch->func_times[FUNC_SEARCH_SA] +=  suffix_time;
-      #endif
+				   &low, &high, &suffix_len);
+      profiler_stop(PROF_SEARCH_SUFFIX, prof_time);
       
       #ifdef _VERBOSE	  
       printf("\t\tnum. suffixes = %lu (suffix length = %lu)\n", num_suffixes, suffix_len);
@@ -1238,32 +1153,16 @@ array_list_t *create_cals(int num_seeds, fastq_read_t *read,
 	
 	// exact search
 	if (suffix_len == read->length) {
-          #ifdef _TIMING
-	  gettimeofday(&start, NULL);
-          #endif
+	  prof_time = profiler_start(PROF_CALS_FROM_EXACT_READ);
 	  generate_cals_from_exact_read(strand, read, low, high, 
 					sa_index, cal_mng);
-          #ifdef _TIMING
-	  gettimeofday(&stop, NULL);
-	  mapping_batch->func_times[FUNC_CALS_FROM_EXACT_READ] += 
-	    ((stop.tv_sec - start.tv_sec) + (stop.tv_usec - start.tv_usec) / 1000000.0f);  
-          #endif
+	  profiler_stop(PROF_CALS_FROM_EXACT_READ, prof_time);
 	  break;
 	} else {
-          #ifdef _TIMING
-	  gettimeofday(&start, NULL);
-          #endif
+	  prof_time = profiler_start(PROF_CALS_FROM_SUFFIXES);
 	  generate_cals_from_suffixes(strand, read,
-				      read_pos, suffix_len, low, high, sa_index, cal_mng
-                                      #ifdef _TIMING
-				      , mapping_batch
-                                      #endif
-				      );
-          #ifdef _TIMING
-	  gettimeofday(&stop, NULL);
-	  mapping_batch->func_times[FUNC_CALS_FROM_SUFFIXES] += 
-	    ((stop.tv_sec - start.tv_sec) + (stop.tv_usec - start.tv_usec) / 1000000.0f);  
-          #endif
+				      read_pos, suffix_len, low, high, sa_index, cal_mng);
+	  profiler_stop(PROF_CALS_FROM_SUFFIXES, prof_time);
 	}
       }
       read_pos += read_inc;
@@ -1275,24 +1174,11 @@ array_list_t *create_cals(int num_seeds, fastq_read_t *read,
       printf("\tread pos. = %lu\n", read_pos);
       #endif
 
-      #ifdef _TIMING
-      gettimeofday(&start, NULL);
-      #endif
+      prof_time = profiler_start(PROF_SEARCH_SUFFIX);
       num_suffixes = search_suffix(&r_seq[read_pos], sa_index->k_value, 
 				   MAX_NUM_SUFFIXES, sa_index, 
-				   &low, &high, &suffix_len
-                                   #ifdef _TIMING
-				   , &prefix_time, &suffix_time
-                                   #endif
-				   );
-      #ifdef _TIMING
-      gettimeofday(&stop, NULL);
-      mapping_batch->func_times[FUNC_SEARCH_SUFFIX] += 
-	((stop.tv_sec - start.tv_sec) + (stop.tv_usec - start.tv_usec) / 1000000.0f);  
-
-      mapping_batch->func_times[FUNC_SEARCH_PREFIX] += prefix_time;
-      mapping_batch->func_times[FUNC_SEARCH_SA] +=  suffix_time;
-      #endif
+				   &low, &high, &suffix_len);
+      profiler_stop(PROF_SEARCH_SUFFIX, prof_time);
       
       #ifdef _VERBOSE	  
       printf("\t\tnum. suffixes = %lu (suffix length = %lu)\n", num_suffixes, suffix_len);
@@ -1302,34 +1188,18 @@ array_list_t *create_cals(int num_seeds, fastq_read_t *read,
 	display_suffix_mappings(strand, read_pos, suffix_len, low, high, sa_index);
         #endif 
 	
-        #ifdef _TIMING
-	gettimeofday(&start, NULL);
-        #endif
+	prof_time = profiler_start(PROF_CALS_FROM_SUFFIXES);
 	read_pos += generate_cals_from_suffixes(strand, read,
-						read_pos, suffix_len, low, high, sa_index, cal_mng
-                                                #ifdef _TIMING
-						, mapping_batch
-                                                #endif
-						);
-        #ifdef _TIMING
-	gettimeofday(&stop, NULL);
-	mapping_batch->func_times[FUNC_CALS_FROM_SUFFIXES] += 
-	  ((stop.tv_sec - start.tv_sec) + (stop.tv_usec - start.tv_usec) / 1000000.0f);  
-        #endif
+						read_pos, suffix_len, low, high, sa_index, cal_mng);
+	profiler_stop(PROF_CALS_FROM_SUFFIXES, prof_time);
       }
     }
 
     // update cal list from cal manager
-    #ifdef _TIMING
-    gettimeofday(&start, NULL);
-    #endif
+    prof_time = profiler_start(PROF_CAL_MNG_TO_LIST);
 
     cal_mng_to_array_list(read->length / 3, cal_list, cal_mng);
-    #ifdef _TIMING
-    gettimeofday(&stop, NULL);
-    mapping_batch->func_times[FUNC_CAL_MNG_TO_LIST] += 
-      ((stop.tv_sec - start.tv_sec) + (stop.tv_usec - start.tv_usec) / 1000000.0f);  
-    #endif
+    profiler_stop(PROF_CAL_MNG_TO_LIST, prof_time);
     
     // next, - strand
     r_seq = read->revcomp;
@@ -1651,13 +1521,9 @@ int prepare_sw(fastq_read_t *read,   array_list_t *sw_prepare_list,
   printf("\n\n====>>>> STEP THREE : prepare_sw <<<<====\n");
   #endif
 
-  #ifdef _TIMING
-  struct timeval stop, start;
-  #endif
+  uint64_t prof_time;
 
-  #ifdef _TIMING
-  gettimeofday(&start, NULL);
-  #endif
+  prof_time = profiler_start(PROF_PRE_SW);
 
   char *seq, *ref;
   seed_t *prev_seed, *seed;
@@ -1901,6 +1767,8 @@ int prepare_sw(fastq_read_t *read,   array_list_t *sw_prepare_list,
     
     num_total_sw += num_sw;
   }
+
+  profiler_stop(PROF_PRE_SW, prof_time);
   
   return num_total_sw;
 }
@@ -1909,9 +1777,9 @@ int prepare_sw(fastq_read_t *read,   array_list_t *sw_prepare_list,
 
 void execute_sw(array_list_t *sw_prepare_list, sa_mapping_batch_t *mapping_batch) {
 
-  #ifdef _TIMING
-  struct timeval stop, start;
-  #endif
+  uint64_t prof_time;
+
+  prof_time = profiler_start(PROF_PRE_SW);
 
   sw_prepare_t *sw_prepare;
 
@@ -1937,15 +1805,9 @@ void execute_sw(array_list_t *sw_prepare_list, sa_mapping_batch_t *mapping_batch
     #endif
   }
   
-  #ifdef _TIMING
-  gettimeofday(&stop, NULL);
-  mapping_batch->func_times[FUNC_PRE_SW] += 
-    ((stop.tv_sec - start.tv_sec) + (stop.tv_usec - start.tv_usec) / 1000000.0f);  
-  #endif
+  profiler_stop(PROF_PRE_SW, prof_time);
 
-  #ifdef _TIMING
-  gettimeofday(&start, NULL);
-  #endif
+  prof_time = profiler_start(PROF_SW_EXECUTION);
 
   sw_multi_output_t *sw_output = sw_multi_output_new(sw_count);
   smith_waterman_mqmr(q, r, sw_count, &sw_optarg, 1, sw_output);
@@ -1953,15 +1815,9 @@ void execute_sw(array_list_t *sw_prepare_list, sa_mapping_batch_t *mapping_batch
   sw_multi_output_save(sw_count, sw_output, stdout);
   #endif
 
-  #ifdef _TIMING
-  gettimeofday(&stop, NULL);
-  mapping_batch->func_times[FUNC_SW] += 
-    ((stop.tv_sec - start.tv_sec) + (stop.tv_usec - start.tv_usec) / 1000000.0f);  
-  #endif
+  profiler_stop(PROF_SW_EXECUTION, prof_time);
 
-  #ifdef _TIMING
-  gettimeofday(&start, NULL);
-  #endif
+  prof_time = profiler_start(PROF_POST_SW);
 
   // process Smith-Waterman output
   seed_t *seed;
@@ -2092,11 +1948,7 @@ void execute_sw(array_list_t *sw_prepare_list, sa_mapping_batch_t *mapping_batch
   // free memory
   sw_multi_output_free(sw_output);
 
-  #ifdef _TIMING
-  gettimeofday(&stop, NULL);
-  mapping_batch->func_times[FUNC_POST_SW] += 
-    ((stop.tv_sec - start.tv_sec) + (stop.tv_usec - start.tv_usec) / 1000000.0f);  
-  #endif
+  profiler_stop(PROF_POST_SW, prof_time);
 }
 
 //--------------------------------------------------------------------
@@ -2104,13 +1956,9 @@ void execute_sw(array_list_t *sw_prepare_list, sa_mapping_batch_t *mapping_batch
 void post_process_sw(int sw_post_read_counter, int *sw_post_read,   
 		     array_list_t **cal_lists, sa_mapping_batch_t *mapping_batch) {
 
-  #ifdef _TIMING
-  struct timeval stop, start;
-  #endif
+  uint64_t prof_time;
 
-  #ifdef _TIMING
-  gettimeofday(&start, NULL);
-  #endif
+  prof_time = profiler_start(PROF_POST_SW);
 
   int num_cals, cigar_type;
   array_list_t *cal_list;
@@ -2188,11 +2036,7 @@ void post_process_sw(int sw_post_read_counter, int *sw_post_read,
     }
   }
 
-  #ifdef _TIMING
-  gettimeofday(&stop, NULL);
-  mapping_batch->func_times[FUNC_POST_SW] += 
-    ((stop.tv_sec - start.tv_sec) + (stop.tv_usec - start.tv_usec) / 1000000.0f);  
-  #endif
+  profiler_stop(PROF_POST_SW, prof_time);
 }
 
 //--------------------------------------------------------------------
@@ -2201,13 +2045,9 @@ void post_process_sw(int sw_post_read_counter, int *sw_post_read,
 
 int sa_single_mapper(void *data) {
 
-  #ifdef _TIMING
-  struct timeval stop, start;
-  #endif
+  uint64_t prof_time;
 
-  #ifdef _TIMING
-  gettimeofday(&start, NULL);
-  #endif
+  prof_time = profiler_start(PROF_OTHER);
   
   sa_wf_batch_t *wf_batch = (sa_wf_batch_t *) data;
 
@@ -2246,20 +2086,28 @@ int sa_single_mapper(void *data) {
   fastq_read_t *read;
 
   cal_mng = cal_mng_new(sa_index->genome);
-  #ifdef _TIMING
-  gettimeofday(&stop, NULL);
-  mapping_batch->func_times[FUNC_OTHER] += 
-    ((stop.tv_sec - start.tv_sec) + (stop.tv_usec - start.tv_usec) / 1000000.0f);  
-  #endif
+  profiler_stop(PROF_OTHER, prof_time);
+
+  // reverse-complementary sequences and adapters, for the whole batch
+  // before seeding
+  prof_time = profiler_start(PROF_ADAPTERS);
+  if (mapping_batch->arena) {
+    sa_read_arena_revcomp(mapping_batch->arena);
+  } else {
+    for (int i = 0; i < num_reads; i++) {
+      fastq_read_revcomp(array_list_get(i, mapping_batch->fq_reads));
+    }
+  }
+  if (wf_batch->options->adapter) {
+    adapter_set_t adapters;
+    adapter_set_init(wf_batch->options->adapter, &adapters);
+    cut_adapters_batch(&adapters, 0, mapping_batch->fq_reads);
+  }
+  profiler_stop(PROF_ADAPTERS, prof_time);
 
   // for each read, create cals and prepare sw
   for (int i = 0; i < num_reads; i++) {
     read = array_list_get(i, mapping_batch->fq_reads);
-    fastq_read_revcomp(read);
-
-    if (wf_batch->options->adapter) {
-      cut_adapter(wf_batch->options->adapter, wf_batch->options->adapter_length, read);
-    }
 
     // 1) extend using mini-sw from suffix
     cal_list = create_cals(num_seeds, read, mapping_batch, sa_index, cal_mng);
@@ -2308,33 +2156,21 @@ int sa_single_mapper(void *data) {
     
     if (array_list_size(cal_list) > 0) {
       // filter by score
-      #ifdef _TIMING
-      gettimeofday(&start, NULL);
-      #endif
+      prof_time = profiler_start(PROF_FILTER_BY_NUM_MISMATCHES);
       max_score = get_max_score(cal_list, match_score, mismatch_penalty,
 				gap_open_penalty, gap_extend_penalty);
       #ifdef _VERBOSE
       printf("\n******* after SW> max. score = %0.2f (read %s)\n", max_score, read->id);
       #endif
       filter_cals_by_max_score(max_score, &cal_list);
-      #ifdef _TIMING
-      gettimeofday(&stop, NULL);
-      mapping_batch->func_times[FUNC_FILTER_BY_NUM_MISMATCHES] += 
-	((stop.tv_sec - start.tv_sec) + (stop.tv_usec - start.tv_usec) / 1000000.0f);  
-      #endif
+      profiler_stop(PROF_FILTER_BY_NUM_MISMATCHES, prof_time);
     }
     
     // if BAM format, create alignments structures
     if (bam_format) {
-      #ifdef _TIMING
-      gettimeofday(&start, NULL);
-      #endif
+      prof_time = profiler_start(PROF_CREATE_ALIGNMENTS);
       create_alignments(cal_list, read, bam_format, mapping_batch->mapping_lists[i]);
-      #ifdef _TIMING
-      gettimeofday(&stop, NULL);
-      mapping_batch->func_times[FUNC_CREATE_ALIGNMENTS] += 
-	((stop.tv_sec - start.tv_sec) + (stop.tv_usec - start.tv_usec) / 1000000.0f);  
-      #endif
+      profiler_stop(PROF_CREATE_ALIGNMENTS, prof_time);
       
       // free cal list and clear seed manager for next read
       array_list_free(cal_list, (void *) NULL);
@@ -2347,15 +2183,9 @@ int sa_single_mapper(void *data) {
   } // end of for reads
   
   // free memory
-  #ifdef _TIMING
-  gettimeofday(&start, NULL);
-  #endif
+  prof_time = profiler_start(PROF_OTHER);
   cal_mng_free(cal_mng);
-  #ifdef _TIMING
-  gettimeofday(&stop, NULL);
-  mapping_batch->func_times[FUNC_OTHER] += 
-    ((stop.tv_sec - start.tv_sec) + (stop.tv_usec - start.tv_usec) / 1000000.0f);  
-  #endif
+  profiler_stop(PROF_OTHER, prof_time);
   
   return -1;
 }
@@ -2364,13 +2194,9 @@ int sa_single_mapper(void *data) {
 
 int sa_pair_mapper(void *data) {
 
-  #ifdef _TIMING
-  struct timeval stop, start;
-  #endif
+  uint64_t prof_time;
 
-  #ifdef _TIMING
-  gettimeofday(&start, NULL);
-  #endif
+  prof_time = profiler_start(PROF_OTHER);
   
   sa_wf_batch_t *wf_batch = (sa_wf_batch_t *) data;
 
@@ -2409,20 +2235,28 @@ int sa_pair_mapper(void *data) {
   fastq_read_t *read;
 
   cal_mng = cal_mng_new(sa_index->genome);
-  #ifdef _TIMING
-  gettimeofday(&stop, NULL);
-  mapping_batch->func_times[FUNC_OTHER] += 
-    ((stop.tv_sec - start.tv_sec) + (stop.tv_usec - start.tv_usec) / 1000000.0f);  
-  #endif
+  profiler_stop(PROF_OTHER, prof_time);
+
+  // reverse-complementary sequences and adapters, for the whole batch
+  // before seeding
+  prof_time = profiler_start(PROF_ADAPTERS);
+  if (mapping_batch->arena) {
+    sa_read_arena_revcomp(mapping_batch->arena);
+  } else {
+    for (int i = 0; i < num_reads; i++) {
+      fastq_read_revcomp(array_list_get(i, mapping_batch->fq_reads));
+    }
+  }
+  if (wf_batch->options->adapter) {
+    adapter_set_t adapters;
+    adapter_set_init(wf_batch->options->adapter, &adapters);
+    cut_adapters_batch(&adapters, 1, mapping_batch->fq_reads);
+  }
+  profiler_stop(PROF_ADAPTERS, prof_time);
 
   // for each read, create cals and prepare sw
   for (int i = 0; i < num_reads; i++) {
     read = array_list_get(i, mapping_batch->fq_reads);
-    fastq_read_revcomp(read);
-
-    if (wf_batch->options->adapter) {
-      cut_adapter(wf_batch->options->adapter, wf_batch->options->adapter_length, read);
-    }
 
     // 1) extend using mini-sw from suffix
     cal_list = create_cals(num_seeds, read, mapping_batch, sa_index, cal_mng);
@@ -2504,15 +2338,9 @@ int sa_pair_mapper(void *data) {
     //for (int i = 0; i < array_list_size(cal_list); i++) { seed_cal_print(array_list_get(i, cal_list)); }
 
     // create alignments structures
-    #ifdef _TIMING
-    gettimeofday(&start, NULL);
-    #endif
+    prof_time = profiler_start(PROF_CREATE_ALIGNMENTS);
     create_alignments(cal_list, read, bam_format, mapping_batch->mapping_lists[i]);
-    #ifdef _TIMING
-    gettimeofday(&stop, NULL);
-    mapping_batch->func_times[FUNC_CREATE_ALIGNMENTS] += 
-      ((stop.tv_sec - start.tv_sec) + (stop.tv_usec - start.tv_usec) / 1000000.0f);  
-    #endif
+    profiler_stop(PROF_CREATE_ALIGNMENTS, prof_time);
       
     // free cal list and clear seed manager for next read
     array_list_free(cal_list, (void *) NULL);
@@ -2521,15 +2349,9 @@ int sa_pair_mapper(void *data) {
   complete_pairs(mapping_batch);
 
   // free memory
-  #ifdef _TIMING
-  gettimeofday(&start, NULL);
-  #endif
+  prof_time = profiler_start(PROF_OTHER);
   cal_mng_free(cal_mng);
-  #ifdef _TIMING
-  gettimeofday(&stop, NULL);
-  mapping_batch->func_times[FUNC_OTHER] += 
-    ((stop.tv_sec - start.tv_sec) + (stop.tv_usec - start.tv_usec) / 1000000.0f);  
-  #endif
+  profiler_stop(PROF_OTHER, prof_time);
   
   return -1;
 }
@@ -0,0 +1,275 @@
+#include "sa_read_arena.h"
+
+#include "commons/log.h"
+#include "aux/aux_nt_simd.h"
+
+//--------------------------------------------------------------------
+// FastQ file buffer
+//--------------------------------------------------------------------
+
+sa_fq_buffer_t *sa_fq_buffer_new(FILE *fd) {
+  sa_fq_buffer_t *p = (sa_fq_buffer_t *) calloc(1, sizeof(sa_fq_buffer_t));
+  p->fd = fd;
+  p->size = SA_FQ_BUFFER_SIZE;
+  p->data = (char *) malloc(p->size);
+  return p;
+}
+
+//--------------------------------------------------------------------
+
+void sa_fq_buffer_free(sa_fq_buffer_t *p) {
+  if (p) {
+    if (p->data) free(p->data);
+    free(p);
+  }
+}
+
+//--------------------------------------------------------------------
+
+static inline int sa_fq_line_length(char *line, int len) {
+  return (len > 0 && line[len - 1] == '\r' ? len - 1 : len);
+}
+
+// next record of the buffer: its four lines (not terminated) and the
+// bytes it takes in the file; 0 at the end of the file
+static int sa_fq_buffer_record(sa_fq_buffer_t *p, char *lines[4], int lens[4], size_t *bytes) {
+  char *nl;
+  size_t pos, skipped;
+  int n;
+
+  while (1) {
+    // blank lines between records
+    for (skipped = 0; p->start < p->end && (p->data[p->start] == '\n' || p->data[p->start] == '\r'); skipped++) {
+      p->start++;
+    }
+
+    pos = p->start;
+    n = 0;
+    while (n < 4 && pos < p->end && (nl = memchr(p->data + pos, '\n', p->end - pos))) {
+      lines[n] = p->data + pos;
+      lens[n] = nl - lines[n];
+      pos = nl - p->data + 1;
+      n++;
+    }
+    // no newline at the end of the file
+    if (n == 3 && p->eof && pos < p->end) {
+      lines[n] = p->data + pos;
+      lens[n] = p->end - pos;
+      pos = p->end;
+      n++;
+    }
+
+    if (n == 4) {
+      for (int i = 0; i < 4; i++) {
+	lens[i] = sa_fq_line_length(lines[i], lens[i]);
+      }
+      *bytes = skipped + pos - p->start;
+      p->start = pos;
+      return 1;
+    }
+
+    if (p->eof) {
+      if (p->start < p->end) {
+	LOG_FATAL("Incomplete FastQ record at the end of the file\n");
+      }
+      return 0;
+    }
+
+    // more data, after the incomplete record (moved to the beginning)
+    if (p->start > 0) {
+      memmove(p->data, p->data + p->start, p->end - p->start);
+      p->end -= p->start;
+      p->start = 0;
+    } else if (p->end == p->size) {
+      p->size *= 2;
+      p->data = (char *) realloc(p->data, p->size);
+    }
+    size_t read_bytes = fread(p->data + p->end, 1, p->size - p->end, p->fd);
+    if (read_bytes == 0) p->eof = 1;
+    p->end += read_bytes;
+  }
+}
+
+//--------------------------------------------------------------------
+// read arena
+//--------------------------------------------------------------------
+
+sa_read_arena_t *sa_read_arena_new(size_t size) {
+  sa_read_arena_t *p = (sa_read_arena_t *) malloc(sizeof(sa_read_arena_t));
+
+  p->num_reads = 0;
+  p->max_reads = (size / 256 > 1024 ? size / 256 : 1024);
+  p->offsets = (sa_read_offset_t *) malloc(p->max_reads * sizeof(sa_read_offset_t));
+  p->reads = (fastq_read_t *) malloc(p->max_reads * sizeof(fastq_read_t));
+
+  p->size = (size > 4096 ? size : 4096);
+  p->used = 0;
+  p->data = (char *) malloc(p->size);
+
+  return p;
+}
+
+//--------------------------------------------------------------------
+
+void sa_read_arena_free(sa_read_arena_t *p) {
+  if (p) {
+    if (p->offsets) free(p->offsets);
+    if (p->reads) free(p->reads);
+    if (p->data) free(p->data);
+    free(p);
+  }
+}
+
+//--------------------------------------------------------------------
+
+// header line to read id: no '@', up to the first blank, and without
+// the mate suffix (/1, /2) in paired mode
+static inline int sa_read_id_length(char *header, int len, int paired) {
+  int id_len = 0;
+  while (id_len < len && header[id_len] != ' ' && header[id_len] != '\t') {
+    id_len++;
+  }
+  if (paired && id_len > 2 && header[id_len - 2] == '/' &&
+      (header[id_len - 1] == '1' || header[id_len - 1] == '2')) {
+    id_len -= 2;
+  }
+  return id_len;
+}
+
+//--------------------------------------------------------------------
+
+static void sa_read_arena_add(char *lines[4], int lens[4], int paired, sa_read_arena_t *arena) {
+  char *header = lines[0];
+  int header_len = lens[0];
+  if (header_len > 0 && header[0] == '@') {
+    header++;
+    header_len--;
+  }
+  int id_len = sa_read_id_length(header, header_len, paired);
+  int len = lens[1];
+
+  if (lens[3] != len) {
+    LOG_FATAL_F("FastQ read %.*s: sequence and quality of different lengths\n", id_len, header);
+  }
+
+  // id, sequence, quality and revcomp
+  size_t needed = id_len + 1 + 3 * ((size_t) len + 1);
+  if (arena->used + needed > arena->size) {
+    while (arena->used + needed > arena->size) arena->size *= 2;
+    arena->data = (char *) realloc(arena->data, arena->size);
+  }
+  if (arena->num_reads == arena->max_reads) {
+    arena->max_reads *= 2;
+    arena->offsets = (sa_read_offset_t *) realloc(arena->offsets, arena->max_reads * sizeof(sa_read_offset_t));
+    arena->reads = (fastq_read_t *) realloc(arena->reads, arena->max_reads * sizeof(fastq_read_t));
+  }
+
+  sa_read_offset_t *offset = &arena->offsets[arena->num_reads];
+  char *p = arena->data + arena->used;
+
+  offset->id = arena->used;
+  memcpy(p, header, id_len);
+  p[id_len] = 0;
+  p += id_len + 1;
+
+  offset->sequence = p - arena->data;
+  memcpy(p, lines[1], len);
+  p[len] = 0;
+  p += len + 1;
+
+  memcpy(p, lines[3], len);
+  p[len] = 0;
+  p += len + 1;
+
+  p[0] = 0;
+  arena->used += needed;
+
+  fastq_read_t *read = &arena->reads[arena->num_reads];
+  memset(read, 0, sizeof(fastq_read_t));
+  read->length = len;
+
+  arena->num_reads++;
+}
+
+//--------------------------------------------------------------------
+
+// the arena may have moved while it was filled, the reads point into
+// it once it is complete
+static void sa_read_arena_set_pointers(sa_read_arena_t *arena) {
+  fastq_read_t *read;
+  for (size_t i = 0; i < arena->num_reads; i++) {
+    read = &arena->reads[i];
+    read->id = arena->data + arena->offsets[i].id;
+    read->sequence = arena->data + arena->offsets[i].sequence;
+    read->quality = read->sequence + read->length + 1;
+    read->revcomp = read->quality + read->length + 1;
+  }
+}
+
+//--------------------------------------------------------------------
+
+size_t sa_read_arena_fill_se(size_t max_bytes, sa_fq_buffer_t *fq, sa_read_arena_t *arena) {
+  char *lines[4];
+  int lens[4];
+  size_t bytes, total_bytes = 0;
+
+  while (total_bytes < max_bytes && sa_fq_buffer_record(fq, lines, lens, &bytes)) {
+    sa_read_arena_add(lines, lens, 0, arena);
+    total_bytes += bytes;
+  }
+  sa_read_arena_set_pointers(arena);
+
+  return total_bytes;
+}
+
+//--------------------------------------------------------------------
+
+size_t sa_read_arena_fill_pe(size_t max_bytes, sa_fq_buffer_t *fq1, sa_fq_buffer_t *fq2,
+			     sa_read_arena_t *arena) {
+  char *lines[4];
+  int lens[4];
+  size_t bytes, total_bytes = 0;
+  int more1, more2;
+
+  while (total_bytes < max_bytes) {
+    // records are copied before the next one is parsed, the lines
+    // point into the file buffer
+    if ((more1 = sa_fq_buffer_record(fq1, lines, lens, &bytes))) {
+      sa_read_arena_add(lines, lens, 1, arena);
+      total_bytes += bytes;
+    }
+    if ((more2 = sa_fq_buffer_record(fq2, lines, lens, &bytes))) {
+      sa_read_arena_add(lines, lens, 1, arena);
+      total_bytes += bytes;
+    }
+    if (more1 != more2) {
+      LOG_FATAL("Paired-end FastQ files with different number of reads\n");
+    }
+    if (!more1) break;
+  }
+  sa_read_arena_set_pointers(arena);
+
+  return total_bytes;
+}
+
+//--------------------------------------------------------------------
+
+void sa_read_arena_to_list(sa_read_arena_t *arena, array_list_t *reads) {
+  for (size_t i = 0; i < arena->num_reads; i++) {
+    array_list_insert(&arena->reads[i], reads);
+  }
+}
+
+//--------------------------------------------------------------------
+
+void sa_read_arena_revcomp(sa_read_arena_t *arena) {
+  fastq_read_t *read;
+  for (size_t r = 0; r < arena->num_reads; r++) {
+    read = &arena->reads[r];
+    simd_nt_revcomp(read->sequence, read->length, read->revcomp);
+    read->revcomp[read->length] = 0;
+  }
+}
+
+//--------------------------------------------------------------------
+//--------------------------------------------------------------------
@@ -0,0 +1,83 @@
+#ifndef _SA_READ_ARENA_H
+#define _SA_READ_ARENA_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "containers/array_list.h"
+#include "bioformats/fastq/fastq_read.h"
+
+//--------------------------------------------------------------------
+// Reads of a batch in a single arena: for every read, its id,
+// sequence, quality and the room for its reverse-complementary, one
+// after the other, and the fastq_read_t structs pointing into it. The
+// FastQ records are parsed straight from large file buffers into the
+// arena, so a batch costs a handful of allocations whatever its number
+// of reads, and it is freed at once with its mapping batch.
+//
+// Only the adapters clipped from the reads (few) are still allocated
+// on their own. Arenas are used for plain FastQ input only: reads from
+// gzip FastQ and BAM inputs are still allocated one by one by their
+// hpg-libs readers, and their batches have no arena.
+//--------------------------------------------------------------------
+
+#define SA_FQ_BUFFER_SIZE      (4 * 1024 * 1024)
+
+//--------------------------------------------------------------------
+
+// input buffer of a FastQ file, the records of a batch are parsed from
+// it; it keeps the incomplete record at its end for the next batch
+typedef struct sa_fq_buffer {
+  FILE *fd;
+  char *data;
+  size_t size;
+  size_t start;
+  size_t end;
+  int eof;
+} sa_fq_buffer_t;
+
+sa_fq_buffer_t *sa_fq_buffer_new(FILE *fd);
+void sa_fq_buffer_free(sa_fq_buffer_t *p);
+
+//--------------------------------------------------------------------
+
+// offsets of a read in the arena, quality and revcomp follow the
+// sequence (length + 1 bytes each)
+typedef struct sa_read_offset {
+  size_t id;
+  size_t sequence;
+} sa_read_offset_t;
+
+typedef struct sa_read_arena {
+  size_t num_reads;
+  size_t max_reads;
+  sa_read_offset_t *offsets;
+  fastq_read_t *reads;
+
+  size_t size;
+  size_t used;
+  char *data;
+} sa_read_arena_t;
+
+//--------------------------------------------------------------------
+
+sa_read_arena_t *sa_read_arena_new(size_t size);
+void sa_read_arena_free(sa_read_arena_t *p);
+
+// parse records until max_bytes of the file(s) are read, mates one
+// after the other in paired mode; it returns the bytes read
+size_t sa_read_arena_fill_se(size_t max_bytes, sa_fq_buffer_t *fq, sa_read_arena_t *arena);
+size_t sa_read_arena_fill_pe(size_t max_bytes, sa_fq_buffer_t *fq1, sa_fq_buffer_t *fq2,
+			     sa_read_arena_t *arena);
+
+// the reads into a list, for the mapping batch
+void sa_read_arena_to_list(sa_read_arena_t *arena, array_list_t *reads);
+
+// reverse-complementary sequences of the reads, in their arena slots
+void sa_read_arena_revcomp(sa_read_arena_t *arena);
+
+//--------------------------------------------------------------------
+//--------------------------------------------------------------------
+
+#endif // _SA_READ_ARENA_H
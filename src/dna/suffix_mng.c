@@ -450,7 +450,7 @@ void suffix_mng_search_read_cals(fastq_read_t *read, int num_seeds,
 				 suffix_mng_t *suffix_mng) {
   int num_suffixes, max_suffixes = MAX_NUM_SUFFIXES;
   unsigned short int chrom;
-  size_t suffix_len;
+  size_t suffix_len = 0;
   size_t low, high, r_start_suf, r_end_suf, g_start_suf, g_end_suf;
 
   int read_pos, read_inc = read->length / num_seeds;
@@ -462,42 +462,44 @@ void suffix_mng_search_read_cals(fastq_read_t *read, int num_seeds,
   int read_end_pos = read->length - sa_index->k_value;
   int extra_seed = (read->length - sa_index->k_value) % read_inc;
 
+  // seed offsets, the same for both strands: every read_inc bases and
+  // the extra seed at the end
+  int num_seeds_grid = 0, num_seeds_all;
+  int max_seeds = read->length / read_inc + 2;
+  int seed_pos[max_seeds];
+  size_t seed_values[max_seeds], seed_lows[max_seeds], seed_highs[max_seeds];
+  size_t seed_prefixes[max_seeds];
+
+  for (read_pos = 0; read_pos < read_end_pos; read_pos += read_inc)  {	
+    seed_pos[num_seeds_grid++] = read_pos;
+  }
+  num_seeds_all = num_seeds_grid;
+  if (extra_seed && read_end_pos > 0) {
+    seed_pos[num_seeds_all++] = read_end_pos;
+  }
+
   // first step, searching mappings in both strands
   // distance between seeds >= prefix value (sa_index->k_value)
   char *r_seq = read->sequence;
   for (int strand = 0; strand < 2; strand++) {
-    for (read_pos = 0; read_pos < read_end_pos; read_pos += read_inc)  {	
-      num_suffixes = search_suffix(&r_seq[read_pos], sa_index->k_value, 
-				   max_suffixes, sa_index, 
-				   &low, &high, &suffix_len
-                                   #ifdef _TIMING
-				   , &prefix_time, &suffix_time
-                                   #endif
-				   );
-      if (num_suffixes < max_suffixes && suffix_len) {
-	for (size_t suff = low; suff <= high; suff++) {
-	  chrom = sa_index->CHROM[suff];
-	  // extend suffix to right side
-	  r_start_suf = read_pos;
-	  r_end_suf = r_start_suf + suffix_len - 1;
-	  
-	  g_start_suf = sa_index->SA[suff] - sa_index->genome->chrom_offsets[chrom];
-	  g_end_suf = g_start_suf + suffix_len - 1;
-	  
-	  suffix_mng_update(chrom, r_start_suf, r_end_suf, g_start_suf, g_end_suf, suffix_mng);
-	}
-      }
-    } // end of for read_pos
-    
-    if (suffix_len != read->length && extra_seed) {
-      read_pos = read->length - sa_index->k_value;
-      num_suffixes = search_suffix(&r_seq[read_pos], sa_index->k_value, 
-				   max_suffixes, sa_index, 
-				   &low, &high, &suffix_len
-                                   #ifdef _TIMING
-				   , &prefix_time, &suffix_time
-                                   #endif
-				   );
+    // prefixes of all the seeds of the strand at once
+    uint64_t prof_time = profiler_start(PROF_SEARCH_PREFIX);
+    compute_seed_prefix_values(r_seq, read->length, sa_index->k_value, 
+			       num_seeds_all, seed_pos, seed_values);
+    search_prefixes(num_seeds_all, seed_values, seed_lows, seed_highs, 
+		    seed_prefixes, sa_index);
+    profiler_stop(PROF_SEARCH_PREFIX, prof_time);
+
+    for (int seed = 0; seed < num_seeds_all; seed++) {
+      // no extra seed after an exact read
+      if (seed == num_seeds_grid && suffix_len == read->length) break;
+
+      read_pos = seed_pos[seed];
+      low = seed_lows[seed];
+      high = seed_highs[seed];
+      num_suffixes = search_suffix_from_prefix(&r_seq[read_pos], seed_prefixes[seed], 
+					       max_suffixes, sa_index, 
+					       &low, &high, &suffix_len);
       if (num_suffixes < max_suffixes && suffix_len) {
 	for (size_t suff = low; suff <= high; suff++) {
 	  chrom = sa_index->CHROM[suff];
@@ -511,7 +513,7 @@ void suffix_mng_search_read_cals(fastq_read_t *read, int num_seeds,
 	  suffix_mng_update(chrom, r_start_suf, r_end_suf, g_start_suf, g_end_suf, suffix_mng);
 	}
       }
-    }
+    } // end of for seed
 
     // using suffix manager instead of the previous cal manager
     suffix_mng_create_cals(read, read->length / 3, strand, 
@@ -2,6 +2,7 @@
 #include "rna/rna_aligner.h"
 
 #include "build-index/index_builder.h"
+#include "server.h"
 
 
 //--------------------------------------------------------------------
@@ -28,11 +29,6 @@ pthread_mutex_t mutex_sp;
 FILE *fd_log;
 size_t junction_id;
 
-size_t total_reads = 0;
-size_t reads_no_map = 0;
-
-size_t total_sw = 0;
-
 unsigned char mute;
 
 double time_write = 0;
@@ -62,13 +58,11 @@ pthread_mutex_t mutex_calls;
 size_t fd_read_bytes = 0;
 size_t fd_total_bytes = 0;
 
-size_t total_reads_ph2 = 0;
 size_t reads_ph2 = 0;
 
 int redirect_stdout = 0;
 int gziped_fileds = 0;
 
-st_bwt_t st_bwt;
 int w1_end;
 int w2_end;
 int w3_end;
@@ -86,6 +80,8 @@ void display_main_help() {
   printf("\trna: to map RNA sequences\n");
   printf("\tbuild-sa-index: to create the genome SA index (suffix array).\n");
   printf("\tbuild-bwt-index: to create the genome BWT index (only available for RNA mapping).\n");
+  printf("\tserver: to keep the SA index loaded and map the DNA jobs submitted to it\n");
+  printf("\tsubmit: to submit a DNA job to a running server\n");
   printf("\n");
   printf("Use -h or --help to display hpg-aligner options.\n");
   printf("Use -v or --version to display hpg-aligner version.\n");
@@ -95,6 +91,9 @@ void display_main_help() {
 // main parameters support
 //--------------------------------------------------------------------
 
+// the benchmarks link the globals above with their own main
+#ifndef HPG_NO_MAIN
+
 int main(int argc, char* argv[]) {
   redirect_stdout = 0;
   gziped_fileds = 0;
@@ -103,20 +102,6 @@ int main(int argc, char* argv[]) {
     redirect_stdout = 1;
   }
 
-  st_bwt.multi_alig = 0;
-  st_bwt.single_alig = 0;
-  st_bwt.total_reads = 0;
-  st_bwt.map_bwt = 0;
-
-  st_bwt.map_w1 = 0;
-  st_bwt.map_w2 = 0;
-  st_bwt.map_w3 = 0;
-
-  st_bwt.tot_sj = 0;
-  st_bwt.dif_sj = 0;
-  st_bwt.cannonical_sj = 0;
-  st_bwt.semi_cannonical_sj = 0;
-
   pthread_mutex_init(&mutex_sp, NULL);
 
   basic_st = basic_statistics_new();
@@ -145,18 +130,47 @@ int main(int argc, char* argv[]) {
 
   char *command = argv[1];  
 
+  // HPG_PROFILE=<file> profiles the run
+  profiler_init(argv[0]);
+
   argc -= 1;
   argv += 1;
   
   if(strcmp(command, "dna") != 0 && 
      strcmp(command, "rna") != 0 &&
      strcmp(command, "build-sa-index") != 0 &&
-     strcmp(command, "build-bwt-index") != 0) {
+     strcmp(command, "build-bwt-index") != 0 &&
+     strcmp(command, "server") != 0 &&
+     strcmp(command, "submit") != 0) {
     printf("Error: unknown command (%s)\n", command);
     display_main_help();
     exit(-1);
   }
 
+  //convert ASCII fill 
+  convert_ASCII['a'] = 'T';
+  convert_ASCII['A'] = 'T';
+
+  convert_ASCII['c'] = 'G';
+  convert_ASCII['C'] = 'G';
+
+  convert_ASCII['g'] = 'C';
+  convert_ASCII['G'] = 'C';
+
+  convert_ASCII['t'] = 'a';
+  convert_ASCII['T'] = 'A';
+
+  convert_ASCII['n'] = 'N';
+  convert_ASCII['N'] = 'N';
+
+  if (!strcmp(command, "submit")) {
+    exit(run_submit(argc, argv));
+  }
+
+  if (!strcmp(command, "server")) {
+    run_server(argc, argv);
+    exit(0);
+  }
 
   if (!strcmp(command, "build-bwt-index") || 
       !strcmp(command, "build-sa-index")) {
@@ -184,34 +198,23 @@ int main(int argc, char* argv[]) {
   init_log_custom(options->log_level, 1, "hpg-aligner.log", "w");
   LOG_DEBUG_F("Command Mode: %s\n", command);
 
-  //convert ASCII fill 
-  convert_ASCII['a'] = 'T';
-  convert_ASCII['A'] = 'T';
-
-  convert_ASCII['c'] = 'G';
-  convert_ASCII['C'] = 'G';
-
-  convert_ASCII['g'] = 'C';
-  convert_ASCII['G'] = 'C';
-
-  convert_ASCII['t'] = 'a';
-  convert_ASCII['T'] = 'A';
-
-  convert_ASCII['n'] = 'N';
-  convert_ASCII['N'] = 'N';
-
   
   if(strcmp(command, "dna") == 0) { 
     // DNA command
     validate_options(options);
+    metrics_start(options);
     dna_aligner(options);
   } else if (strcmp(command, "rna") == 0)  { 
     // RNA command
     validate_options(options);
+    metrics_start(options);
     rna_aligner(options);
   }
+  metrics_stop();
   options_free(options);
 
   return 0;
 
 }
+
+#endif // HPG_NO_MAIN
@@ -0,0 +1,419 @@
+#include "metrics.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "commons/log.h"
+
+#define METRICS_MAX_RECORD  4096
+
+extern size_t fd_read_bytes;
+extern size_t fd_total_bytes;
+
+//------------------------------------------------------------------------
+
+typedef struct metrics_sample {
+  double time;
+  size_t reads;
+  size_t bytes_in;
+  size_t bytes_out;
+  double cpu_time;
+} metrics_sample_t;
+
+typedef struct metrics {
+  int interval;
+  int num_threads;
+  FILE *file;
+  char *socket_path;
+  int socket_fd;
+  int wakeup[2];
+  pthread_t thread;
+
+  // everything below is protected by the mutex
+  pthread_mutex_t mutex;
+
+  char *output;
+  char phase[METRICS_MAX_LABEL];
+  double phase_start;
+
+  int num_stages;
+  char stage_labels[METRICS_MAX_STAGES][METRICS_MAX_LABEL];
+  workflow_t *wf;
+  workflow_SA_t *wf_SA;
+
+  double start;
+  metrics_sample_t last;
+} metrics_t;
+
+static metrics_t *metrics = NULL;
+
+//------------------------------------------------------------------------
+// sampling
+//------------------------------------------------------------------------
+
+static double metrics_now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//------------------------------------------------------------------------
+
+static void metrics_sample(metrics_sample_t *sample) {
+  sample->time = metrics_now();
+
+  // only one of them counts in every mode
+  sample->reads = thread_stats_get(ST_TOTAL_READS) + thread_stats_get(ST_BWT_TOTAL_READS) +
+    thread_stats_get(ST_SA_TOTAL_READS);
+
+  sample->bytes_in = __atomic_load_n(&fd_read_bytes, __ATOMIC_RELAXED);
+
+  struct stat st;
+  sample->bytes_out = (metrics->output && stat(metrics->output, &st) == 0) ? st.st_size : 0;
+
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  sample->cpu_time = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 +
+    ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+}
+
+//------------------------------------------------------------------------
+
+static size_t metrics_rss() {
+  size_t size, resident = 0;
+  FILE *f = fopen("/proc/self/statm", "r");
+  if (f) {
+    if (fscanf(f, "%lu %lu", &size, &resident) != 2) resident = 0;
+    fclose(f);
+  }
+  return resident * sysconf(_SC_PAGESIZE);
+}
+
+//------------------------------------------------------------------------
+// records
+//------------------------------------------------------------------------
+
+static void metrics_append(char *buf, size_t size, size_t *len, const char *fmt, ...) {
+  if (*len >= size) return;
+
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(buf + *len, size - *len, fmt, args);
+  va_end(args);
+
+  *len = (n < 0 || *len + n >= size) ? size : *len + n;
+}
+
+//------------------------------------------------------------------------
+
+// the current record, rates since the last periodic one; call it with
+// the mutex locked
+static size_t metrics_record(char *buf, size_t size, metrics_sample_t *cur) {
+  size_t len = 0;
+
+  metrics_sample(cur);
+  metrics_sample_t *last = &metrics->last;
+  double elapsed = cur->time - last->time;
+  if (elapsed <= 0) elapsed = 1e-9;
+
+  metrics_append(buf, size, &len, "{\"time\":%ld,\"elapsed\":%.1f,\"phase\":\"%s\"",
+		 (long) time(NULL), cur->time - metrics->start, metrics->phase);
+
+  metrics_append(buf, size, &len, ",\"reads\":%lu,\"reads_per_sec\":%.1f",
+		 cur->reads, (cur->reads - last->reads) / elapsed);
+
+  // bytes in go back to 0 at every input file
+  size_t bytes_in = cur->bytes_in >= last->bytes_in ? cur->bytes_in - last->bytes_in : cur->bytes_in;
+  metrics_append(buf, size, &len, ",\"bytes_in\":%lu,\"bytes_in_per_sec\":%.1f",
+		 cur->bytes_in, bytes_in / elapsed);
+
+  size_t total_bytes = __atomic_load_n(&fd_total_bytes, __ATOMIC_RELAXED);
+  if (total_bytes > 0 && cur->bytes_in > 0 && cur->bytes_in <= total_bytes) {
+    double eta = (cur->time - metrics->phase_start) * (total_bytes - cur->bytes_in) / cur->bytes_in;
+    metrics_append(buf, size, &len, ",\"bytes_in_total\":%lu,\"progress\":%.4f,\"eta\":%.0f",
+		   total_bytes, (double) cur->bytes_in / total_bytes, eta);
+  } else {
+    metrics_append(buf, size, &len, ",\"progress\":null,\"eta\":null");
+  }
+
+  size_t bytes_out = cur->bytes_out >= last->bytes_out ? cur->bytes_out - last->bytes_out : 0;
+  metrics_append(buf, size, &len, ",\"bytes_out\":%lu,\"bytes_out_per_sec\":%.1f",
+		 cur->bytes_out, bytes_out / elapsed);
+
+  // items waiting in every stage, and for the writer
+  metrics_append(buf, size, &len, ",\"queues\":{");
+  if (metrics->wf || metrics->wf_SA) {
+    for (int i = 0; i < metrics->num_stages; i++) {
+      int num_items = metrics->wf ? workflow_get_num_items_at(i, metrics->wf) :
+	workflow_get_num_items_at_SA(i, metrics->wf_SA);
+      metrics_append(buf, size, &len, "\"%s\":%i,", metrics->stage_labels[i], num_items);
+    }
+    metrics_append(buf, size, &len, "\"writer\":%i", metrics->wf ?
+		   workflow_get_num_completed_items(metrics->wf) :
+		   workflow_get_num_completed_items_SA(metrics->wf_SA));
+  }
+  metrics_append(buf, size, &len, "}");
+
+  double times[NUM_PROFILER_SCOPES];
+  profiler_get_times(times);
+  metrics_append(buf, size, &len, ",\"busy\":{");
+  int first = 1;
+  for (int s = 0; s < NUM_PROFILER_SCOPES; s++) {
+    if (profiler_scope_parent(s) >= 0 || times[s] <= 0) continue;
+    metrics_append(buf, size, &len, "%s\"%s\":%.2f", first ? "" : ",", profiler_scope_name(s), times[s]);
+    first = 0;
+  }
+  metrics_append(buf, size, &len, "}");
+
+  // cores busy on average, out of num_threads
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  metrics_append(buf, size, &len, ",\"threads\":%i,\"cpu_time\":%.1f,\"cpu_load\":%.2f",
+		 metrics->num_threads, cur->cpu_time, (cur->cpu_time - last->cpu_time) / elapsed);
+  metrics_append(buf, size, &len, ",\"rss\":%lu,\"max_rss\":%lu}\n",
+		 metrics_rss(), (size_t) ru.ru_maxrss * 1024);
+
+  if (len >= size) {
+    // truncated, at least keep it a line
+    len = size - 1;
+    buf[len - 1] = '\n';
+  }
+  return len;
+}
+
+//------------------------------------------------------------------------
+
+static void metrics_write() {
+  char record[METRICS_MAX_RECORD];
+  metrics_sample_t cur;
+
+  pthread_mutex_lock(&metrics->mutex);
+  size_t len = metrics_record(record, sizeof(record), &cur);
+  metrics->last = cur;
+  pthread_mutex_unlock(&metrics->mutex);
+
+  if (metrics->file) {
+    fwrite(record, 1, len, metrics->file);
+    fflush(metrics->file);
+  }
+}
+
+//------------------------------------------------------------------------
+
+static void metrics_serve() {
+  int fd = accept(metrics->socket_fd, NULL, NULL);
+  if (fd < 0) return;
+
+  // an HTTP client sends its request first, a plain one may send nothing
+  int http = 0;
+  char request[1024];
+  struct pollfd pfd = { .fd = fd, .events = POLLIN };
+  if (poll(&pfd, 1, 100) > 0) {
+    ssize_t n = recv(fd, request, sizeof(request), MSG_DONTWAIT);
+    http = (n >= 4 && strncmp(request, "GET ", 4) == 0);
+  }
+
+  char record[METRICS_MAX_RECORD];
+  metrics_sample_t cur;
+
+  pthread_mutex_lock(&metrics->mutex);
+  size_t len = metrics_record(record, sizeof(record), &cur);
+  pthread_mutex_unlock(&metrics->mutex);
+
+  if (http) {
+    char header[256];
+    int header_len = snprintf(header, sizeof(header),
+			      "HTTP/1.0 200 OK\r\nContent-Type: application/json\r\n"
+			      "Content-Length: %lu\r\nConnection: close\r\n\r\n", len);
+    send(fd, header, header_len, MSG_NOSIGNAL);
+  }
+  send(fd, record, len, MSG_NOSIGNAL);
+  close(fd);
+}
+
+//------------------------------------------------------------------------
+// monitor thread
+//------------------------------------------------------------------------
+
+static void *metrics_monitor(void *input) {
+  struct pollfd fds[2];
+  fds[0].fd = metrics->wakeup[0];
+  fds[0].events = POLLIN;
+  fds[1].fd = metrics->socket_fd;  // ignored when -1
+  fds[1].events = POLLIN;
+
+  double next = metrics->start + metrics->interval;
+  while (1) {
+    int timeout = (int) ((next - metrics_now()) * 1000);
+    int ret = poll(fds, 2, timeout < 0 ? 0 : timeout);
+    if (ret < 0 && errno != EINTR) {
+      LOG_WARN_F("Metrics monitor stopped: %s\n", strerror(errno));
+      break;
+    }
+
+    if (ret > 0 && (fds[0].revents & POLLIN)) break;
+    if (ret > 0 && (fds[1].revents & POLLIN)) metrics_serve();
+
+    if (metrics_now() >= next) {
+      metrics_write();
+      next += metrics->interval;
+    }
+  }
+
+  return NULL;
+}
+
+//------------------------------------------------------------------------
+
+static int metrics_listen(const char *path) {
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    LOG_FATAL_F("Metrics socket path too long: %s\n", path);
+  }
+  strcpy(addr.sun_path, path);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    LOG_FATAL_F("Could not create the metrics socket: %s\n", strerror(errno));
+  }
+
+  // a previous run may have left it behind
+  unlink(path);
+  if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 || listen(fd, 8) < 0) {
+    LOG_FATAL_F("Could not listen on the metrics socket %s: %s\n", path, strerror(errno));
+  }
+
+  return fd;
+}
+
+//------------------------------------------------------------------------
+// public
+//------------------------------------------------------------------------
+
+void metrics_start(options_t *options) {
+  if (!options->metrics_filename && !options->metrics_socket) return;
+
+  metrics = (metrics_t *) calloc(1, sizeof(metrics_t));
+  metrics->interval = options->metrics_interval > 0 ? options->metrics_interval : DEFAULT_METRICS_INTERVAL;
+  metrics->num_threads = options->num_cpu_threads;
+  metrics->socket_fd = -1;
+
+  if (options->metrics_filename) {
+    if (strcmp(options->metrics_filename, "-") == 0) {
+      metrics->file = stderr;
+    } else if ((metrics->file = fopen(options->metrics_filename, "w")) == NULL) {
+      LOG_FATAL_F("Could not create the metrics file %s\n", options->metrics_filename);
+    }
+  }
+
+  if (options->metrics_socket) {
+    metrics->socket_path = strdup(options->metrics_socket);
+    metrics->socket_fd = metrics_listen(metrics->socket_path);
+  }
+
+  if (pipe(metrics->wakeup) < 0) {
+    LOG_FATAL_F("Could not create the metrics pipe: %s\n", strerror(errno));
+  }
+
+  // the busy times of the stages come from the profiler, with no
+  // output file if it is not profiling; stage scopes are timed on every
+  // call, only the per-read scopes are sampled
+  profiler_enable(NULL, PROFILER_DEFAULT_RATE);
+
+  pthread_mutex_init(&metrics->mutex, NULL);
+  strcpy(metrics->phase, "loading");
+  metrics->start = metrics->phase_start = metrics_now();
+  metrics_sample(&metrics->last);
+
+  pthread_create(&metrics->thread, NULL, metrics_monitor, NULL);
+}
+
+//------------------------------------------------------------------------
+
+void metrics_stop() {
+  if (!metrics) return;
+
+  if (write(metrics->wakeup[1], "", 1) == 1) {
+    pthread_join(metrics->thread, NULL);
+  }
+
+  pthread_mutex_lock(&metrics->mutex);
+  strcpy(metrics->phase, "done");
+  metrics->wf = NULL;
+  metrics->wf_SA = NULL;
+  pthread_mutex_unlock(&metrics->mutex);
+  metrics_write();
+
+  if (metrics->file && metrics->file != stderr) fclose(metrics->file);
+  if (metrics->socket_fd >= 0) {
+    close(metrics->socket_fd);
+    unlink(metrics->socket_path);
+    free(metrics->socket_path);
+  }
+  close(metrics->wakeup[0]);
+  close(metrics->wakeup[1]);
+  if (metrics->output) free(metrics->output);
+
+  pthread_mutex_destroy(&metrics->mutex);
+  free(metrics);
+  metrics = NULL;
+}
+
+//------------------------------------------------------------------------
+
+void metrics_set_output(const char *filename) {
+  if (!metrics) return;
+
+  pthread_mutex_lock(&metrics->mutex);
+  if (metrics->output) free(metrics->output);
+  metrics->output = filename ? strdup(filename) : NULL;
+  pthread_mutex_unlock(&metrics->mutex);
+}
+
+//------------------------------------------------------------------------
+
+static void metrics_set_phase(const char *phase, int num_stages, char **stage_labels) {
+  if (phase && strcmp(phase, metrics->phase)) {
+    snprintf(metrics->phase, METRICS_MAX_LABEL, "%s", phase);
+    metrics->phase_start = metrics_now();
+  }
+
+  metrics->num_stages = num_stages < METRICS_MAX_STAGES ? num_stages : METRICS_MAX_STAGES;
+  for (int i = 0; i < metrics->num_stages; i++) {
+    snprintf(metrics->stage_labels[i], METRICS_MAX_LABEL, "%s", stage_labels[i]);
+  }
+}
+
+void metrics_set_workflow(const char *phase, int num_stages, char **stage_labels,
+			  workflow_t *wf) {
+  if (!metrics) return;
+
+  pthread_mutex_lock(&metrics->mutex);
+  metrics_set_phase(phase, wf ? num_stages : 0, stage_labels);
+  metrics->wf = wf;
+  metrics->wf_SA = NULL;
+  pthread_mutex_unlock(&metrics->mutex);
+}
+
+void metrics_set_workflow_SA(const char *phase, int num_stages, char **stage_labels,
+			     workflow_SA_t *wf) {
+  if (!metrics) return;
+
+  pthread_mutex_lock(&metrics->mutex);
+  metrics_set_phase(phase, wf ? num_stages : 0, stage_labels);
+  metrics->wf = NULL;
+  metrics->wf_SA = wf;
+  pthread_mutex_unlock(&metrics->mutex);
+}
+
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
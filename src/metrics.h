@@ -0,0 +1,60 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "commons/workflow_scheduler.h"
+#include "rna/workflow_scheduler_SA.h"
+
+#include "options.h"
+#include "statistics.h"
+#include "aux/aux_profiler.h"
+
+//------------------------------------------------------------------------
+// Live metrics for long-running jobs, one JSON object per line:
+//
+//   --metrics-file=<file>      appends a record every --metrics-interval
+//                              seconds (and a last one at the end)
+//   --metrics-socket=<path>    Unix socket answering every connection
+//                              with the current record; an HTTP GET is
+//                              answered as HTTP, e.g.:
+//                              curl --unix-socket <path> http://hpg/
+//
+// A record holds the phase (workflow) being run, reads and bytes in/out
+// with their rates over the last interval, the input progress and ETA
+// (plain FastQ input only), the items waiting in every workflow stage
+// and for the writer, the busy time of every pipeline stage (threads
+// added up, from the profiler: stages run once per batch are timed on
+// every call, stages made of per-read scopes are estimated from a
+// sample of many calls), the CPU load and the memory used.
+//
+// Everything is read by a monitor thread from the per-thread counters,
+// the workers never wait for it.
+//------------------------------------------------------------------------
+
+#define METRICS_MAX_STAGES          8
+#define METRICS_MAX_LABEL          64
+
+//------------------------------------------------------------------------
+
+// starts the monitor thread if a metrics file or socket is given
+void metrics_start(options_t *options);
+
+// writes the last record and stops the monitor thread
+void metrics_stop();
+
+// the output file, its size is reported as the bytes out
+void metrics_set_output(const char *filename);
+
+// the workflow being run, set wf to NULL before freeing it
+void metrics_set_workflow(const char *phase, int num_stages, char **stage_labels,
+			  workflow_t *wf);
+void metrics_set_workflow_SA(const char *phase, int num_stages, char **stage_labels,
+			     workflow_SA_t *wf);
+
+//------------------------------------------------------------------------
+
+#endif // METRICS_H
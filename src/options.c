@@ -68,6 +68,11 @@ options_t *options_new(void) {
   options->sw_set = 0;
   options->filter_read_mappings = DEFAULT_FILTER_READ_MAPPINGS;
   options->filter_seed_mappings = DEFAULT_FILTER_SEED_MAPPINGS;
+  options->metrics_filename = NULL;
+  options->metrics_socket = NULL;
+  options->metrics_interval = DEFAULT_METRICS_INTERVAL;
+  options->num_read_groups = 0;
+  options->read_groups = NULL;
   //=========================================================
 
   options->min_cal_size = 0; 
@@ -78,9 +83,6 @@ options_t *options_new(void) {
   options->flank_length = 0;
   options->fast_mode = 1;
 
-  options->adapter_length = 0;
-
-  options->adapter_length = 0;
   options->set_bam_format = 0;
   options->set_cal = 0;
 
@@ -220,6 +222,14 @@ void options_free(options_t *options) {
      }
 
      if (options->cmdline)  { free(options->cmdline); }
+     if (options->metrics_filename) { free(options->metrics_filename); }
+     if (options->metrics_socket) { free(options->metrics_socket); }
+     if (options->read_groups) {
+       for (int i = 0; i < options->num_read_groups; i++) {
+	 free(options->read_groups[i]);
+       }
+       free(options->read_groups);
+     }
 
      free(options);
 }
@@ -581,9 +591,12 @@ void** argtable_options_new(int mode) {
   argtable[count++] = arg_str0(NULL, "output-format", NULL, "BAM output format (otherwise, SAM format. This option is only available for SA mode, BWT mode always report in BAM format), this option turn the process slow");
   argtable[count++] = arg_lit0(NULL, "indel-realignment", "Indel-based realignment");
   argtable[count++] = arg_lit0(NULL, "recalibration", "Base quality score recalibration");
-  argtable[count++] = arg_str0("a", "adapter", NULL, "Adapter sequence in the read");
+  argtable[count++] = arg_str0("a", "adapter", NULL, "Adapter sequences in the read, comma-separated");
   argtable[count++] = arg_str0(NULL, "input-format", NULL, "Input file format: fastq or bam. Default: fastq");
   argtable[count++] = arg_lit0("v", "version", "Display the HPG Aligner version");
+  argtable[count++] = arg_file0(NULL, "metrics-file", NULL, "Write live metrics to this file as JSON lines ('-' for stderr)");
+  argtable[count++] = arg_file0(NULL, "metrics-socket", NULL, "Serve live metrics as JSON on this Unix socket (plain or HTTP)");
+  argtable[count++] = arg_int0(NULL, "metrics-interval", NULL, "Seconds between metrics records");
 
   if (mode == DNA_MODE) {
     argtable[count++] = arg_int0(NULL, "num-seeds", NULL, "Number of seeds");
@@ -693,8 +706,6 @@ options_t *read_CLI_options(void **argtable, options_t *options) {
   if (((struct arg_int*)argtable[++count])->count) { options->recalibration = ((struct arg_int*)argtable[count])->count; }
   if (((struct arg_str*)argtable[++count])->count) { options->adapter = strdup(*(((struct arg_str*)argtable[count])->sval)); }
 
-  if (options->adapter) options->adapter_length = strlen(options->adapter);
-
   if (((struct arg_int*)argtable[++count])->count) {
     char *format = (char *) (*((struct arg_str*)argtable[count])->sval);
     if (!strcmp(format, "sam") || !strcmp(format, "SAM")) {
@@ -707,6 +718,9 @@ options_t *read_CLI_options(void **argtable, options_t *options) {
   }
 
   if (((struct arg_int*)argtable[++count])->count) { options->version = ((struct arg_int*)argtable[count])->count; }
+  if (((struct arg_file*)argtable[++count])->count) { options->metrics_filename = strdup(*(((struct arg_file*)argtable[count])->filename)); }
+  if (((struct arg_file*)argtable[++count])->count) { options->metrics_socket = strdup(*(((struct arg_file*)argtable[count])->filename)); }
+  if (((struct arg_int*)argtable[++count])->count) { options->metrics_interval = *(((struct arg_int*)argtable[count])->ival); }
 
   if (options->mode == DNA_MODE) {
     if (((struct arg_int*)argtable[++count])->count) { options->num_seeds = *(((struct arg_int*)argtable[count])->ival); }
@@ -927,12 +941,18 @@ void display_dna_help() {
   printf("\n");
 
   printf("Pre-processing options:\n");
-  printf("\t-a,--adapter=<string>              Adapter sequence in the read to remove before mapping\n");
+  printf("\t-a,--adapter=<string>              Adapter sequences to remove before mapping (comma-separated)\n");
   printf("\n");
 
   printf("Post-processing options:\n");
   printf("\t--indel-realignment                Perform the indel-based realignment after mapping\n");
   printf("\t--recalibration                    Perform the base-quality recalibration after mapping\n");  
+  printf("\n");
+
+  printf("Monitoring options:\n");
+  printf("\t--metrics-file=<file>              Write live metrics as JSON lines to <file> ('-' for stderr)\n");
+  printf("\t--metrics-socket=<file>            Serve live metrics as JSON on a Unix socket (plain or HTTP)\n");
+  printf("\t--metrics-interval=<int>           Seconds between metrics records [%i]\n", DEFAULT_METRICS_INTERVAL);
   printf("+===============================================================+\n");
 }
 
@@ -1088,6 +1108,12 @@ void display_rna_help() {
   printf("\t--report-n-best=<int>              Report the <n> best alignments\n");
   printf("\t--report-n-hits=<int>              Report <n> hits\n");
   printf("\t--report-only-paired               Report only the paired reads\n");
+  printf("\n");
+
+  printf("Monitoring options:\n");
+  printf("\t--metrics-file=<file>              Write live metrics as JSON lines to <file> ('-' for stderr)\n");
+  printf("\t--metrics-socket=<file>            Serve live metrics as JSON on a Unix socket (plain or HTTP)\n");
+  printf("\t--metrics-interval=<int>           Seconds between metrics records [%i]\n", DEFAULT_METRICS_INTERVAL);
   printf("+===============================================================+\n");
 }
 
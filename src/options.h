@@ -51,6 +51,7 @@
 #define MINIMUM_BATCH_SIZE              10000
 #define DEFAULT_FILTER_READ_MAPPINGS    500
 #define DEFAULT_FILTER_SEED_MAPPINGS    500
+#define DEFAULT_METRICS_INTERVAL        10
 
 //========================================================================
 
@@ -73,7 +74,7 @@
 
 //========================================================================
 
-#define NUM_OPTIONS			31
+#define NUM_OPTIONS			34
 #define NUM_RNA_OPTIONS			 5
 #define NUM_DNA_OPTIONS			 1
 
@@ -133,8 +134,8 @@ typedef struct options {
   int bs_index;
   int fast_mode;
   int set_bam_format;
-  int adapter_length;
   int set_cal;
+  int metrics_interval;
   double min_score;
   double match;
   double mismatch;
@@ -153,6 +154,11 @@ typedef struct options {
   char *adapter;
   char *adapter_revcomp;
   char *cmdline;
+  char *metrics_filename;
+  char *metrics_socket;
+  // read groups of the input files (DNA, several files), in the headers
+  int num_read_groups;
+  char **read_groups;
   // new variables for bisulphite case
 } options_t;
 
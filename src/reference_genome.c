@@ -0,0 +1,163 @@
+#include "reference_genome.h"
+
+
+//--------------------------------------------------------------------------------------
+
+reference_n_mask_t *reference_n_mask_new(sa_genome3_t *sa_genome) {
+  reference_n_mask_t *mask = (reference_n_mask_t *) calloc(1, sizeof(reference_n_mask_t));
+  size_t max_runs = 1024;
+  char *S = sa_genome->S;
+
+  mask->starts = (size_t *) malloc(max_runs * sizeof(size_t));
+  mask->ends = (size_t *) malloc(max_runs * sizeof(size_t));
+
+  for (size_t i = 0; i < sa_genome->length; i++) {
+    if (S[i] != 'N' && S[i] != 'n') continue;
+
+    if (mask->num_runs && mask->ends[mask->num_runs - 1] + 1 == i) {
+      mask->ends[mask->num_runs - 1] = i;
+    } else {
+      if (mask->num_runs == max_runs) {
+	max_runs *= 2;
+	mask->starts = (size_t *) realloc(mask->starts, max_runs * sizeof(size_t));
+	mask->ends = (size_t *) realloc(mask->ends, max_runs * sizeof(size_t));
+      }
+      mask->starts[mask->num_runs] = i;
+      mask->ends[mask->num_runs] = i;
+      mask->num_runs++;
+    }
+    S[i] = 'A';
+  }
+
+  return mask;
+}
+
+//--------------------------------------------------------------------------------------
+
+void reference_n_mask_free(reference_n_mask_t *mask) {
+  if (!mask) return;
+
+  free(mask->starts);
+  free(mask->ends);
+  free(mask);
+}
+
+//--------------------------------------------------------------------------------------
+
+// Ns back into the window of S [start, end] copied to sequence
+static inline void reference_n_mask_apply(char *sequence, size_t start, size_t end,
+					  reference_n_mask_t *mask) {
+  size_t lo = 0, hi = mask->num_runs, mid;
+
+  // first run ending at or after start
+  while (lo < hi) {
+    mid = (lo + hi) >> 1;
+    if (mask->ends[mid] < start) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  for (size_t r = lo; r < mask->num_runs && mask->starts[r] <= end; r++) {
+    size_t run_start = mask->starts[r] > start ? mask->starts[r] : start;
+    size_t run_end = mask->ends[r] < end ? mask->ends[r] : end;
+    memset(&sequence[run_start - start], 'N', run_end - run_start + 1);
+  }
+}
+
+//--------------------------------------------------------------------------------------
+
+genome_t *reference_genome_new_packed(char *filename, char *dirname, int mode) {
+  reference_t *reference = (reference_t *) calloc(1, sizeof(reference_t));
+  genome_t *genome = genome_new(filename, dirname, mode);
+
+  // genome_free releases the fields and then the reference_t itself
+  reference->genome = *genome;
+  free(genome);
+  reference->source = REFERENCE_SOURCE_PACKED;
+
+  return &reference->genome;
+}
+
+//--------------------------------------------------------------------------------------
+
+genome_t *reference_genome_new_from_sa(sa_genome3_t *p, reference_n_mask_t *n_mask) {
+  reference_t *reference = (reference_t *) calloc(1, sizeof(reference_t));
+  genome_t *genome = &reference->genome;
+  size_t offset = 0;
+
+  genome->num_chromosomes = p->num_chroms;
+  genome->chr_name = (char **) calloc(p->num_chroms, sizeof(char *));
+  genome->chr_size = (size_t *) calloc(p->num_chroms, sizeof(size_t));
+  genome->chr_offset = (size_t *) calloc(p->num_chroms, sizeof(size_t));
+
+  for (int c = 0; c < p->num_chroms; c++) {
+    genome->chr_size[c] = p->chrom_lengths[c];
+    genome->chr_name[c] = strdup(p->chrom_names[c]);
+    genome->chr_offset[c] = offset;
+    offset += genome->chr_size[c];
+  }
+
+  reference->source = REFERENCE_SOURCE_SA;
+  reference->sa_genome = p;
+  reference->n_mask = n_mask;
+
+  return genome;
+}
+
+//--------------------------------------------------------------------------------------
+
+void reference_genome_free(genome_t *genome) {
+  if (!genome) return;
+
+  reference_t *reference = reference_of(genome);
+  if (reference->source != REFERENCE_SOURCE_SA) {
+    genome_free(genome);
+    return;
+  }
+
+  for (int c = 0; c < genome->num_chromosomes; c++) {
+    free(genome->chr_name[c]);
+  }
+  free(genome->chr_name);
+  free(genome->chr_size);
+  free(genome->chr_offset);
+
+  reference_n_mask_free(reference->n_mask);
+  free(reference);
+}
+
+//--------------------------------------------------------------------------------------
+
+void reference_read_sequence(char *sequence, unsigned int strand,
+			     unsigned int chromosome, size_t *start_p, size_t *end_p,
+			     genome_t *genome) {
+  reference_t *reference = reference_of(genome);
+
+  if (reference->source != REFERENCE_SOURCE_SA) {
+    genome_read_sequence_by_chr_index(sequence, strand, chromosome,
+				      start_p, end_p, genome);
+    return;
+  }
+
+  if (*end_p >= genome->chr_size[chromosome]) {
+    *end_p = genome->chr_size[chromosome] - 1;
+  }
+
+  if (*start_p > *end_p) {
+    sequence[0] = '\0';
+    return;
+  }
+
+  size_t len = *end_p - *start_p + 1;
+  size_t start = reference->sa_genome->chrom_offsets[chromosome] + *start_p;
+  memcpy(sequence, &reference->sa_genome->S[start], len);
+  if (reference->n_mask) {
+    reference_n_mask_apply(sequence, start, start + len - 1, reference->n_mask);
+  }
+  sequence[len] = '\0';
+}
+
+//--------------------------------------------------------------------------------------
+//--------------------------------------------------------------------------------------
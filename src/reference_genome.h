@@ -0,0 +1,77 @@
+#ifndef REFERENCE_GENOME_H
+#define REFERENCE_GENOME_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "aligners/bwt/genome.h"
+
+#include "sa/sa_index3.h"
+
+//--------------------------------------------------------------------------------------
+//  Reference sequence accessor shared by the mappers.
+//
+//  In BWT mode the sequence is read from the packed genome_t (dna_compression.bin).
+//  In SA mode the genome_t returned by reference_genome_new_from_sa only keeps the
+//  chromosome names, sizes and offsets, and the sequence is read from the one
+//  already loaded with the SA index, so the reference is not resident twice.
+//
+//  The SA search needs the Ns of the index genome as As, the N runs are kept
+//  apart (reference_n_mask_new) and put back in every window read in SA mode,
+//  so the mappers see the same sequence as from the packed genome.
+//
+//  Every genome_t given to reference_read_sequence and reference_genome_free must
+//  come from reference_genome_new_packed or reference_genome_new_from_sa: it is the
+//  first member of its reference_t, so each genome carries its own source and
+//  several references can live in one process.
+//--------------------------------------------------------------------------------------
+
+#define REFERENCE_SOURCE_PACKED   0
+#define REFERENCE_SOURCE_SA       1
+
+// N runs of the SA genome, [start, end] in S coordinates and sorted
+typedef struct reference_n_mask {
+  size_t num_runs;
+  size_t *starts;
+  size_t *ends;
+} reference_n_mask_t;
+
+// It records the N runs of sa_genome->S and replaces them with A
+reference_n_mask_t *reference_n_mask_new(sa_genome3_t *sa_genome);
+void reference_n_mask_free(reference_n_mask_t *mask);
+
+//--------------------------------------------------------------------------------------
+
+// Where the sequence of a reference comes from: genome_t (hpg-libs) has no room
+// for it, so the genome_t is embedded first and the rest follows it
+typedef struct reference {
+  genome_t genome;
+  int source;
+  sa_genome3_t *sa_genome;
+  reference_n_mask_t *n_mask;
+} reference_t;
+
+static inline reference_t *reference_of(genome_t *genome) {
+  return (reference_t *) genome;
+}
+
+// Same arguments as genome_new
+genome_t *reference_genome_new_packed(char *filename, char *dirname, int mode);
+
+// The returned genome_t takes the N mask
+genome_t *reference_genome_new_from_sa(sa_genome3_t *sa_genome, reference_n_mask_t *n_mask);
+void reference_genome_free(genome_t *genome);
+
+//--------------------------------------------------------------------------------------
+
+// Same interface as genome_read_sequence_by_chr_index: 0-based and inclusive
+// coordinates, end is clipped to the chromosome length and the strand is ignored
+void reference_read_sequence(char *sequence, unsigned int strand,
+			     unsigned int chromosome, size_t *start_p, size_t *end_p,
+			     genome_t *genome);
+
+//--------------------------------------------------------------------------------------
+//--------------------------------------------------------------------------------------
+
+#endif // end of REFERENCE_GENOME_H
@@ -36,7 +36,7 @@ int close_double_anchor_gap(size_t start_genome_gap, size_t end_genome_gap,
   register int i = 0;
   register int distance = 0;
 
-  genome_read_sequence_by_chr_index(reference, 0, 
+  reference_read_sequence(reference, 0, 
 				    genome_chromosome, &start_genome_gap, &end_genome_gap, genome);
 
   memcpy(query, sequence + start_read_gap, end_read_gap - start_read_gap);
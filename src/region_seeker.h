@@ -12,6 +12,7 @@
 #include "buffers.h"
 
 #include "breakpoint.h"
+#include "reference_genome.h"
 
 //====================================================================================
 //  structures and prototypes
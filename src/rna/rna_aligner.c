@@ -17,7 +17,6 @@ extern size_t total_reads_w2, total_reads_w3;
 extern size_t reads_w2, reads_w3;
 
 int max = 65;
-extern size_t total_reads_ph2;
 
 void write_sam_header_BWT(options_t *options, genome_t *genome, FILE *f) {
   fprintf(f, "@HD\tVN:1.4\tSO:unsorted\n");
@@ -259,6 +258,7 @@ void display_progress_2() {
   if (redirect_stdout || gziped_fileds) { return; }
 
   extern size_t reads_ph2;  
+  size_t total_reads_ph2 = thread_stats_get(ST_SA_READS_PH2);
   float progress;
 
   printf("[");
@@ -366,6 +366,7 @@ void sa_index3_parallel_genome_new(char *sa_index_dirname, int num_threads,
   sa_genome3_t *genome;
   uint *SA, *PRE, *A, *IA;
   genome_t *genome_;
+  reference_n_mask_t *n_mask = NULL;
 
   //printf("Parametro: %i num threads \n", num_threads);
 
@@ -411,11 +412,8 @@ void sa_index3_parallel_genome_new(char *sa_index_dirname, int num_threads,
 	genome = sa_genome3_new(genome_len, num_chroms, chrom_lengths, 
 				chrom_flags, chrom_names, S);
       
-	for (size_t i = 0; i < genome->length; i++) {
-	  if (genome->S[i] == 'N' || genome->S[i] == 'n') {
-	    genome->S[i] = 'A';
-	  }
-	}
+	// Ns as As for the SA search, kept apart for the reference windows
+	n_mask = reference_n_mask_new(genome);
 
 	pthread_mutex_lock(&mutex_sp);
 	load_progress += 10;
@@ -591,30 +589,14 @@ void sa_index3_parallel_genome_new(char *sa_index_dirname, int num_threads,
 	print_load_progress(load_progress, 0);
 	pthread_mutex_unlock(&mutex_sp);
 
-	genome_ = genome_new("dna_compression.bin", sa_index_dirname, SA_MODE);	
-
-	genome_->num_chromosomes = num_chroms;
-	genome_->chr_name = (char **) calloc(genome_->num_chromosomes, sizeof(char *));
-	genome_->chr_size = (size_t *) calloc(genome_->num_chromosomes, sizeof(size_t));
-	genome_->chr_offset = (size_t *) calloc(genome_->num_chromosomes, sizeof(size_t));
-	size_t offset = 0;
-	
-	for (int c = 0; c < num_chroms; c++) {
-	  genome_->chr_size[c] = chrom_lengths[c];
-	  genome_->chr_name[c] = strdup(chrom_names[c]);
-	  genome_->chr_offset[c] = offset;
-	  offset += genome_->chr_size[c];
-	}
-	
-	pthread_mutex_lock(&mutex_sp);
-	load_progress += 3.5;
-	print_load_progress(load_progress, 0);
-	pthread_mutex_unlock(&mutex_sp);
-
       }
     }
   }
 
+  // the reference sequence is read from the SA genome, do not load it twice
+  genome_ = reference_genome_new_from_sa(genome, n_mask);
+
+  load_progress += 3.5;
   print_load_progress(load_progress, 1);
   free(prefix);
   
@@ -854,7 +836,7 @@ void rna_aligner(options_t *options) {
     LOG_DEBUG("Reading bwt index done !!");
     
     LOG_DEBUG("Reading genome...");
-    genome = genome_new("dna_compression.bin", options->bwt_dirname, BWT_MODE);  
+    genome = reference_genome_new_packed("dna_compression.bin", options->bwt_dirname, BWT_MODE);
     LOG_DEBUG("Done !!");
     //////////////////////////////////////////////////////
   } else {    
@@ -942,7 +924,8 @@ void rna_aligner(options_t *options) {
 
   if (options->transcriptome_filename != NULL) {
     printf("\nLoading transcriptome...\n");
-    load_transcriptome(options->transcriptome_filename, genome, avls_list, metaexons);
+    load_transcriptome(options->transcriptome_filename, options->output_name, 
+		       genome, avls_list, metaexons);
     printf("Load done!\n");
   }
 
@@ -1029,10 +1012,11 @@ void rna_aligner(options_t *options) {
 			  &writer_input);
 
   writer_input.bam_format = options->bam_format;
+  metrics_set_output(output_filename);
   if (options->bam_format) {
     bam_header_t *bam_header;
     if (options->fast_mode) {
-      bam_header = create_bam_header(options, sa_index->genome);
+      bam_header = create_bam_header(options, sa_index->genome, "unsorted");
     } else {
       bam_header = create_bam_header_by_genome(genome);
     }
@@ -1115,6 +1099,7 @@ void rna_aligner(options_t *options) {
 				  NULL, options->gzip, &reader_input);  
 
     extern size_t fd_total_bytes;
+    fd_read_bytes = 0;
     if (options->pair_mode == SINGLE_END_MODE) {
       if (options->gzip) {
 	reader_input.fq_gzip_file1 = fastq_gzopen(file1);
@@ -1242,7 +1227,9 @@ void rna_aligner(options_t *options) {
       {
           #pragma omp section
           {      
+	    metrics_set_workflow("workflow 1", 4, stage_labels, wf);
 	    workflow_run_with(options->num_cpu_threads, wf_input, wf);
+	    metrics_set_workflow(NULL, 0, NULL, NULL);
 	    w1_end = 1;
 	  }
           #pragma omp section
@@ -1259,7 +1246,9 @@ void rna_aligner(options_t *options) {
       {
           #pragma omp section
           {      
+	    metrics_set_workflow("workflow 2", 2, stage_labels_last, wf_last);
 	    workflow_run_with(options->num_cpu_threads, wf_input_file, wf_last);
+	    metrics_set_workflow(NULL, 0, NULL, NULL);
 	    w2_end = 1;
 	  }
           #pragma omp section
@@ -1276,7 +1265,9 @@ void rna_aligner(options_t *options) {
       {
           #pragma omp section
           {      
+	    metrics_set_workflow("workflow 3", 2, stage_labels_hc, wf_hc);
 	    workflow_run_with(options->num_cpu_threads, wf_input_file_hc, wf_hc);
+	    metrics_set_workflow(NULL, 0, NULL, NULL);
 	    w3_end = 1;
 	  }
           #pragma omp section
@@ -1367,7 +1358,9 @@ void rna_aligner(options_t *options) {
           #pragma omp section
           {      
 	    start_timer(time_s1);
+	    metrics_set_workflow_SA("first phase", 1, stage_labels, wf);
 	    workflow_run_with_SA(options->num_cpu_threads, wf_input, wf);
+	    metrics_set_workflow_SA(NULL, 0, NULL, NULL);
 	    stop_timer(time_s1, time_e1, time_total_1);
 	    //printf("= = = = T I M I N G    W O R K F L O W    '1' = = = =\n");
 	    //workflow_display_timing(wf);
@@ -1388,7 +1381,9 @@ void rna_aligner(options_t *options) {
           {
 	    start_timer(time_s2);
 	    rewind(f_sa);
+	    metrics_set_workflow_SA("second phase", 1, stage_labels_last, wf_last);
 	    workflow_run_with_SA(options->num_cpu_threads, wf_input, wf_last);      
+	    metrics_set_workflow_SA(NULL, 0, NULL, NULL);
 	    stop_timer(time_s2, time_e2, time_total_2);      
 	    //printf("= = = = T I M I N G    W O R K F L O W    '2' = = = =\n");
 	    //workflow_display_timing(wf_last);
@@ -1417,10 +1412,14 @@ void rna_aligner(options_t *options) {
 
 
 
+      size_t total_reads_ph2 = thread_stats_get(ST_SA_READS_PH2);
+      st_bwt_t st_bwt;
+      thread_stats_to_st_bwt(&st_bwt);
+      basic_statistics_update(basic_st);
+
       basic_statistics_display(basic_st, 1, 
 			       (time_total_1 + time_total_2) / 1000000, 
 			       time_genome / 1000000, total_reads_ph2);  
-      extern st_bwt_t st_bwt;
 
       printf("|    S P L I C E    J U N C T I O N S    S T A T I S T I C S    |\n");
       printf("+===============================================================+\n");
@@ -1507,7 +1506,8 @@ void rna_aligner(options_t *options) {
   
 
   if (!options->fast_mode) {
-    extern st_bwt_t st_bwt;
+    st_bwt_t st_bwt;
+    thread_stats_to_st_bwt(&st_bwt);
     size_t mapped = st_bwt.single_alig + st_bwt.multi_alig;
     size_t unmapped = st_bwt.total_reads - mapped;
 
@@ -1569,6 +1569,9 @@ void rna_aligner(options_t *options) {
     fprintf(fd_log_output, " Total cannonical splice junctions       :  %lu (%.2f%%)\n", st_bwt.cannonical_sj, (float)(st_bwt.cannonical_sj * 100)/(float)st_bwt.tot_sj);
     fprintf(fd_log_output, " Total semi-cannonical splice junctions  :  %lu (%.2f%%)\n", st_bwt.semi_cannonical_sj, (float)(st_bwt.semi_cannonical_sj * 100)/(float)st_bwt.tot_sj);
     fprintf(fd_log_output, "--------------------------------------------------------------\n\n");
+
+    metaexons_print_stats(fd_log_output, metaexons);
+    fprintf(fd_log_output, "\n");
   
     fprintf(fd_log_output, "====================================================================================\n");
     fprintf(fd_log_output, "=                                                                                  =\n");
@@ -1601,7 +1604,7 @@ void rna_aligner(options_t *options) {
   //--------------------------------------------------------------------------------------
 
   if (genome) {
-    genome_free(genome);
+    reference_genome_free(genome);
   }
 
   bwt_optarg_free(bwt_optarg);
@@ -1705,21 +1708,55 @@ static inline exon_t *parse_exon_line(FILE *f, genome_t *genome) {
 
 //--------------------------------------------------------------------------------------
 
-void load_transcriptome(char *filename, genome_t *genome, 
-			avls_list_t *avls_list, metaexons_t *metaexons) {
+static inline annotation_record_t *annotation_record_add(annotation_record_t **records,
+							 size_t *num_records,
+							 size_t *max_records) {
+  if (*num_records >= *max_records) {
+    *max_records = *max_records ? *max_records * 2 : 65536;
+    *records = (annotation_record_t *) realloc(*records, *max_records * sizeof(annotation_record_t));
+  }
+  annotation_record_t *record = &(*records)[*num_records];
+  memset(record, 0, sizeof(annotation_record_t));
+  record->order = (*num_records)++;
+  return record;
+}
+
+//--------------------------------------------------------------------------------------
+
+static int annotation_record_cmp(const void *a, const void *b) {
+  const annotation_record_t *r1 = a, *r2 = b;
+  if (r1->chr != r2->chr) { return r1->chr < r2->chr ? -1 : 1; }
+  if (r1->start != r2->start) { return r1->start < r2->start ? -1 : 1; }
+  if (r1->end != r2->end) { return r1->end < r2->end ? -1 : 1; }
+  //qsort is not stable, equal keys keep the GTF order
+  if (r1->order != r2->order) { return r1->order < r2->order ? -1 : 1; }
+  return 0;
+}
+
+//--------------------------------------------------------------------------------------
+
+annotation_record_t *annotation_parse_gtf(char *filename, genome_t *genome, 
+					  size_t *num_records) {
 
   FILE *f = fopen(filename, "r");
+  if (!f) {
+    LOG_FATAL_F("Error opening transcriptome file %s\n", filename);
+  }
 
   int pos, direction, count = 0;
   exon_t *exon = NULL, *exon1 = NULL, *exon2 = NULL;
 
   size_t g_start, g_end;
   int type, strand;
-  char nt_start[2], nt_end[2];
+  char nt_start[3], nt_end[3];
   char *transcript_id;
 
+  annotation_record_t *records = NULL, *record;
+  size_t max_records = 0;
+
   array_list_t *list = array_list_new(100, 1.25f, COLLECTION_MODE_ASYNCHRONIZED);
 
+  *num_records = 0;
   
   while (1) {
 
@@ -1755,8 +1792,6 @@ void load_transcriptome(char *filename, genome_t *genome,
 
     for (int i = 0; i < list->size; i++, pos += direction) {
 
-      //      printf("---> pos = %i\n", pos);
-
       // get exon1
       if (!exon1) {
 	exon1 = array_list_get(pos, list);
@@ -1768,81 +1803,51 @@ void load_transcriptome(char *filename, genome_t *genome,
       if (!exon2) {
 	exon2 = array_list_get(pos, list);
 	if (exon2) {
-	  //	exon_display(exon2);
 	  count++;
 	}
       }
 
       if (exon1 && exon2) {
-	//	printf("Process Exon1[%lu-%lu] and Exon2[%lu-%lu]\n", exon1->start, exon1->end, exon2->start, exon2->end);
 	// exons belonging to the same transcript
 	// process exon1 and exon2, to init the splice junction
 	g_start = exon1->end + 1;
 	g_end = g_start + 1;
-	//	printf("chr = %s (%i), strand %i, g_start = %i, g_end = %i\n", exon1->chr_name, exon1->chr, exon1->strand, g_start, g_end);
-	genome_read_sequence_by_chr_index(nt_start, exon1->strand, exon1->chr, &g_start, &g_end, genome);
-	//	printf("\tnt_start = %s\n", nt_start);
+	reference_read_sequence(nt_start, exon1->strand, exon1->chr, &g_start, &g_end, genome);
 	
 	g_end = exon2->start - 1;
 	g_start = g_end - 1;
-	//	printf("chr = %s (%i), strand %i, g_start = %i, g_end = %i\n", exon2->chr_name, exon2->chr, exon2->strand, g_start, g_end);
-	genome_read_sequence_by_chr_index(nt_end, exon2->strand, exon2->chr, &g_start, &g_end, genome);
-	//	printf("\tnt_end = %s\n", nt_end);
+	reference_read_sequence(nt_end, exon2->strand, exon2->chr, &g_start, &g_end, genome);
 	
 	type = splice_junction_type(nt_start[0], nt_start[1], nt_end[0], nt_end[1]);
-	int splice_strand;
-	avl_node_t *avl_node_start, *avl_node_end;
-	
-	splice_strand = 0;
-	if (type == CT_AC_SPLICE || type == GT_AT_SPLICE || type == CT_GC_SPLICE ) {
-	  splice_strand = 1;
-	}
-	
-	//LOG_FATAL_F("nt_start = %s, nt_end = %s, type = %i\n", nt_start, nt_end, type);
 	
-	//LOG_DEBUG_F("start_splice = %lu - end_splice = %lu (%s, %s, %s)\n", exon1->end, exon2->start, exon1->transcript_id, exon2->transcript_id, transcript_id);
 	if (exon2->start - 1 < exon1->end + 1) {
 	  LOG_FATAL_F("start_splice = %lu - end_splice = %lu (%s, %s, %s)\n", exon1->end, exon2->start, exon1->transcript_id, exon2->transcript_id, transcript_id);
 	}
 
-	char sj_ref[10];
+	record = annotation_record_add(&records, num_records, &max_records);
+	record->type = ANNOTATION_SPLICE;
+	record->chr = exon1->chr;
+	record->sj_type = type;
+	record->splice_strand = (type == CT_AC_SPLICE || type == GT_AT_SPLICE || type == CT_GC_SPLICE);
+	record->start = exon1->start;
+	record->end = exon1->end;
+	record->next_start = exon2->start;
+	record->next_end = exon2->end;
+
 	size_t genome_start = exon1->end + 1;
 	size_t genome_end   = genome_start + 2;      
-	genome_read_sequence_by_chr_index(sj_ref, 0, exon1->chr,
-					  &genome_start, &genome_end, genome);     
+	reference_read_sequence(record->sj_ref, 0, exon1->chr,
+				&genome_start, &genome_end, genome);     
 
-	sj_ref[2] = '-';
+	record->sj_ref[2] = '-';
 
 	genome_start = exon2->start - 2;
 	genome_end   = genome_start + 1;
-	genome_read_sequence_by_chr_index(&sj_ref[3], 0, exon1->chr,
-					  &genome_start, &genome_end, genome);
-
+	reference_read_sequence(&record->sj_ref[3], 0, exon1->chr,
+				&genome_start, &genome_end, genome);
       
-	sj_ref[5] = '\0';
+	record->sj_ref[5] = '\0';
 
-	//printf("%i:%lu-%lu : %s\n", exon1->chr + 1, exon1->end + 1, exon2->start - 1, sj_ref);
-	
-	//exit(-1);
-	allocate_start_node(exon1->chr,       // startint at 0
-			    splice_strand,
-			    exon1->end + 1,   // splice start
-			    exon2->start - 1, // splice_end,
-			    exon1->end + 1,   // splice start
-			    exon2->start - 1, // splice_end,
-			    FROM_FILE,
-			    type,
-			    sj_ref, 
-			    &avl_node_start,
-			    &avl_node_end, 
-			    avls_list);
-	
-	metaexon_insert(0/*exon1->strand*/, exon1->chr, exon1->start, exon1->end, 40,
-			METAEXON_RIGHT_END, avl_node_start, metaexons);
-	
-	metaexon_insert(0/*exon2->strand*/, exon2->chr, exon2->start, exon2->end, 40,
-			METAEXON_LEFT_END, avl_node_end, metaexons);
-	
 	// ...and then, free exon1 and update it to exon2
 	exon_free(exon1);
 	exon1 = exon2;
@@ -1851,9 +1856,11 @@ void load_transcriptome(char *filename, genome_t *genome,
 	// process the last exon (exon1) but only if it's the first (no splice)
 	// (otherwise, it was already processed, there was a splice)
 	if (exon1->exon_number == 1) {
-	  //	  printf("Process Exon1[%lu-%lu]\n", exon1->start, exon1->end);
-	  metaexon_insert(0/*exon1->strand*/, exon1->chr, exon1->start, exon1->end, 40,
-			  METAEXON_NORMAL, NULL, metaexons);
+	  record = annotation_record_add(&records, num_records, &max_records);
+	  record->type = ANNOTATION_EXON;
+	  record->chr = exon1->chr;
+	  record->start = exon1->start;
+	  record->end = exon1->end;
 	}
 	// and free and exit
 	exon_free(exon1);
@@ -1867,9 +1874,11 @@ void load_transcriptome(char *filename, genome_t *genome,
       // process the last exon (exon1) but only if it's the first (no splice)
       // (otherwise, it was already processed, there was a splice)
       if (exon1->exon_number == 1) {
-	//	printf("Process Exon1[%lu-%lu]\n", exon1->start, exon1->end);
-	metaexon_insert(0/*exon1->strand*/, exon1->chr, exon1->start, exon1->end, 40,
-			METAEXON_NORMAL, NULL, metaexons);
+	record = annotation_record_add(&records, num_records, &max_records);
+	record->type = ANNOTATION_EXON;
+	record->chr = exon1->chr;
+	record->start = exon1->start;
+	record->end = exon1->end;
       }
       // and free and exit
       exon_free(exon1);
@@ -1881,8 +1890,198 @@ void load_transcriptome(char *filename, genome_t *genome,
   fclose(f);
   array_list_free(list, NULL);
 
+  qsort(records, *num_records, sizeof(annotation_record_t), annotation_record_cmp);
+
   LOG_DEBUG_F("Number of processed exons: %i", count);
 
+  return records;
+}
+
+//--------------------------------------------------------------------------------------
+
+//FNV-1a over the chromosome names and lengths: records keep chromosome
+//indices, an index with other names or another order must not reuse them
+static uint64_t annotation_cache_genome_hash(genome_t *genome) {
+  uint64_t hash = 14695981039346656037ULL;
+  uint64_t size;
+
+  for (int c = 0; c < genome->num_chromosomes; c++) {
+    for (unsigned char *n = (unsigned char *) genome->chr_name[c]; ; n++) {
+      hash = (hash ^ *n) * 1099511628211ULL;
+      if (!*n) break;
+    }
+    size = genome->chr_size[c];
+    for (int b = 0; b < 8; b++) {
+      hash = (hash ^ ((size >> (8 * b)) & 0xff)) * 1099511628211ULL;
+    }
+  }
+
+  return hash;
+}
+
+//--------------------------------------------------------------------------------------
+
+static void annotation_cache_header_init(char *gtf_filename, genome_t *genome,
+					 annotation_cache_header_t *header) {
+  struct stat st;
+
+  memset(header, 0, sizeof(annotation_cache_header_t));
+  memcpy(header->magic, ANNOTATION_CACHE_MAGIC, sizeof(header->magic));
+  if (stat(gtf_filename, &st) == 0) {
+    header->gtf_size = st.st_size;
+    header->gtf_mtime = st.st_mtime;
+  }
+  header->num_chromosomes = genome->num_chromosomes;
+  for (int c = 0; c < genome->num_chromosomes; c++) {
+    header->genome_length += genome->chr_size[c];
+  }
+  header->genome_hash = annotation_cache_genome_hash(genome);
+}
+
+//--------------------------------------------------------------------------------------
+
+int annotation_cache_write(char *cache_filename, char *gtf_filename, genome_t *genome,
+			   annotation_record_t *records, size_t num_records) {
+  annotation_cache_header_t header;
+  char tmp_filename[strlen(cache_filename) + 8];
+  FILE *f;
+
+  annotation_cache_header_init(gtf_filename, genome, &header);
+  header.num_records = num_records;
+
+  //Write aside and rename, concurrent runs never see a partial cache
+  sprintf(tmp_filename, "%s.tmp", cache_filename);
+  if (!(f = fopen(tmp_filename, "wb"))) {
+    return 0;
+  }
+
+  if (fwrite(&header, sizeof(header), 1, f) != 1 ||
+      fwrite(records, sizeof(annotation_record_t), num_records, f) != num_records) {
+    fclose(f);
+    unlink(tmp_filename);
+    return 0;
+  }
+
+  fclose(f);
+  if (rename(tmp_filename, cache_filename)) {
+    unlink(tmp_filename);
+    return 0;
+  }
+
+  return 1;
+}
+
+//--------------------------------------------------------------------------------------
+
+annotation_record_t *annotation_cache_map(char *cache_filename, char *gtf_filename, 
+					  genome_t *genome, size_t *num_records,
+					  void **map, size_t *map_size) {
+  annotation_cache_header_t expected, *header;
+  struct stat st;
+  int fd;
+
+  if ((fd = open(cache_filename, O_RDONLY)) < 0) {
+    return NULL;
+  }
+
+  if (fstat(fd, &st) || st.st_size < sizeof(annotation_cache_header_t)) {
+    close(fd);
+    return NULL;
+  }
+
+  *map_size = st.st_size;
+  *map = mmap(NULL, *map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (*map == MAP_FAILED) {
+    return NULL;
+  }
+
+  //The cache is only valid for the same annotation file and genome
+  header = (annotation_cache_header_t *) *map;
+  annotation_cache_header_init(gtf_filename, genome, &expected);
+  if (memcmp(header->magic, expected.magic, sizeof(expected.magic)) ||
+      header->gtf_size != expected.gtf_size ||
+      header->gtf_mtime != expected.gtf_mtime ||
+      header->num_chromosomes != expected.num_chromosomes ||
+      header->genome_length != expected.genome_length ||
+      header->genome_hash != expected.genome_hash ||
+      *map_size != sizeof(annotation_cache_header_t) + header->num_records * sizeof(annotation_record_t)) {
+    munmap(*map, *map_size);
+    return NULL;
+  }
+
+  *num_records = header->num_records;
+  return (annotation_record_t *) (header + 1);
+}
+
+//--------------------------------------------------------------------------------------
+
+void annotation_apply(annotation_record_t *records, size_t num_records,
+		      avls_list_t *avls_list, metaexons_t *metaexons) {
+  avl_node_t *avl_node_start, *avl_node_end;
+  char sj_ref[8];
+
+  for (size_t i = 0; i < num_records; i++) {
+    annotation_record_t *record = &records[i];
+    if (record->type == ANNOTATION_SPLICE) {
+      memcpy(sj_ref, record->sj_ref, sizeof(sj_ref));
+      allocate_start_node(record->chr,       // startint at 0
+			  record->splice_strand,
+			  record->end + 1,        // splice start
+			  record->next_start - 1, // splice_end,
+			  record->end + 1,        // splice start
+			  record->next_start - 1, // splice_end,
+			  FROM_FILE,
+			  record->sj_type,
+			  sj_ref, 
+			  &avl_node_start,
+			  &avl_node_end, 
+			  avls_list);
+	
+      metaexon_insert(0, record->chr, record->start, record->end, 40,
+		      METAEXON_RIGHT_END, avl_node_start, metaexons);
+	
+      metaexon_insert(0, record->chr, record->next_start, record->next_end, 40,
+		      METAEXON_LEFT_END, avl_node_end, metaexons);
+    } else {
+      metaexon_insert(0, record->chr, record->start, record->end, 40,
+		      METAEXON_NORMAL, NULL, metaexons);
+    }
+  }
+}
+
+//--------------------------------------------------------------------------------------
+
+void load_transcriptome(char *filename, char *cache_dirname, genome_t *genome, 
+			avls_list_t *avls_list, metaexons_t *metaexons) {
+  char *gtf_basename = strrchr(filename, '/') ? strrchr(filename, '/') + 1 : filename;
+  char cache_filenames[2][strlen(filename) + strlen(cache_dirname) + 16];
+  annotation_record_t *records;
+  size_t num_records, map_size;
+  void *map;
+
+  //Next to the GTF first, the output directory when that one is read-only
+  sprintf(cache_filenames[0], "%s%s", filename, ANNOTATION_CACHE_SUFFIX);
+  sprintf(cache_filenames[1], "%s/%s%s", cache_dirname, gtf_basename, ANNOTATION_CACHE_SUFFIX);
+
+  for (int i = 0; i < 2; i++) {
+    if ((records = annotation_cache_map(cache_filenames[i], filename, genome, 
+					&num_records, &map, &map_size))) {
+      LOG_DEBUG_F("Transcriptome loaded from cache %s", cache_filenames[i]);
+      annotation_apply(records, num_records, avls_list, metaexons);
+      munmap(map, map_size);
+      return;
+    }
+  }
+
+  records = annotation_parse_gtf(filename, genome, &num_records);
+  if (!annotation_cache_write(cache_filenames[0], filename, genome, records, num_records) &&
+      !annotation_cache_write(cache_filenames[1], filename, genome, records, num_records)) {
+    LOG_WARN_F("Could not write the transcriptome cache %s\n", cache_filenames[1]);
+  }
+  annotation_apply(records, num_records, avls_list, metaexons);
+  free(records);
+
 }
 
 //--------------------------------------------------------------------
@@ -11,6 +11,10 @@
 #include <getopt.h>
 #include <unistd.h>
 #include <dirent.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "cprops/trie.h"
 
@@ -34,6 +38,7 @@
 
 #include "options.h"
 #include "statistics.h"
+#include "metrics.h"
 #include "workflow_functions.h"
 #include "rna_server.h"
 
@@ -134,7 +139,57 @@ static inline void exon_display(exon_t *p) {
   }
 }
 
-void load_transcriptome(char *filename, genome_t *genome, 
+//--------------------------------------------------------------------------------------
+// Transcriptome annotation, compiled the first time a GTF is used to a
+// binary cache next to it (<gtf>.hpgann), or in the output directory when
+// the GTF one is read-only, that later runs mmap directly
+//--------------------------------------------------------------------------------------
+
+#define ANNOTATION_CACHE_MAGIC  "HPGANN3"
+#define ANNOTATION_CACHE_SUFFIX ".hpgann"
+
+#define ANNOTATION_EXON   0
+#define ANNOTATION_SPLICE 1
+
+typedef struct annotation_cache_header {
+  char magic[8];
+  uint64_t gtf_size;
+  int64_t gtf_mtime;
+  uint64_t num_chromosomes;
+  uint64_t genome_length;
+  uint64_t genome_hash;    //chromosome names and lengths, in index order
+  uint64_t num_records;
+} annotation_cache_header_t;
+
+//Splice records join exon [start-end] with exon [next_start-next_end],
+//records are sorted by chromosome and start, then by GTF order
+typedef struct annotation_record {
+  uint32_t type;
+  uint32_t chr;
+  uint32_t splice_strand;
+  uint32_t sj_type;
+  uint64_t start;
+  uint64_t end;
+  uint64_t next_start;
+  uint64_t next_end;
+  uint64_t order;           //position in the GTF, sort tiebreaker
+  char sj_ref[8];
+} annotation_record_t;
+
+annotation_record_t *annotation_parse_gtf(char *filename, genome_t *genome, 
+					  size_t *num_records);
+
+int annotation_cache_write(char *cache_filename, char *gtf_filename, genome_t *genome,
+			   annotation_record_t *records, size_t num_records);
+
+annotation_record_t *annotation_cache_map(char *cache_filename, char *gtf_filename, 
+					  genome_t *genome, size_t *num_records,
+					  void **map, size_t *map_size);
+
+void annotation_apply(annotation_record_t *records, size_t num_records,
+		      avls_list_t *avls_list, metaexons_t *metaexons);
+
+void load_transcriptome(char *filename, char *cache_dirname, genome_t *genome, 
 			avls_list_t *avls_list, metaexons_t *metaexons);
 
 #endif
@@ -1,5 +1,6 @@
 #include <omp.h>
 #include "rna_server.h"
+#include "aux/aux_nt_simd.h"
 
 //COLORS
 #define KNRM  "\x1B[0m"
@@ -115,7 +116,6 @@ int ii = -1;
 
 //extern size_t TOTAL_READS_PROCESS, TOTAL_SW, TOTAL_READS_SA;
 extern pthread_mutex_t mutex_sp; 
-extern st_bwt_t st_bwt;
 extern size_t total_reads_w2, total_reads_w3;
 
 extern int min_intron, max_intron;
@@ -190,7 +190,7 @@ char *cigar_code_find_and_report_sj(size_t start_map, cigar_code_t *cigar_code,
 
       genome_start = sj_start;
       genome_end   = genome_start + 2;      
-      genome_read_sequence_by_chr_index(sj_ref, 0, chromosome - 1,
+      reference_read_sequence(sj_ref, 0, chromosome - 1,
 					&genome_start, &genome_end, genome);
       
       //printf("SP_START: %c%c\n", sj_start_ref[0], sj_start_ref[1]);
@@ -199,7 +199,7 @@ char *cigar_code_find_and_report_sj(size_t start_map, cigar_code_t *cigar_code,
 
       genome_start = sj_end - 1;
       genome_end   = genome_start + 1;
-      genome_read_sequence_by_chr_index(&sj_ref[3], 0, chromosome - 1,
+      reference_read_sequence(&sj_ref[3], 0, chromosome - 1,
 					&genome_start, &genome_end, genome);
 
       
@@ -230,18 +230,11 @@ char *cigar_code_find_and_report_sj(size_t start_map, cigar_code_t *cigar_code,
 	//printf("%s : %i:%lu, cigar: %s, SP=> %lu-%lu\n", read->id, chromosome, start_map, new_cigar_code_string(cigar_code), sj_start, sj_end);
 	if ((sj_ref[0] == 'C' && sj_ref[1] == 'T' && sj_ref[3] == 'A' && sj_ref[4] == 'C') ||
 	    (sj_ref[0] == 'G' && sj_ref[1] == 'T' && sj_ref[3] == 'A' && sj_ref[4] == 'G')) {
-	  pthread_mutex_lock(&mutex_sp);
-	  st_bwt.cannonical_sj++;
-	  pthread_mutex_unlock(&mutex_sp);
+	  thread_stats_inc(ST_CANNONICAL_SJ);
 	} else {
-	  pthread_mutex_lock(&mutex_sp);
-	  st_bwt.semi_cannonical_sj++;
-	  pthread_mutex_unlock(&mutex_sp);
+	  thread_stats_inc(ST_SEMI_CANNONICAL_SJ);
 	}
-
-	pthread_mutex_lock(&mutex_sp);
-	st_bwt.tot_sj++;
-	pthread_mutex_unlock(&mutex_sp);
+	thread_stats_inc(ST_TOT_SJ);
 	
 	allocate_start_node(chromosome - 1,
 			    sj_strand,
@@ -300,18 +293,9 @@ char *cigar_code_find_and_report_sj(size_t start_map, cigar_code_t *cigar_code,
 
 
 void fastq_read_revcomp(fastq_read_t *read) {
-  extern char convert_ASCII[128];
-
   read->revcomp = (char *)malloc((read->length + 1)*sizeof(char));
-
-  register int i, j;
-
-  for (i = read->length - 1, j = 0; i >= 0; i--, j++) {
-    read->revcomp[j] = convert_ASCII[(unsigned char)read->sequence[i]];
-  }
-  
-  read->revcomp[j] = '\0';
-
+  simd_nt_revcomp(read->sequence, read->length, read->revcomp);
+  read->revcomp[read->length] = '\0';
 }
 
 
@@ -593,11 +577,11 @@ cigar_code_t *generate_cigar_sw_output(char *seq_sw,
 	  /*char nt_start[5], nt_end[5];
 	  size_t g_start = start_splice;
 	  size_t g_end   = start_splice + 1;
-	  genome_read_sequence_by_chr_index(nt_start, strand, chromosome - 1, &g_start, &g_end, genome);
+	  reference_read_sequence(nt_start, strand, chromosome - 1, &g_start, &g_end, genome);
 	  
 	  g_end   = end_splice;
 	  g_start = end_splice - 1;
-	  genome_read_sequence_by_chr_index(nt_end, strand, chromosome - 1, &g_start, &g_end, genome);
+	  reference_read_sequence(nt_end, strand, chromosome - 1, &g_start, &g_end, genome);
 	  
 	  found = UNKNOWN_SPLICE;
 	  sprintf(str_sp_type, "%c%c-%c%c\0", nt_start[0], nt_start[1], nt_end[0], nt_end[1]);
@@ -871,7 +855,7 @@ cigar_code_t *meta_alignment_fill_extrem_gap(char *query,
 
   //cal_print(cal);
 
-  pthread_mutex_lock(&(metaexons->mutex[cal->chromosome_id - 1]));
+  metaexons_read_lock(cal->chromosome_id - 1, metaexons);
 
   //FILL_GAP_LEFT  0
   //FILL_GAP_RIGHT 1
@@ -892,9 +876,9 @@ cigar_code_t *meta_alignment_fill_extrem_gap(char *query,
     genome_end = s_prev->genome_start - 1;
     //printf("FILL_GAP_LEFT [%i-%i] %i\n", read_start, read_end, read_gap);
     
-    metaexon_search(cal->strand, cal->chromosome_id - 1,
-		    cal->start, cal->start + 5, &metaexon,
-		    metaexons);
+    metaexon_search_unlocked(cal->strand, cal->chromosome_id - 1,
+			     cal->start, cal->start + 5, &metaexon,
+			     metaexons);
     
   } else {
     seed_region_t *s_prev = linked_list_get_last(cal->sr_list);
@@ -905,9 +889,9 @@ cigar_code_t *meta_alignment_fill_extrem_gap(char *query,
     genome_start = s_prev->genome_end + 1;
     genome_end = s_prev->genome_end + read_gap + 1;
     //printf("FILL_GAP_RIGHT [%i-%i] %i\n", read_start, read_end, read_gap);
-    metaexon_search(cal->strand, cal->chromosome_id - 1,
-		    cal->end - 5, cal->end, &metaexon,
-		    metaexons);
+    metaexon_search_unlocked(cal->strand, cal->chromosome_id - 1,
+			     cal->end - 5, cal->end, &metaexon,
+			     metaexons);
     
   }
 
@@ -957,7 +941,7 @@ cigar_code_t *meta_alignment_fill_extrem_gap(char *query,
 					   avls_list);   
   }
   
-  pthread_mutex_unlock(&(metaexons->mutex[cal->chromosome_id - 1]));
+  metaexons_read_unlock(cal->chromosome_id - 1, metaexons);
 
 
   return cigar_code;
@@ -1015,15 +999,15 @@ cigar_code_t *fill_extrem_gap(char *query,
 
   //printf("FILL EXTREM GAP: [%i-%i]\n", read_start, read_end);
 
-  pthread_mutex_lock(&(metaexons->mutex[cal->chromosome_id - 1]));
+  metaexons_read_lock(cal->chromosome_id - 1, metaexons);
 
   //printf("genome_start = %i, genome_end = %i\n", genome_start, genome_end);
 
   //printf("%i:%lu-%lu(%i)\n", cal->chromosome_id, cal->start, cal->end, cal->strand);
 
-  metaexon_search(cal->strand, cal->chromosome_id - 1,
-		  cal->start, cal->end, &metaexon,
-		  metaexons);
+  metaexon_search_unlocked(cal->strand, cal->chromosome_id - 1,
+			   cal->start, cal->end, &metaexon,
+			   metaexons);
 
   if (metaexon != NULL) {
     //printf("METAEXON NOT NULL! %i-%i\n", metaexon->start, metaexon->end);
@@ -1080,11 +1064,11 @@ cigar_code_t *fill_extrem_gap(char *query,
   if (cigar_code == NULL) {
     //printf("Search NORMAL\n");
     if (genome_end - genome_start >= 2048) {
-      pthread_mutex_unlock(&(metaexons->mutex[cal->chromosome_id - 1]));
+      metaexons_read_unlock(cal->chromosome_id - 1, metaexons);
       return NULL;
     }    
    
-    genome_read_sequence_by_chr_index(reference, 0, 
+    reference_read_sequence(reference, 0, 
 				      chromosome_id - 1,
 				      &genome_start, &genome_end,
 				      genome);    
@@ -1123,7 +1107,7 @@ cigar_code_t *fill_extrem_gap(char *query,
     
   }
   
-  pthread_mutex_unlock(&(metaexons->mutex[cal->chromosome_id - 1]));
+  metaexons_read_unlock(cal->chromosome_id - 1, metaexons);
 
 
   return cigar_code;
@@ -1436,7 +1420,7 @@ int merge_and_filter_cals(array_list_t *cals_targets,
 
       genome_start = cal_prev->start - s_prev->read_start + 1;
       genome_end = cal_prev->start;
-      genome_read_sequence_by_chr_index(reference, 0, 
+      reference_read_sequence(reference, 0, 
 					cal_prev->chromosome_id - 1, &genome_start, &genome_end, genome);      
       memcpy(query, sequence, s_prev->read_start);
       query[s_prev->read_start] = '\0';
@@ -1472,7 +1456,7 @@ int merge_and_filter_cals(array_list_t *cals_targets,
 
       genome_start = cal_next->end;
       genome_end = cal_next->end + (fq_read->length - s_next->read_end) - 1;
-      genome_read_sequence_by_chr_index(reference, 0, 
+      reference_read_sequence(reference, 0, 
 					cal_next->chromosome_id - 1, &genome_start, &genome_end, genome);
 
       //printf("#############From %i:%lu-%lu: %s\n", cal_next->chromosome_id - 1, genome_start, genome_end, reference);
@@ -1638,12 +1622,12 @@ void generate_reference_splice_juntion(array_list_t *cals_targets, char *query_r
 	//Extend to Right --> <-- Extend to Left
 	genome_start = s_prev->genome_end;
 	genome_end = s_prev->genome_end + seeds_nt - 1;
-	genome_read_sequence_by_chr_index(reference_prev, 0, 
+	reference_read_sequence(reference_prev, 0, 
 					  cal->chromosome_id - 1, &genome_start, &genome_end, genome);
 
 	genome_start2 = s->genome_start - seeds_nt;
 	genome_end2 = s->genome_start - 1;
-	genome_read_sequence_by_chr_index(reference_next, 0, 
+	reference_read_sequence(reference_next, 0, 
 					  cal->chromosome_id - 1, &genome_start2, &genome_end2, genome);
 
 	memcpy(query, query_map + read_start, read_end - read_start);
@@ -1682,13 +1666,13 @@ void generate_reference_splice_juntion(array_list_t *cals_targets, char *query_r
       //Extract and fusion Reference SW
       genome_start = cal_prev->end - flank;
       genome_end = cal_prev->end + flank - 1;
-      genome_read_sequence_by_chr_index(reference_prev, 0, 
+      reference_read_sequence(reference_prev, 0, 
 					cal_prev->chromosome_id - 1, &genome_start, &genome_end, genome);
 
       //printf("Ref Prev %i\n", strlen(reference_prev));
       genome_start2 = cal->start - flank;
       genome_end2 = cal->start + flank - 1;
-      genome_read_sequence_by_chr_index(reference_next, 0, 
+      reference_read_sequence(reference_next, 0, 
 					cal->chromosome_id - 1, &genome_start2, &genome_end2, genome);
       
       //printf("Ref Next %i [%i:%i-%i]=%s\n", strlen(reference_next), cal->chromosome_id, genome_start2, genome_end2, reference_next);
@@ -2332,7 +2316,7 @@ void meta_alignment_fill_gaps(int meta_type,
 	    max_size = genome_end - genome_start + 1024;
 	    reference = (char *)calloc(max_size, sizeof(char));
 	  }
-          genome_read_sequence_by_chr_index(reference, 0, cal->chromosome_id - 1,
+          reference_read_sequence(reference, 0, cal->chromosome_id - 1,
                                             &genome_start, &genome_end, genome);
 	  //printf("[%lu|%i]-GAP-[%i|%lu]: %s\n", genome_start, read_start, read_end, genome_end, reference);
 	  for (int k = 0; k < gap_read; k++) {
@@ -2422,7 +2406,7 @@ void meta_alignment_fill_gaps(int meta_type,
 	    max_size = genome_end - genome_start + 1024;
 	    reference = (char *)calloc(max_size, sizeof(char));
 	  }
-	  genome_read_sequence_by_chr_index(reference, 0, cal->chromosome_id - 1,
+	  reference_read_sequence(reference, 0, cal->chromosome_id - 1,
 					    &genome_start, &genome_end, genome);
 	  char query[2048];
 
@@ -2772,12 +2756,12 @@ info_sp_t* sw_reference_splice_junction(cal_t *cal_prev, cal_t *cal_next,
     //Extend to Right --> <-- Extend to Left
     genome_start = s_prev->genome_end;
     genome_end = s_prev->genome_end + seeds_nt - 1;
-    genome_read_sequence_by_chr_index(reference_prev, 0, 
+    reference_read_sequence(reference_prev, 0, 
 				      cal_prev->chromosome_id - 1, &genome_start, &genome_end, genome);
 
     genome_start2 = s_next->genome_start - seeds_nt;
     genome_end2 = s_next->genome_start - 1;
-    genome_read_sequence_by_chr_index(reference_next, 0, 
+    reference_read_sequence(reference_next, 0, 
 				      cal_next->chromosome_id - 1, &genome_start2, &genome_end2, genome);
 
     memcpy(query, query_map + read_start, read_end - read_start);
@@ -2835,7 +2819,7 @@ info_sp_t* sw_reference_splice_junction(cal_t *cal_prev, cal_t *cal_next,
   genome_start = cal_prev->end - flank_left + 1;
   //printf("GENOME END %lu - %i + 1 = %lu\n", cal_prev->end, flank_left, genome_start);
   genome_end = cal_prev->end + flank - 1;
-  genome_read_sequence_by_chr_index(reference_prev, 0, 
+  reference_read_sequence(reference_prev, 0, 
 				    cal_prev->chromosome_id - 1, &genome_start, &genome_end, genome);
   //printf("1g[From %lu to %lu](%i): %s(%i)\n", genome_start, genome_end, genome_end - genome_start + 1, 
   //	 reference_prev, strlen(reference_prev));
@@ -2844,7 +2828,7 @@ info_sp_t* sw_reference_splice_junction(cal_t *cal_prev, cal_t *cal_next,
   cal_next->r_flank = flank_right;
   genome_start2 = cal_next->start - flank;
   genome_end2 = cal_next->start + flank_right - 1;
-  genome_read_sequence_by_chr_index(reference_next, 0, 
+  reference_read_sequence(reference_next, 0, 
 				    cal_next->chromosome_id - 1, &genome_start2, &genome_end2, genome);
   //printf("2g[From %lu to %lu](%i): %s(%i)\n", genome_start2, genome_end2, genome_end2 - genome_start2 + 1, 
   //	 reference_next, strlen(reference_next));
@@ -2957,7 +2941,7 @@ int search_simple_splice_junction_semi_cannonical(seed_region_t *s_prev, seed_re
   LOG_DEBUG_F("GAP READ %i - %i = %i\n", read_end, read_start, gap_read);
   LOG_DEBUG_F("SEQUENCE   : %s\n", sequence);
 
-  genome_read_sequence_by_chr_index(left_exon, 0, 
+  reference_read_sequence(left_exon, 0, 
 				    chromosome_id - 1, 
 				    &genome_start, &genome_end, genome);		  
 
@@ -2966,7 +2950,7 @@ int search_simple_splice_junction_semi_cannonical(seed_region_t *s_prev, seed_re
   genome_start = genome_start_aux - gap_read - FLANK;
   genome_end   = genome_start_aux - 1;
   
-  genome_read_sequence_by_chr_index(right_exon, 0, 
+  reference_read_sequence(right_exon, 0, 
 				    chromosome_id - 1, 
 				    &genome_start, &genome_end, genome);		  
 
@@ -3301,7 +3285,7 @@ int search_simple_splice_junction(seed_region_t *s_prev, seed_region_t *s_next,
   LOG_DEBUG_F("SEQUENCE   : %s\n", sequence);
 
   LOG_DEBUG_F("GAP READ %i - %i = %i\n", read_end, read_start, gap_read);
-  genome_read_sequence_by_chr_index(left_exon, 0, 
+  reference_read_sequence(left_exon, 0, 
 				    chromosome_id - 1, 
 				    &genome_start, &genome_end, genome);		  
 
@@ -3311,7 +3295,7 @@ int search_simple_splice_junction(seed_region_t *s_prev, seed_region_t *s_next,
   genome_start = genome_start_aux - gap_read - FLANK;
   genome_end   = genome_start_aux - 1;
   
-  genome_read_sequence_by_chr_index(right_exon, 0, 
+  reference_read_sequence(right_exon, 0, 
 				    chromosome_id - 1, 
 				    &genome_start, &genome_end, genome);		  
 
@@ -3522,6 +3506,7 @@ int search_simple_splice_junction(seed_region_t *s_prev, seed_region_t *s_next,
 
 }
 
+//The caller holds the read lock of the CAL chromosome
 cigar_code_t *search_left_single_anchor(int gap_close, 
 					cal_t *cal,
 					int filter_pos, 
@@ -3586,7 +3571,7 @@ cigar_code_t *search_left_single_anchor(int gap_close,
       //printf("::: %i+%i=%i <= %i\n", read_pos, gap_close, read_pos + gap_close, strlen(query_map));
       assert((read_pos + gap_close) <= strlen(query_map));
 
-      genome_read_sequence_by_chr_index(reference, 0, 
+      reference_read_sequence(reference, 0, 
 					cal_chromosome_id - 1, 
 					&genome_start, &genome_end, genome);
 
@@ -3646,7 +3631,7 @@ cigar_code_t *search_left_single_anchor(int gap_close,
     } else {
       assert((genome_end - genome_start) + 5 < 2048);
 
-      genome_read_sequence_by_chr_index(reference, 0, 
+      reference_read_sequence(reference, 0, 
 					cal_chromosome_id - 1, 
 					&genome_start, &genome_end, genome);
       //printf("(%i)after extraction genome_start = %lu, genome_end = %lu\n", cal_chromosome_id, genome_start, genome_end);
@@ -3738,7 +3723,7 @@ cigar_code_t *search_left_single_anchor(int gap_close,
 
 	assert((genome_end - genome_start) + 5 < 2048);
 	//printf("%lu - %lu\n", genome_start, genome_end);
-	genome_read_sequence_by_chr_index(s_reference[s], 0, 
+	reference_read_sequence(s_reference[s], 0, 
 					  cal_chromosome_id - 1, 
 					  &genome_start, &genome_end, genome); 	      
 	//printf("Reference END_SP [START_SP]----[[[END_SP]]]  [%i:%lu-%lu](%i): %s\n", cal_chromosome_id, genome_start, genome_end, 
@@ -3810,9 +3795,9 @@ cigar_code_t *search_left_single_anchor(int gap_close,
 	map = 1;
 	break; 
       } else {
-	if (metaexon_search(cal_strand, cal_chromosome_id - 1, 
-			    final_pos, final_pos + anchor_nt, 
-			    &final_metaexon, metaexons)) {
+	if (metaexon_search_unlocked(cal_strand, cal_chromosome_id - 1, 
+				     final_pos, final_pos + anchor_nt, 
+				     &final_metaexon, metaexons)) {
 	  if (final_metaexon) {
 	    if (final_metaexon->right_closed) {
 	      array_list_clear(starts_targets, (void *)NULL);
@@ -3831,7 +3816,7 @@ cigar_code_t *search_left_single_anchor(int gap_close,
 		genome_end = genome_start + gap_close + 1;
 		assert((genome_end - genome_start) + 5 < 2048);
 		assert((read_pos + gap_close) <= strlen(query_map));
-		genome_read_sequence_by_chr_index(reference, 0, 
+		reference_read_sequence(reference, 0, 
 						  cal_chromosome_id - 1, 
 						  &genome_start, &genome_end, genome);		
 		//printf("CLOSE GAP: %s\n", reference);
@@ -3890,11 +3875,11 @@ cigar_code_t *search_left_single_anchor(int gap_close,
 	//Report splice junction
 	size_t g_start = start_sp;
 	size_t g_end   = start_sp + 1;
-	genome_read_sequence_by_chr_index(nt_start, cal->strand, cal->chromosome_id - 1, &g_start, &g_end, genome);
+	reference_read_sequence(nt_start, cal->strand, cal->chromosome_id - 1, &g_start, &g_end, genome);
 
 	g_end   = end_sp;
 	g_start = end_sp - 1;
-	genome_read_sequence_by_chr_index(nt_end, cal->strand, cal->chromosome_id - 1, &g_start, &g_end, genome);
+	reference_read_sequence(nt_end, cal->strand, cal->chromosome_id - 1, &g_start, &g_end, genome);
 		
 	type = splice_junction_type(nt_start[0], nt_start[1], nt_end[0], nt_end[1]);
 	int splice_strand;
@@ -3947,6 +3932,7 @@ cigar_code_t *search_left_single_anchor(int gap_close,
 
 }
 
+//The caller holds the read lock of the CAL chromosome
 cigar_code_t *search_right_single_anchor(int gap_close, 
 					 cal_t *cal,
 					 int filter_pos, 
@@ -4020,7 +4006,7 @@ cigar_code_t *search_right_single_anchor(int gap_close,
       assert((genome_end - genome_start) + 2 < 2048);
       //assert((read_pos + gap_close) <= strlen(query_map));
 
-      genome_read_sequence_by_chr_index(reference, 0, 
+      reference_read_sequence(reference, 0, 
 					cal_chromosome_id - 1, 
 					&genome_start, &genome_end, genome);
       reference_len = strlen(reference) - 1;
@@ -4081,7 +4067,7 @@ cigar_code_t *search_right_single_anchor(int gap_close,
     } else {
       assert((genome_end - genome_start) + 2 < 2048);
 
-      genome_read_sequence_by_chr_index(reference, 0, 
+      reference_read_sequence(reference, 0, 
 					cal_chromosome_id - 1, 
 					&genome_start, &genome_end, genome);
       //printf("(%lu-%lu)Reference START_SP [[[START_SP]]]----[END_SP]: %s\n",  genome_start, genome_end, reference);
@@ -4163,7 +4149,7 @@ cigar_code_t *search_right_single_anchor(int gap_close,
 	genome_end = (size_t)array_list_get(s, final_ends) - 1;
 	genome_start = genome_end - gap_close - 1;
 	assert((genome_end - genome_start) + 2 < 2048);
-	genome_read_sequence_by_chr_index(s_reference[s], 0, 
+	reference_read_sequence(s_reference[s], 0, 
 					  cal_chromosome_id - 1, 
 					  &genome_start, &genome_end, genome); 	      
 	references_len[s] = strlen(s_reference[s]) - 1;
@@ -4227,9 +4213,9 @@ cigar_code_t *search_right_single_anchor(int gap_close,
 	break;
       } else {
 	//printf("Search in meta: %lu-%lu\n", final_pos, final_pos - anchor_nt);
-	if (metaexon_search(cal_strand, cal_chromosome_id - 1, 
-			    final_pos - anchor_nt, final_pos, 
-			    &final_metaexon, metaexons)) {
+	if (metaexon_search_unlocked(cal_strand, cal_chromosome_id - 1, 
+				     final_pos - anchor_nt, final_pos, 
+				     &final_metaexon, metaexons)) {
 	  if (final_metaexon) {
 	    if (final_metaexon->left_closed) {
 	      array_list_clear(ends_targets, (void *)NULL);
@@ -4249,7 +4235,7 @@ cigar_code_t *search_right_single_anchor(int gap_close,
 		assert((genome_end - genome_start) + 2 < 2048);
 		assert((read_pos) <= strlen(query_map));
 
-		genome_read_sequence_by_chr_index(reference, 0, 
+		reference_read_sequence(reference, 0, 
 						  cal_chromosome_id - 1, 
 						  &genome_start, &genome_end, genome);		
 		//printf("CLOSE GAP (%i): %s\n", gap_close, reference);
@@ -4313,11 +4299,11 @@ cigar_code_t *search_right_single_anchor(int gap_close,
 	//Report splice junction
 	size_t g_start = start_sp;
 	size_t g_end   = start_sp + 1;	
-	genome_read_sequence_by_chr_index(nt_start, cal->strand, cal->chromosome_id - 1, &g_start, &g_end, genome);
+	reference_read_sequence(nt_start, cal->strand, cal->chromosome_id - 1, &g_start, &g_end, genome);
 
 	g_end   = end_sp;
 	g_start = end_sp - 1;
-	genome_read_sequence_by_chr_index(nt_end, cal->strand, cal->chromosome_id - 1, &g_start, &g_end, genome);
+	reference_read_sequence(nt_end, cal->strand, cal->chromosome_id - 1, &g_start, &g_end, genome);
 		
 	type = splice_junction_type(nt_start[0], nt_start[1], nt_end[0], nt_end[1]);
 	int splice_strand;
@@ -4407,7 +4393,7 @@ cigar_code_t *search_double_anchors_cal(char *query_map,
 
   *type = META_ALIGNMENT_MIDDLE;
 
-  pthread_mutex_lock(&(metaexons->mutex[first_cal->chromosome_id - 1]));
+  metaexons_read_lock(first_cal->chromosome_id - 1, metaexons);
 
   //printf("-------------------------------------------\n");
   //cal_print(first_cal);
@@ -4416,18 +4402,20 @@ cigar_code_t *search_double_anchors_cal(char *query_map,
   //metaexons_print(metaexons);
   //printf("-------------------------------------------\n");
 
-  int m_found_f = metaexon_search(first_cal->strand, 
-				  first_cal->chromosome_id - 1,
-				  first_cal->start,
-				  first_cal->end, &first_metaexon,
-				  metaexons); 
-
-  int m_found_l = metaexon_search(last_cal->strand,
-				  last_cal->chromosome_id - 1,
-				  last_cal->start, 
-				  last_cal->end,
-				  &last_metaexon,
-				  metaexons);
+  int m_found_f = metaexon_search_unlocked(first_cal->strand, 
+					   first_cal->chromosome_id - 1,
+					   first_cal->start,
+					   first_cal->end, &first_metaexon,
+					   metaexons); 
+
+  //Only the first CAL chromosome is locked here
+  int m_found_l = (last_cal->chromosome_id == first_cal->chromosome_id ?
+		   metaexon_search_unlocked : metaexon_search)(last_cal->strand,
+							      last_cal->chromosome_id - 1,
+							      last_cal->start, 
+							      last_cal->end,
+							      &last_metaexon,
+							      metaexons);
 
   //if (first_metaexon == last_metaexon) {
   //return NULL;
@@ -4656,7 +4644,7 @@ cigar_code_t *search_double_anchors_cal(char *query_map,
 
 	  assert((s_prev_read_end + size_ex_l + 1) < strlen(query_map));
 
-	  genome_read_sequence_by_chr_index(reference, 0, 
+	  reference_read_sequence(reference, 0, 
 					    first_cal->chromosome_id - 1, 
 					    &genome_start, &genome_end, genome);
 	  //printf("Ref-l-%s\n", reference);
@@ -4687,7 +4675,7 @@ cigar_code_t *search_double_anchors_cal(char *query_map,
 	    exit(-1);
 	  }
 
-	  genome_read_sequence_by_chr_index(reference, 0, 
+	  reference_read_sequence(reference, 0, 
 					    first_cal->chromosome_id - 1, 
 					    &genome_start, &genome_end, genome);		  
 	  //printf("Ref-r-%s\n", reference);
@@ -4741,11 +4729,11 @@ cigar_code_t *search_double_anchors_cal(char *query_map,
 	//Report splice junction
 	size_t g_start = start_sp;
 	size_t g_end   = start_sp + 1;	
-	genome_read_sequence_by_chr_index(nt_start, first_cal->strand, first_cal->chromosome_id - 1, &g_start, &g_end, genome);
+	reference_read_sequence(nt_start, first_cal->strand, first_cal->chromosome_id - 1, &g_start, &g_end, genome);
 
 	g_end   = end_sp;
 	g_start = end_sp - 1;
-	genome_read_sequence_by_chr_index(nt_end, first_cal->strand, first_cal->chromosome_id - 1, &g_start, &g_end, genome);
+	reference_read_sequence(nt_end, first_cal->strand, first_cal->chromosome_id - 1, &g_start, &g_end, genome);
 		
 	type = splice_junction_type(nt_start[0], nt_start[1], nt_end[0], nt_end[1]);
 	int splice_strand;
@@ -4791,7 +4779,7 @@ cigar_code_t *search_double_anchors_cal(char *query_map,
 
   //if (cigar_code == NULL) { exit(-1); }
 
-  pthread_mutex_unlock(&(metaexons->mutex[first_cal->chromosome_id - 1]));  
+  metaexons_read_unlock(first_cal->chromosome_id - 1, metaexons);  
 
   return cigar_code;
 
@@ -5083,14 +5071,14 @@ int meta_alignment_regenerate_cigar(meta_alignment_t *meta_alignment, char *quer
 
       genome_start = seed_prev->genome_end + 1;
       genome_end = seed_prev->genome_end + read_gap + 5;      
-      genome_read_sequence_by_chr_index(reference_prev, 0, 
+      reference_read_sequence(reference_prev, 0, 
 					cal_next->chromosome_id - 1,
 					&genome_start, &genome_end,
 					genome);
 
       genome_start = seed_next->genome_start - read_gap - 5;
       genome_end = seed_next->genome_start - 1;
-      genome_read_sequence_by_chr_index(reference_next, 0, 
+      reference_read_sequence(reference_next, 0, 
 					cal_next->chromosome_id - 1,
 					&genome_start, &genome_end,
 					genome);
@@ -6313,9 +6301,7 @@ int apply_sw_rna(sw_server_input_t* input_p, batch_t *batch) {
     int final_distance;
 
     if (n_alignments) {
-      pthread_mutex_lock(&mutex_sp);
-      st_bwt.map_w1++;
-      pthread_mutex_unlock(&mutex_sp);
+      thread_stats_inc(ST_MAP_W1);
     }
 
     for (size_t a = 0; a < n_alignments; a++) {
@@ -7368,9 +7354,7 @@ int apply_rna_last(sw_server_input_t* input_p, batch_t *batch) {
     size_t n_alignments = array_list_size(mapping_batch->mapping_lists[i]);
 
     if (n_alignments) {
-      pthread_mutex_lock(&mutex_sp);
-      st_bwt.map_w2++;
-      pthread_mutex_unlock(&mutex_sp);
+      thread_stats_inc(ST_MAP_W2);
     }
 
     int final_distance;
@@ -7809,7 +7793,7 @@ int apply_rna_last_hc(sw_server_input_t* input_p, batch_t *batch) {
 	  //SW
 	  genome_start = s_prev->genome_start - s_prev->read_start ;
 	  genome_end   = s_prev->genome_start - 1;
-	  genome_read_sequence_by_chr_index(r, 0, 
+	  reference_read_sequence(r, 0, 
 					    first_cal->chromosome_id - 1,
 					    &genome_start, &genome_end,
 					    genome);    
@@ -7856,7 +7840,7 @@ int apply_rna_last_hc(sw_server_input_t* input_p, batch_t *batch) {
 	  
 	  genome_start = s_next->genome_end + 1;
 	  genome_end   = genome_start + r_gap - 1;	  
-	  genome_read_sequence_by_chr_index(r, 0,
+	  reference_read_sequence(r, 0,
 					    last_cal->chromosome_id - 1,
 					    &genome_start, &genome_end,
 					    genome);    
@@ -8135,9 +8119,7 @@ int apply_rna_last_hc(sw_server_input_t* input_p, batch_t *batch) {
     size_t n_alignments = array_list_size(alignments_list);
 
     if (n_alignments) {
-      pthread_mutex_lock(&mutex_sp);
-      st_bwt.map_w3++;
-      pthread_mutex_unlock(&mutex_sp);
+      thread_stats_inc(ST_MAP_W3);
     }
 
     int final_distance;
@@ -22,6 +22,7 @@
 #include "bioformats/bam/alignment.h"
 #include "aligners/bwt/bwt.h"
 #include "aligners/bwt/genome.h"
+#include "reference_genome.h"
 #include "aligners/sw/macros.h"
 
 #define FILL_GAP_LEFT  0
@@ -1,6 +1,9 @@
 #include "sa_rna_mapper.h"
 
-#define MAX_DEPTH 4
+//SW jobs queued before a flush, a multiple of the SIMD depth
+#define MAX_DEPTH 16
+//Query and reference windows are always shorter than 2048 nt
+#define SW_ARENA_SIZE (MAX_DEPTH * 2 * 2048)
 //#define DEBUG 1
 
 extern int min_intron, max_intron;
@@ -100,6 +103,7 @@ cigar_code_t* search_splice_junction(sw_optarg_t *sw_optarg,
 //Sa Mappings Reader, 2nd round
 void *sa_alignments_reader_rna(void *input) {
   sa_wf_input_t *wf_input = (sa_wf_input_t *) input;  
+  uint64_t prof_time = profiler_start(PROF_READER);
   sa_wf_batch_t *new_wf_batch = NULL;
   sa_wf_batch_t *curr_wf_batch = wf_input->wf_batch;  
   sa_rna_input_t *sa_rna = curr_wf_batch->data_input;
@@ -198,6 +202,8 @@ void *sa_alignments_reader_rna(void *input) {
 
   reads_ph2 += num_reads;
 
+  profiler_stop(PROF_READER, prof_time);
+
   return new_wf_batch;
 
 }
@@ -206,6 +212,7 @@ void *sa_alignments_reader_rna(void *input) {
 //Fastq Reader
 void *sa_fq_reader_rna(void *input) {
   sa_wf_input_t *wf_input = (sa_wf_input_t *) input;
+  uint64_t prof_time = profiler_start(PROF_READER);
   sa_wf_batch_t *new_wf_batch = NULL;
   sa_wf_batch_t *curr_wf_batch = wf_input->wf_batch;  
   fastq_batch_reader_input_t *fq_reader_input = wf_input->fq_reader_input;
@@ -245,6 +252,8 @@ void *sa_fq_reader_rna(void *input) {
 				   curr_wf_batch->data_input);
   }
 
+  profiler_stop(PROF_READER, prof_time);
+
   return new_wf_batch;
 
 }
@@ -269,14 +278,10 @@ int sa_bam_writer_rna(void *data) {
 
   //mapping_batch_t *mapping_batch = (mapping_batch_t *) batch->mapping_batch;
   
-  extern size_t total_reads;
-  extern size_t reads_no_map;
 
   extern pthread_mutex_t mutex_sp;
   
-  pthread_mutex_lock(&mutex_sp);
-  total_reads += num_reads;
-  pthread_mutex_unlock(&mutex_sp);
+  thread_stats_add(ST_SA_TOTAL_READS, num_reads);
   
   //
   // DNA/RNA mode
@@ -287,9 +292,7 @@ int sa_bam_writer_rna(void *data) {
     fq_read = (fastq_read_t *) array_list_get(i, read_list);
     // mapped or not mapped ?	 
     if (num_items == 0) {
-      pthread_mutex_lock(&mutex_sp);
-      reads_no_map++;
-      pthread_mutex_unlock(&mutex_sp);      
+      thread_stats_inc(ST_SA_READS_NO_MAP);
       write_unmapped_read(fq_read, bam_file);
       if (mapping_batch->mapping_lists[i]) {
 	array_list_free(mapping_batch->mapping_lists[i], NULL);
@@ -334,17 +337,13 @@ int sa_sam_writer_rna(void *data) {
   num_reads = mapping_batch->num_reads;
 
   //extern size_t total_reads, unmapped_reads, correct_reads;
-  extern size_t total_reads;
-  extern size_t reads_no_map;
 
   extern pthread_mutex_t mutex_sp;
 
   //struct timeval time_free_s, time_free_e;
   //extern double time_free_alig, time_free_list, time_free_batch;
 
-  pthread_mutex_lock(&mutex_sp);
-  total_reads += num_reads;
-  pthread_mutex_unlock(&mutex_sp);
+  thread_stats_add(ST_SA_TOTAL_READS, num_reads);
 
   if (pair_mode != SINGLE_END_MODE) {
     /*
@@ -462,9 +461,7 @@ int sa_sam_writer_rna(void *data) {
 
 	}
       } else {
-	pthread_mutex_lock(&mutex_sp);
-	reads_no_map++;
-	pthread_mutex_unlock(&mutex_sp);
+	thread_stats_inc(ST_SA_READS_NO_MAP);
       
 	fprintf(out_file, "%s\t4\t*\t0\t0\t*\t*\t0\t0\t%s\t%s\n", 
 		read->id,
@@ -987,9 +984,14 @@ typedef struct sa_sw_depth {
   int depth;
   char *q[MAX_DEPTH];
   char *r[MAX_DEPTH];
+  int q_len[MAX_DEPTH];
+  int r_len[MAX_DEPTH];
   //seed_region_t *seed_ref[MAX_DEPTH];
   void *item_ref[MAX_DEPTH];
   int type[MAX_DEPTH];
+  //Per-thread storage for the queued sequences, reused on every flush
+  size_t arena_used;
+  char arena[SW_ARENA_SIZE];
 } sa_sw_depth_t;
 
 void sw_process(sa_sw_depth_t *sw_depth, sw_optarg_t *sw_optarg, sw_multi_output_t *output) {
@@ -998,57 +1000,58 @@ void sw_process(sa_sw_depth_t *sw_depth, sw_optarg_t *sw_optarg, sw_multi_output
 
   float match = sw_optarg->subst_matrix['A']['A'];
   int distance;
+  int depth = sw_depth->depth;
+  int order[MAX_DEPTH];
+  char *q[MAX_DEPTH], *r[MAX_DEPTH];
+
+  //Bucket the jobs by length so each SIMD group aligns sequences of
+  //similar size and no lane waits for a much longer neighbour
+  for (int i = 0; i < depth; i++) {
+    int j = i;
+    while (j > 0 && sw_depth->q_len[order[j - 1]] > sw_depth->q_len[i]) {
+      order[j] = order[j - 1];
+      j--;
+    }
+    order[j] = i;
+  }
 
-  /*
-  printf("depth: %i\n", sw_depth->depth);
-  for (int i = 0; i < sw_depth->depth; i++) {
-    printf("REF: (%i)%s\n", strlen(sw_depth->r[i]), sw_depth->r[i]);
-    printf("SEQ: (%i)%s\n", strlen(sw_depth->q[i]), sw_depth->q[i]);
+  for (int k = 0; k < depth; k++) {
+    q[k] = sw_depth->q[order[k]];
+    r[k] = sw_depth->r[order[k]];
   }
-  */
 
-  smith_waterman_mqmr(sw_depth->q, sw_depth->r, sw_depth->depth, sw_optarg, 1, output);
+  smith_waterman_mqmr(q, r, depth, sw_optarg, 1, output);
 
-  for (int i = 0; i < sw_depth->depth; i++) {
+  // packed on the stack, only the CIGARs kept become cigar_code_t
+  cigar_packed_t cigar_packed;
+  cigar_packed_init(&cigar_packed);
+
+  for (int k = 0; k < depth; k++) {
+    int i = order[k];
     if (sw_depth->type[i] != SJ_SW) {
-      cigar_code_t *cigar_code = generate_cigar_code(output->query_map_p[i],
-						     output->ref_map_p[i],
-						     strlen(output->ref_map_p[i]),
-						     output->query_start_p[i], output->ref_start_p[i],
-						     strlen(sw_depth->q[i]), strlen(sw_depth->r[i]),
-						     &distance, sw_depth->type[i]);
+      generate_cigar_packed(output->query_map_p[k],
+			    output->ref_map_p[k],
+			    strlen(output->ref_map_p[k]),
+			    output->query_start_p[k], output->ref_start_p[k],
+			    sw_depth->q_len[i], sw_depth->r_len[i],
+			    &distance, sw_depth->type[i], &cigar_packed);
     
-      //printf("==========================SW============================\n");
-      //printf("REF: %s\n", output->ref_map_p[i]);
-      //printf("SEQ: %s\n", output->query_map_p[i]);
-      //printf("======================================================\n");
-
-      //printf("/////////// cigar : %s\n", new_cigar_code_string(cigar_code));
       if (sw_depth->type[i] == FIRST_SW || sw_depth->type[i] == LAST_SW) {
-	float norm_score = NORM_SCORE(output->score_p[i], strlen(sw_depth->q[i]), match);
-	//printf("norm_score = %f\n", norm_score);
+	float norm_score = NORM_SCORE(output->score_p[k], sw_depth->q_len[i], match);
 	if (norm_score > 0.4) {
-	  ((seed_region_t *)sw_depth->item_ref[i])->info = cigar_code;
-	} else {
-	  array_list_clear(cigar_code->ops, (void *)cigar_op_free);
-	  cigar_code_free(cigar_code);
+	  ((seed_region_t *)sw_depth->item_ref[i])->info = cigar_packed_to_cigar_code(&cigar_packed);
 	}
       } else {
-	((seed_region_t *)sw_depth->item_ref[i])->info = cigar_code;
+	((seed_region_t *)sw_depth->item_ref[i])->info = cigar_packed_to_cigar_code(&cigar_packed);
       }
 
-      free(sw_depth->q[i]);
-      free(sw_depth->r[i]);
-    
-      free(output->query_map_p[i]);
-      free(output->ref_map_p[i]);
-      output->query_map_p[i] = NULL;
-      output->ref_map_p[i] = NULL;
-    } else {
-      //printf("REF: %s\n", output->ref_map_p[i]);
-      //printf("SEQ: %s\n", output->query_map_p[i]);      
-    }    
+      free(output->query_map_p[k]);
+      free(output->ref_map_p[k]);
+      output->query_map_p[k] = NULL;
+      output->ref_map_p[k] = NULL;
+    }
   }
+  cigar_packed_clean(&cigar_packed);
   
 }
 
@@ -1056,15 +1059,36 @@ void sw_insert_item(char *q, char *r, int type, void *item,
 		    sw_optarg_t *sw_optarg, sw_multi_output_t *output,
 		    sa_sw_depth_t *sw_depth) {
 
+  if (sw_depth->depth == 0) {
+    sw_depth->arena_used = 0;
+  }
+
   if (q != NULL && r != NULL) {
-    sw_depth->q[sw_depth->depth] = strdup(q);
-    sw_depth->r[sw_depth->depth] = strdup(r);
+    int q_len = strlen(q);
+    int r_len = strlen(r);
+    
+    if (sw_depth->arena_used + q_len + r_len + 2 > SW_ARENA_SIZE) {
+      sw_process(sw_depth, sw_optarg, output);
+      sw_depth->depth = 0;
+      sw_depth->arena_used = 0;
+    }
+    assert(q_len + r_len + 2 <= SW_ARENA_SIZE);
+
+    char *arena = &sw_depth->arena[sw_depth->arena_used];
+    memcpy(arena, q, q_len + 1);
+    memcpy(arena + q_len + 1, r, r_len + 1);
+    sw_depth->arena_used += q_len + r_len + 2;
+
+    sw_depth->q[sw_depth->depth] = arena;
+    sw_depth->r[sw_depth->depth] = arena + q_len + 1;
+    sw_depth->q_len[sw_depth->depth] = q_len;
+    sw_depth->r_len[sw_depth->depth] = r_len;
     sw_depth->type[sw_depth->depth] = type;
 
     sw_depth->item_ref[sw_depth->depth++] = item;
   }
 
-  if (sw_depth->depth == 4 || 
+  if (sw_depth->depth == MAX_DEPTH || 
       (q == NULL && r == NULL)) {
     sw_process(sw_depth, sw_optarg, output);
     sw_depth->depth = 0;
@@ -1161,7 +1185,7 @@ void cal_fill_gaps(cal_t *cal,
 	  max_size = genome_end - genome_start + 1024;
 	  reference = (char *)calloc(max_size, sizeof(char));
 	}
-	genome_read_sequence_by_chr_index(reference, 0, cal->chromosome_id - 1,
+	reference_read_sequence(reference, 0, cal->chromosome_id - 1,
 					  &genome_start, &genome_end, genome);
 	
 	//printf("[%lu|%i]-GAP-[%i|%lu]\n", genome_start, read_start, read_end, genome_end);
@@ -1275,7 +1299,7 @@ void cal_fill_gaps(cal_t *cal,
 	    break;
 	  }
 
-	  genome_read_sequence_by_chr_index(reference, 0, cal->chromosome_id - 1,
+	  reference_read_sequence(reference, 0, cal->chromosome_id - 1,
 					    &genome_start, &genome_end, genome);
 	  
 	  memcpy(query, &query_map[read_start],  read_end - read_start + 1);
@@ -1445,7 +1469,7 @@ void cal_fill_gaps_2(cal_t *cal,
 	    reference = (char *)calloc(max_size, sizeof(char));
 	  }
 	  
-	  genome_read_sequence_by_chr_index(reference, 0, cal->chromosome_id - 1,
+	  reference_read_sequence(reference, 0, cal->chromosome_id - 1,
 					    &genome_start, &genome_end, genome);
 	  
 	  //printf("[%lu|%i]-GAP-[%i|%lu]\n", genome_start, read_start, read_end, genome_end);
@@ -1504,7 +1528,7 @@ void cal_fill_gaps_2(cal_t *cal,
 	    break;
 	  }
 	  
-	  genome_read_sequence_by_chr_index(reference, 0, cal->chromosome_id - 1,
+	  reference_read_sequence(reference, 0, cal->chromosome_id - 1,
 					    &genome_start, &genome_end, genome);
 	  
 	  memcpy(query, &query_map[read_start],  read_end - read_start + 1);
@@ -1565,8 +1589,6 @@ void convert_batch_to_str(sa_wf_batch_t *wf_batch) {
   sa_genome3_t *genome = wf_batch->sa_index->genome;
   
   //extern size_t total_reads, unmapped_reads, correct_reads;
-  extern size_t total_reads;
-  extern size_t reads_no_map;
   extern pthread_mutex_t mutex_sp;
 
 
@@ -1610,6 +1632,7 @@ void convert_batch_to_str(sa_wf_batch_t *wf_batch) {
 	
 	mapping_list = sa_batch->mapping_lists[i];
 	num_mappings = array_list_size(mapping_list);
+	thread_stats_add_mappings(num_mappings);
 
 
 	int mqual = 0;
@@ -1706,6 +1729,7 @@ void convert_batch_to_str(sa_wf_batch_t *wf_batch) {
 	read = (fastq_read_t *) array_list_get(i, read_list);
 	mapping_list = sa_batch->mapping_lists[i];
 	num_mappings = array_list_size(mapping_list);
+	thread_stats_add_mappings(num_mappings);
 	
 	int mqual = 0;
 	if (num_mappings == 1) { 
@@ -1831,10 +1855,13 @@ int write_to_file(void *data) {
 
 
   int bam_format = wf_batch->writer_input->bam_format;
+  uint64_t prof_time;
 
   if (!bam_format) {
     FILE *out_file = (FILE *) wf_batch->writer_input->bam_file;
+    prof_time = profiler_start(PROF_WRITER);
     fwrite((char *)wf_batch->data_output, sizeof(char), wf_batch->data_output_size, out_file);    
+    profiler_stop(PROF_WRITER, prof_time);
     free(wf_batch->data_output);
   } else {
     bam_file_t *out_file = (bam_file_t *) wf_batch->writer_input->bam_file;
@@ -1848,9 +1875,9 @@ int write_to_file(void *data) {
       num_mappings = array_list_size(mapping_list);    
       for (size_t j = 0; j < num_mappings; j++) {
 	bam1 = array_list_get(j, mapping_list);
-	//start_timer(time_free_s);
+	prof_time = profiler_start(PROF_COMPRESSION);
 	bam_fwrite(bam1, out_file);
-	//stop_timer(time_free_s, time_free_e, time_write);
+	profiler_stop(PROF_COMPRESSION, prof_time);
 	//start_timer(time_free_s);
 	bam_destroy1(bam1);
 	//stop_timer(time_free_s, time_free_e, time_free);
@@ -2108,6 +2135,9 @@ int sa_generate_cals(fastq_read_t *read,
 
   //===== Seeding Strategy =====//
 
+  // prefix values of every offset, the seeds jump by suffix lengths
+  size_t *prefix_values = (size_t *) malloc((read->length + 1) * sizeof(size_t));
+
   for (int s = 0; s < 2; s++) { //Strand
     read_pos  = 0;
     if (!s) {
@@ -2117,11 +2147,12 @@ int sa_generate_cals(fastq_read_t *read,
       query = read->revcomp;
       cal_mng = cal_mng_n;
     }
+    compute_prefix_values(query, read->length, sa_index->k_value, prefix_values);
     
     while (read_pos + sa_index->k_value < read->length) {
-      num_suffixes = search_suffix(&query[read_pos], sa_index->k_value, 
-				   MAX_NUM_SUFFIXES, sa_index, 
-				   &low, &high, &suffix_len);
+      num_suffixes = search_suffix_value(&query[read_pos], prefix_values[read_pos], 
+					 MAX_NUM_SUFFIXES, sa_index, 
+					 &low, &high, &suffix_len);
       
 	
       if (suffix_len && num_suffixes) {
@@ -2158,11 +2189,11 @@ int sa_generate_cals(fastq_read_t *read,
     } //loop seeds	
     
 
-    if (read->length - 1 != read_pos) {
+    if (read->length - 1 != read_pos && read->length > sa_index->k_value) {
       read_pos = read->length - sa_index->k_value - 1;
-      num_suffixes = search_suffix(&query[read_pos], sa_index->k_value, 
-				   MAX_NUM_SUFFIXES, sa_index, 
-				   &low, &high, &suffix_len);	      
+      num_suffixes = search_suffix_value(&query[read_pos], prefix_values[read_pos], 
+					 MAX_NUM_SUFFIXES, sa_index, 
+					 &low, &high, &suffix_len);	      
 	
       if (suffix_len && num_suffixes) {
 	//Storage Mappings
@@ -2177,6 +2208,7 @@ int sa_generate_cals(fastq_read_t *read,
       }
     }
   } //loop strands 
+  free(prefix_values);
   
     //Merge CALs and select new targets
   for (int st = 0; st < 2; st++) {
@@ -2784,6 +2816,8 @@ void cal_rna_mng_free(cal_mng_t *p) {
 //--------------------------------------------------------------------
 
 int sa_rna_mapper(void *data) {
+  uint64_t prof_time = profiler_start(PROF_MAPPING);
+
   sa_wf_batch_t *wf_batch = (sa_wf_batch_t *) data;
   sa_batch_t *sa_batch = wf_batch->mapping_batch;
   sa_index3_t *sa_index = (sa_index3_t *) wf_batch->sa_index;
@@ -3344,7 +3378,6 @@ int sa_rna_mapper(void *data) {
   array_list_t *alignments_list_aux;
   int n_reads = 0;
   extern pthread_mutex_t mutex_sp;
-  extern size_t total_reads_ph2;
 
   //printf("NUM READS %i:\n", num_reads);
   if (pair_mode == SINGLE_END_MODE) {
@@ -3355,8 +3388,8 @@ int sa_rna_mapper(void *data) {
 	//Write to buffer
 	pthread_mutex_lock(&mutex_sp);
 	sa_file_write_items(SA_PARTIAL_TYPE, read, alignments_list_aux, file1);
-	total_reads_ph2++;
 	pthread_mutex_unlock(&mutex_sp);
+	thread_stats_inc(ST_SA_READS_PH2);
       
 	fastq_read_free(read);
 	array_list_free(alignments_list_aux, (void *)sa_alignment_partial_free);
@@ -3403,9 +3436,7 @@ int sa_rna_mapper(void *data) {
 	  pthread_mutex_unlock(&mutex_sp);
 	  fastq_read_free(read);
 	
-	  pthread_mutex_lock(&mutex_sp);
-	  total_reads_ph2 += 2;
-	  pthread_mutex_unlock(&mutex_sp);	  
+	  thread_stats_add(ST_SA_READS_PH2, 2);
   
 	  array_list_free(sa_batch->mapping_lists[r + 1], (void *)function_callback);
 	  
@@ -3504,7 +3535,11 @@ int sa_rna_mapper(void *data) {
   } 
   
   
+  profiler_stop(PROF_MAPPING, prof_time);
+
+  prof_time = profiler_start(PROF_FORMATTING);
   convert_batch_to_str(wf_batch);
+  profiler_stop(PROF_FORMATTING, prof_time);
   
   return -1;
   
@@ -3512,6 +3547,8 @@ int sa_rna_mapper(void *data) {
 
 
 int sa_rna_mapper_last(void *data) {
+  uint64_t prof_time = profiler_start(PROF_MAPPING);
+
   array_list_t *sa_list;
   sa_wf_batch_t *wf_batch = (sa_wf_batch_t *) data;
   sa_batch_t *sa_batch = wf_batch->mapping_batch;
@@ -3543,7 +3580,6 @@ int sa_rna_mapper_last(void *data) {
   sw_multi_output_t *output = sw_multi_output_new(MAX_DEPTH);
   sa_sw_depth_t sw_depth;
   extern pthread_mutex_t mutex_sp;
-  extern size_t total_sw;
 
   float cals_score[2048];
   array_list_t *target_cals = array_list_new(100, 1.25f,
@@ -3623,15 +3659,13 @@ int sa_rna_mapper_last(void *data) {
 	seed_region_l->info = c_left;
 
 	if (!c_left && region->read_start <= 30) {
-	  pthread_mutex_lock(&mutex_sp);
-	  total_sw++;
-	  pthread_mutex_unlock(&mutex_sp);
+	  thread_stats_inc(ST_SA_SW);
 
 	  char reference_sw[2048];
 	  size_t genome_start = region->genome_start - region->read_start;
 	  size_t genome_end   = region->genome_start - 1;
 	  
-	  genome_read_sequence_by_chr_index(reference_sw, 0, cal->chromosome_id - 1,
+	  reference_read_sequence(reference_sw, 0, cal->chromosome_id - 1,
 					    &genome_start, &genome_end, genome);
 	  
 	  char query_sw[2048];
@@ -3676,15 +3710,13 @@ int sa_rna_mapper_last(void *data) {
 	linked_list_insert_last(seed_region_r, cal->sr_list);
 
 	if (!c_right && gap_len <= 30) {
-	  pthread_mutex_lock(&mutex_sp);
-	  total_sw++;
-	  pthread_mutex_unlock(&mutex_sp);
+	  thread_stats_inc(ST_SA_SW);
 
 	  char reference_sw[2048];
 	  size_t genome_start = region->genome_end + 1;
 	  size_t genome_end   = genome_start + gap_len;
 	  
-	  genome_read_sequence_by_chr_index(reference_sw, 0, cal->chromosome_id - 1,
+	  reference_read_sequence(reference_sw, 0, cal->chromosome_id - 1,
 	  				    &genome_start, &genome_end, genome);
 	  
 	  char query_sw[2048];
@@ -4108,7 +4140,7 @@ int sa_rna_mapper_last(void *data) {
       int seed_inc  = seed_size / 2;
       int read_pos;
       size_t num_suffixes, low, high, suffix_len, id_seed = 0;
-
+      size_t *prefix_values = (size_t *) malloc((read->length + 1) * sizeof(size_t));
 
       
       for (int s = 0; s < 2; s++) { //Strand
@@ -4120,11 +4152,12 @@ int sa_rna_mapper_last(void *data) {
 	  query = seq_revcomp;
 	  cal_mng = cal_mng_n;
 	}
+	compute_prefix_values(query, read->length, sa_index->k_value, prefix_values);
 	
 	while (read_pos + sa_index->k_value < read->length) {
-	  num_suffixes = search_suffix(&query[read_pos], sa_index->k_value, 
-				       MAX_NUM_SUFFIXES, sa_index, 
-				       &low, &high, &suffix_len);
+	  num_suffixes = search_suffix_value(&query[read_pos], prefix_values[read_pos], 
+					     MAX_NUM_SUFFIXES, sa_index, 
+					     &low, &high, &suffix_len);
 	  
 	  //printf("(%c)============= Seed (%i + %i), %i ===========\n", s == 0 ? '+' : '-', read_pos, read_pos + sa_index->k_value, suffix_len);
 	  
@@ -4161,11 +4194,11 @@ int sa_rna_mapper_last(void *data) {
 	} //loop seeds	
 
 	
-	if (read->length - 1 != read_pos) {
+	if (read->length - 1 != read_pos && read->length > sa_index->k_value) {
 	  read_pos = read->length - sa_index->k_value - 1;
-	  num_suffixes = search_suffix(&query[read_pos], sa_index->k_value, 
-				       MAX_NUM_SUFFIXES, sa_index, 
-				       &low, &high, &suffix_len);	      
+	  num_suffixes = search_suffix_value(&query[read_pos], prefix_values[read_pos], 
+					     MAX_NUM_SUFFIXES, sa_index, 
+					     &low, &high, &suffix_len);	      
 
 	  //printf("L.(%c)============= Seed (%i + %i), %i ===========\n", s == 0 ? '+' : '-', read_pos, read_pos + sa_index->k_value, suffix_len);
 
@@ -4184,6 +4217,7 @@ int sa_rna_mapper_last(void *data) {
 	  }
 	}
       } //loop strands      
+      free(prefix_values);
 
       //printf("==================== CALs result Seeding =====================\n");
       //printf("==(+)==\n");
@@ -4434,15 +4468,13 @@ int sa_rna_mapper_last(void *data) {
 	  //seed_region_l->info = c_left;
 	  
 	  //c_left = NULL;
-	  pthread_mutex_lock(&mutex_sp);
-	  total_sw++;
-	  pthread_mutex_unlock(&mutex_sp);
+	  thread_stats_inc(ST_SA_SW);
 	    
 	  char reference_sw[2048];
 	  size_t genome_start = region->genome_start - region->read_start;
 	  size_t genome_end   = region->genome_start - 1;
 	    
-	  genome_read_sequence_by_chr_index(reference_sw, 0, cal_prev->chromosome_id - 1,
+	  reference_read_sequence(reference_sw, 0, cal_prev->chromosome_id - 1,
 					    &genome_start, &genome_end, genome);
 	    
 	  char query_sw[2048];
@@ -4492,15 +4524,13 @@ int sa_rna_mapper_last(void *data) {
 	  linked_list_insert_last(seed_region_r, cal->sr_list);
 	  
 
-	  pthread_mutex_lock(&mutex_sp);
-	  total_sw++;
-	  pthread_mutex_unlock(&mutex_sp);
+	  thread_stats_inc(ST_SA_SW);
 	    
 	  char reference_sw[2048];
 	  size_t genome_start = region->genome_end + 1;
 	  size_t genome_end   = genome_start + gap_len;
 	    
-	  genome_read_sequence_by_chr_index(reference_sw, 0, cal->chromosome_id - 1,
+	  reference_read_sequence(reference_sw, 0, cal->chromosome_id - 1,
 					    &genome_start, &genome_end, genome);
 	    
 	  char query_sw[2048];
@@ -4806,7 +4836,11 @@ int sa_rna_mapper_last(void *data) {
     }
   }
 
+  profiler_stop(PROF_MAPPING, prof_time);
+
+  prof_time = profiler_start(PROF_FORMATTING);
   convert_batch_to_str(wf_batch);
+  profiler_stop(PROF_FORMATTING, prof_time);
   
   return -1;
 
@@ -4878,7 +4912,7 @@ cigar_code_t* search_splice_junction(sw_optarg_t *sw_optarg,
   genome_end   = s_prev->genome_end + gap_read + FLANK;
   assert(genome_end - genome_start < 2048);
   
-  genome_read_sequence_by_chr_index(left_exon, 0, 
+  reference_read_sequence(left_exon, 0, 
 				    chromosome_id - 1, 
 				    &genome_start, &genome_end, genome);
 
@@ -4887,7 +4921,7 @@ cigar_code_t* search_splice_junction(sw_optarg_t *sw_optarg,
   genome_end   = s_next->genome_start - 1;
   assert(genome_end - genome_start < 2048);
 
-  genome_read_sequence_by_chr_index(right_exon, 0, 
+  reference_read_sequence(right_exon, 0, 
 				    chromosome_id - 1, 
 				    &genome_start, &genome_end, genome);		  
   
@@ -5006,6 +5040,9 @@ cigar_code_t* search_splice_junction(sw_optarg_t *sw_optarg,
 
   }
 
+  //Not queued in sa_sw_depth_t: both callers need the junction CIGAR at
+  //once, to split the seed list or to fall back to the gap fill, and the
+  //candidates of one junction already go as a single multi-query batch
   sw_multi_output_t *output = sw_multi_output_new(n_sw);
   smith_waterman_mqmr(query_p, ref_p, n_sw,
 		      sw_optarg, 1,
@@ -4,17 +4,24 @@
 
 size_t search_prefix(char *sequence, size_t *low, size_t *high, 
 		     sa_index3_t *sa_index, int display) {
+  //  printf("prefix: %s\n", sequence);
+  //  display_prefix(sequence, sa_index->k_value);
+  return search_prefix_value(compute_prefix_value(sequence, sa_index->k_value),
+			     low, high, sa_index);
+}
+
+//--------------------------------------------------------------------
+
+size_t search_prefix_value(size_t value, size_t *low, size_t *high, 
+			   sa_index3_t *sa_index) {
   size_t num_mappings = 0;
 
 
-  size_t value, row, col;
+  size_t row, col;
   uint ia, ia1, ia2;
   uint  found_ja;
   uint a1, a2;
 
-  //  printf("prefix: %s\n", sequence);
-  //  display_prefix(sequence, sa_index->k_value);
-  value = compute_prefix_value(sequence, sa_index->k_value);
   row = value >> 8;
   col = 255LLU & value;
   //  printf(" -> prefix value = %lu -> (row, col) = (%lu, %lu)\n", value, row, col); 
@@ -74,31 +81,78 @@ size_t search_prefix(char *sequence, size_t *low, size_t *high,
 
 //--------------------------------------------------------------------
 
+void search_prefixes(int num_seeds, size_t *values, size_t *lows, size_t *highs, 
+		     size_t *nums_prefixes, sa_index3_t *sa_index) {
+  uint ia;
+  int i, j;
+
+  // IA rows of all the seeds first, then their A and JA columns, so
+  // that the cache misses of the seeds overlap
+  for (i = 0; i < num_seeds; i++) {
+    __builtin_prefetch(&sa_index->IA[values[i] >> 8]);
+  }
+  for (i = 0; i < num_seeds; i++) {
+    if ((ia = sa_index->IA[values[i] >> 8]) != max_uint) {
+      __builtin_prefetch(&sa_index->JA[ia]);
+      __builtin_prefetch(&sa_index->A[ia]);
+    }
+  }
+
+  for (i = 0; i < num_seeds; i++) {
+    // repeated prefixes (low-complexity reads) are looked up once
+    for (j = 0; j < i && values[j] != values[i]; j++);
+    if (j < i) {
+      nums_prefixes[i] = nums_prefixes[j];
+      lows[i] = lows[j];
+      highs[i] = highs[j];
+    } else {
+      nums_prefixes[i] = search_prefix_value(values[i], &lows[i], &highs[i], sa_index);
+    }
+  }
+}
+
+//--------------------------------------------------------------------
+
 size_t search_suffix(char *seq, uint len, int max_num_suffixes,
 		     sa_index3_t *sa_index, 
-		     size_t *low, size_t *high, size_t *suffix_len
-                     #ifdef _TIMING
-		     , double *prefix_time, double *suffix_time
-                     #endif
-		     ) {
-  #ifdef _TIMING
-  struct timeval stop, start;
-  #endif
+		     size_t *low, size_t *high, size_t *suffix_len) {
+  uint64_t prof_time;
+
+  prof_time = profiler_start(PROF_SEARCH_PREFIX);
+  size_t num_prefixes = search_prefix_value(compute_prefix_value(seq, sa_index->k_value),
+					    low, high, sa_index);
+  profiler_stop(PROF_SEARCH_PREFIX, prof_time);
+
+  return search_suffix_from_prefix(seq, num_prefixes, max_num_suffixes, sa_index,
+				   low, high, suffix_len);
+}
+
+//--------------------------------------------------------------------
+
+size_t search_suffix_value(char *seq, size_t value, int max_num_suffixes,
+			   sa_index3_t *sa_index, 
+			   size_t *low, size_t *high, size_t *suffix_len) {
+  uint64_t prof_time;
+
+  prof_time = profiler_start(PROF_SEARCH_PREFIX);
+  size_t num_prefixes = search_prefix_value(value, low, high, sa_index);
+  profiler_stop(PROF_SEARCH_PREFIX, prof_time);
+
+  return search_suffix_from_prefix(seq, num_prefixes, max_num_suffixes, sa_index,
+				   low, high, suffix_len);
+}
+
+//--------------------------------------------------------------------
+
+size_t search_suffix_from_prefix(char *seq, size_t num_prefixes, int max_num_suffixes,
+				 sa_index3_t *sa_index, 
+				 size_t *low, size_t *high, size_t *suffix_len) {
+  uint64_t prof_time;
 
-  int display = 1;
   char *ref, *query;
   size_t num_suffixes = 0;
   uint matched, max_matched = 0;
 
-  #ifdef _TIMING
-  gettimeofday(&start, NULL);
-  #endif
-  size_t num_prefixes = search_prefix(seq, low, high, sa_index, display);
-  #ifdef _TIMING
-  gettimeofday(&stop, NULL);
-  *prefix_time = ((stop.tv_sec - start.tv_sec) + (stop.tv_usec - start.tv_usec) / 1000000.0f);  
-  #endif
-
   #ifdef _VERBOSE	  
   printf("\t\tnum. prefixes = %lu\n", num_prefixes);
   #endif
@@ -111,9 +165,7 @@ size_t search_suffix(char *seq, uint len, int max_num_suffixes,
     //    *suffix_len = sa_index->k_value;
     //    return num_prefixes;
     
-    #ifdef _TIMING
-    gettimeofday(&start, NULL);
-    #endif
+    prof_time = profiler_start(PROF_SEARCH_SA);
 
 
     #ifdef _VERBOSE1	  
@@ -173,10 +225,7 @@ size_t search_suffix(char *seq, uint len, int max_num_suffixes,
       }
     }
 
-    #ifdef _TIMING
-    gettimeofday(&stop, NULL);
-    *suffix_time = ((stop.tv_sec - start.tv_sec) + (stop.tv_usec - start.tv_usec) / 1000000.0f);  
-    #endif
+    profiler_stop(PROF_SEARCH_SA, prof_time);
   }
 
   //  printf("\t\tnum_prefixes = %i, (num_suffixes = %i, length = %i)\n",
@@ -4,18 +4,39 @@
 #include "sa/sa_tools.h"
 #include "sa/sa_index3.h"
 
+#include "aux/aux_profiler.h"
+
 //--------------------------------------------------------------------
 
 size_t search_prefix(char *sequence, size_t *low, size_t *high, 
 		     sa_index3_t *sa_index, int display);
 
+// prefix search from the prefix value (compute_prefix_value, or
+// compute_prefix_values for all the offsets of a read)
+size_t search_prefix_value(size_t value, size_t *low, size_t *high, 
+			   sa_index3_t *sa_index);
+
+// prefix ranges of the seeds of a read at once (num_prefixes, low and
+// high for every value)
+void search_prefixes(int num_seeds, size_t *values, size_t *lows, size_t *highs, 
+		     size_t *nums_prefixes, sa_index3_t *sa_index);
+
+//--------------------------------------------------------------------
+
 size_t search_suffix(char *seq, uint len, int max_num_suffixes,
 		     sa_index3_t *sa_index, 
-		     size_t *low, size_t *high, size_t *suffix_len
-                     #ifdef _TIMING
-		     , double *prefix_time, double *suffix_time
-                     #endif
-		     );
+		     size_t *low, size_t *high, size_t *suffix_len);
+
+// search_suffix with the prefix value of seq already computed
+size_t search_suffix_value(char *seq, size_t value, int max_num_suffixes,
+			   sa_index3_t *sa_index, 
+			   size_t *low, size_t *high, size_t *suffix_len);
+
+// longest suffix from the prefix range of seq (low, high), as found
+// by search_prefix
+size_t search_suffix_from_prefix(char *seq, size_t num_prefixes, int max_num_suffixes,
+				 sa_index3_t *sa_index, 
+				 size_t *low, size_t *high, size_t *suffix_len);
 
 //--------------------------------------------------------------------
 //--------------------------------------------------------------------
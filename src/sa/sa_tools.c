@@ -1,5 +1,7 @@
 #include "sa_tools.h"
 
+#include "aux/aux_nt_simd.h"
+
 //--------------------------------------------------------------------------------------
 
 #define PROGRESS 100000000
@@ -132,6 +134,32 @@ inline size_t compute_prefix_value(char *prefix, int len) {
   return value;
 }
 
+//--------------------------------------------------------------------------------------
+
+size_t compute_prefix_values(char *seq, size_t len, int k, size_t *values) {
+  // same codes as PREFIX_TABLE_NT_VALUE
+  return simd_nt_kmers(seq, len, k, values);
+}
+
+//--------------------------------------------------------------------------------------
+
+#define MAX_ROLLING_LENGTH  4096
+
+void compute_seed_prefix_values(char *seq, size_t len, int k, 
+				int num_seeds, int *seed_pos, size_t *values) {
+  if ((size_t) num_seeds * k >= len && len <= MAX_ROLLING_LENGTH) {
+    size_t prefix_values[len + 1];
+    compute_prefix_values(seq, len, k, prefix_values);
+    for (int i = 0; i < num_seeds; i++) {
+      values[i] = prefix_values[seed_pos[i]];
+    }
+  } else {
+    for (int i = 0; i < num_seeds; i++) {
+      values[i] = compute_prefix_value(seq + seed_pos[i], k);
+    }
+  }
+}
+
 //--------------------------------------------------------------------------------------
 //--------------------------------------------------------------------------------------
 
@@ -24,6 +24,17 @@ void compute_child(uint *lcp, int *child, uint num_sufixes);
 
 size_t compute_prefix_value(char *prefix, int len);
 
+// prefix values of the k-mers at every offset of a sequence, rolling
+// the 2-bit codes (values[i] = compute_prefix_value(seq + i, k)); it
+// returns the number of values, len - k + 1
+size_t compute_prefix_values(char *seq, size_t len, int k, size_t *values);
+
+// prefix values of the seeds of a sequence (seed_pos offsets, all of
+// them <= len - k): rolled over the sequence when the seeds cover it,
+// one by one when they are sparse
+void compute_seed_prefix_values(char *seq, size_t len, int k, 
+				int num_seeds, int *seed_pos, size_t *values);
+
 //--------------------------------------------------------------------------------------
 //--------------------------------------------------------------------------------------
 
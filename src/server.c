@@ -0,0 +1,421 @@
+#include "server.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <omp.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "commons/log.h"
+
+extern int redirect_stdout;
+
+static volatile sig_atomic_t server_stop = 0;
+
+//------------------------------------------------------------------------
+
+static void server_signal_handler(int sig) {
+  server_stop = 1;
+}
+
+//------------------------------------------------------------------------
+// command line
+//------------------------------------------------------------------------
+
+static void **argtable_server_options_new() {
+  void **argtable = (void **) malloc((NUM_SERVER_OPTIONS + 1) * sizeof(void *));
+
+  int count = 0;
+  argtable[count++] = arg_file1("i", "index", NULL, "SA index directory name");
+  argtable[count++] = arg_file1("s", "socket", NULL, "Unix socket the jobs are submitted to");
+  argtable[count++] = arg_int0("t", "cpu-threads", NULL, "Number of CPU threads, shared by the running jobs");
+  argtable[count++] = arg_int0(NULL, "max-jobs", NULL, "Number of jobs run at once. Default: 1");
+  argtable[count++] = arg_lit0("h", "help", "Help option");
+
+  argtable[NUM_SERVER_OPTIONS] = arg_end(count);
+
+  return argtable;
+}
+
+//------------------------------------------------------------------------
+
+static void server_usage(void **argtable) {
+  printf("\nUsage:\n\t%s server <options>\n", HPG_ALIGNER_BIN);
+  printf("\t%s submit -s <socket> dna <dna options>\n", HPG_ALIGNER_BIN);
+  printf("\nOptions:\n");
+  arg_print_glossary(stdout, argtable, "\t%-50s\t%s\n");
+}
+
+//------------------------------------------------------------------------
+
+static void parse_server_options(int argc, char **argv, server_t *server) {
+  void **argtable = argtable_server_options_new();
+
+  int num_errors = arg_parse(argc, argv, argtable);
+  if (argc < 2 || num_errors > 0 || ((struct arg_lit *) argtable[4])->count) {
+    if (num_errors > 0 && argc >= 2) {
+      fprintf(stdout, "\nError:\n");
+      arg_print_errors(stdout, argtable[NUM_SERVER_OPTIONS], "\t");
+    }
+    server_usage(argtable);
+    arg_freetable(argtable, NUM_SERVER_OPTIONS + 1);
+    free(argtable);
+    exit(num_errors > 0 || argc < 2 ? EXIT_FAILURE : EXIT_SUCCESS);
+  }
+
+  // absolute, the jobs run in their own working directories
+  int count = -1;
+  char path[PATH_MAX];
+  const char *index_dirname = *(((struct arg_file *) argtable[++count])->filename);
+  if (!realpath(index_dirname, path)) {
+    LOG_FATAL_F("Index directory %s not found\n", index_dirname);
+  }
+  server->index_dirname = strdup(path);
+  server->socket_path = strdup(*(((struct arg_file *) argtable[++count])->filename));
+  if (((struct arg_int *) argtable[++count])->count) {
+    server->num_threads = *(((struct arg_int *) argtable[count])->ival);
+  }
+  if (((struct arg_int *) argtable[++count])->count) {
+    server->max_jobs = *(((struct arg_int *) argtable[count])->ival);
+  }
+
+  arg_freetable(argtable, NUM_SERVER_OPTIONS + 1);
+  free(argtable);
+
+  if (server->num_threads <= 0) {
+    server->num_threads = get_optimal_cpu_num_threads();
+  }
+  if (server->max_jobs <= 0) {
+    server->max_jobs = 1;
+  } else if (server->max_jobs > SERVER_MAX_JOBS) {
+    server->max_jobs = SERVER_MAX_JOBS;
+  }
+}
+
+//------------------------------------------------------------------------
+// job, run in the forked process
+//------------------------------------------------------------------------
+
+static void server_job(int conn, server_t *server) {
+  // request: argument count, working directory and the arguments, all
+  // NUL terminated; the count lets empty arguments through
+  char *request = (char *) malloc(SERVER_MAX_REQUEST);
+  size_t len = 0, num_strings = 0;
+  int argc = -1;
+  ssize_t n;
+  while (len < SERVER_MAX_REQUEST &&
+	 (n = read(conn, request + len, SERVER_MAX_REQUEST - len)) > 0) {
+    for (size_t i = len; i < len + n; i++) {
+      if (request[i]) continue;
+      if (++num_strings == 1) argc = atoi(request);
+    }
+    len += n;
+    if (argc >= 0 && num_strings >= argc + 2) break;
+  }
+
+  // the job output goes to the client
+  dup2(conn, STDOUT_FILENO);
+  dup2(conn, STDERR_FILENO);
+  close(conn);
+  setvbuf(stdout, NULL, _IOLBF, 0);
+  redirect_stdout = 1;
+
+  if (argc < 0 || argc > SERVER_MAX_ARGS || num_strings != argc + 2 || request[len - 1]) {
+    printf("Error: invalid job request\n");
+    exit(EXIT_FAILURE);
+  }
+
+  char *cwd = request + strlen(request) + 1;
+  char *argv[SERVER_MAX_ARGS];
+  char *p = cwd + strlen(cwd) + 1;
+  for (int i = 0; i < argc; i++, p += strlen(p) + 1) {
+    argv[i] = p;
+  }
+
+  if (chdir(cwd) < 0) {
+    printf("Error: could not change to the working directory %s: %s\n", cwd, strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
+  if (argc < 1 || strcmp(argv[0], "dna")) {
+    printf("Error: the server maps DNA jobs only (%s submit -s <socket> dna <options>)\n",
+	   HPG_ALIGNER_BIN);
+    exit(EXIT_FAILURE);
+  }
+
+  omp_set_max_active_levels(server->omp_levels);
+
+  options_t *options = parse_options(argc, argv);
+  options->cmdline = create_cmdline(argc, argv);
+
+  // the index is the server's
+  char job_index[PATH_MAX];
+  if (options->bwt_dirname) {
+    if (!realpath(options->bwt_dirname, job_index) ||
+	strcmp(job_index, server->index_dirname)) {
+      printf("Error: the server index is %s, not %s\n", server->index_dirname, options->bwt_dirname);
+      exit(EXIT_FAILURE);
+    }
+  } else {
+    options->bwt_dirname = strdup(server->index_dirname);
+  }
+
+  // this job's share of the server threads
+  int num_threads = server->num_threads / server->max_jobs;
+  if (num_threads < 1) num_threads = 1;
+  if (options->num_cpu_threads > num_threads) {
+    options->num_cpu_threads = num_threads;
+  }
+
+  if (options->adapter) {
+    options->adapter_revcomp = strdup(options->adapter);
+    seq_reverse_complementary(options->adapter_revcomp, strlen(options->adapter_revcomp));
+  }
+
+  init_log_custom(options->log_level, 1, "hpg-aligner.log", "w");
+
+  validate_options(options);
+  metrics_start(options);
+  dna_aligner_run(options, server->sa_index);
+  metrics_stop();
+
+  options_free(options);
+  free(request);
+
+  exit(EXIT_SUCCESS);
+}
+
+//------------------------------------------------------------------------
+// server
+//------------------------------------------------------------------------
+
+static int server_listen(const char *path) {
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    LOG_FATAL_F("Server socket path too long: %s\n", path);
+  }
+  strcpy(addr.sun_path, path);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    LOG_FATAL_F("Could not create the server socket: %s\n", strerror(errno));
+  }
+
+  // owner only, from bind on: jobs read and write as the server user
+  unlink(path);
+  mode_t mask = umask(0177);
+  int ret = bind(fd, (struct sockaddr *) &addr, sizeof(addr));
+  umask(mask);
+  if (ret < 0 || chmod(path, 0600) < 0 || listen(fd, 64) < 0) {
+    LOG_FATAL_F("Could not listen on the server socket %s: %s\n", path, strerror(errno));
+  }
+
+  return fd;
+}
+
+//------------------------------------------------------------------------
+
+// only the server user submits jobs, whatever the socket permissions
+static int server_peer_allowed(int conn) {
+  struct ucred cred;
+  socklen_t len = sizeof(cred);
+  if (getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0) {
+    return 0;
+  }
+  return cred.uid == getuid();
+}
+
+//------------------------------------------------------------------------
+
+static void server_start_job(int conn, server_t *server) {
+  int id = ++server->num_submitted;
+
+  pid_t pid = fork();
+  if (pid < 0) {
+    dprintf(conn, "Error: could not start the job: %s\n%s%i\n",
+	    strerror(errno), SERVER_EXIT_MARKER, EXIT_FAILURE);
+    close(conn);
+    return;
+  }
+
+  if (pid == 0) {
+    // the connections of the other jobs are not this job's
+    close(server->socket_fd);
+    for (int i = 0; i < server->num_jobs; i++) {
+      close(server->jobs[i].conn);
+    }
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGPIPE, SIG_DFL);
+    server_job(conn, server);
+  }
+
+  server_job_t *job = &server->jobs[server->num_jobs++];
+  job->pid = pid;
+  job->conn = conn;
+  job->id = id;
+
+  printf("Job %i started (pid %i, %i running)\n", id, pid, server->num_jobs);
+  fflush(stdout);
+}
+
+//------------------------------------------------------------------------
+
+static void server_reap_jobs(int options, server_t *server) {
+  int status;
+  pid_t pid;
+  while ((pid = waitpid(-1, &status, options)) > 0) {
+    for (int i = 0; i < server->num_jobs; i++) {
+      server_job_t *job = &server->jobs[i];
+      if (job->pid != pid) continue;
+
+      int code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+      dprintf(job->conn, "%s%i\n", SERVER_EXIT_MARKER, code);
+      close(job->conn);
+
+      printf("Job %i done, status %i\n", job->id, code);
+      fflush(stdout);
+
+      server->jobs[i] = server->jobs[--server->num_jobs];
+      break;
+    }
+  }
+}
+
+//------------------------------------------------------------------------
+
+void run_server(int argc, char **argv) {
+  server_t server;
+  memset(&server, 0, sizeof(server_t));
+  parse_server_options(argc, argv, &server);
+
+  // the index is loaded with no OpenMP threads: the thread pool of the
+  // server would not exist in the forked jobs, and they would wait for it
+  server.omp_levels = omp_get_max_active_levels();
+  omp_set_max_active_levels(0);
+  server.sa_index = dna_aligner_load_index(server.index_dirname);
+
+  server.socket_fd = server_listen(server.socket_path);
+
+  signal(SIGINT, server_signal_handler);
+  signal(SIGTERM, server_signal_handler);
+  signal(SIGPIPE, SIG_IGN);
+
+  printf("-----------------------------------------------------------------\n");
+  printf("Server ready on %s (%i threads, up to %i jobs at once)\n",
+	 server.socket_path, server.num_threads, server.max_jobs);
+  fflush(stdout);
+
+  struct pollfd pfd;
+  while (!server_stop) {
+    // while all the slots are busy, new jobs wait in the backlog
+    pfd.fd = server.num_jobs < server.max_jobs ? server.socket_fd : -1;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    if (poll(&pfd, 1, 200) > 0 && (pfd.revents & POLLIN)) {
+      int conn = accept(server.socket_fd, NULL, NULL);
+      if (conn >= 0 && !server_peer_allowed(conn)) {
+	dprintf(conn, "Error: jobs are only accepted from the server user\n%s%i\n",
+		SERVER_EXIT_MARKER, EXIT_FAILURE);
+	close(conn);
+	printf("Job refused: not the server user\n");
+	fflush(stdout);
+      } else if (conn >= 0) {
+	server_start_job(conn, &server);
+      }
+    }
+
+    server_reap_jobs(WNOHANG, &server);
+  }
+
+  // running jobs are finished
+  close(server.socket_fd);
+  unlink(server.socket_path);
+  if (server.num_jobs) {
+    printf("Waiting for %i running job(s)...\n", server.num_jobs);
+    fflush(stdout);
+  }
+  while (server.num_jobs) {
+    server_reap_jobs(0, &server);
+  }
+
+  sa_index3_free(server.sa_index);
+  free(server.index_dirname);
+  free(server.socket_path);
+}
+
+//------------------------------------------------------------------------
+// client
+//------------------------------------------------------------------------
+
+int run_submit(int argc, char **argv) {
+  // argv: submit -s <socket> dna ...
+  if (argc < 4 || (strcmp(argv[1], "-s") && strcmp(argv[1], "--socket"))) {
+    printf("\nUsage:\n\t%s submit -s <socket> dna <dna options>\n", HPG_ALIGNER_BIN);
+    return EXIT_FAILURE;
+  }
+  char *path = argv[2];
+
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    printf("Error: socket path too long: %s\n", path);
+    return EXIT_FAILURE;
+  }
+  strcpy(addr.sun_path, path);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 || connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+    printf("Error: could not connect to the server on %s: %s\n", path, strerror(errno));
+    return EXIT_FAILURE;
+  }
+
+  // request
+  char cwd[PATH_MAX];
+  if (!getcwd(cwd, sizeof(cwd))) {
+    printf("Error: could not get the working directory: %s\n", strerror(errno));
+    return EXIT_FAILURE;
+  }
+  FILE *f = fdopen(fd, "r+");
+  fprintf(f, "%i", argc - 3);
+  fputc('\0', f);
+  fwrite(cwd, 1, strlen(cwd) + 1, f);
+  for (int i = 3; i < argc; i++) {
+    fwrite(argv[i], 1, strlen(argv[i]) + 1, f);
+  }
+  fflush(f);
+
+  // job output, up to the exit status
+  int code = -1;
+  char *line = NULL, *marker;
+  size_t size = 0;
+  while (getline(&line, &size, f) > 0) {
+    if ((marker = strstr(line, SERVER_EXIT_MARKER))) {
+      fwrite(line, 1, marker - line, stdout);
+      code = atoi(marker + strlen(SERVER_EXIT_MARKER));
+      break;
+    }
+    fputs(line, stdout);
+    fflush(stdout);
+  }
+  free(line);
+  fclose(f);
+
+  if (code < 0) {
+    printf("Error: connection to the server lost\n");
+    return EXIT_FAILURE;
+  }
+  return code;
+}
+
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
@@ -0,0 +1,72 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "argtable/argtable2.h"
+
+#include "options.h"
+#include "dna/dna_aligner.h"
+
+//------------------------------------------------------------------------
+// Aligner server: keeps the SA index loaded and maps the DNA jobs
+// submitted on a Unix socket,
+//
+//   hpg-aligner server -i <sa-index-dir> -s <socket> [-t <n>] [--max-jobs <n>]
+//   hpg-aligner submit -s <socket> dna -f reads.fq -o outdir [dna options]
+//
+// The client sends its working directory and the job command line; the
+// job output is streamed back and the client exits with the job status.
+// The socket is created 0600 and jobs are accepted only from clients of
+// the server user (SO_PEERCRED).
+//
+// Every job runs in a process forked from the server, so options_t, the
+// writers, the statistics and the rest of the mapping state are the
+// job's own, while the index pages are shared (read-only) by all of
+// them. Up to --max-jobs jobs run at once, sharing the -t threads of
+// the server; the next ones wait in the socket backlog.
+//------------------------------------------------------------------------
+
+#define NUM_SERVER_OPTIONS     5
+
+#define SERVER_MAX_REQUEST     65536
+#define SERVER_MAX_ARGS        256
+#define SERVER_MAX_JOBS        64
+#define SERVER_EXIT_MARKER     "#hpg-job-exit "
+
+//------------------------------------------------------------------------
+
+typedef struct server_job {
+  pid_t pid;
+  int conn;
+  int id;
+} server_job_t;
+
+typedef struct server {
+  char *index_dirname;
+  char *socket_path;
+  int num_threads;
+  int max_jobs;
+
+  sa_index3_t *sa_index;
+  int omp_levels;
+
+  int socket_fd;
+  int num_jobs;
+  int num_submitted;
+  server_job_t jobs[SERVER_MAX_JOBS];
+} server_t;
+
+//------------------------------------------------------------------------
+
+// hpg-aligner server <options>
+void run_server(int argc, char **argv);
+
+// hpg-aligner submit -s <socket> <job command line>, returns the job status
+int run_submit(int argc, char **argv);
+
+//------------------------------------------------------------------------
+
+#endif // SERVER_H
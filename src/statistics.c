@@ -180,7 +180,6 @@ void basic_statistics_sp_init(size_t total_sp, size_t uniq_sp, basic_statistics_
 
 basic_statistics_t *basic_statistics_new() {
   basic_statistics_t *basic = (basic_statistics_t *)malloc(sizeof(basic_statistics_t));
-  pthread_mutex_init(&(basic->mutex), NULL);
   basic->total_reads = 0;
   basic->num_mapped_reads = 0;
   basic->total_mappings = 0;
@@ -194,10 +193,99 @@ basic_statistics_t *basic_statistics_new() {
 //-------------------------------------------------------------------------------------------
 
 void basic_statistics_add(size_t total_reads, size_t num_mapped_reads, size_t total_mappings, size_t reads_uniq_mappings, basic_statistics_t *basic) {
-  pthread_mutex_lock(&basic->mutex);
-  basic->total_reads         += total_reads;
-  basic->num_mapped_reads    += num_mapped_reads;
-  basic->total_mappings      += total_mappings;
-  basic->reads_uniq_mappings += reads_uniq_mappings;
-  pthread_mutex_unlock(&basic->mutex);
+  thread_stats_add(ST_TOTAL_READS, total_reads);
+  thread_stats_add(ST_MAPPED_READS, num_mapped_reads);
+  thread_stats_add(ST_TOTAL_MAPPINGS, total_mappings);
+  thread_stats_add(ST_UNIQ_MAPPINGS, reads_uniq_mappings);
+}
+
+//-------------------------------------------------------------------------------------------
+
+void basic_statistics_update(basic_statistics_t *basic) {
+  basic->total_reads         = thread_stats_get(ST_TOTAL_READS);
+  basic->num_mapped_reads    = thread_stats_get(ST_MAPPED_READS);
+  basic->total_mappings      = thread_stats_get(ST_TOTAL_MAPPINGS);
+  basic->reads_uniq_mappings = thread_stats_get(ST_UNIQ_MAPPINGS);
+}
+
+//-------------------------------------------------------------------------------------------
+// per-thread counters
+//-------------------------------------------------------------------------------------------
+
+thread_stats_t thread_stats[THREAD_STATS_MAX_THREADS];
+__thread thread_stats_t *thread_stats_local = NULL;
+
+static int thread_stats_num_slots = 0;
+
+thread_stats_t *thread_stats_slot() {
+  int slot = __sync_fetch_and_add(&thread_stats_num_slots, 1);
+  if (slot >= THREAD_STATS_MAX_THREADS - 1) {
+    slot = THREAD_STATS_MAX_THREADS - 1;
+    thread_stats[slot].shared = 1;
+  }
+  thread_stats_local = &thread_stats[slot];
+  return thread_stats_local;
+}
+
+//-------------------------------------------------------------------------------------------
+
+size_t thread_stats_get(thread_stats_counter_t counter) {
+  size_t value = 0;
+  for (int i = 0; i < THREAD_STATS_MAX_THREADS; i++) {
+    value += __atomic_load_n(&thread_stats[i].counters[counter], __ATOMIC_RELAXED);
+  }
+  return value;
+}
+
+//-------------------------------------------------------------------------------------------
+
+void thread_stats_get_mappings(size_t *num_mappings) {
+  for (int b = 0; b < THREAD_STATS_NUM_MAPPINGS_BINS; b++) {
+    num_mappings[b] = 0;
+    for (int i = 0; i < THREAD_STATS_MAX_THREADS; i++) {
+      num_mappings[b] += __atomic_load_n(&thread_stats[i].num_mappings[b], __ATOMIC_RELAXED);
+    }
+  }
+}
+
+//-------------------------------------------------------------------------------------------
+
+// slots stay assigned to their threads, only the values are cleared
+void thread_stats_reset() {
+  for (int i = 0; i < THREAD_STATS_MAX_THREADS; i++) {
+    memset(thread_stats[i].counters, 0, sizeof(thread_stats[i].counters));
+    memset(thread_stats[i].num_mappings, 0, sizeof(thread_stats[i].num_mappings));
+  }
+}
+
+//-------------------------------------------------------------------------------------------
+
+void thread_stats_to_st_bwt(st_bwt_t *st) {
+  st->total_reads        = thread_stats_get(ST_BWT_TOTAL_READS);
+  st->single_alig        = thread_stats_get(ST_BWT_SINGLE_ALIG);
+  st->multi_alig         = thread_stats_get(ST_BWT_MULTI_ALIG);
+  st->map_bwt            = thread_stats_get(ST_MAP_BWT);
+  st->map_w1             = thread_stats_get(ST_MAP_W1);
+  st->map_w2             = thread_stats_get(ST_MAP_W2);
+  st->map_w3             = thread_stats_get(ST_MAP_W3);
+  st->tot_sj             = thread_stats_get(ST_TOT_SJ);
+  st->dif_sj             = 0;
+  st->cannonical_sj      = thread_stats_get(ST_CANNONICAL_SJ);
+  st->semi_cannonical_sj = thread_stats_get(ST_SEMI_CANNONICAL_SJ);
+}
+
+//-------------------------------------------------------------------------------------------
+
+void thread_stats_display_mappings(FILE *f) {
+  size_t num_mappings[THREAD_STATS_NUM_MAPPINGS_BINS], total = 0;
+  thread_stats_get_mappings(num_mappings);
+  for (int b = 0; b < THREAD_STATS_NUM_MAPPINGS_BINS; b++) total += num_mappings[b];
+  if (!total) return;
+
+  fprintf(f, "Num. mappings per read:\n");
+  for (int b = 0; b < THREAD_STATS_NUM_MAPPINGS_BINS; b++) {
+    if (!num_mappings[b]) continue;
+    fprintf(f, "\t%s%2i : %lu (%0.2f %%)\n", (b == THREAD_STATS_NUM_MAPPINGS_BINS - 1 ? ">=" : "  "),
+	    b, num_mappings[b], 100.0f * num_mappings[b] / total);
+  }
 }
@@ -25,6 +25,102 @@ typedef struct st_bwt {
 
 } st_bwt_t;
 
+//------------------------------------------------------------------------
+// Per-thread counters: every thread updates its own cache-line aligned
+// slot without locking, and totals are reduced on demand, so they can
+// also be read while mapping (e.g., progress). Threads take a slot the
+// first time they count; past THREAD_STATS_MAX_THREADS threads share
+// the last slot with atomic updates.
+//------------------------------------------------------------------------
+
+#define THREAD_STATS_MAX_THREADS  256
+#define THREAD_STATS_CACHE_LINE   64
+
+// mappings per read histogram, the last bin counts the rest
+#define THREAD_STATS_NUM_MAPPINGS_BINS  16
+
+typedef enum thread_stats_counter {
+  // DNA and RNA writers
+  ST_TOTAL_READS = 0,
+  ST_MAPPED_READS,
+  ST_UNMAPPED_READS,
+  ST_TOTAL_MAPPINGS,
+  ST_UNIQ_MAPPINGS,
+  ST_MULTIHIT_READS,
+
+  // RNA, BWT and workflows
+  ST_BWT_TOTAL_READS,
+  ST_BWT_SINGLE_ALIG,
+  ST_BWT_MULTI_ALIG,
+  ST_MAP_BWT,
+  ST_MAP_W1,
+  ST_MAP_W2,
+  ST_MAP_W3,
+
+  // RNA, suffix array
+  ST_SA_TOTAL_READS,
+  ST_SA_READS_NO_MAP,
+  ST_SA_READS_PH2,
+  ST_SA_SW,
+
+  // splice junctions
+  ST_TOT_SJ,
+  ST_CANNONICAL_SJ,
+  ST_SEMI_CANNONICAL_SJ,
+
+  // RNA, metaexon index
+  ST_METAEXON_SEARCHES,
+  ST_METAEXON_INSERTS,
+  ST_METAEXON_READ_WAITS,
+  ST_METAEXON_WRITE_WAITS,
+
+  NUM_THREAD_STATS
+} thread_stats_counter_t;
+
+typedef struct thread_stats {
+  size_t counters[NUM_THREAD_STATS];
+  size_t num_mappings[THREAD_STATS_NUM_MAPPINGS_BINS];
+  int shared;
+} __attribute__((aligned(THREAD_STATS_CACHE_LINE))) thread_stats_t;
+
+extern thread_stats_t thread_stats[THREAD_STATS_MAX_THREADS];
+extern __thread thread_stats_t *thread_stats_local;
+
+thread_stats_t *thread_stats_slot();
+
+static inline void thread_stats_slot_add(size_t *counter, size_t value, thread_stats_t *slot) {
+  if (slot->shared) {
+    __sync_fetch_and_add(counter, value);
+  } else {
+    // single writer: a relaxed store is enough for the readers
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + value, __ATOMIC_RELAXED);
+  }
+}
+
+static inline void thread_stats_add(thread_stats_counter_t counter, size_t value) {
+  thread_stats_t *slot = thread_stats_local ? thread_stats_local : thread_stats_slot();
+  thread_stats_slot_add(&slot->counters[counter], value, slot);
+}
+
+static inline void thread_stats_inc(thread_stats_counter_t counter) {
+  thread_stats_add(counter, 1);
+}
+
+// counts a read with num_mappings mappings
+static inline void thread_stats_add_mappings(size_t num_mappings) {
+  thread_stats_t *slot = thread_stats_local ? thread_stats_local : thread_stats_slot();
+  size_t bin = num_mappings < THREAD_STATS_NUM_MAPPINGS_BINS ? num_mappings : THREAD_STATS_NUM_MAPPINGS_BINS - 1;
+  thread_stats_slot_add(&slot->num_mappings[bin], 1, slot);
+}
+
+// reduced over all the threads, lock-free
+size_t thread_stats_get(thread_stats_counter_t counter);
+void thread_stats_get_mappings(size_t *num_mappings);
+void thread_stats_reset();
+
+// fills the legacy summaries from the per-thread counters
+void thread_stats_to_st_bwt(st_bwt_t *st);
+
 
 typedef struct statistics{
   int num_sections;
@@ -43,7 +139,6 @@ typedef struct basic_statistics {
   size_t reads_uniq_mappings;
   size_t total_sp;
   size_t uniq_sp;
-  pthread_mutex_t mutex;
 } basic_statistics_t;
 
 typedef struct cal_st {
@@ -78,6 +173,11 @@ void timing_and_statistics_display(statistics_t* statistics_p,
 
 void basic_statistics_add(size_t total_reads, size_t num_mapped_reads, size_t total_mappings, size_t reads_uniq_mappings, basic_statistics_t *basic);
 
+// reduces the counters added by basic_statistics_add into basic
+void basic_statistics_update(basic_statistics_t *basic);
+
+void thread_stats_display_mappings(FILE *f);
+
 basic_statistics_t *basic_statistics_new();
 
 #endif // end of if TIMING
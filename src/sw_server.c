@@ -170,7 +170,7 @@ void set_sw_sequences(char **q, char **r, size_t sw_count, char *sequence,
   // get ref. sequence
   gap_len = sr->genome_end - sr->genome_start + 1;
   r[sw_count] = (char *) malloc((gap_len + 1) * sizeof(char));
-  genome_read_sequence_by_chr_index(r[sw_count], 0, chromosome, 
+  reference_read_sequence(r[sw_count], 0, chromosome, 
   				    &sr->genome_start, &sr->genome_end, genome);
   r[sw_count][gap_len] = '\0';
 }
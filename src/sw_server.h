@@ -12,6 +12,7 @@
 
 #include "aligners/sw/smith_waterman.h"
 #include "aligners/bwt/genome.h"
+#include "reference_genome.h"
 
 #include "rna/rna_splice.h"
 
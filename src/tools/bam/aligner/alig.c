@@ -41,7 +41,6 @@ static inline ERROR_CODE alig_region_filter_read(bam1_t *read, array_list_t *lis
 static inline ERROR_CODE alig_aux_write_to_disk(array_list_t *write_buffer, bam_file_t *output_bam_f, uint8_t force) /* DEPRECATED */;
 static inline ERROR_CODE alig_aux_read_from_disk(circular_buffer_t *read_buffer, bam_file_t *input_bam_f) /* DEPRECATED */;
 static ERROR_CODE alig_get_scores(alig_context_t *context);
-static ERROR_CODE alig_get_scores_from_read(bam1_t *read, alig_context_t *context, uint32_t *v_scores, size_t *v_positions);
 static inline ERROR_CODE alig_get_alternative_haplotype(alig_context_t *context, int *out_haplo_index, uint32_t *out_haplo_score, uint32_t *out_ref_score);
 static ERROR_CODE alig_indel_realign_from_haplo(alig_context_t *context, size_t alt_haplo_index);
 
@@ -1237,10 +1236,11 @@ alig_get_scores(alig_context_t *context)
 	size_t haplo_list_l;
 
 	//Score vector
-	uint32_t *v_scores;
-	size_t *v_positions;
 	size_t v_total;
 
+	//Scratch buffers
+	alig_scratch_t scratch;
+
 	assert(context);
 
 	//Validate context
@@ -1280,42 +1280,35 @@ alig_get_scores(alig_context_t *context)
 	assert(m_positions);
 	assert(m_scores);
 
-	//Init matrices
-	for(i = 0; i < m_total; i++)
-	{
-		*((size_t*)m_positions + i) = SIZE_MAX;
-		*((uint32_t*)m_scores + i) = UINT32_MAX;
-	}
+	//Init matrices (all bits set is SIZE_MAX and UINT32_MAX)
+	memset(m_positions, 0xFF, m_total * sizeof(size_t));
+	memset(m_scores, 0xFF, m_total * sizeof(uint32_t));
 
-	//Iterate reads
-	//#pragma omp parallel private(read, err, j, i, v_total, v_positions, v_scores, index) firstprivate(read_list_l)
-	{
-		//Allocate new scores
-		v_total = context->scores.m_ldim;
-		v_positions = (size_t *)malloc(v_total * sizeof(size_t));
-		v_scores = (uint32_t *)malloc(v_total * sizeof(uint32_t));
-
-		//#pragma omp for
-		for(i = 0; i < read_list_l; i++)
-		{
-			//Get read
-			read = array_list_get(i, read_list);
-			assert(read);
+	//Scratch buffers are shared by all reads in region
+	memset(&scratch, 0, sizeof(alig_scratch_t));
+	scratch.aux_cigar = (uint32_t *)malloc(MAX_CIGAR_LENGTH * sizeof(uint32_t));
+	scratch.read_left_cigar = (uint32_t *)malloc(MAX_CIGAR_LENGTH * sizeof(uint32_t));
 
-			//Get scores
-			err = alig_get_scores_from_read(read, context, v_scores, v_positions);
+	//Iterate reads, scores are written directly in its matrix row
+	v_total = context->scores.m_ldim;
+	for(i = 0; i < read_list_l; i++)
+	{
+		//Get read
+		read = array_list_get(i, read_list);
+		assert(read);
 
-			//Merge scores
-			index = i * v_total;
-			memcpy((uint32_t*)m_scores + index, v_scores, v_total * sizeof(uint32_t));
-			memcpy((size_t*)m_positions + index, v_positions, v_total * sizeof(size_t));
+		//Get scores
+		index = i * v_total;
+		err = alig_get_scores_from_read(read, context, &scratch, m_scores + index, m_positions + index);
 
-		}//FOR reads
+	}//FOR reads
 
-		//Free
-		free(v_scores);
-		free(v_positions);
-	}
+	//Free
+	free(scratch.read_seq);
+	free(scratch.read_seq_ref);
+	free(scratch.quals_seq);
+	free(scratch.aux_cigar);
+	free(scratch.read_left_cigar);
 
 	//Print table
 	/*{
@@ -1373,16 +1366,16 @@ alig_get_scores(alig_context_t *context)
 }
 
 /**
- * PRIVATE FUNCTION.Obtain score tables from read.
+ * Obtain score tables from read.
+ * Scores and positions vectors must be initialized to UINT32_MAX and SIZE_MAX.
  */
-static ERROR_CODE
-alig_get_scores_from_read(bam1_t *read, alig_context_t *context, uint32_t *v_scores, size_t *v_positions)
+ERROR_CODE
+alig_get_scores_from_read(bam1_t *read, alig_context_t *context, alig_scratch_t *scratch, uint32_t *v_scores, size_t *v_positions)
 {
 	int i, err;
 
 	//Reads
 	char *read_seq;
-	char *comp_seq;
 	char *quals_seq;
 	size_t read_l;
 
@@ -1417,11 +1410,9 @@ alig_get_scores_from_read(bam1_t *read, alig_context_t *context, uint32_t *v_sco
 	size_t ref_pos_begin;
 	size_t ref_pos_end;
 
-	//Score vector
-	size_t v_total;
-
 	assert(read);
 	assert(context);
+	assert(scratch);
 
 	//Lengths
 	haplo_list_l = array_list_size(context->haplo_list);
@@ -1436,24 +1427,20 @@ alig_get_scores_from_read(bam1_t *read, alig_context_t *context, uint32_t *v_sco
 	ref_pos_begin = reference->position;
 	ref_pos_end = ref_pos_begin + reference->length;
 
-	//Allocate new read
+	//Grow scratch read buffers if needed
 	read_l = read->core.l_qseq;
-	read_seq = (char *) malloc((read_l + 1) * sizeof(char));
-	comp_seq = (char *) malloc((read_l + 1) * sizeof(char));
-	read_seq_ref = (char *) malloc((read_l + 1) * sizeof(char));
-	quals_seq = (char *) malloc((read_l + 1) * sizeof(char));
-
-	//Allocate cigars
-	aux_cigar = (uint32_t *)malloc(MAX_CIGAR_LENGTH * sizeof(uint32_t));
-	read_left_cigar = (uint32_t *)malloc(MAX_CIGAR_LENGTH * sizeof(uint32_t));
-
-	//Init scores
-	v_total = context->scores.m_ldim;
-	for(i = 0; i < v_total; i++)
+	if(scratch->max_l < read_l + 1)
 	{
-		*((size_t*)v_positions + i) = SIZE_MAX;
-		*((uint32_t*)v_scores + i) = UINT32_MAX;
+		scratch->max_l = read_l + 1;
+		scratch->read_seq = (char *) realloc(scratch->read_seq, scratch->max_l * sizeof(char));
+		scratch->read_seq_ref = (char *) realloc(scratch->read_seq_ref, scratch->max_l * sizeof(char));
+		scratch->quals_seq = (char *) realloc(scratch->quals_seq, scratch->max_l * sizeof(char));
 	}
+	read_seq = scratch->read_seq;
+	read_seq_ref = scratch->read_seq_ref;
+	quals_seq = scratch->quals_seq;
+	aux_cigar = scratch->aux_cigar;
+	read_left_cigar = scratch->read_left_cigar;
 
 	//Convert read sequence to string
 	new_sequence_from_bam_ref(read, read_seq, read_l + 1);
@@ -1477,7 +1464,7 @@ alig_get_scores_from_read(bam1_t *read, alig_context_t *context, uint32_t *v_sco
 			read_seq_ref, &read_seq_ref_l, NULL);
 
 	//Get raw score with reference
-	nucleotide_miss_qual_sum(read_seq_ref, read_seq, quals_seq, read_l, comp_seq, &misses, &misses_sum);
+	simd_miss_qual_sum(read_seq_ref, read_seq, quals_seq, read_l, &misses, &misses_sum);
 	v_scores[0] = misses_sum;
 	v_positions[0] = read->core.pos;
 
@@ -1566,7 +1553,7 @@ alig_get_scores_from_read(bam1_t *read, alig_context_t *context, uint32_t *v_sco
 					//assert(read_seq_ref_l == read->core.l_qseq);
 
 					//Compare and miss with haplotype
-					nucleotide_miss_qual_sum(read_seq, read_seq_ref, quals_seq, read_seq_ref_l, comp_seq, &misses, &misses_sum);
+					simd_miss_qual_sum(read_seq, read_seq_ref, quals_seq, read_seq_ref_l, &misses, &misses_sum);
 
 					//Better?
 					if(v_scores[i+1] > misses_sum)
@@ -1587,14 +1574,6 @@ alig_get_scores_from_read(bam1_t *read, alig_context_t *context, uint32_t *v_sco
 		} //Iterate haplotypes
 	} //Misses != 0 if
 
-	//Free
-	free(read_seq);
-	free(comp_seq);
-	free(read_seq_ref);
-	free(quals_seq);
-	free(read_left_cigar);
-	free(aux_cigar);
-
 	return NO_ERROR;
 }
 
@@ -84,6 +84,18 @@ typedef struct {
  * 		ERRZZZZ
  */
 
+/**
+ * SCORING BUFFERS, REUSED BY ALL READS IN A REGION
+ */
+typedef struct {
+	char *read_seq;
+	char *read_seq_ref;
+	char *quals_seq;
+	size_t max_l;
+	uint32_t *aux_cigar;
+	uint32_t *read_left_cigar;
+} alig_scratch_t;
+
 /**
  * REALIGNER CONTEXT
  */
@@ -220,14 +232,16 @@ EXTERNC ERROR_CODE alig_bam_file_old(char *bam_path, char *ref_name, char *ref_p
 //static ERROR_CODE alig_get_scores(alig_context_t *context) __ATTR_HOT;
 
 /**
- * \brief PRIVATE FUNCTION.Obtain score tables from read.
+ * \brief Obtain score tables from read. Only needs the context reference
+ * and haplotype list, exported for the benchmarks.
  *
  *	\param[in] read Read to process.
  * \param[in] context Context to process.
+ * \param[in] scratch Scoring buffers, aux_cigar and read_left_cigar with MAX_CIGAR_LENGTH items.
  * \param[out] v_scores Best score vector for every haplotype (index).
  * \param[out] v_positions Best score position vector for every haplotype (index).
  */
-//static ERROR_CODE alig_get_scores_from_read(bam1_t *read, alig_context_t *context, uint32_t *v_scores, size_t *v_positions) __ATTR_HOT;
+EXTERNC ERROR_CODE alig_get_scores_from_read(bam1_t *read, alig_context_t *context, alig_scratch_t *scratch, uint32_t *v_scores, size_t *v_positions) __ATTR_HOT;
 
 /**
  * \brief PRIVATE FUNCTION. Obtain alternative haplotype from generated score tables.
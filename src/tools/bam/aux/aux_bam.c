@@ -16,6 +16,7 @@
 */
 
 #include "aux_bam.h"
+#include "aux_nt_simd.h"
 #include <assert.h>
 
 ERROR_CODE
@@ -131,30 +132,7 @@ new_sequence_from_bam(bam1_t *bam1)
 	seq = (char *) malloc(seq_len * sizeof(char));
 
 	// nucleotide content
-	for (int i = 0; i < seq_len; i++) {
-		switch (bam1_seqi(bam_seq, i))
-		{
-		case 1:
-			seq[i] = 'A';
-			break;
-		case 2:
-			seq[i] = 'C';
-			break;
-		case 4:
-			seq[i] = 'G';
-			break;
-		case 8:
-			seq[i] = 'T';
-			break;
-		case 15:
-			seq[i] = 'N';
-			//printf("N");
-			break;
-		default:
-			seq[i] = 'N';
-			break;
-		}
-	}
+	simd_bam_unpack((uint8_t *)bam_seq, seq_len, seq);
 
 	return seq;
 }
@@ -167,39 +145,15 @@ new_sequence_from_bam_ref(bam1_t *bam1, char *seq, uint32_t max_l)
 {
 	char *bam_seq = (char *)bam1_seq(bam1);
 	int seq_len = bam1->core.l_qseq;
-	int i;
 
 	if(seq_len > max_l)
 		seq_len = max_l;
 
 	// nucleotide content
-	for (i = 0; i < seq_len; i++) {
-		switch (bam1_seqi(bam_seq, i))
-		{
-		case 1:
-			seq[i] = 'A';
-			break;
-		case 2:
-			seq[i] = 'C';
-			break;
-		case 4:
-			seq[i] = 'G';
-			break;
-		case 8:
-			seq[i] = 'T';
-			break;
-		case 15:
-			seq[i] = 'N';
-			//printf("N");
-			break;
-		default:
-			seq[i] = 'N';
-			break;
-		}
-	}
+	simd_bam_unpack((uint8_t *)bam_seq, seq_len, seq);
 
 	if(max_l > seq_len)
-		seq[i] = '\0';
+		seq[seq_len] = '\0';
 
 	return NO_ERROR;
 }
@@ -0,0 +1,309 @@
+#include "aux_index.h"
+
+#include <string.h>
+#include <unistd.h>
+
+#include "commons/log.h"
+
+//--------------------------------------------------------------------
+// binning scheme, BAI is the CSI scheme with min_shift = 14 and
+// 5 levels
+//--------------------------------------------------------------------
+
+static inline int bam_indexer_reg2bin(int64_t beg, int64_t end, int min_shift, int num_levels) {
+  int l, s = min_shift, t = ((1 << ((num_levels << 1) + num_levels)) - 1) / 7;
+  for (--end, l = num_levels; l > 0; --l, s += 3, t -= 1 << ((l << 1) + l)) {
+    if (beg >> s == end >> s) return t + (beg >> s);
+  }
+  return 0;
+}
+
+static inline int64_t bam_indexer_bin2beg(uint32_t bin, int min_shift, int num_levels) {
+  int l = 0, t = 0;
+  while (l < num_levels && bin >= t + (1 << (3 * l))) {
+    t += 1 << (3 * l);
+    l++;
+  }
+  return (int64_t) (bin - t) << (min_shift + 3 * (num_levels - l));
+}
+
+static inline uint32_t bam_indexer_meta_bin(bam_indexer_t *indexer) {
+  return ((1 << (3 * indexer->num_levels + 3)) - 1) / 7 + 1;
+}
+
+//--------------------------------------------------------------------
+
+bam_indexer_t *bam_indexer_new(const char *bam_filename, const bam_header_t *header, BGZF *fp) {
+  bam_indexer_t *p = (bam_indexer_t *) calloc(1, sizeof(bam_indexer_t));
+  int64_t max_len = 0, s;
+
+  for (int i = 0; i < header->n_targets; i++) {
+    if (header->target_len[i] > max_len) max_len = header->target_len[i];
+  }
+
+  p->min_shift = BAM_INDEX_MIN_SHIFT;
+  for (p->num_levels = 0, s = 1LL << p->min_shift; max_len > s; p->num_levels++, s <<= 3);
+  if (p->num_levels <= BAM_INDEX_BAI_LEVELS) {
+    p->num_levels = BAM_INDEX_BAI_LEVELS;
+  } else {
+    p->is_csi = 1;
+  }
+  p->num_targets = header->n_targets;
+  p->fp = fp;
+
+  p->idx_filename = (char *) malloc(strlen(bam_filename) + 5);
+  sprintf(p->idx_filename, "%s.%s", bam_filename, p->is_csi ? "csi" : "bai");
+  p->idx_file = fopen(p->idx_filename, "wb");
+  if (!p->idx_file) {
+    LOG_WARN_F("Could not create index file %s, BAM will not be indexed\n", p->idx_filename);
+    p->failed = 1;
+    return p;
+  }
+
+  if (p->is_csi) {
+    int32_t aux[3] = { p->min_shift, p->num_levels, 0 };
+    fwrite("CSI\1", 1, 4, p->idx_file);
+    fwrite(aux, sizeof(int32_t), 3, p->idx_file);
+  } else {
+    fwrite("BAI\1", 1, 4, p->idx_file);
+  }
+  fwrite(&p->num_targets, sizeof(int32_t), 1, p->idx_file);
+
+  p->bin_slots = (int32_t *) malloc((bam_indexer_meta_bin(p) + 1) * sizeof(int32_t));
+  memset(p->bin_slots, 0xFF, (bam_indexer_meta_bin(p) + 1) * sizeof(int32_t));
+  p->tid = -1;
+
+  return p;
+}
+
+//--------------------------------------------------------------------
+
+void bam_indexer_free(bam_indexer_t *indexer) {
+  if (indexer) {
+    for (int i = 0; i < indexer->max_bins; i++) {
+      if (indexer->bins[i].chunks) free(indexer->bins[i].chunks);
+    }
+    if (indexer->bins) free(indexer->bins);
+    if (indexer->bin_slots) free(indexer->bin_slots);
+    if (indexer->linear) free(indexer->linear);
+    if (indexer->idx_filename) free(indexer->idx_filename);
+    if (indexer->idx_file) fclose(indexer->idx_file);
+    free(indexer);
+  }
+}
+
+//--------------------------------------------------------------------
+
+static void bam_indexer_add_chunk(uint32_t bin, uint64_t beg, uint64_t end, bam_indexer_t *indexer) {
+  int32_t slot = indexer->bin_slots[bin];
+  bam_index_bin_t *b;
+
+  if (slot < 0) {
+    if (indexer->num_bins == indexer->max_bins) {
+      indexer->max_bins = indexer->max_bins ? 2 * indexer->max_bins : 64;
+      indexer->bins = (bam_index_bin_t *) realloc(indexer->bins, indexer->max_bins * sizeof(bam_index_bin_t));
+      memset(&indexer->bins[indexer->num_bins], 0,
+	     (indexer->max_bins - indexer->num_bins) * sizeof(bam_index_bin_t));
+    }
+    slot = indexer->bin_slots[bin] = indexer->num_bins++;
+    indexer->bins[slot].bin = bin;
+    indexer->bins[slot].num_chunks = 0;
+  }
+
+  b = &indexer->bins[slot];
+  if (b->num_chunks == b->max_chunks) {
+    b->max_chunks = b->max_chunks ? 2 * b->max_chunks : 4;
+    b->chunks = (bam_index_chunk_t *) realloc(b->chunks, b->max_chunks * sizeof(bam_index_chunk_t));
+  }
+  b->chunks[b->num_chunks].beg = beg;
+  b->chunks[b->num_chunks].end = end;
+  b->num_chunks++;
+}
+
+//--------------------------------------------------------------------
+// write the current chromosome and the empty ones up to tid
+//--------------------------------------------------------------------
+
+static void bam_indexer_flush(int tid, bam_indexer_t *indexer) {
+  FILE *f = indexer->idx_file;
+  int32_t n, zero = 0;
+  uint64_t loffset;
+
+  if (indexer->tid >= 0) {
+    bam_indexer_add_chunk(indexer->chunk_bin, indexer->chunk_beg, indexer->chunk_end, indexer);
+
+    // fill the linear index holes
+    for (size_t i = 1; i < indexer->num_linear; i++) {
+      if (!indexer->linear[i]) indexer->linear[i] = indexer->linear[i - 1];
+    }
+
+    n = indexer->num_bins + 1;
+    fwrite(&n, sizeof(int32_t), 1, f);
+    for (int i = 0; i < indexer->num_bins; i++) {
+      bam_index_bin_t *b = &indexer->bins[i];
+
+      // merge chunks sharing a BGZF block
+      n = 0;
+      for (int c = 1; c < b->num_chunks; c++) {
+	if (b->chunks[n].end >> 16 == b->chunks[c].beg >> 16) {
+	  if (b->chunks[c].end > b->chunks[n].end) b->chunks[n].end = b->chunks[c].end;
+	} else {
+	  b->chunks[++n] = b->chunks[c];
+	}
+      }
+      b->num_chunks = n + 1;
+
+      fwrite(&b->bin, sizeof(uint32_t), 1, f);
+      if (indexer->is_csi) {
+	size_t w = bam_indexer_bin2beg(b->bin, indexer->min_shift, indexer->num_levels) >> indexer->min_shift;
+	loffset = w < indexer->num_linear ? indexer->linear[w] : b->chunks[0].beg;
+	fwrite(&loffset, sizeof(uint64_t), 1, f);
+      }
+      fwrite(&b->num_chunks, sizeof(int32_t), 1, f);
+      fwrite(b->chunks, sizeof(bam_index_chunk_t), b->num_chunks, f);
+
+      indexer->bin_slots[b->bin] = -1;
+    }
+
+    // metadata pseudo-bin: offsets of the chromosome and read counts
+    {
+      uint32_t meta = bam_indexer_meta_bin(indexer);
+      uint64_t meta_chunks[4] = { indexer->ref_beg, indexer->ref_end,
+				  indexer->num_mapped, indexer->num_unmapped };
+      n = 2;
+      loffset = 0;
+      fwrite(&meta, sizeof(uint32_t), 1, f);
+      if (indexer->is_csi) fwrite(&loffset, sizeof(uint64_t), 1, f);
+      fwrite(&n, sizeof(int32_t), 1, f);
+      fwrite(meta_chunks, sizeof(uint64_t), 4, f);
+    }
+
+    if (!indexer->is_csi) {
+      n = indexer->num_linear;
+      fwrite(&n, sizeof(int32_t), 1, f);
+      fwrite(indexer->linear, sizeof(uint64_t), indexer->num_linear, f);
+    }
+
+    indexer->num_bins = 0;
+    indexer->num_linear = 0;
+    indexer->num_mapped = 0;
+    indexer->num_unmapped = 0;
+  }
+
+  // chromosomes without reads
+  for (int t = indexer->tid + 1; t < tid; t++) {
+    fwrite(&zero, sizeof(int32_t), 1, f);
+    if (!indexer->is_csi) fwrite(&zero, sizeof(int32_t), 1, f);
+  }
+
+  indexer->tid = tid;
+  indexer->last_pos = -1;
+}
+
+//--------------------------------------------------------------------
+
+static void bam_indexer_fail(const char *msg, bam_indexer_t *indexer) {
+  LOG_WARN_F("%s, %s will not be created\n", msg, indexer->idx_filename);
+  indexer->failed = 1;
+  fclose(indexer->idx_file);
+  indexer->idx_file = NULL;
+  unlink(indexer->idx_filename);
+}
+
+//--------------------------------------------------------------------
+
+void bam_indexer_write(const bam1_t *bam1, bam_indexer_t *indexer) {
+  const bam1_core_t *c = &bam1->core;
+  uint64_t beg_off, end_off;
+  int64_t beg, end;
+  uint32_t bin;
+
+  beg_off = bam_tell(indexer->fp);
+  bam_write1(indexer->fp, (bam1_t *) bam1);
+  if (indexer->failed) return;
+  end_off = bam_tell(indexer->fp);
+
+  // unmapped reads without coordinates go last and are only counted
+  if (c->tid < 0) {
+    if (indexer->tid != indexer->num_targets) {
+      bam_indexer_flush(indexer->num_targets, indexer);
+    }
+    indexer->num_no_coor++;
+    return;
+  }
+
+  if (c->tid < indexer->tid || (c->tid == indexer->tid && c->pos < indexer->last_pos)) {
+    bam_indexer_fail("BAM records are not sorted by coordinate", indexer);
+    return;
+  }
+  if (c->tid >= indexer->num_targets) {
+    bam_indexer_fail("BAM record chromosome out of header", indexer);
+    return;
+  }
+
+  if (c->tid != indexer->tid) {
+    bam_indexer_flush(c->tid, indexer);
+    indexer->ref_beg = beg_off;
+    indexer->chunk_bin = 0xFFFFFFFFu;
+  }
+  indexer->last_pos = c->pos;
+  indexer->ref_end = end_off;
+
+  beg = c->pos;
+  end = (c->flag & BAM_FUNMAP) ? beg + 1 : bam_calend((bam1_core_t *) c, bam1_cigar(bam1));
+  if (end <= beg) end = beg + 1;
+  bin = bam_indexer_reg2bin(beg, end, indexer->min_shift, indexer->num_levels);
+
+  if (c->flag & BAM_FUNMAP) {
+    indexer->num_unmapped++;
+  } else {
+    indexer->num_mapped++;
+  }
+
+  // consecutive records in the same bin make a chunk
+  if (bin != indexer->chunk_bin) {
+    if (indexer->chunk_bin != 0xFFFFFFFFu) {
+      bam_indexer_add_chunk(indexer->chunk_bin, indexer->chunk_beg, indexer->chunk_end, indexer);
+    }
+    indexer->chunk_bin = bin;
+    indexer->chunk_beg = beg_off;
+  }
+  indexer->chunk_end = end_off;
+
+  // linear index: first record overlapping every window
+  {
+    size_t w_beg = beg >> indexer->min_shift, w_end = (end - 1) >> indexer->min_shift;
+    if (w_end >= indexer->max_linear) {
+      size_t max = indexer->max_linear ? indexer->max_linear : 1024;
+      while (max <= w_end) max *= 2;
+      indexer->linear = (uint64_t *) realloc(indexer->linear, max * sizeof(uint64_t));
+      indexer->max_linear = max;
+    }
+    if (w_end >= indexer->num_linear) {
+      memset(&indexer->linear[indexer->num_linear], 0, (w_end + 1 - indexer->num_linear) * sizeof(uint64_t));
+      indexer->num_linear = w_end + 1;
+    }
+    for (size_t w = w_beg; w <= w_end; w++) {
+      if (!indexer->linear[w]) indexer->linear[w] = beg_off;
+    }
+  }
+}
+
+//--------------------------------------------------------------------
+
+int bam_indexer_finish(bam_indexer_t *indexer) {
+  if (indexer->failed) return -1;
+
+  if (indexer->tid < indexer->num_targets) {
+    bam_indexer_flush(indexer->num_targets, indexer);
+  }
+  fwrite(&indexer->num_no_coor, sizeof(uint64_t), 1, indexer->idx_file);
+
+  fclose(indexer->idx_file);
+  indexer->idx_file = NULL;
+
+  return 0;
+}
+
+//--------------------------------------------------------------------
+//--------------------------------------------------------------------
@@ -0,0 +1,99 @@
+#ifndef _AUX_INDEX_H
+#define _AUX_INDEX_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "bioformats/bam/bam_file.h"
+
+//--------------------------------------------------------------------
+// bam_indexer_t: builds the BAM index while a coordinate sorted file
+// is written, so no extra pass over the output is needed.
+//
+// Every record is written through bam_indexer_write, which takes the
+// BGZF virtual offsets before and after the record and bins it. Data
+// for a chromosome is streamed to the index file as soon as the next
+// chromosome starts, so memory only holds one chromosome.
+//
+// A BAI index (<bam>.bai) is built when every target fits the BAI
+// binning scheme (< 2^29 bp); otherwise a CSI index (<bam>.csi) with
+// enough levels for the longest target is built. If the records turn
+// out not to be sorted, indexing is dropped with a warning.
+//--------------------------------------------------------------------
+
+#define BAM_INDEX_MIN_SHIFT  14
+#define BAM_INDEX_BAI_LEVELS 5
+
+//--------------------------------------------------------------------
+
+typedef struct bam_index_chunk {
+  uint64_t beg;
+  uint64_t end;
+} bam_index_chunk_t;
+
+typedef struct bam_index_bin {
+  uint32_t bin;
+  int num_chunks;
+  int max_chunks;
+  bam_index_chunk_t *chunks;
+} bam_index_bin_t;
+
+typedef struct bam_indexer {
+  int is_csi;
+  int min_shift;
+  int num_levels;
+  int num_targets;
+
+  BGZF *fp;
+  FILE *idx_file;
+  char *idx_filename;
+  int failed;
+
+  // current chromosome
+  int tid;
+  int last_pos;
+
+  int num_bins;
+  int max_bins;
+  bam_index_bin_t *bins;
+  int32_t *bin_slots;
+
+  size_t num_linear;
+  size_t max_linear;
+  uint64_t *linear;
+
+  // current chunk
+  uint32_t chunk_bin;
+  uint64_t chunk_beg;
+  uint64_t chunk_end;
+
+  // metadata pseudo-bin
+  uint64_t ref_beg;
+  uint64_t ref_end;
+  uint64_t num_mapped;
+  uint64_t num_unmapped;
+
+  uint64_t num_no_coor;
+} bam_indexer_t;
+
+//--------------------------------------------------------------------
+
+// fp is the BGZF stream the records are written to, the BAM header
+// must be already written
+bam_indexer_t *bam_indexer_new(const char *bam_filename, const bam_header_t *header, BGZF *fp);
+
+// writes bam1 to the BAM stream and indexes it
+void bam_indexer_write(const bam1_t *bam1, bam_indexer_t *indexer);
+
+// completes and closes the index file, call it after closing the BAM
+// file so the index is newer than the BAM. Returns 0 if the index was
+// created
+int bam_indexer_finish(bam_indexer_t *indexer);
+
+void bam_indexer_free(bam_indexer_t *indexer);
+
+//--------------------------------------------------------------------
+//--------------------------------------------------------------------
+
+#endif // _AUX_INDEX_H
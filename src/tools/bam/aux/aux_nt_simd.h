@@ -0,0 +1,459 @@
+/*
+ * aux_nt_simd.h
+ *
+ * Nucleotide sequence kernels shared by the DNA and RNA mappers and
+ * hpg-bam: reverse-complement, 2-bit and BAM 4-bit encodings and k-mer
+ * values. Self-contained (no hpg-bam headers), so any module can
+ * include it.
+ *
+ * Bases are translated 16 or 32 at a time with pshufb lookups on the
+ * low nibble of every byte, checked against the expected base to reject
+ * the other characters (A, C, G and T have distinct low nibbles). The
+ * scalar tails give the same results.
+ */
+
+#ifndef AUX_NT_SIMD_H_
+#define AUX_NT_SIMD_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#if defined(__SSSE3__) || defined(__AVX2__)
+#include <x86intrin.h>
+#endif
+
+/***************************
+ * SEQUENCE KERNELS
+ **************************/
+
+/**
+ * Reverse-complementary of a sequence. Lower case bases are complemented
+ * to upper case, anything but ACGT is an N.
+ * \param[in] seq Input sequence.
+ * \param[in] len Length of the sequence.
+ * \param[out] out Output, len characters (not terminated), it must not overlap seq.
+ */
+static inline void simd_nt_revcomp(const char *seq, size_t len, char *out);
+
+/**
+ * Reverse-complementary of a sequence, in place.
+ */
+static inline void simd_nt_revcomp_inplace(char *seq, size_t len);
+
+/**
+ * 2-bit codes of a sequence, one per byte (A and N 0, C 1, G 2, T 3, as
+ * the SA index prefix table; anything else 0).
+ */
+static inline void simd_nt_encode(const char *seq, size_t len, uint8_t *codes);
+
+/**
+ * Sequence packed in 2 bits per base, 4 per byte, first base in the high bits.
+ * \param[out] packed (len + 3) / 4 bytes.
+ */
+static inline void simd_nt_pack(const char *seq, size_t len, uint8_t *packed);
+
+/**
+ * Packed 2-bit sequence back to ACGT characters (not terminated).
+ */
+static inline void simd_nt_unpack(const uint8_t *packed, size_t len, char *seq);
+
+/**
+ * Values of the k-mers (k <= 32) starting at every position of a
+ * sequence, as compute_prefix_value: 2 bits per base, first base in the
+ * high bits. The codes are computed by blocks and rolled into the values.
+ * \param[out] values len - k + 1 values.
+ * \return Number of values, 0 if the sequence is shorter than k.
+ */
+static inline size_t simd_nt_kmers(const char *seq, size_t len, int k, size_t *values);
+
+/**
+ * Sequence packed in BAM 4-bit codes, two per byte, first base in the
+ * high nibble. Anything but ACGT (any case) is an N (15).
+ * \param[out] bam_seq (len + 1) / 2 bytes.
+ */
+static inline void simd_bam_pack(const char *seq, size_t len, uint8_t *bam_seq);
+
+/**
+ * BAM 4-bit sequence to characters, ambiguous bases to N (not terminated).
+ */
+static inline void simd_bam_unpack(const uint8_t *bam_seq, size_t len, char *seq);
+
+/**
+ * INLINE DEFINITIONS
+ */
+
+//Scalar translations
+static inline char
+simd_nt_comp(char nt)
+{
+	switch(nt)
+	{
+	case 'A': case 'a': return 'T';
+	case 'C': case 'c': return 'G';
+	case 'G': case 'g': return 'C';
+	case 'T': case 't': return 'A';
+	default: return 'N';
+	}
+}
+
+static inline uint8_t
+simd_nt_code(char nt)
+{
+	switch(nt)
+	{
+	case 'C': return 1;
+	case 'G': return 2;
+	case 'T': return 3;
+	default: return 0;
+	}
+}
+
+static inline uint8_t
+simd_bam_code(char nt)
+{
+	switch(nt)
+	{
+	case 'A': case 'a': return 1;
+	case 'C': case 'c': return 2;
+	case 'G': case 'g': return 4;
+	case 'T': case 't': return 8;
+	default: return 15;
+	}
+}
+
+static const char simd_nt_chars[4] = { 'A', 'C', 'G', 'T' };
+static const char simd_bam_chars[16] = { 'N', 'A', 'C', 'N', 'G', 'N', 'N', 'N', 'T', 'N', 'N', 'N', 'N', 'N', 'N', 'N' };
+
+#ifdef __SSSE3__
+//Lookup tables on the low nibble: the base with that nibble (0 for none) and its translation
+#define SIMD_NT_BASES	_mm_setr_epi8(0, 'A', 0, 'C', 'T', 0, 0, 'G', 0, 0, 0, 0, 0, 0, 0, 0)
+#define SIMD_NT_COMPS	_mm_setr_epi8('N', 'T', 'N', 'G', 'A', 'N', 'N', 'C', 'N', 'N', 'N', 'N', 'N', 'N', 'N', 'N')
+#define SIMD_NT_CODES	_mm_setr_epi8(0, 0, 0, 1, 3, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0)
+#define SIMD_BAM_CODES	_mm_setr_epi8(15, 1, 15, 2, 8, 15, 15, 4, 15, 15, 15, 15, 15, 15, 15, 15)
+#define SIMD_BAM_CHARS	_mm_setr_epi8('N', 'A', 'C', 'N', 'G', 'N', 'N', 'N', 'T', 'N', 'N', 'N', 'N', 'N', 'N', 'N')
+#define SIMD_REVERSE	_mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+
+//Translation of 16 bases through a nibble table, the rest to other
+static inline __m128i
+simd_nt_translate_16(__m128i v_seq, __m128i v_table, __m128i v_other)
+{
+	const __m128i v_nibble = _mm_set1_epi8(0x0F);
+	__m128i v_idx = _mm_and_si128(v_seq, v_nibble);
+	__m128i v_valid = _mm_cmpeq_epi8(v_seq, _mm_shuffle_epi8(SIMD_NT_BASES, v_idx));
+	return _mm_or_si128(_mm_and_si128(v_valid, _mm_shuffle_epi8(v_table, v_idx)),
+			_mm_andnot_si128(v_valid, v_other));
+}
+
+//Reverse-complementary of 16 bases (upper case first)
+static inline __m128i
+simd_nt_revcomp_16(__m128i v_seq)
+{
+	v_seq = _mm_and_si128(v_seq, _mm_set1_epi8((char)0xDF));
+	return _mm_shuffle_epi8(simd_nt_translate_16(v_seq, SIMD_NT_COMPS, _mm_set1_epi8('N')), SIMD_REVERSE);
+}
+#endif	//End SSSE3 if
+
+#ifdef __AVX2__
+//Reverse-complementary of 32 bases, as simd_nt_revcomp_16 on both lanes, then swapped
+static inline __m256i
+simd_nt_revcomp_32(__m256i v_seq)
+{
+	const __m256i v_nibble = _mm256_set1_epi8(0x0F);
+	const __m256i v_bases = _mm256_broadcastsi128_si256(SIMD_NT_BASES);
+	const __m256i v_comps = _mm256_broadcastsi128_si256(SIMD_NT_COMPS);
+	const __m256i v_reverse = _mm256_broadcastsi128_si256(SIMD_REVERSE);
+
+	v_seq = _mm256_and_si256(v_seq, _mm256_set1_epi8((char)0xDF));
+	__m256i v_idx = _mm256_and_si256(v_seq, v_nibble);
+	__m256i v_valid = _mm256_cmpeq_epi8(v_seq, _mm256_shuffle_epi8(v_bases, v_idx));
+	__m256i v_comp = _mm256_or_si256(_mm256_and_si256(v_valid, _mm256_shuffle_epi8(v_comps, v_idx)),
+			_mm256_andnot_si256(v_valid, _mm256_set1_epi8('N')));
+	v_comp = _mm256_shuffle_epi8(v_comp, v_reverse);
+	return _mm256_permute2x128_si256(v_comp, v_comp, 0x01);
+}
+#endif	//End AVX2 if
+
+/**
+ * Reverse-complementary of a sequence.
+ */
+static inline void
+simd_nt_revcomp(const char *seq, size_t len, char *out)
+{
+	size_t i = 0;
+
+#ifdef __AVX2__	 //AVX2 block
+	for(; i + 32 <= len; i += 32)
+	{
+		_mm256_storeu_si256((__m256i *)(out + i),
+				simd_nt_revcomp_32(_mm256_loadu_si256((__m256i const *)(seq + len - i - 32))));
+	}
+#endif	//End AVX2 if
+
+#ifdef __SSSE3__	 //SSSE3 block
+	for(; i + 16 <= len; i += 16)
+	{
+		_mm_storeu_si128((__m128i *)(out + i),
+				simd_nt_revcomp_16(_mm_loadu_si128((__m128i const *)(seq + len - i - 16))));
+	}
+#endif	//End SSSE3 if
+
+	//Remaining nucleotides
+	for(; i < len; i++)
+	{
+		out[i] = simd_nt_comp(seq[len - 1 - i]);
+	}
+}
+
+/**
+ * Reverse-complementary of a sequence, in place: blocks from both ends
+ * are swapped.
+ */
+static inline void
+simd_nt_revcomp_inplace(char *seq, size_t len)
+{
+	size_t i = 0, j = len;
+	char nt;
+
+#ifdef __AVX2__	 //AVX2 block
+	for(; i + 64 <= j; i += 32, j -= 32)
+	{
+		__m256i v_head = _mm256_loadu_si256((__m256i const *)(seq + i));
+		__m256i v_tail = _mm256_loadu_si256((__m256i const *)(seq + j - 32));
+		_mm256_storeu_si256((__m256i *)(seq + i), simd_nt_revcomp_32(v_tail));
+		_mm256_storeu_si256((__m256i *)(seq + j - 32), simd_nt_revcomp_32(v_head));
+	}
+#endif	//End AVX2 if
+
+#ifdef __SSSE3__	 //SSSE3 block
+	for(; i + 32 <= j; i += 16, j -= 16)
+	{
+		__m128i v_head = _mm_loadu_si128((__m128i const *)(seq + i));
+		__m128i v_tail = _mm_loadu_si128((__m128i const *)(seq + j - 16));
+		_mm_storeu_si128((__m128i *)(seq + i), simd_nt_revcomp_16(v_tail));
+		_mm_storeu_si128((__m128i *)(seq + j - 16), simd_nt_revcomp_16(v_head));
+	}
+#endif	//End SSSE3 if
+
+	//Remaining nucleotides, in the middle
+	for(; i + 1 < j; i++, j--)
+	{
+		nt = seq[i];
+		seq[i] = simd_nt_comp(seq[j - 1]);
+		seq[j - 1] = simd_nt_comp(nt);
+	}
+	if(i + 1 == j)
+	{
+		seq[i] = simd_nt_comp(seq[i]);
+	}
+}
+
+/**
+ * 2-bit codes of a sequence, one per byte.
+ */
+static inline void
+simd_nt_encode(const char *seq, size_t len, uint8_t *codes)
+{
+	size_t i = 0;
+
+#ifdef __SSSE3__	 //SSSE3 block
+	{
+		const __m128i v_zero = _mm_setzero_si128();
+		for(; i + 16 <= len; i += 16)
+		{
+			_mm_storeu_si128((__m128i *)(codes + i),
+					simd_nt_translate_16(_mm_loadu_si128((__m128i const *)(seq + i)), SIMD_NT_CODES, v_zero));
+		}
+	}
+#endif	//End SSSE3 if
+
+	//Remaining nucleotides
+	for(; i < len; i++)
+	{
+		codes[i] = simd_nt_code(seq[i]);
+	}
+}
+
+/**
+ * Sequence packed in 2 bits per base.
+ */
+static inline void
+simd_nt_pack(const char *seq, size_t len, uint8_t *packed)
+{
+	size_t i = 0;
+
+#ifdef __SSSE3__	 //SSSE3 block
+	{
+		const __m128i v_zero = _mm_setzero_si128();
+		//Weights of the 4 bases of a byte, then the low byte of every 32 bits
+		const __m128i v_weights = _mm_set1_epi32(0x01041040);
+		const __m128i v_one = _mm_set1_epi16(1);
+		const __m128i v_gather = _mm_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+		__m128i v_codes;
+		uint32_t bytes;
+
+		for(; i + 16 <= len; i += 16)
+		{
+			v_codes = simd_nt_translate_16(_mm_loadu_si128((__m128i const *)(seq + i)), SIMD_NT_CODES, v_zero);
+			v_codes = _mm_madd_epi16(_mm_maddubs_epi16(v_codes, v_weights), v_one);
+			bytes = (uint32_t)_mm_cvtsi128_si32(_mm_shuffle_epi8(v_codes, v_gather));
+			memcpy(packed + i / 4, &bytes, 4);
+		}
+	}
+#endif	//End SSSE3 if
+
+	//Remaining nucleotides
+	for(; i < len; i++)
+	{
+		if(i % 4 == 0)
+		{
+			packed[i / 4] = 0;
+		}
+		packed[i / 4] |= simd_nt_code(seq[i]) << (6 - 2 * (i % 4));
+	}
+}
+
+/**
+ * Packed 2-bit sequence back to characters.
+ */
+static inline void
+simd_nt_unpack(const uint8_t *packed, size_t len, char *seq)
+{
+	size_t i = 0;
+
+#ifdef __SSSE3__	 //SSSE3 block
+	{
+		//Every byte 4 times, the high nibble for the first 2 bases
+		const __m128i v_spread = _mm_setr_epi8(0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3);
+		const __m128i v_low = _mm_set1_epi32((int)0xFFFF0000);
+		const __m128i v_nibble = _mm_set1_epi8(0x0F);
+		const __m128i v_second = _mm_set1_epi32((int)0xFF00FF00);
+		//First and second base of a nibble
+		const __m128i v_first_chars = _mm_setr_epi8('A', 'A', 'A', 'A', 'C', 'C', 'C', 'C', 'G', 'G', 'G', 'G', 'T', 'T', 'T', 'T');
+		const __m128i v_second_chars = _mm_setr_epi8('A', 'C', 'G', 'T', 'A', 'C', 'G', 'T', 'A', 'C', 'G', 'T', 'A', 'C', 'G', 'T');
+		__m128i v_bytes, v_idx;
+		uint32_t bytes;
+
+		for(; i + 16 <= len; i += 16)
+		{
+			memcpy(&bytes, packed + i / 4, 4);
+			v_bytes = _mm_shuffle_epi8(_mm_cvtsi32_si128((int)bytes), v_spread);
+			v_idx = _mm_or_si128(_mm_andnot_si128(v_low, _mm_srli_epi16(v_bytes, 4)), _mm_and_si128(v_low, v_bytes));
+			v_idx = _mm_and_si128(v_idx, v_nibble);
+			_mm_storeu_si128((__m128i *)(seq + i),
+					_mm_or_si128(_mm_andnot_si128(v_second, _mm_shuffle_epi8(v_first_chars, v_idx)),
+							_mm_and_si128(v_second, _mm_shuffle_epi8(v_second_chars, v_idx))));
+		}
+	}
+#endif	//End SSSE3 if
+
+	//Remaining nucleotides
+	for(; i < len; i++)
+	{
+		seq[i] = simd_nt_chars[(packed[i / 4] >> (6 - 2 * (i % 4))) & 3];
+	}
+}
+
+/**
+ * Values of the k-mers at every position of a sequence.
+ */
+static inline size_t
+simd_nt_kmers(const char *seq, size_t len, int k, size_t *values)
+{
+	uint8_t codes[256];
+	size_t value = 0, mask, block, i, j;
+
+	if(k <= 0 || len < (size_t)k)
+	{
+		return 0;
+	}
+	mask = (k >= 32 ? (size_t)-1 : ((size_t)1 << (2 * k)) - 1);
+
+	for(i = 0; i < len; i += block)
+	{
+		block = (len - i < sizeof(codes) ? len - i : sizeof(codes));
+		simd_nt_encode(seq + i, block, codes);
+		for(j = 0; j < block; j++)
+		{
+			value = ((value << 2) | codes[j]) & mask;
+			if(i + j + 1 >= (size_t)k)
+			{
+				values[i + j + 1 - k] = value;
+			}
+		}
+	}
+
+	return len - k + 1;
+}
+
+/**
+ * Sequence packed in BAM 4-bit codes.
+ */
+static inline void
+simd_bam_pack(const char *seq, size_t len, uint8_t *bam_seq)
+{
+	size_t i = 0;
+
+#ifdef __SSSE3__	 //SSSE3 block
+	{
+		const __m128i v_upper = _mm_set1_epi8((char)0xDF);
+		const __m128i v_other = _mm_set1_epi8(15);
+		const __m128i v_weights = _mm_set1_epi16(0x0110);
+		__m128i v_codes;
+
+		for(; i + 16 <= len; i += 16)
+		{
+			v_codes = _mm_and_si128(_mm_loadu_si128((__m128i const *)(seq + i)), v_upper);
+			v_codes = simd_nt_translate_16(v_codes, SIMD_BAM_CODES, v_other);
+			v_codes = _mm_maddubs_epi16(v_codes, v_weights);
+			_mm_storel_epi64((__m128i *)(bam_seq + i / 2), _mm_packus_epi16(v_codes, v_codes));
+		}
+	}
+#endif	//End SSSE3 if
+
+	//Remaining nucleotides
+	for(; i < len; i++)
+	{
+		if(i % 2 == 0)
+		{
+			bam_seq[i / 2] = simd_bam_code(seq[i]) << 4;
+		}
+		else
+		{
+			bam_seq[i / 2] |= simd_bam_code(seq[i]);
+		}
+	}
+}
+
+/**
+ * BAM 4-bit sequence to characters.
+ */
+static inline void
+simd_bam_unpack(const uint8_t *bam_seq, size_t len, char *seq)
+{
+	size_t i = 0;
+
+#ifdef __SSSE3__	 //SSSE3 block
+	{
+		const __m128i v_nibble = _mm_set1_epi8(0x0F);
+		__m128i v_bytes, v_high, v_low;
+
+		for(; i + 32 <= len; i += 32)
+		{
+			v_bytes = _mm_loadu_si128((__m128i const *)(bam_seq + i / 2));
+			v_high = _mm_shuffle_epi8(SIMD_BAM_CHARS, _mm_and_si128(_mm_srli_epi16(v_bytes, 4), v_nibble));
+			v_low = _mm_shuffle_epi8(SIMD_BAM_CHARS, _mm_and_si128(v_bytes, v_nibble));
+			_mm_storeu_si128((__m128i *)(seq + i), _mm_unpacklo_epi8(v_high, v_low));
+			_mm_storeu_si128((__m128i *)(seq + i + 16), _mm_unpackhi_epi8(v_high, v_low));
+		}
+	}
+#endif	//End SSSE3 if
+
+	//Remaining nucleotides
+	for(; i < len; i++)
+	{
+		seq[i] = simd_bam_chars[(bam_seq[i / 2] >> ((~i & 1) << 2)) & 0x0F];
+	}
+}
+
+#endif /* AUX_NT_SIMD_H_ */
@@ -0,0 +1,254 @@
+#include "aux_profiler.h"
+
+#include <string.h>
+
+#include "commons/log.h"
+
+//--------------------------------------------------------------------
+// scope names and parents (-1 for the stages), a parent is always
+// declared before its scopes
+//--------------------------------------------------------------------
+
+typedef struct profiler_scope_info {
+  const char *name;
+  int parent;
+} profiler_scope_info_t;
+
+static const profiler_scope_info_t profiler_scopes[NUM_PROFILER_SCOPES] = {
+  [PROF_READER]                   = { "reader",                    -1 },
+  [PROF_ADAPTERS]                 = { "adapters",                  -1 },
+  [PROF_SEEDING]                  = { "seeding",                   -1 },
+  [PROF_CAL]                      = { "cal",                       -1 },
+  [PROF_SW]                       = { "sw",                        -1 },
+  [PROF_PAIRING]                  = { "pairing",                   -1 },
+  [PROF_MAPPING]                  = { "mapping",                   -1 },
+  [PROF_FILTERING]                = { "filtering",                 -1 },
+  [PROF_STATISTICS]               = { "statistics",                -1 },
+  [PROF_FORMATTING]               = { "formatting",                -1 },
+  [PROF_COMPRESSION]              = { "compression",               -1 },
+  [PROF_WRITER]                   = { "writer",                    -1 },
+  [PROF_OTHER]                    = { "other",                     -1 },
+  [PROF_RNA_LAST]                 = { "rna_last",                  -1 },
+
+  [PROF_SEARCH_SUFFIX]            = { "search_suffix",             PROF_SEEDING },
+  [PROF_SEARCH_PREFIX]            = { "search_prefix",             PROF_SEARCH_SUFFIX },
+  [PROF_SEARCH_SA]                = { "search_sa",                 PROF_SEARCH_SUFFIX },
+  [PROF_CALS_FROM_EXACT_READ]     = { "cals_from_exact_read",      PROF_CAL },
+  [PROF_CALS_FROM_SUFFIXES]       = { "cals_from_suffixes",        PROF_CAL },
+  [PROF_INIT_CALS_FROM_SUFFIXES]  = { "init_cals_from_suffixes",   PROF_CALS_FROM_SUFFIXES },
+  [PROF_SET_POSITIONS]            = { "set_positions",             PROF_CALS_FROM_SUFFIXES },
+  [PROF_SET_REF_SEQUENCE]         = { "set_reference_sequence",    PROF_CALS_FROM_SUFFIXES },
+  [PROF_SKIP_SUFFIXES]            = { "skip_suffixes",             PROF_CALS_FROM_SUFFIXES },
+  [PROF_MINI_SW_RIGHT_SIDE]       = { "mini_sw_right_side",        PROF_CALS_FROM_SUFFIXES },
+  [PROF_MINI_SW_LEFT_SIDE]        = { "mini_sw_left_side",         PROF_CALS_FROM_SUFFIXES },
+  [PROF_CAL_MNG_INSERT]           = { "cal_mng_insert",            PROF_CALS_FROM_SUFFIXES },
+  [PROF_CAL_MNG_TO_LIST]          = { "cal_mng_to_array_list",     PROF_CAL },
+  [PROF_FILTER_BY_READ_AREA]      = { "filter_by_read_area",       PROF_CAL },
+  [PROF_FILTER_BY_NUM_MISMATCHES] = { "filter_by_num_mismatches",  PROF_CAL },
+  [PROF_PRE_SW]                   = { "sw_pre_processing",         PROF_SW },
+  [PROF_SW_EXECUTION]             = { "sw_execution",              PROF_SW },
+  [PROF_POST_SW]                  = { "sw_post_processing",        PROF_SW },
+  [PROF_CREATE_ALIGNMENTS]        = { "create_alignments",         PROF_FORMATTING },
+  [PROF_CONVERT_TO_BAM]           = { "convert_to_bam",            PROF_FORMATTING },
+
+  [PROF_BWT]                      = { "bwt",                       PROF_SEEDING },
+};
+
+//--------------------------------------------------------------------
+
+int profiler_enabled = 0;
+uint32_t profiler_rate = PROFILER_DEFAULT_RATE;
+__thread profiler_slot_t *profiler_local = NULL;
+
+static profiler_slot_t profiler_slots[PROFILER_MAX_THREADS];
+static int profiler_num_slots = 0;
+
+static char profiler_name[256] = "hpg";
+static char *profiler_filename = NULL;
+
+// TSC and wall clock when enabled, to convert ticks to microseconds
+static uint64_t profiler_start_ticks;
+static struct timespec profiler_start_time;
+
+//--------------------------------------------------------------------
+
+profiler_slot_t *profiler_slot() {
+  int slot = __sync_fetch_and_add(&profiler_num_slots, 1);
+  if (slot >= PROFILER_MAX_THREADS - 1) {
+    // calls are still counted, never timed
+    slot = PROFILER_MAX_THREADS - 1;
+    profiler_slots[slot].shared = 1;
+  } else {
+    profiler_slots[slot].seed = (slot + 1) * 2654435761u;
+    profiler_slots[slot].countdown = 1 + profiler_slots[slot].seed % profiler_rate;
+  }
+  profiler_local = &profiler_slots[slot];
+  return profiler_local;
+}
+
+//--------------------------------------------------------------------
+
+void profiler_init(const char *name) {
+  if (name) {
+    const char *base = strrchr(name, '/');
+    snprintf(profiler_name, sizeof(profiler_name), "%s", base ? base + 1 : name);
+  }
+
+  char *filename = getenv("HPG_PROFILE");
+  if (filename && *filename) {
+    char *rate = getenv("HPG_PROFILE_RATE");
+    profiler_enable(filename, rate ? atoi(rate) : PROFILER_DEFAULT_RATE);
+  }
+}
+
+//--------------------------------------------------------------------
+
+void profiler_enable(const char *filename, uint32_t rate) {
+  if (profiler_enabled) return;
+
+  profiler_filename = filename ? strdup(filename) : NULL;
+  profiler_rate = rate < 1 ? 1 : rate;
+
+  clock_gettime(CLOCK_MONOTONIC, &profiler_start_time);
+  profiler_start_ticks = profiler_ticks();
+
+  __sync_synchronize();
+  profiler_enabled = 1;
+
+  // the stages end in different places for every command
+  if (profiler_filename) {
+    atexit(profiler_dump);
+  }
+}
+
+//--------------------------------------------------------------------
+
+// estimated ticks per scope, nested scopes included; a scope that is
+// never timed is the sum of its scopes
+static void profiler_totals(double *totals, double *nested) {
+  for (int s = 0; s < NUM_PROFILER_SCOPES; s++) {
+    totals[s] = nested[s] = 0;
+  }
+
+  for (int s = NUM_PROFILER_SCOPES - 1; s >= 0; s--) {
+    uint64_t calls = 0, sampled = 0, ticks = 0;
+    for (int i = 0; i < PROFILER_MAX_THREADS; i++) {
+      calls += profiler_slots[i].calls[s];
+      sampled += profiler_slots[i].sampled[s];
+      ticks += profiler_slots[i].ticks[s];
+    }
+
+    if (calls) {
+      totals[s] = sampled ? (double) ticks * calls / sampled : 0;
+    } else {
+      totals[s] = nested[s];
+    }
+    if (profiler_scopes[s].parent >= 0) {
+      nested[profiler_scopes[s].parent] += totals[s];
+    }
+  }
+}
+
+//--------------------------------------------------------------------
+
+static double profiler_ticks_per_usec() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  uint64_t ticks = profiler_ticks() - profiler_start_ticks;
+
+  double usecs = (now.tv_sec - profiler_start_time.tv_sec) * 1e6 +
+    (now.tv_nsec - profiler_start_time.tv_nsec) / 1e3;
+  return usecs > 0 ? ticks / usecs : 1;
+}
+
+//--------------------------------------------------------------------
+
+double profiler_get_time(profiler_scope_t scope) {
+  double totals[NUM_PROFILER_SCOPES], nested[NUM_PROFILER_SCOPES];
+  profiler_totals(totals, nested);
+  return totals[scope] / profiler_ticks_per_usec() / 1e6;
+}
+
+void profiler_get_times(double *times) {
+  double nested[NUM_PROFILER_SCOPES];
+  profiler_totals(times, nested);
+
+  double ticks_per_sec = profiler_ticks_per_usec() * 1e6;
+  for (int s = 0; s < NUM_PROFILER_SCOPES; s++) {
+    times[s] /= ticks_per_sec;
+  }
+}
+
+//--------------------------------------------------------------------
+
+const char *profiler_scope_name(profiler_scope_t scope) {
+  return profiler_scopes[scope].name;
+}
+
+int profiler_scope_parent(profiler_scope_t scope) {
+  return profiler_scopes[scope].parent;
+}
+
+//--------------------------------------------------------------------
+
+static void profiler_write_stack(int scope, FILE *f) {
+  if (profiler_scopes[scope].parent >= 0) {
+    profiler_write_stack(profiler_scopes[scope].parent, f);
+  } else {
+    fprintf(f, "%s", profiler_name);
+  }
+  fprintf(f, ";%s", profiler_scopes[scope].name);
+}
+
+static void profiler_display(int parent, int depth, double *totals, double sum,
+			     double ticks_per_sec) {
+  for (int s = 0; s < NUM_PROFILER_SCOPES; s++) {
+    if (profiler_scopes[s].parent != parent || totals[s] <= 0) continue;
+    fprintf(stderr, "\t%*s%6.2f %%\t%10.4f\t%s\n", 2 * depth, "", 100.0 * totals[s] / sum,
+	   totals[s] / ticks_per_sec, profiler_scopes[s].name);
+    profiler_display(s, depth + 1, totals, sum, ticks_per_sec);
+  }
+}
+
+//--------------------------------------------------------------------
+
+void profiler_dump() {
+  if (!profiler_enabled || !profiler_filename) return;
+  profiler_enabled = 0;
+
+  double ticks_per_usec = profiler_ticks_per_usec();
+  double totals[NUM_PROFILER_SCOPES], nested[NUM_PROFILER_SCOPES];
+  profiler_totals(totals, nested);
+
+  FILE *f = fopen(profiler_filename, "w");
+  if (!f) {
+    LOG_WARN_F("Could not create the profile file %s\n", profiler_filename);
+    return;
+  }
+
+  // self time, in microseconds
+  double sum = 0;
+  for (int s = 0; s < NUM_PROFILER_SCOPES; s++) {
+    if (profiler_scopes[s].parent < 0) sum += totals[s];
+
+    long usecs = (long) ((totals[s] - nested[s]) / ticks_per_usec);
+    if (usecs > 0) {
+      profiler_write_stack(s, f);
+      fprintf(f, " %li\n", usecs);
+    }
+  }
+  fclose(f);
+
+  if (sum > 0) {
+    fprintf(stderr, "Profile in seconds, threads added up (stages timed on every call, "
+	    "nested scopes on 1/%u calls):\n", profiler_rate);
+    profiler_display(-1, 0, totals, sum, ticks_per_usec * 1e6);
+  }
+  fprintf(stderr, "Profile written to %s\n", profiler_filename);
+
+  free(profiler_filename);
+  profiler_filename = NULL;
+}
+
+//--------------------------------------------------------------------
+//--------------------------------------------------------------------
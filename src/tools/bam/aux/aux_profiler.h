@@ -0,0 +1,185 @@
+#ifndef _AUX_PROFILER_H
+#define _AUX_PROFILER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+//--------------------------------------------------------------------
+// Stage profiler, switched on at run time by setting HPG_PROFILE to
+// the output file (and optionally HPG_PROFILE_RATE, one timed call of
+// the nested scopes out of that many on average, 64 by default; 1
+// times every call):
+//
+//   HPG_PROFILE=prof.folded hpg-aligner dna ...
+//   flamegraph.pl prof.folded > prof.svg
+//
+// The output is in the folded-stack format of the flame graph tools,
+// one line per scope with its self time in microseconds.
+//
+// A scope is timed with the TSC between profiler_start and
+// profiler_stop. Every thread counts in its own cache-line aligned
+// slot, as thread_stats. Pipeline stages (once per batch) are timed on
+// every call; for the scopes nested in them (once per read or suffix)
+// only a random sample of the calls reads the clock, and their totals
+// are estimated from the number of calls. When the profiler is off
+// both calls are a single predictable branch.
+//
+// Scopes nest statically, as declared in aux_profiler.c: a stage
+// that is never timed itself (e.g. the DNA seeding, CAL and SW
+// stages, interleaved read by read) is the sum of its scopes. A scope
+// timed in a program must enclose the scopes nested in it that the
+// program times, and top-level stages should not overlap; a scope
+// called from elsewhere (e.g. suffix searches from the RNA mapper) is
+// still reported in its place, and counted twice.
+//--------------------------------------------------------------------
+
+#define PROFILER_MAX_THREADS    256
+#define PROFILER_CACHE_LINE     64
+#define PROFILER_DEFAULT_RATE   64
+
+//--------------------------------------------------------------------
+
+typedef enum profiler_scope {
+  // pipeline stages
+  PROF_READER = 0,
+  PROF_ADAPTERS,
+  PROF_SEEDING,
+  PROF_CAL,
+  PROF_SW,
+  PROF_PAIRING,
+  PROF_MAPPING,
+  PROF_FILTERING,
+  PROF_STATISTICS,
+  PROF_FORMATTING,
+  PROF_COMPRESSION,
+  PROF_WRITER,
+  PROF_OTHER,
+  PROF_RNA_LAST,
+
+  // DNA, suffix array mapper
+  PROF_SEARCH_SUFFIX,
+  PROF_SEARCH_PREFIX,
+  PROF_SEARCH_SA,
+  PROF_CALS_FROM_EXACT_READ,
+  PROF_CALS_FROM_SUFFIXES,
+  PROF_INIT_CALS_FROM_SUFFIXES,
+  PROF_SET_POSITIONS,
+  PROF_SET_REF_SEQUENCE,
+  PROF_SKIP_SUFFIXES,
+  PROF_MINI_SW_RIGHT_SIDE,
+  PROF_MINI_SW_LEFT_SIDE,
+  PROF_CAL_MNG_INSERT,
+  PROF_CAL_MNG_TO_LIST,
+  PROF_FILTER_BY_READ_AREA,
+  PROF_FILTER_BY_NUM_MISMATCHES,
+  PROF_PRE_SW,
+  PROF_SW_EXECUTION,
+  PROF_POST_SW,
+  PROF_CREATE_ALIGNMENTS,
+
+  // DNA and RNA writers
+  PROF_CONVERT_TO_BAM,
+
+  // RNA, BWT mapper
+  PROF_BWT,
+
+  NUM_PROFILER_SCOPES
+} profiler_scope_t;
+
+//--------------------------------------------------------------------
+
+typedef struct profiler_slot {
+  uint64_t calls[NUM_PROFILER_SCOPES];
+  uint64_t sampled[NUM_PROFILER_SCOPES];
+  uint64_t ticks[NUM_PROFILER_SCOPES];
+
+  // calls of the nested scopes left before the next timed one
+  uint32_t countdown;
+  uint32_t seed;
+  int shared;
+} __attribute__((aligned(PROFILER_CACHE_LINE))) profiler_slot_t;
+
+extern int profiler_enabled;
+extern uint32_t profiler_rate;
+extern __thread profiler_slot_t *profiler_local;
+
+profiler_slot_t *profiler_slot();
+
+//--------------------------------------------------------------------
+
+static inline uint64_t profiler_ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+  uint32_t lo, hi;
+  __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t) hi << 32) | lo;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+//--------------------------------------------------------------------
+
+// returns the start tick if this call is timed, 0 otherwise
+static inline uint64_t profiler_start(profiler_scope_t scope) {
+  if (__builtin_expect(!profiler_enabled, 1)) return 0;
+
+  profiler_slot_t *slot = profiler_local ? profiler_local : profiler_slot();
+  if (slot->shared) {
+    __sync_fetch_and_add(&slot->calls[scope], 1);
+    return 0;
+  }
+  slot->calls[scope]++;
+
+  // stages are few calls, all of them timed
+  if (scope <= PROF_RNA_LAST) return profiler_ticks();
+  if (--slot->countdown) return 0;
+
+  // next timed call uniformly in [1, 2 * rate - 1], xorshift
+  slot->seed ^= slot->seed << 13;
+  slot->seed ^= slot->seed >> 17;
+  slot->seed ^= slot->seed << 5;
+  slot->countdown = profiler_rate > 1 ? 1 + slot->seed % (2 * profiler_rate - 1) : 1;
+
+  return profiler_ticks();
+}
+
+static inline void profiler_stop(profiler_scope_t scope, uint64_t start) {
+  if (__builtin_expect(!start, 1)) return;
+
+  uint64_t ticks = profiler_ticks() - start;
+  profiler_slot_t *slot = profiler_local;
+  slot->sampled[scope]++;
+  slot->ticks[scope] += ticks;
+}
+
+//--------------------------------------------------------------------
+
+// reads HPG_PROFILE and HPG_PROFILE_RATE, name is the root of the stacks
+void profiler_init(const char *name);
+
+// enables the profiler, the folded stacks are written to filename;
+// with no filename the scopes are only counted (e.g., for the metrics)
+void profiler_enable(const char *filename, uint32_t rate);
+
+// writes the folded stacks, and a summary to stderr, if enabled
+void profiler_dump();
+
+// estimated time in seconds spent in the scope, nested scopes included
+double profiler_get_time(profiler_scope_t scope);
+
+// the same for every scope at once, times has NUM_PROFILER_SCOPES items
+void profiler_get_times(double *times);
+
+const char *profiler_scope_name(profiler_scope_t scope);
+
+// -1 for the pipeline stages
+int profiler_scope_parent(profiler_scope_t scope);
+
+//--------------------------------------------------------------------
+//--------------------------------------------------------------------
+
+#endif // _AUX_PROFILER_H
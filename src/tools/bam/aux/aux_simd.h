@@ -9,7 +9,110 @@
 #define AUX_SIMD_H_
 
 #include "aux_library.h"
+#include "x86intrin.h"
 
+/***************************
+ * SIMD KERNELS
+ **************************/
 
+/**
+ * Compare two sequences and obtain missmatches and missmatches qualities summatory.
+ * Unlike nucleotide_miss_qual_sum, works on unaligned input in place, without
+ * temporary buffers nor per nucleotide output, so it can be called for every
+ * candidate position of a read.
+ * \param[in] seq1 First sequence.
+ * \param[in] seq2 Second sequence.
+ * \param[in] qual Sequence qualities.
+ * \param[in] seq_l Length of input sequences.
+ * \param[out] out_miss_count Number of missmatches in comparation. Optional, set to NULL in case.
+ * \param[out] out_sum_quals Summatory of missmatch qualities.
+ */
+static inline void simd_miss_qual_sum(const char *seq1, const char *seq2, const char *qual, size_t seq_l, uint32_t *out_miss_count, uint32_t *out_sum_quals) __ATTR_HOT __ATTR_INLINE;
+
+/**
+ * INLINE DEFINITIONS
+ */
+
+/**
+ * Compare two sequences and obtain missmatches and missmatches qualities summatory.
+ */
+static inline void
+simd_miss_qual_sum(const char *seq1, const char *seq2, const char *qual, size_t seq_l, uint32_t *out_miss_count, uint32_t *out_sum_quals)
+{
+	size_t i = 0;
+	uint32_t misses = 0;
+	uint32_t sum = 0;
+
+	assert(seq1);
+	assert(seq2);
+	assert(qual);
+
+#ifdef __AVX2__	 //AVX2 block
+	{
+		const __m256i v_zero = _mm256_setzero_si256();
+		__m256i v_eq, v_sum = _mm256_setzero_si256();
+
+		for(; i + 32 <= seq_l; i += 32)
+		{
+			//0xFF Equals, 0x00 Diff
+			v_eq = _mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i const *)(seq1 + i)),
+					_mm256_loadu_si256((__m256i const *)(seq2 + i)));
+
+			//Keep only different qualities and accumulate in 64 bit partial sums
+			v_sum = _mm256_add_epi64(v_sum,
+					_mm256_sad_epu8(_mm256_andnot_si256(v_eq, _mm256_loadu_si256((__m256i const *)(qual + i))), v_zero));
+
+			misses += 32 - __builtin_popcount((uint32_t)_mm256_movemask_epi8(v_eq));
+		}
+
+		sum += _mm256_extract_epi64(v_sum, 0) + _mm256_extract_epi64(v_sum, 1)
+				+ _mm256_extract_epi64(v_sum, 2) + _mm256_extract_epi64(v_sum, 3);
+	}
+#endif	//End AVX2 if
+
+#ifdef __SSE2__	 //SSE2 block
+	{
+		const __m128i v_zero = _mm_setzero_si128();
+		__m128i v_eq, v_sum = _mm_setzero_si128();
+
+		for(; i + 16 <= seq_l; i += 16)
+		{
+			//0xFF Equals, 0x00 Diff
+			v_eq = _mm_cmpeq_epi8(_mm_loadu_si128((__m128i const *)(seq1 + i)),
+					_mm_loadu_si128((__m128i const *)(seq2 + i)));
+
+			//Keep only different qualities and accumulate in 64 bit partial sums
+			v_sum = _mm_add_epi64(v_sum,
+					_mm_sad_epu8(_mm_andnot_si128(v_eq, _mm_loadu_si128((__m128i const *)(qual + i))), v_zero));
+
+			misses += 16 - __builtin_popcount((uint32_t)_mm_movemask_epi8(v_eq));
+		}
+
+		sum += _mm_cvtsi128_si32(v_sum) + _mm_cvtsi128_si32(_mm_srli_si128(v_sum, 8));
+	}
+#endif	//End SSE if
+
+	//Remaining nucleotides
+	for(; i < seq_l; i++)
+	{
+		if(seq1[i] != seq2[i])
+		{
+			sum += (uint8_t)qual[i];
+			misses++;
+		}
+	}
+
+	//Set miss count
+	if(out_miss_count)
+	{
+		*out_miss_count = misses;
+	}
+
+	//Sum diff qualities
+	if(out_sum_quals)
+	{
+		*out_sum_quals = sum;
+	}
+}
 
 #endif /* AUX_SIMD_H_ */
@@ -0,0 +1,483 @@
+#include "aux_sort.h"
+#include "aux_index.h"
+
+#include <ctype.h>
+#include <string.h>
+#include <unistd.h>
+#include <omp.h>
+
+#include "commons/log.h"
+
+//--------------------------------------------------------------------
+// sort keys and comparators
+//--------------------------------------------------------------------
+
+static inline uint64_t bam_sorter_key(const bam1_t *b) {
+  // unmapped reads (tid = -1) become the largest tid
+  return ((uint64_t) (uint32_t) b->core.tid << 32) |
+    ((uint64_t) ((uint32_t) (b->core.pos + 1) << 1)) | (uint64_t) bam1_strand(b);
+}
+
+//--------------------------------------------------------------------
+
+// natural order for read names (same as samtools sort -n)
+static inline int bam_sorter_strnum_cmp(const char *_a, const char *_b) {
+  const unsigned char *a = (const unsigned char *) _a, *b = (const unsigned char *) _b;
+  const unsigned char *pa = a, *pb = b;
+  while (*pa && *pb) {
+    if (isdigit(*pa) && isdigit(*pb)) {
+      while (*pa == '0') ++pa;
+      while (*pb == '0') ++pb;
+      while (isdigit(*pa) && isdigit(*pb) && *pa == *pb) ++pa, ++pb;
+      if (isdigit(*pa) && isdigit(*pb)) {
+	int i = 0;
+	while (isdigit(pa[i]) && isdigit(pb[i])) ++i;
+	return isdigit(pa[i]) ? 1 : isdigit(pb[i]) ? -1 : (int) *pa - (int) *pb;
+      } else if (isdigit(*pa)) {
+	return 1;
+      } else if (isdigit(*pb)) {
+	return -1;
+      } else if (pa - a != pb - b) {
+	return pa - a < pb - b ? 1 : -1;
+      }
+    } else {
+      if (*pa != *pb) return (int) *pa - (int) *pb;
+      ++pa; ++pb;
+    }
+  }
+  return *pa ? 1 : *pb ? -1 : 0;
+}
+
+static inline int bam_sorter_qname_cmp(const bam1_t *b1, const bam1_t *b2) {
+  int t = bam_sorter_strnum_cmp(bam1_qname(b1), bam1_qname(b2));
+  if (t) return t;
+  // first mate before second mate
+  return (int) (b1->core.flag & 0xc0) - (int) (b2->core.flag & 0xc0);
+}
+
+static int bam_sorter_qsort_qname_cmp(const void *a, const void *b) {
+  return bam_sorter_qname_cmp(((const bam_sorter_item_t *) a)->bam1,
+			      ((const bam_sorter_item_t *) b)->bam1);
+}
+
+static inline int bam_sorter_cmp(const bam_sorter_item_t *i1, const bam_sorter_item_t *i2,
+				 int by_qname) {
+  if (by_qname) return bam_sorter_qname_cmp(i1->bam1, i2->bam1);
+  return i1->key < i2->key ? -1 : i1->key > i2->key;
+}
+
+//--------------------------------------------------------------------
+// stable LSD radix sort on 16-bit digits, digits shared by all the
+// keys (e.g., the tid of a slice from a single chromosome) are skipped
+//--------------------------------------------------------------------
+
+static void bam_sorter_radix_sort(bam_sorter_item_t *items, bam_sorter_item_t *tmp, size_t n) {
+  size_t *count = (size_t *) malloc(65536 * sizeof(size_t));
+  bam_sorter_item_t *src = items, *dst = tmp, *aux;
+  size_t sum, c;
+
+  for (int shift = 0; shift < 64; shift += 16) {
+    memset(count, 0, 65536 * sizeof(size_t));
+    for (size_t i = 0; i < n; i++) {
+      count[(src[i].key >> shift) & 0xFFFF]++;
+    }
+    if (count[(src[0].key >> shift) & 0xFFFF] == n) continue;
+
+    sum = 0;
+    for (int d = 0; d < 65536; d++) {
+      c = count[d];
+      count[d] = sum;
+      sum += c;
+    }
+    for (size_t i = 0; i < n; i++) {
+      dst[count[(src[i].key >> shift) & 0xFFFF]++] = src[i];
+    }
+    aux = src; src = dst; dst = aux;
+  }
+
+  if (src != items) {
+    memcpy(items, src, n * sizeof(bam_sorter_item_t));
+  }
+  free(count);
+}
+
+//--------------------------------------------------------------------
+
+bam_sorter_t *bam_sorter_new(bam_header_t *header, const char *prefix, int by_qname,
+			     size_t max_mem, int num_threads) {
+  bam_sorter_t *p = (bam_sorter_t *) calloc(1, sizeof(bam_sorter_t));
+
+  p->by_qname = by_qname;
+  p->num_threads = num_threads > 0 ? num_threads : omp_get_max_threads();
+  p->max_mem = max_mem ? max_mem : BAM_SORTER_DEFAULT_MEM;
+  p->max_items = 65536;
+  p->items = (bam_sorter_item_t *) malloc(p->max_items * sizeof(bam_sorter_item_t));
+  p->slices = (size_t *) calloc(p->num_threads + 1, sizeof(size_t));
+  p->prefix = strdup(prefix);
+  p->header = header;
+
+  return p;
+}
+
+//--------------------------------------------------------------------
+
+void bam_sorter_free(bam_sorter_t *sorter) {
+  if (sorter) {
+    for (size_t i = 0; i < sorter->num_items; i++) {
+      bam_destroy1(sorter->items[i].bam1);
+    }
+    if (sorter->items) free(sorter->items);
+    if (sorter->slices) free(sorter->slices);
+    if (sorter->run_levels) free(sorter->run_levels);
+    if (sorter->prefix) free(sorter->prefix);
+    free(sorter);
+  }
+}
+
+//--------------------------------------------------------------------
+// split the buffer in one slice per thread and sort them in parallel
+//--------------------------------------------------------------------
+
+static void bam_sorter_sort(bam_sorter_t *sorter) {
+  size_t num_items = sorter->num_items;
+  int num_slices = sorter->num_threads;
+
+  if (num_items / BAM_SORTER_MIN_SLICE < num_slices) {
+    num_slices = num_items / BAM_SORTER_MIN_SLICE;
+  }
+  if (num_slices < 1) num_slices = 1;
+
+  sorter->num_slices = num_slices;
+  for (int s = 0; s <= num_slices; s++) {
+    sorter->slices[s] = num_items * s / num_slices;
+  }
+  if (num_items < 2) return;
+
+  bam_sorter_item_t *tmp = NULL;
+  if (!sorter->by_qname) {
+    tmp = (bam_sorter_item_t *) malloc(num_items * sizeof(bam_sorter_item_t));
+  }
+
+  #pragma omp parallel for schedule(dynamic, 1) num_threads(sorter->num_threads)
+  for (int s = 0; s < num_slices; s++) {
+    size_t beg = sorter->slices[s], n = sorter->slices[s + 1] - beg;
+    if (n > 1) {
+      if (sorter->by_qname) {
+	qsort(&sorter->items[beg], n, sizeof(bam_sorter_item_t), bam_sorter_qsort_qname_cmp);
+      } else {
+	bam_sorter_radix_sort(&sorter->items[beg], &tmp[beg], n);
+      }
+    }
+  }
+
+  if (tmp) free(tmp);
+}
+
+//--------------------------------------------------------------------
+
+static inline void bam_sorter_run_filename(char *filename, int run, bam_sorter_t *sorter) {
+  sprintf(filename, "%s.%04i.bam", sorter->prefix, run);
+}
+
+static bam_file_t *bam_sorter_create(const char *filename, bam_header_t *header) {
+  bam_file_t *f = bam_fopen_mode((char *) filename, header, "w");
+  if (!f) {
+    LOG_FATAL_F("Could not create sort file %s\n", filename);
+  }
+  bam_fwrite_header(header, f);
+  // the header is shared with the other files, do not let bam_fclose free it
+  f->bam_header_p = NULL;
+  return f;
+}
+
+//--------------------------------------------------------------------
+
+// header text with the @HD line stating the sort order: its SO field is
+// replaced (or added), or a new @HD line is inserted when missing
+static char *bam_sorter_header_text(const char *text, int l_text, int by_qname) {
+  const char *so = by_qname ? "queryname" : "coordinate";
+  char *out = (char *) malloc(l_text + strlen(so) + 40);
+  const char *line_end, *field, *field_end;
+  int len = 3;
+
+  if (l_text >= 3 && !strncmp(text, "@HD", 3)) {
+    line_end = memchr(text, '\n', l_text);
+    if (!line_end) line_end = text + l_text;
+
+    // @HD fields but SO (VN first if missing), then SO
+    memcpy(out, "@HD", 3);
+    if (!memmem(text, line_end - text, "\tVN:", 4)) {
+      len += sprintf(out + len, "\tVN:1.4");
+    }
+    for (field = text + 3; field < line_end; field = field_end) {
+      field_end = (field + 1 < line_end ? memchr(field + 1, '\t', line_end - field - 1) : NULL);
+      if (!field_end) field_end = line_end;
+      if (strncmp(field, "\tSO:", 4)) {
+	memcpy(out + len, field, field_end - field);
+	len += field_end - field;
+      }
+    }
+    len += sprintf(out + len, "\tSO:%s\n", so);
+
+    if (line_end < text + l_text) line_end++;
+    memcpy(out + len, line_end, text + l_text - line_end);
+    len += text + l_text - line_end;
+  } else {
+    len = sprintf(out, "@HD\tVN:1.4\tSO:%s\n", so);
+    if (l_text) memcpy(out + len, text, l_text);
+    len += l_text;
+  }
+  out[len] = '\0';
+
+  return out;
+}
+
+//--------------------------------------------------------------------
+// k-way merge: one source per run file in [first_run, first_run +
+// num_runs) plus, optionally, one per in-memory slice. Run files are
+// removed once merged, the output is indexed while written when an
+// indexer is given
+//--------------------------------------------------------------------
+
+typedef struct bam_sorter_source {
+  bam_sorter_item_t item;
+  bam_file_t *file;
+  size_t index;
+  size_t end;
+} bam_sorter_source_t;
+
+static inline int bam_sorter_source_next(bam_sorter_source_t *source, bam_sorter_t *sorter) {
+  if (source->file) {
+    if (bam_read1(source->file->bam_fd, source->item.bam1) <= 0) return 0;
+    if (!sorter->by_qname) source->item.key = bam_sorter_key(source->item.bam1);
+    return 1;
+  }
+  if (source->index < source->end) {
+    source->item = sorter->items[source->index++];
+    return 1;
+  }
+  return 0;
+}
+
+// ties are broken by source order, runs are older than the buffer,
+// so the merge is stable
+static inline int bam_sorter_source_cmp(const bam_sorter_source_t *s1, const bam_sorter_source_t *s2,
+					int by_qname) {
+  int c = bam_sorter_cmp(&s1->item, &s2->item, by_qname);
+  return c ? c : (s1 < s2 ? -1 : 1);
+}
+
+static inline void bam_sorter_heap_down(bam_sorter_source_t **heap, int n, int i, int by_qname) {
+  int child;
+  bam_sorter_source_t *tmp;
+  while ((child = 2 * i + 1) < n) {
+    if (child + 1 < n && bam_sorter_source_cmp(heap[child + 1], heap[child], by_qname) < 0) {
+      child++;
+    }
+    if (bam_sorter_source_cmp(heap[child], heap[i], by_qname) >= 0) break;
+    tmp = heap[i]; heap[i] = heap[child]; heap[child] = tmp;
+    i = child;
+  }
+}
+
+static size_t bam_sorter_merge(bam_sorter_t *sorter, int first_run, int num_runs, int with_slices,
+			       bam_file_t *out, bam_indexer_t *indexer) {
+  size_t num_written = 0;
+  int num_sources = num_runs + (with_slices ? sorter->num_slices : 0), n = 0;
+  int by_qname = sorter->by_qname;
+  bam_sorter_source_t *sources = (bam_sorter_source_t *) calloc(num_sources, sizeof(bam_sorter_source_t));
+  bam_sorter_source_t **heap = (bam_sorter_source_t **) malloc(num_sources * sizeof(bam_sorter_source_t *));
+  char filename[strlen(sorter->prefix) + 32];
+
+  for (int r = 0; r < num_runs; r++) {
+    bam_sorter_run_filename(filename, first_run + r, sorter);
+    sources[r].file = bam_fopen(filename);
+    if (!sources[r].file) {
+      LOG_FATAL_F("Could not open sort run file %s\n", filename);
+    }
+    sources[r].item.bam1 = bam_init1();
+  }
+  for (int s = num_runs; s < num_sources; s++) {
+    sources[s].index = sorter->slices[s - num_runs];
+    sources[s].end = sorter->slices[s - num_runs + 1];
+  }
+
+  for (int s = 0; s < num_sources; s++) {
+    if (bam_sorter_source_next(&sources[s], sorter)) {
+      heap[n++] = &sources[s];
+    }
+  }
+  for (int i = n / 2 - 1; i >= 0; i--) {
+    bam_sorter_heap_down(heap, n, i, by_qname);
+  }
+
+  while (n > 0) {
+    bam_sorter_source_t *top = heap[0];
+    if (indexer) {
+      bam_indexer_write(top->item.bam1, indexer);
+    } else {
+      bam_fwrite(top->item.bam1, out);
+    }
+    num_written++;
+    if (!top->file) {
+      bam_destroy1(top->item.bam1);
+    }
+    if (!bam_sorter_source_next(top, sorter)) {
+      heap[0] = heap[--n];
+    }
+    bam_sorter_heap_down(heap, n, 0, by_qname);
+  }
+
+  for (int r = 0; r < num_runs; r++) {
+    bam_destroy1(sources[r].item.bam1);
+    bam_fclose(sources[r].file);
+    bam_sorter_run_filename(filename, first_run + r, sorter);
+    unlink(filename);
+  }
+  free(heap);
+  free(sources);
+
+  return num_written;
+}
+
+//--------------------------------------------------------------------
+
+// merge num_runs consecutive runs from first_run into one run of the
+// next level, in their place, so the merge stays stable
+static void bam_sorter_merge_runs(bam_sorter_t *sorter, int first_run, int num_runs) {
+  char filename[strlen(sorter->prefix) + 32], run_filename[strlen(sorter->prefix) + 32];
+  int level = sorter->run_levels[first_run] + 1;
+
+  bam_sorter_run_filename(filename, sorter->num_runs, sorter);
+  bam_file_t *f = bam_sorter_create(filename, sorter->header);
+  bam_sorter_merge(sorter, first_run, num_runs, 0, f, NULL);
+  bam_fclose(f);
+
+  bam_sorter_run_filename(run_filename, first_run, sorter);
+  if (rename(filename, run_filename)) {
+    LOG_FATAL_F("Could not rename sort run file %s\n", filename);
+  }
+  sorter->run_levels[first_run] = level;
+
+  // newer runs move down
+  for (int r = first_run + num_runs; r < sorter->num_runs; r++) {
+    bam_sorter_run_filename(filename, r, sorter);
+    bam_sorter_run_filename(run_filename, r - num_runs + 1, sorter);
+    if (rename(filename, run_filename)) {
+      LOG_FATAL_F("Could not rename sort run file %s\n", filename);
+    }
+    sorter->run_levels[r - num_runs + 1] = sorter->run_levels[r];
+  }
+  sorter->num_runs -= num_runs - 1;
+}
+
+//--------------------------------------------------------------------
+
+// levels never grow from older to newer runs, so same-level runs are
+// consecutive; the newest group with two runs or more is merged, up to
+// BAM_SORTER_MAX_RUNS / 2 of its oldest runs
+static void bam_sorter_compact(bam_sorter_t *sorter) {
+  int fan_in = BAM_SORTER_MAX_RUNS / 2;
+  int end = sorter->num_runs, beg;
+
+  while (end > 0) {
+    beg = end - 1;
+    while (beg > 0 && sorter->run_levels[beg - 1] == sorter->run_levels[end - 1]) beg--;
+    if (end - beg >= 2) {
+      bam_sorter_merge_runs(sorter, beg, end - beg < fan_in ? end - beg : fan_in);
+      return;
+    }
+    end = beg;
+  }
+}
+
+//--------------------------------------------------------------------
+
+static void bam_sorter_spill(bam_sorter_t *sorter) {
+  while (sorter->num_runs > 1 && sorter->num_runs + sorter->num_threads > BAM_SORTER_MAX_RUNS) {
+    bam_sorter_compact(sorter);
+  }
+
+  bam_sorter_sort(sorter);
+
+  if (sorter->num_runs + sorter->num_slices > sorter->max_runs) {
+    sorter->max_runs = sorter->num_runs + sorter->num_slices + BAM_SORTER_MAX_RUNS;
+    sorter->run_levels = (int *) realloc(sorter->run_levels, sorter->max_runs * sizeof(int));
+  }
+  for (int s = 0; s < sorter->num_slices; s++) {
+    sorter->run_levels[sorter->num_runs + s] = 0;
+  }
+
+  // every slice goes to its own run, so runs are compressed in parallel
+  int first_run = sorter->num_runs;
+  #pragma omp parallel for schedule(dynamic, 1) num_threads(sorter->num_threads)
+  for (int s = 0; s < sorter->num_slices; s++) {
+    char filename[strlen(sorter->prefix) + 32];
+    bam_sorter_run_filename(filename, first_run + s, sorter);
+    bam_file_t *f = bam_sorter_create(filename, sorter->header);
+    for (size_t i = sorter->slices[s]; i < sorter->slices[s + 1]; i++) {
+      bam_fwrite(sorter->items[i].bam1, f);
+      bam_destroy1(sorter->items[i].bam1);
+    }
+    bam_fclose(f);
+  }
+
+  sorter->num_runs += sorter->num_slices;
+  sorter->num_items = 0;
+  sorter->mem = 0;
+}
+
+//--------------------------------------------------------------------
+
+void bam_sorter_add(bam1_t *bam1, bam_sorter_t *sorter) {
+  if (sorter->num_items >= sorter->max_items) {
+    sorter->max_items *= 2;
+    sorter->items = (bam_sorter_item_t *) realloc(sorter->items, sorter->max_items * sizeof(bam_sorter_item_t));
+  }
+  bam_sorter_item_t *item = &sorter->items[sorter->num_items++];
+  item->bam1 = bam1;
+  item->key = sorter->by_qname ? 0 : bam_sorter_key(bam1);
+  sorter->mem += sizeof(bam1_t) + 2 * sizeof(bam_sorter_item_t) + bam1->m_data;
+
+  if (sorter->mem >= sorter->max_mem) {
+    bam_sorter_spill(sorter);
+  }
+}
+
+//--------------------------------------------------------------------
+
+size_t bam_sorter_finish(const char *out_filename, bam_sorter_t *sorter) {
+  size_t num_written;
+
+  bam_sorter_sort(sorter);
+
+  // the output header states its sort order, run files keep the input one
+  bam_header_t out_header = *sorter->header;
+  out_header.text = bam_sorter_header_text(sorter->header->text, sorter->header->l_text,
+					   sorter->by_qname);
+  out_header.l_text = strlen(out_header.text);
+
+  bam_file_t *out = bam_sorter_create(out_filename, &out_header);
+  bam_indexer_t *indexer = NULL;
+  if (!sorter->by_qname) {
+    indexer = bam_indexer_new(out_filename, sorter->header, out->bam_fd);
+  }
+  num_written = bam_sorter_merge(sorter, 0, sorter->num_runs, 1, out, indexer);
+  bam_fclose(out);
+  free(out_header.text);
+
+  // the index must be newer than the BAM file
+  if (indexer) {
+    bam_indexer_finish(indexer);
+    bam_indexer_free(indexer);
+  }
+
+  sorter->num_items = 0;
+  sorter->mem = 0;
+  sorter->num_runs = 0;
+
+  return num_written;
+}
+
+//--------------------------------------------------------------------
+//--------------------------------------------------------------------
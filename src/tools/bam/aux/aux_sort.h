@@ -0,0 +1,87 @@
+#ifndef _AUX_SORT_H
+#define _AUX_SORT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "bioformats/bam/bam_file.h"
+
+//--------------------------------------------------------------------
+// bam_sorter_t: external BAM sorter by coordinate or by read name,
+// used by the 'hpg-bam sort' command and fed directly by the aligner
+// BAM writer, so post-processing (realignment, recalibration) does not
+// need to re-read and re-sort the whole mapping output.
+//
+// Alignments are buffered in memory until max_mem is reached. The
+// buffer is split in one slice per thread, every slice is sorted in
+// parallel (radix sort on packed (tid, pos, strand) keys, or read
+// names) and spilled to its own run file, so run compression runs in
+// parallel too. bam_sorter_finish k-way merges runs and in-memory
+// slices into the final BAM file, coordinate sorted files are indexed
+// while written (see aux_index.h).
+//--------------------------------------------------------------------
+
+#define BAM_SORTER_DEFAULT_MEM 500000000
+
+// runs are merged before exceeding this number of simultaneously open
+// files in the final merge. Consecutive runs of the same level (number
+// of merges their alignments went through) are merged by groups of up
+// to BAM_SORTER_MAX_RUNS / 2 into one run of the next level, so every
+// alignment is rewritten a logarithmic number of times
+#define BAM_SORTER_MAX_RUNS    256
+
+// do not split the buffer in slices smaller than this
+#define BAM_SORTER_MIN_SLICE   4096
+
+#define BAM_SORTER_BY_COORD    0
+#define BAM_SORTER_BY_QNAME    1
+
+//--------------------------------------------------------------------
+
+typedef struct bam_sorter_item {
+  // coordinate sort key: tid (unmapped last), pos + 1 and strand
+  uint64_t key;
+  bam1_t *bam1;
+} bam_sorter_item_t;
+
+typedef struct bam_sorter {
+  int by_qname;
+  int num_threads;
+
+  size_t max_mem;
+  size_t mem;
+
+  size_t num_items;
+  size_t max_items;
+  bam_sorter_item_t *items;
+
+  // sorted slices of items, [slices[s], slices[s + 1])
+  int num_slices;
+  size_t *slices;
+
+  // run files, oldest first, and their merge levels
+  int num_runs;
+  int max_runs;
+  int *run_levels;
+  char *prefix;
+  bam_header_t *header;
+} bam_sorter_t;
+
+//--------------------------------------------------------------------
+
+// max_mem = 0 and num_threads <= 0 select the defaults
+bam_sorter_t *bam_sorter_new(bam_header_t *header, const char *prefix, int by_qname,
+			     size_t max_mem, int num_threads);
+void bam_sorter_free(bam_sorter_t *sorter);
+
+// the sorter takes ownership of bam1
+void bam_sorter_add(bam1_t *bam1, bam_sorter_t *sorter);
+
+// returns the number of alignments written
+size_t bam_sorter_finish(const char *out_filename, bam_sorter_t *sorter);
+
+//--------------------------------------------------------------------
+//--------------------------------------------------------------------
+
+#endif // _AUX_SORT_H
@@ -0,0 +1,214 @@
+#include "aux_writer.h"
+
+#include <string.h>
+#include <zlib.h>
+
+#include "commons/log.h"
+
+#include "aux_profiler.h"
+
+//--------------------------------------------------------------------
+// BGZF block layout: gzip header with the BC extra field holding the
+// block size - 1, raw deflate data, CRC32 and uncompressed size
+//--------------------------------------------------------------------
+
+#define BGZF_HEADER_SIZE  18
+#define BGZF_FOOTER_SIZE  8
+
+static const uint8_t bgzf_header[BGZF_HEADER_SIZE] = {
+  0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0, 0, 0
+};
+
+static const uint8_t bgzf_eof[28] = {
+  0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0, 0x1b, 0,
+  3, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+static inline void pack_u16(uint8_t *p, uint16_t v) {
+  p[0] = v; p[1] = v >> 8;
+}
+
+static inline void pack_u32(uint8_t *p, uint32_t v) {
+  p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+//--------------------------------------------------------------------
+
+static int bgzf_deflate(const uint8_t *src, size_t src_size, uint8_t *dst, int level) {
+  z_stream zs;
+  memset(&zs, 0, sizeof(z_stream));
+  zs.next_in = (Bytef *) src;
+  zs.avail_in = src_size;
+  zs.next_out = dst + BGZF_HEADER_SIZE;
+  zs.avail_out = BAM_PWRITER_MAX_BLOCK - BGZF_HEADER_SIZE - BGZF_FOOTER_SIZE;
+
+  if (deflateInit2(&zs, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    LOG_FATAL("Error initializing zlib to write BAM blocks\n");
+  }
+  int ret = deflate(&zs, Z_FINISH);
+  deflateEnd(&zs);
+  if (ret != Z_STREAM_END) {
+    // does not fit in a BGZF block
+    return -1;
+  }
+
+  int size = zs.total_out + BGZF_HEADER_SIZE + BGZF_FOOTER_SIZE;
+  memcpy(dst, bgzf_header, BGZF_HEADER_SIZE);
+  pack_u16(dst + 16, size - 1);
+  pack_u32(dst + size - 8, crc32(crc32(0L, NULL, 0L), src, src_size));
+  pack_u32(dst + size - 4, src_size);
+
+  return size;
+}
+
+//--------------------------------------------------------------------
+
+bam_pblock_t *bam_pblock_new(int level) {
+  bam_pblock_t *p = (bam_pblock_t *) calloc(1, sizeof(bam_pblock_t));
+  p->level = level < 0 ? Z_DEFAULT_COMPRESSION : level;
+  p->max_size = BAM_PWRITER_MAX_BLOCK;
+  p->data = (uint8_t *) malloc(p->max_size);
+  return p;
+}
+
+void bam_pblock_free(bam_pblock_t *block) {
+  if (block) {
+    if (block->data) free(block->data);
+    free(block);
+  }
+}
+
+void bam_pblock_clear(bam_pblock_t *block) {
+  block->num_records = 0;
+  block->raw_size = 0;
+  block->size = 0;
+}
+
+//--------------------------------------------------------------------
+
+void bam_pblock_flush(bam_pblock_t *block) {
+  if (block->raw_size == 0) return;
+
+  if (block->size + BAM_PWRITER_MAX_BLOCK > block->max_size) {
+    block->max_size = 2 * block->max_size + BAM_PWRITER_MAX_BLOCK;
+    block->data = (uint8_t *) realloc(block->data, block->max_size);
+  }
+
+  uint64_t prof_time = profiler_start(PROF_COMPRESSION);
+  uint8_t *dst = block->data + block->size;
+  int size = bgzf_deflate(block->raw, block->raw_size, dst, block->level);
+  if (size < 0) {
+    // incompressible data, stored blocks always fit
+    size = bgzf_deflate(block->raw, block->raw_size, dst, Z_NO_COMPRESSION);
+  }
+  profiler_stop(PROF_COMPRESSION, prof_time);
+
+  block->size += size;
+  block->raw_size = 0;
+}
+
+//--------------------------------------------------------------------
+
+static void bam_pblock_append(const void *src, size_t len, bam_pblock_t *block) {
+  const uint8_t *p = (const uint8_t *) src;
+  while (len > 0) {
+    size_t n = BAM_PWRITER_BLOCK_SIZE - block->raw_size;
+    if (n > len) n = len;
+    memcpy(block->raw + block->raw_size, p, n);
+    block->raw_size += n;
+    p += n;
+    len -= n;
+    if (block->raw_size == BAM_PWRITER_BLOCK_SIZE) {
+      bam_pblock_flush(block);
+    }
+  }
+}
+
+//--------------------------------------------------------------------
+
+void bam_pblock_add(const bam1_t *bam1, bam_pblock_t *block) {
+  const bam1_core_t *c = &bam1->core;
+  uint8_t core[36];
+
+  pack_u32(core, 32 + bam1->data_len);
+  pack_u32(core + 4, c->tid);
+  pack_u32(core + 8, c->pos);
+  pack_u32(core + 12, (uint32_t) c->bin << 16 | c->qual << 8 | c->l_qname);
+  pack_u32(core + 16, (uint32_t) c->flag << 16 | c->n_cigar);
+  pack_u32(core + 20, c->l_qseq);
+  pack_u32(core + 24, c->mtid);
+  pack_u32(core + 28, c->mpos);
+  pack_u32(core + 32, c->isize);
+
+  // keep small records in a single BGZF block, as samtools
+  if (block->raw_size + sizeof(core) + bam1->data_len > BAM_PWRITER_BLOCK_SIZE) {
+    bam_pblock_flush(block);
+  }
+
+  bam_pblock_append(core, sizeof(core), block);
+  bam_pblock_append(bam1->data, bam1->data_len, block);
+  block->num_records++;
+}
+
+//--------------------------------------------------------------------
+//--------------------------------------------------------------------
+
+bam_pwriter_t *bam_pwriter_new(const char *filename, const bam_header_t *header, int level) {
+  bam_pwriter_t *p = (bam_pwriter_t *) calloc(1, sizeof(bam_pwriter_t));
+  p->filename = strdup(filename);
+  p->file = fopen(filename, "wb");
+  if (!p->file) {
+    LOG_FATAL_F("Could not create BAM file %s\n", filename);
+  }
+
+  // header, in its own BGZF blocks
+  bam_pblock_t *block = bam_pblock_new(level);
+  uint8_t buf[4];
+
+  bam_pblock_append("BAM\1", 4, block);
+  pack_u32(buf, header->l_text);
+  bam_pblock_append(buf, 4, block);
+  if (header->l_text) bam_pblock_append(header->text, header->l_text, block);
+  pack_u32(buf, header->n_targets);
+  bam_pblock_append(buf, 4, block);
+  for (int i = 0; i < header->n_targets; i++) {
+    uint32_t len = strlen(header->target_name[i]) + 1;
+    pack_u32(buf, len);
+    bam_pblock_append(buf, 4, block);
+    bam_pblock_append(header->target_name[i], len, block);
+    pack_u32(buf, header->target_len[i]);
+    bam_pblock_append(buf, 4, block);
+  }
+  bam_pblock_flush(block);
+  bam_pwriter_write(block, p);
+  bam_pblock_free(block);
+
+  return p;
+}
+
+//--------------------------------------------------------------------
+
+void bam_pwriter_write(const bam_pblock_t *block, bam_pwriter_t *writer) {
+  uint64_t prof_time = profiler_start(PROF_WRITER);
+  if (block->size && fwrite(block->data, 1, block->size, writer->file) != block->size) {
+    LOG_FATAL_F("Error writing BAM file %s\n", writer->filename);
+  }
+  writer->num_records += block->num_records;
+  profiler_stop(PROF_WRITER, prof_time);
+}
+
+//--------------------------------------------------------------------
+
+void bam_pwriter_close(bam_pwriter_t *writer) {
+  if (writer) {
+    fwrite(bgzf_eof, 1, sizeof(bgzf_eof), writer->file);
+    if (fclose(writer->file)) {
+      LOG_FATAL_F("Error closing BAM file %s\n", writer->filename);
+    }
+    free(writer->filename);
+    free(writer);
+  }
+}
+
+//--------------------------------------------------------------------
+//--------------------------------------------------------------------
@@ -0,0 +1,77 @@
+#ifndef _AUX_WRITER_H
+#define _AUX_WRITER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "bioformats/bam/bam_file.h"
+
+//--------------------------------------------------------------------
+// bam_pwriter_t: parallel BAM writer.
+//
+// Compression is the expensive part of writing a BAM file, so it is
+// moved out of the writer: every worker encodes its alignments into a
+// bam_pblock_t and deflates them into complete BGZF blocks. The writer
+// only appends the already compressed blocks to the file, in the order
+// the blocks are given (the consumer order), and the EOF marker when
+// closed. Every pblock ends a BGZF block, which the format allows.
+//
+// Records are encoded little-endian, as the rest of the BAM code.
+//--------------------------------------------------------------------
+
+// uncompressed bytes per BGZF block, as samtools
+#define BAM_PWRITER_BLOCK_SIZE  0xff00
+#define BAM_PWRITER_MAX_BLOCK   0x10000
+
+//--------------------------------------------------------------------
+
+typedef struct bam_pblock {
+  int level;
+  size_t num_records;
+
+  // pending uncompressed bytes
+  size_t raw_size;
+  uint8_t raw[BAM_PWRITER_BLOCK_SIZE];
+
+  // complete BGZF blocks
+  size_t size;
+  size_t max_size;
+  uint8_t *data;
+} bam_pblock_t;
+
+typedef struct bam_pwriter {
+  FILE *file;
+  char *filename;
+  size_t num_records;
+} bam_pwriter_t;
+
+//--------------------------------------------------------------------
+
+// level is the zlib compression level, -1 for the default one
+bam_pblock_t *bam_pblock_new(int level);
+void bam_pblock_free(bam_pblock_t *block);
+
+// empties the block to encode a new batch
+void bam_pblock_clear(bam_pblock_t *block);
+
+void bam_pblock_add(const bam1_t *bam1, bam_pblock_t *block);
+
+// compresses the pending bytes, the block is ready to be written
+void bam_pblock_flush(bam_pblock_t *block);
+
+//--------------------------------------------------------------------
+
+// creates the file and writes the header
+bam_pwriter_t *bam_pwriter_new(const char *filename, const bam_header_t *header, int level);
+
+// appends a flushed block, not thread-safe: call it from one thread
+void bam_pwriter_write(const bam_pblock_t *block, bam_pwriter_t *writer);
+
+// writes the EOF marker, closes the file and frees the writer
+void bam_pwriter_close(bam_pwriter_t *writer);
+
+//--------------------------------------------------------------------
+//--------------------------------------------------------------------
+
+#endif // _AUX_WRITER_H
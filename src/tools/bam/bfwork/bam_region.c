@@ -221,7 +221,7 @@ static int compare_pos(const void *item1, const void *item2) {
 }
 
 void
-breg_write_n(bam_region_t *region, size_t n, bam_file_t *output_file)
+breg_write_n(bam_region_t *region, size_t n, bam_file_t *output_file, bam_indexer_t *output_index)
 {
 	int i;
 	bam1_t *read;
@@ -241,8 +241,12 @@ breg_write_n(bam_region_t *region, size_t n, bam_file_t *output_file)
 		read = region->reads[i];
 		assert(read);
 
-		//Write to disk
-		if(output_file != NULL)
+		//Write to disk, indexing if requested
+		if(output_index != NULL)
+		{
+			bam_indexer_write(read, output_index);
+		}
+		else if(output_file != NULL)
 		{
 			bam_write1(output_file->bam_fd, read);
 		}
@@ -24,6 +24,7 @@
 #include "aux/aux_common.h"
 #include "aux/aux_library.h"
 #include "aux/timestats.h"
+#include "aux/aux_index.h"
 
 #define BAM_REGION_DEFAULT_SIZE 1000
 
@@ -56,7 +57,7 @@ EXTERNC void breg_init(bam_region_t *region);
 EXTERNC void breg_destroy(bam_region_t *region, int free_bam);
 
 //EXTERNC int breg_fill(bam_region_t *region, bam_file_t *input_file);
-EXTERNC void breg_write_n(bam_region_t *region, size_t n, bam_file_t *output_file);
+EXTERNC void breg_write_n(bam_region_t *region, size_t n, bam_file_t *output_file, bam_indexer_t *output_index);
 
 //EXTERNC void breg_load_window(bam_region_t *region, size_t init_pos, size_t end_pos, uint8_t filters, bam_region_window_t *window);
 //EXTERNC void breg_load_subwindow(bam_region_window_t *window, size_t init_pos, size_t end_pos, bam_region_window_t *out_window);
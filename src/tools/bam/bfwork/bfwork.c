@@ -16,15 +16,33 @@
 */
 #include <errno.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "bfwork.h"
 
+/**
+ * BAM READER
+ * Sequential reader over the whole input or, in indexed mode, an
+ * iterator over one genome chunk with its own BGZF handle.
+ */
+typedef struct {
+	bamFile fp;
+	bam_iter_t iter;
+	int32_t beg;
+
+	//Read that changed the region, first of the next one
+	bam1_t *last_read;
+	int last_read_bytes;
+
+	//Virtual offset after the last mapped read
+	int64_t last_offset;
+} bfwork_reader_t;
+
 /**
  * STATIC VARS
  */
 //bfwork_obtain_region
-static bam1_t *last_read = NULL;
-static int last_read_bytes = 0;
+static bfwork_reader_t input_reader;
 
 /**
  * STATIC FUNCTIONS
@@ -42,9 +60,10 @@ static int bfwork_region_insert(bam_fwork_t *fwork, bam_region_t *region);
  * \brief PRIVATE. Wander for a region.
  *
  * \param[in] fwork Target framework.
+ * \param[in] reader Reader to obtain reads from.
  * \param[out] region Region to fill using current context wandering function.
  */
-static int bfwork_obtain_region(bam_fwork_t *fwork, bam_region_t *current_region);
+static int bfwork_obtain_region(bam_fwork_t *fwork, bfwork_reader_t *reader, bam_region_t *current_region);
 
 /**
  * Initialize empty BAM framework data structure.
@@ -206,7 +225,7 @@ bfwork_run_sequential(bam_fwork_t *fwork)
 #ifdef D_TIME_DEBUG
 		times = omp_get_wtime();
 #endif
-		err = bfwork_obtain_region(fwork, region);
+		err = bfwork_obtain_region(fwork, &input_reader, region);
 #ifdef D_TIME_DEBUG
 		times = omp_get_wtime() - times;
 		if(region->size != 0)
@@ -244,7 +263,7 @@ bfwork_run_sequential(bam_fwork_t *fwork)
 				printf("Reads processed: %lu\r", reads);
 
 				//Write region
-				breg_write_n(region, reads_to_write, fwork->output_file);
+				breg_write_n(region, reads_to_write, fwork->output_file, fwork->output_index);
 
 				//Remove region from list
 				linked_list_remove(region, fwork->regions_list);
@@ -331,7 +350,7 @@ bfwork_run_threaded(bam_fwork_t *fwork)
 #ifdef D_TIME_DEBUG
 					times = omp_get_wtime();
 #endif
-					err = bfwork_obtain_region(fwork, region);
+					err = bfwork_obtain_region(fwork, &input_reader, region);
 #ifdef D_TIME_DEBUG
 					times = omp_get_wtime() - times;
 					omp_set_lock(&region->lock);
@@ -453,7 +472,7 @@ bfwork_run_threaded(bam_fwork_t *fwork)
 					//Write region
 					omp_set_lock(&fwork->output_file_lock);
 					reads_to_write = region->size;
-					breg_write_n(region, reads_to_write, fwork->output_file);
+					breg_write_n(region, reads_to_write, fwork->output_file, fwork->output_index);
 					omp_unset_lock(&fwork->output_file_lock);
 
 					//Remove from list
@@ -502,6 +521,280 @@ bfwork_run_threaded(bam_fwork_t *fwork)
 	return NO_ERROR;
 }
 
+/**
+ * PRIVATE. Process regions from a reader until it is exhausted.
+ * Processed regions are queued in 'done' to be written later in order.
+ */
+static int
+bfwork_run_reader(bam_fwork_t *fwork, bfwork_reader_t *reader, linked_list_t *done)
+{
+	int i, err;
+	size_t pf_l;
+	bam_region_t *region;
+
+	pf_l = fwork->context->processing_f_l;
+	while(1)
+	{
+		//Create new current region
+		region = (bam_region_t *)malloc(sizeof(bam_region_t));
+		breg_init(region);
+
+		err = bfwork_obtain_region(fwork, reader, region);
+		if(err == WANDER_REGION_CHANGED || err == WANDER_READ_EOF)
+		{
+			//Process region
+			for(i = 0; i < pf_l; i++)
+			{
+				fwork->context->processing_f[i](fwork, region);
+			}
+			linked_list_insert_last(region, done);
+
+			if(err == WANDER_READ_EOF)
+				return NO_ERROR;
+		}
+		else
+		{
+			breg_destroy(region, 1);
+			free(region);
+
+			if(err == WANDER_READ_TRUNCATED)
+			{
+				LOG_WARN("Readed truncated read\n");
+				return NO_ERROR;
+			}
+			else if(err)
+			{
+				LOG_FATAL_F("Failed to read next region, error code: %d\n", err);
+			}
+			return err;
+		}
+	}
+}
+
+/**
+ * PRIVATE. Write processed regions in order and free them.
+ */
+static size_t
+bfwork_write_regions(bam_fwork_t *fwork, linked_list_t *done)
+{
+	size_t reads = 0;
+	bam_region_t *region;
+
+	while((region = linked_list_remove_first(done)) != NULL)
+	{
+		reads += region->size;
+		breg_write_n(region, region->size, fwork->output_file, fwork->output_index);
+		breg_destroy(region, 1);
+		free(region);
+	}
+
+	return reads;
+}
+
+/**
+ * PRIVATE. Alignment end as the index queries see it.
+ */
+static inline uint32_t
+bfwork_read_end(bam1_t *read)
+{
+	if(read->core.n_cigar)
+		return bam_calend(&read->core, bam1_cigar(read));
+	return read->core.pos + 1;
+}
+
+/**
+ * PRIVATE. First coverage gap in [pos, pos + FWORK_GAP_SCAN_MAX): a
+ * position no read spans, every read starting before it ends at or
+ * before it. Deep data rarely has one, so past the scan limit pos itself
+ * is returned and the boundary just splits reads by start position.
+ */
+static int32_t
+bfwork_coverage_gap(bamFile fp, bam_index_t *idx, int tid, int32_t pos, int32_t len)
+{
+	bam_iter_t iter;
+	bam1_t *read;
+	int32_t gap, limit;
+	uint32_t end;
+
+	limit = pos + FWORK_GAP_SCAN_MAX < len ? pos + FWORK_GAP_SCAN_MAX : len;
+
+	read = bam_init1();
+	iter = bam_iter_query(idx, tid, pos, limit);
+	gap = pos;
+	while(gap < limit && bam_iter_read(fp, iter, read) > 0)
+	{
+		if(read->core.pos >= gap)
+			break;
+
+		end = bfwork_read_end(read);
+		if(end > gap)
+			gap = end;
+	}
+	bam_iter_destroy(iter);
+	bam_destroy1(read);
+
+	return gap < limit ? gap : pos;
+}
+
+/**
+ * PRIVATE. Run current context using the BAI index of the input.
+ * The genome is split in FWORK_CHUNK_SIZE chunks. Their boundaries are
+ * computed once, in parallel, and moved to a close coverage gap when
+ * there is one. A chunk owns the reads starting in it, so every read is
+ * processed once even when a boundary falls inside covered sequence.
+ * Regions restart at every chunk, so their bounds can differ from a
+ * sequential run near chunk boundaries. Every thread opens one BGZF
+ * handle and processes whole chunks. Outputs are written in chunk order.
+ * Reads without coordinates are processed at the end from the offset
+ * after the last mapped read.
+ */
+static int
+bfwork_run_indexed(bam_fwork_t *fwork, bam_index_t *idx)
+{
+	int c, tid, num_chunks, num_threads;
+	int32_t beg;
+	bam_header_t *header;
+	bamFile *thread_fp;
+	size_t reads;
+	int64_t tail_offset;
+
+	struct {
+		int tid;
+		int32_t beg;
+		int32_t end;
+	} *chunks;
+
+	assert(fwork);
+	assert(idx);
+
+	header = fwork->input_file->bam_header_p;
+
+	//Split genome in chunks
+	num_chunks = 0;
+	for(tid = 0; tid < header->n_targets; tid++)
+	{
+		num_chunks += (header->target_len[tid] + FWORK_CHUNK_SIZE - 1) / FWORK_CHUNK_SIZE;
+	}
+	chunks = malloc(num_chunks * sizeof(*chunks));
+	c = 0;
+	for(tid = 0; tid < header->n_targets; tid++)
+	{
+		for(beg = 0; beg < header->target_len[tid]; beg += FWORK_CHUNK_SIZE)
+		{
+			chunks[c].tid = tid;
+			chunks[c].beg = beg;
+			chunks[c].end = beg + FWORK_CHUNK_SIZE < header->target_len[tid] ? beg + FWORK_CHUNK_SIZE : header->target_len[tid];
+			c++;
+		}
+	}
+
+	num_threads = omp_get_max_threads();
+	thread_fp = calloc(num_threads, sizeof(bamFile));
+
+	//Move inner boundaries to coverage gaps, each one scanned once
+	#pragma omp parallel for schedule(dynamic, 16)
+	for(c = 1; c < num_chunks; c++)
+	{
+		int thread = omp_get_thread_num();
+
+		if(chunks[c].tid != chunks[c - 1].tid)
+			continue;
+
+		//One handle per thread, reused by all its chunks
+		if(thread_fp[thread] == NULL)
+		{
+			thread_fp[thread] = bam_open(fwork->input_file_str, "r");
+			assert(thread_fp[thread]);
+		}
+
+		chunks[c].beg = bfwork_coverage_gap(thread_fp[thread], idx, chunks[c].tid, chunks[c].beg,
+				header->target_len[chunks[c].tid]);
+	}
+	for(c = 1; c < num_chunks; c++)
+	{
+		if(chunks[c].tid == chunks[c - 1].tid)
+			chunks[c - 1].end = chunks[c].beg;
+	}
+
+	printf("Running in indexed mode with %d threads and %d chunks\n", num_threads, num_chunks);
+
+	reads = 0;
+	tail_offset = -1;
+
+	#pragma omp parallel for ordered schedule(dynamic, 1)
+	for(c = 0; c < num_chunks; c++)
+	{
+		bfwork_reader_t reader;
+		linked_list_t *done = linked_list_new(COLLECTION_MODE_ASYNCHRONIZED);
+		int thread = omp_get_thread_num();
+
+		//One handle per thread, reused by all its chunks
+		if(thread_fp[thread] == NULL)
+		{
+			thread_fp[thread] = bam_open(fwork->input_file_str, "r");
+			assert(thread_fp[thread]);
+		}
+
+		memset(&reader, 0, sizeof(bfwork_reader_t));
+		reader.fp = thread_fp[thread];
+		reader.last_offset = -1;
+		reader.beg = chunks[c].beg;
+
+		if(reader.beg < chunks[c].end)
+		{
+			reader.iter = bam_iter_query(idx, chunks[c].tid, reader.beg, chunks[c].end);
+			bfwork_run_reader(fwork, &reader, done);
+			bam_iter_destroy(reader.iter);
+		}
+
+		#pragma omp ordered
+		{
+			reads += bfwork_write_regions(fwork, done);
+			printf("Reads processed: %lu\r", reads);
+
+			if(reader.last_offset >= 0)
+				tail_offset = reader.last_offset;
+		}
+
+		linked_list_free(done, NULL);
+	}
+
+	for(c = 0; c < num_threads; c++)
+	{
+		if(thread_fp[c])
+			bam_close(thread_fp[c]);
+	}
+	free(thread_fp);
+	free(chunks);
+
+	//Reads without coordinates
+	{
+		bfwork_reader_t reader;
+		linked_list_t *done = linked_list_new(COLLECTION_MODE_ASYNCHRONIZED);
+		bam_header_t *aux_header;
+
+		memset(&reader, 0, sizeof(bfwork_reader_t));
+		reader.last_offset = -1;
+		reader.fp = bam_open(fwork->input_file_str, "r");
+		assert(reader.fp);
+		aux_header = bam_header_read(reader.fp);
+		bam_header_destroy(aux_header);
+		if(tail_offset >= 0)
+			bam_seek(reader.fp, tail_offset, SEEK_SET);
+
+		bfwork_run_reader(fwork, &reader, done);
+		reads += bfwork_write_regions(fwork, done);
+		printf("Reads processed: %lu\r", reads);
+
+		bam_close(reader.fp);
+		linked_list_free(done, NULL);
+	}
+
+	printf("\n");
+
+	return NO_ERROR;
+}
+
 /**
  * Run framework contexts.
  */
@@ -510,6 +803,8 @@ bfwork_run(bam_fwork_t *fwork)
 {
 	int err = 0, c;
 	double times;
+	bam_index_t *idx;
+	char idx_filename[strlen(fwork->input_file_str) + 8];
 
 
 	assert(fwork);
@@ -622,6 +917,12 @@ bfwork_run(bam_fwork_t *fwork)
 			bam_fwrite_header(fwork->output_file->bam_header_p, fwork->output_file);
 			fwork->output_file->bam_header_p = NULL;
 			printf("New intermediate BAM initialized!...\n");
+
+			//Index final output while writing
+			if(c == fwork->v_context_l - 1 && fwork->output_file_str)
+			{
+				fwork->output_index = bam_indexer_new(fwork->context->output_file_str, fwork->input_file->bam_header_p, fwork->output_file->bam_fd);
+			}
 		}
 
 #ifdef D_TIME_DEBUG
@@ -645,7 +946,33 @@ bfwork_run(bam_fwork_t *fwork)
 #endif
 
 		//Run this context
-		if(omp_get_max_threads() > 1)
+		input_reader.fp = fwork->input_file->bam_fd;
+		idx = NULL;
+		if(omp_get_max_threads() > 1 && !fwork->last_temp_file_str)
+		{
+			//Only the initial input can have an index
+			snprintf(idx_filename, sizeof(idx_filename), "%s.bai", fwork->input_file_str);
+			if(access(idx_filename, R_OK) == 0)
+			{
+				idx = bam_index_load(fwork->input_file_str);
+				if(idx)
+					printf("Index \"%s\" found, reading the input by genome chunks (indexed mode)\n", idx_filename);
+				else
+					LOG_WARN_F("Could not load index \"%s\", reading the input sequentially\n", idx_filename);
+			}
+			else
+			{
+				printf("No index \"%s\", reading the input sequentially\n", idx_filename);
+			}
+		}
+
+		if(idx)
+		{
+			//Run in indexed mode, every thread reads its own chunks
+			err = bfwork_run_indexed(fwork, idx);
+			bam_index_destroy(idx);
+		}
+		else if(omp_get_max_threads() > 1)
 		{
 			//Run in multithreaded mode
 			err = bfwork_run_threaded(fwork);
@@ -682,6 +1009,15 @@ bfwork_run(bam_fwork_t *fwork)
 			bam_fclose(fwork->output_file);
 			fwork->output_file = NULL;
 			printf("BAM closed.\n");
+
+			//Complete index after BAM closing, so it is newer
+			if(fwork->output_index != NULL)
+			{
+				if(!bam_indexer_finish(fwork->output_index))
+					printf("Index created in %s\n", fwork->output_index->idx_filename);
+				bam_indexer_free(fwork->output_index);
+				fwork->output_index = NULL;
+			}
 		}
 
 		//Remove last temporary file
@@ -1082,29 +1418,58 @@ bfwork_region_insert(bam_fwork_t *fwork, bam_region_t *region)
 	return NO_ERROR;
 }
 
+/**
+ * PRIVATE. Read next alignment from a reader.
+ */
+static inline int
+bfwork_reader_read(bfwork_reader_t *reader, bam1_t *read)
+{
+	int bytes;
+
+	while(1)
+	{
+		if(reader->iter == NULL)
+		{
+			bytes = bam_read1(reader->fp, read);
+			break;
+		}
+
+		bytes = bam_iter_read(reader->fp, reader->iter, read);
+
+		//Reads starting before the chunk belong to the previous one
+		if(bytes <= 0 || read->core.pos >= reader->beg)
+			break;
+	}
+
+	if(bytes > 0 && read->core.tid >= 0)
+		reader->last_offset = bam_tell(reader->fp);
+
+	return bytes;
+}
+
 /**
  * PRIVATE. Wander for a region.
  */
 static inline int
-bfwork_obtain_region(bam_fwork_t *fwork, bam_region_t *region)
+bfwork_obtain_region(bam_fwork_t *fwork, bfwork_reader_t *reader, bam_region_t *region)
 {
 	int err, bytes;
 	bam1_t *read;
 	double times;
 
 	//Get first read
-	if(last_read != NULL)
+	if(reader->last_read != NULL)
 	{
-		read = last_read;
-		bytes = last_read_bytes;
-		last_read = NULL;
+		read = reader->last_read;
+		bytes = reader->last_read_bytes;
+		reader->last_read = NULL;
 	}
 	else
 	{
 		//Get first read from file
 		read = bam_init1();
 		assert(read);
-		bytes = bam_read1(fwork->input_file->bam_fd, read);
+		bytes = bfwork_reader_read(reader, read);
 	}
 
 	//Iterate reads
@@ -1143,13 +1508,13 @@ bfwork_obtain_region(bam_fwork_t *fwork, bam_region_t *region)
 			//Get next read from file
 			read = bam_init1();
 			assert(read);
-			bytes = bam_read1(fwork->input_file->bam_fd, read);
+			bytes = bfwork_reader_read(reader, read);
 			break;
 
 		case WANDER_REGION_CHANGED:
 			//The region have changed
-			last_read = read;
-			last_read_bytes = bytes;
+			reader->last_read = read;
+			reader->last_read_bytes = bytes;
 			return err;
 
 		default:
@@ -43,6 +43,8 @@
 #define FWORK_REGIONS_MAX 1000
 #define FWORK_CONTEXT_MAX 	16
 #define FWORK_PROC_FUNC_MAX 	16
+#define FWORK_CHUNK_SIZE	1000000	//Genome chunk per thread in indexed mode
+#define FWORK_GAP_SCAN_MAX	10000	//Max distance scanned for a coverage gap at chunk boundaries
 
 //ALIGNMENTS FILTERS
 #define FILTER_ZERO_QUAL 1
@@ -102,6 +104,7 @@ typedef struct {
 	int erase_tmp;
 	bam_file_t *input_file;
 	bam_file_t *output_file;
+	bam_indexer_t *output_index;
 	genome_t *reference;
 	omp_lock_t output_file_lock;
 	omp_lock_t reference_lock;
@@ -13,6 +13,7 @@
 
 #define CONSUMER_STAGE   -1
 
+
 //--------------------------------------------------------------------
 // workflow input
 //--------------------------------------------------------------------
@@ -21,30 +22,48 @@ typedef struct bam_filter_wf_input {
   size_t num_passed;
   size_t num_failed;
   filter_options_t *options;
+  filter_prog_t *prog;
   bam_file_t *in_file;
-  bam_file_t *passed_file;
-  bam_file_t *failed_file;
+  bam_pwriter_t *passed_file;
+  bam_pwriter_t *failed_file;
+
+  // index to read only the regions
+  bam_index_t *idx;
+  bam_iter_t iter;
+  size_t cur_region;
+  int skip_tid;
+  int skip_end;
 } bam_filter_wf_input_t;
 
 bam_filter_wf_input_t *bam_filter_wf_input_new(filter_options_t *opts,
+					       filter_prog_t *prog,
 					       bam_file_t *in_file,
-					       bam_file_t *passed_file,
-					       bam_file_t *failed_file) {
+					       bam_pwriter_t *passed_file,
+					       bam_pwriter_t *failed_file) {
   
   bam_filter_wf_input_t *p = (bam_filter_wf_input_t *) calloc(1, sizeof(bam_filter_wf_input_t));
 
   p->num_passed = 0;
   p->num_failed = 0;
   p->options = opts;
+  p->prog = prog;
   p->in_file = in_file;
   p->passed_file = passed_file;
   p->failed_file = failed_file;
 
+  p->idx = NULL;
+  p->iter = NULL;
+  p->cur_region = 0;
+  p->skip_tid = -1;
+  p->skip_end = 0;
+
   return p;
 }
 
 void bam_filter_wf_input_free(bam_filter_wf_input_t *p) {
   if (p) {
+    if (p->iter) bam_iter_destroy(p->iter);
+    if (p->idx) bam_index_destroy(p->idx);
     free(p);
   }
 }
@@ -56,33 +75,30 @@ void bam_filter_wf_input_free(bam_filter_wf_input_t *p) {
 typedef struct bam_filter_wf_batch {
   size_t *num_passed;
   size_t *num_failed;
-  filter_options_t *options;
+  filter_prog_t *prog;
   array_list_t *bam1s;
-  array_list_t *passed_bam1s;
-  array_list_t *failed_bam1s;
-  bam_file_t *passed_file;
-  bam_file_t *failed_file;
+  bam_pblock_t *passed_block;
+  bam_pblock_t *failed_block;
+  bam_pwriter_t *passed_file;
+  bam_pwriter_t *failed_file;
 } bam_filter_wf_batch_t;
 
 bam_filter_wf_batch_t *bam_filter_wf_batch_new(size_t *num_passed,
 					       size_t *num_failed,
-					       filter_options_t *opts,
+					       filter_prog_t *prog,
 					       array_list_t *bam1s,
-					       bam_file_t *passed_file,
-					       bam_file_t *failed_file) {
+					       bam_pwriter_t *passed_file,
+					       bam_pwriter_t *failed_file) {
   
   bam_filter_wf_batch_t *p = (bam_filter_wf_batch_t *) calloc(1, 
 							      sizeof(bam_filter_wf_batch_t));
   
-  size_t num_items = array_list_size(bam1s) / 2;
-  if (num_items <= 0) num_items = 100;
-
   p->num_passed = num_passed;
   p->num_failed = num_failed;
-  p->options = opts;
+  p->prog = prog;
   p->bam1s = bam1s;
-  p->passed_bam1s = array_list_new(num_items, 1.25f, COLLECTION_MODE_ASYNCHRONIZED);  
-  p->failed_bam1s = array_list_new(num_items, 1.25f, COLLECTION_MODE_ASYNCHRONIZED);  
+  p->passed_block = bam_pblock_new(-1);
+  p->failed_block = bam_pblock_new(-1);
   p->passed_file = passed_file;
   p->failed_file = failed_file;
   
@@ -100,8 +116,8 @@ void bam_filter_wf_batch_free(bam_filter_wf_batch_t *p) {
       }
       array_list_free(p->bam1s, NULL);
     }
-    if (p->passed_bam1s) array_list_free(p->passed_bam1s, NULL);
-    if (p->failed_bam1s) array_list_free(p->failed_bam1s, NULL);
+    bam_pblock_free(p->passed_block);
+    bam_pblock_free(p->failed_block);
     
     free(p);
   }
@@ -111,19 +127,57 @@ void bam_filter_wf_batch_free(bam_filter_wf_batch_t *p) {
 // workflow producer : read BAM file
 //--------------------------------------------------------------------
 
+// reads the next alignment overlapping the regions, from the index;
+// regions are sorted and merged, so an alignment starting before the
+// end of the previous region on the same target was already read
+static int bam_filter_read_region(bam_filter_wf_input_t *wf_input, bam1_t *bam1) {
+  filter_regions_t *regions = wf_input->prog->regions;
+  bamFile bam_file = wf_input->in_file->bam_fd;
+
+  while (1) {
+    if (!wf_input->iter) {
+      if (wf_input->cur_region >= regions->num_regions) return -1;
+      filter_region_t *r = &regions->regions[wf_input->cur_region];
+      wf_input->iter = bam_iter_query(wf_input->idx, r->tid, r->start, r->end);
+    }
+
+    if (bam_iter_read(bam_file, wf_input->iter, bam1) >= 0) {
+      if (bam1->core.tid == wf_input->skip_tid && bam1->core.pos < wf_input->skip_end) {
+	continue;
+      }
+      return 1;
+    }
+
+    filter_region_t *r = &regions->regions[wf_input->cur_region++];
+    wf_input->skip_tid = r->tid;
+    wf_input->skip_end = r->end;
+    bam_iter_destroy(wf_input->iter);
+    wf_input->iter = NULL;
+  }
+}
+
+//--------------------------------------------------------------------
+
 void *bam_filter_producer(void *input) {
   
   bam_filter_wf_input_t *wf_input = (bam_filter_wf_input_t *) input;
   bam_filter_wf_batch_t *new_batch = NULL;
+  uint64_t prof_time = profiler_start(PROF_READER);
   int max_num_bam1s = wf_input->options->batch_size;
 
   bamFile bam_file = wf_input->in_file->bam_fd;
   bam1_t *bam1;
+  int ret;
 
   array_list_t *bam1_list = array_list_new(max_num_bam1s, 1.25f, COLLECTION_MODE_ASYNCHRONIZED);  
   for (int i = 0; i < max_num_bam1s; i++) {
     bam1 = bam_init1();    
-    if (bam_read1(bam_file, bam1) > 0) {
+    if (wf_input->idx) {
+      ret = bam_filter_read_region(wf_input, bam1);
+    } else {
+      ret = bam_read1(bam_file, bam1);
+    }
+    if (ret > 0) {
 
       if (++read_progress % 500000 == 0) {
 	LOG_INFO_F("%i reads extracting from disk...\n", read_progress);
@@ -143,36 +197,49 @@ void *bam_filter_producer(void *input) {
   } else {
     new_batch = bam_filter_wf_batch_new(&wf_input->num_passed,
 					&wf_input->num_failed,
-					wf_input->options,
+					wf_input->prog,
 					bam1_list,
 					wf_input->passed_file,
 					wf_input->failed_file);				      
   }
+
+  profiler_stop(PROF_READER, prof_time);
     
   return new_batch;
 }
 
 //--------------------------------------------------------------------
-// workflow worker : filter reads
+// workflow worker : filter reads and compress them
 //--------------------------------------------------------------------
 
 int bam_filter_worker(void *data) {
   bam_filter_wf_batch_t *batch = (bam_filter_wf_batch_t *) data;
 
-  filter_options_t *o = batch->options;
+  filter_prog_t *prog = batch->prog;
+  bam1_t *bam1;
 
-  bam_filter_options_t *opts;
-  opts = bam_filter_options_new(o->unique, o->proper_pairs,
-				o->min_length, o->max_length,
-				o->min_quality, o->max_quality,
-				o->min_num_errors, o->max_num_errors,
-				o->region_table);
-  
-  bam_filter(batch->bam1s, batch->passed_bam1s, 
-	     batch->failed_bam1s, opts);
+  // the whole batch is filtered first, so that it is profiled apart
+  // from the compression
+  size_t num_items = array_list_size(batch->bam1s);
+  char passed[num_items];
 
-  // free memory
-  bam_filter_options_free(opts);
+  uint64_t prof_time = profiler_start(PROF_FILTERING);
+  for (size_t i = 0; i < num_items; i++) {
+    passed[i] = filter_prog_run(array_list_get(i, batch->bam1s), prog);
+  }
+  profiler_stop(PROF_FILTERING, prof_time);
+
+  for (size_t i = 0; i < num_items; i++) {
+    bam1 = array_list_get(i, batch->bam1s);
+    if (passed[i]) {
+      bam_pblock_add(bam1, batch->passed_block);
+    } else {
+      bam_pblock_add(bam1, batch->failed_block);
+    }
+  }
+
+  bam_pblock_flush(batch->passed_block);
+  bam_pblock_flush(batch->failed_block);
 
   return CONSUMER_STAGE;
 }
@@ -185,12 +252,12 @@ int bam_filter_consumer(void *data) {
   bam_filter_wf_batch_t *batch = (bam_filter_wf_batch_t *) data;
 
   // write passed reads
-  bam_fwrite_bam1s(batch->passed_bam1s, batch->passed_file);
-  (*batch->num_passed) += array_list_size(batch->passed_bam1s);
+  bam_pwriter_write(batch->passed_block, batch->passed_file);
+  (*batch->num_passed) += batch->passed_block->num_records;
 
   // write failed reads
-  bam_fwrite_bam1s(batch->failed_bam1s, batch->failed_file);
-  (*batch->num_failed) += array_list_size(batch->failed_bam1s);
+  bam_pwriter_write(batch->failed_block, batch->failed_file);
+  (*batch->num_failed) += batch->failed_block->num_records;
 
   // free memory
   bam_filter_wf_batch_free(batch);
@@ -211,13 +278,11 @@ void filter_bam(filter_options_t *opts) {
 
   char passed_filename[name_length];
   sprintf(passed_filename, "%s/passed.bam", opts->out_dirname);
-  bam_file_t *passed_file = bam_fopen_mode(passed_filename, in_file->bam_header_p, "w");
-  bam_fwrite_header(in_file->bam_header_p, passed_file);
+  bam_pwriter_t *passed_file = bam_pwriter_new(passed_filename, in_file->bam_header_p, -1);
 
   char failed_filename[name_length];
   sprintf(failed_filename, "%s/failed.bam", opts->out_dirname);
-  bam_file_t *failed_file = bam_fopen_mode(failed_filename, in_file->bam_header_p, "w");
-  bam_fwrite_header(in_file->bam_header_p, failed_file);
+  bam_pwriter_t *failed_file = bam_pwriter_new(failed_filename, in_file->bam_header_p, -1);
 
   // update opts
   if (opts->min_length == NO_VALUE) opts->min_length = MIN_VALUE;
@@ -227,13 +292,27 @@ void filter_bam(filter_options_t *opts) {
   if (opts->min_num_errors == NO_VALUE) opts->min_num_errors = MIN_VALUE;
   if (opts->max_num_errors == NO_VALUE) opts->max_num_errors = MAX_VALUE;
 
+  // compile the filters
+  filter_prog_t *prog = filter_prog_new(opts, in_file->bam_header_p);
+
   //------------------------------------------------------------------
   // workflow management
   //
   bam_filter_wf_input_t *wf_input = bam_filter_wf_input_new(opts,
+							    prog,
 							    in_file,
 							    passed_file,
 							    failed_file);
+
+  // read only the regions when the BAM file is indexed
+  if (prog->regions && !opts->no_index) {
+    wf_input->idx = bam_index_load(opts->in_filename);
+    if (wf_input->idx) {
+      LOG_INFO_F("Reading %lu regions from the BAM index\n", prog->regions->num_regions);
+    } else {
+      LOG_WARN("BAM index not found, reading the whole file\n");
+    }
+  }
   
   // create and initialize workflow
   workflow_t *wf = workflow_new();
@@ -253,6 +332,9 @@ void filter_bam(filter_options_t *opts) {
   printf("======================================================\n");
   printf("Num. passed alignments: %lu (%s)\n", wf_input->num_passed, passed_filename);
   printf("Num. failed alignments: %lu (%s)\n", wf_input->num_failed, failed_filename);
+  if (wf_input->idx) {
+    printf("(alignments out of the regions were not read)\n");
+  }
   printf("======================================================\n");
 
   // free memory
@@ -263,12 +345,8 @@ void filter_bam(filter_options_t *opts) {
   //------------------------------------------------------------------
 
   // free memory and close files
-  in_file->bam_header_p = NULL;
+  filter_prog_free(prog);
   bam_fclose(in_file);     
-  passed_file->bam_header_p = NULL;
-  bam_fclose(passed_file); 
-  bam_fclose(failed_file);
+  bam_pwriter_close(passed_file); 
+  bam_pwriter_close(failed_file);
 }
-
-//------------------------------------------------------------------------
-//------------------------------------------------------------------------
@@ -22,10 +22,13 @@
 #include "containers/khash.h"
 
 #include "bioformats/bam/bam_file.h"
-#include "bioformats/bam/bam_filter.h"
+
+#include "aux/aux_writer.h"
+#include "aux/aux_profiler.h"
 
 #include "commons_bam.h"
 #include "filter_options.h"
+#include "filter_prog.h"
 
 //------------------------------------------------------------------------
 
@@ -23,7 +23,7 @@ filter_options_t *filter_options_new(char *exec_name, char *command_name) {
   opts->gff_region_filename = NULL;
   opts->region_list = NULL;
 
-  opts->region_table = NULL;
+  opts->no_index = 0;
 
   opts->unique = 0;
   opts->proper_pairs = 0;
@@ -78,10 +78,6 @@ filter_options_t *filter_options_parse(char *exec_name, char *command_name,
 void filter_options_free(filter_options_t *opts) {
   if (opts == NULL) { return; }
 
-  if (opts->region_table) {
-    free_region_table(opts->region_table);
-  }
-  
   if (opts->in_filename) { free(opts->in_filename); }
   if (opts->out_dirname) { free(opts->out_dirname); }
   if (opts->gff_region_filename) { free(opts->gff_region_filename); }
@@ -109,11 +105,6 @@ void filter_options_validate(filter_options_t *opts) {
     opts->out_dirname = strdup(".");
   }
 
-  // region table
-  opts->region_table = build_region_table(opts->in_filename, 
-					  opts->region_list, 
-					  opts->gff_region_filename);
-
   // length range
   if (!parse_range(&opts->min_length, &opts->max_length, 
 		   opts->length_range, "alignment length range")) {
@@ -152,6 +143,9 @@ void filter_options_display(filter_options_t *opts) {
   } else if (opts->gff_region_filename) {
     printf("\tBy GFF region filename : %s\n", opts->gff_region_filename);
   }
+  if ((opts->region_list || opts->gff_region_filename) && opts->no_index) {
+    printf("\tRegions read from the whole file (index not used)\n");
+  }
   if (opts->unique) {
     printf("\tBy unique alignments\n");
   }
@@ -199,6 +193,7 @@ filter_options_t *read_cli_filter_options(void **argtable, filter_options_t *opt
   
   if (((struct arg_file*)argtable[12])->count) { opts->gff_region_filename = strdup(*(((struct arg_file*)argtable[12])->filename)); }
   if (((struct arg_str*)argtable[13])->count) { opts->region_list = strdup(*(((struct arg_str*)argtable[13])->sval)); }
+  if (((struct arg_lit*)argtable[14])->count) { opts->no_index = ((struct arg_lit*)argtable[14])->count; }
 
   return opts;
 }
@@ -234,6 +229,7 @@ void** new_argtable_filter_options() {
 
   argtable[12] = arg_file0(NULL, "gff-refion-file", NULL, "Region file name (GFF format)");
   argtable[13] = arg_str0(NULL, "region-list", NULL, "Regions (e.g., 1:3000-3200,4:100-200,...)");
+  argtable[14] = arg_lit0(NULL, "no-index", "Read the whole BAM file even if it is indexed: failed alignments include the ones out of the regions");
 
   argtable[NUM_FILTER_OPTIONS] = arg_end(20);
   
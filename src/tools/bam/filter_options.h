@@ -24,7 +24,7 @@
 
 //------------------------------------------------------------------------
 
-#define NUM_FILTER_OPTIONS     14
+#define NUM_FILTER_OPTIONS     15
 
 //------------------------------------------------------------------------
 
@@ -44,7 +44,7 @@ typedef struct filter_options {
   int min_length;
   int max_length;
 
-  region_table_t *region_table;
+  int no_index;
 
   char *length_range;
   char *quality_range;
@@ -0,0 +1,251 @@
+/*
+ * filter_prog.c
+ *
+ * Filter options compiled into a list of predicates over alignments
+ */
+
+#include "filter_prog.h"
+
+#include <stdio.h>
+
+#include "commons/log.h"
+#include "commons_bam.h"
+
+//------------------------------------------------------------------------
+// regions
+//------------------------------------------------------------------------
+
+static int target_id(const char *name, const bam_header_t *header) {
+  for (int i = 0; i < header->n_targets; i++) {
+    if (strcmp(name, header->target_name[i]) == 0) return i;
+  }
+  return -1;
+}
+
+//------------------------------------------------------------------------
+
+static void filter_regions_add(const char *chr, long start, long end,
+			       const bam_header_t *header, filter_regions_t *regions) {
+  int tid = target_id(chr, header);
+  if (tid < 0) {
+    LOG_WARN_F("Chromosome %s not found in the BAM header, region skipped\n", chr);
+    return;
+  }
+
+  // 1-based inclusive to 0-based half-open
+  if (start < 1) start = 1;
+  if (end <= 0 || end > header->target_len[tid]) end = header->target_len[tid];
+  if (start > end) return;
+
+  if (regions->num_regions >= regions->max_regions) {
+    regions->max_regions = 2 * regions->max_regions + 16;
+    regions->regions = (filter_region_t *) realloc(regions->regions,
+						   regions->max_regions * sizeof(filter_region_t));
+  }
+  filter_region_t *r = &regions->regions[regions->num_regions++];
+  r->tid = tid;
+  r->start = start - 1;
+  r->end = end;
+}
+
+//------------------------------------------------------------------------
+
+static int filter_region_cmp(const void *a, const void *b) {
+  const filter_region_t *ra = (const filter_region_t *) a;
+  const filter_region_t *rb = (const filter_region_t *) b;
+  if (ra->tid != rb->tid) return ra->tid < rb->tid ? -1 : 1;
+  if (ra->start != rb->start) return ra->start < rb->start ? -1 : 1;
+  return 0;
+}
+
+//------------------------------------------------------------------------
+
+filter_regions_t *filter_regions_new(const char *region_list, const char *gff_filename,
+				     const bam_header_t *header) {
+  if (!region_list && !gff_filename) return NULL;
+
+  filter_regions_t *p = (filter_regions_t *) calloc(1, sizeof(filter_regions_t));
+
+  if (region_list) {
+    // chr, chr:start or chr:start-end, comma separated
+    char *list = strdup(region_list), *saveptr = NULL, *colon;
+    for (char *token = strtok_r(list, ",", &saveptr); token; token = strtok_r(NULL, ",", &saveptr)) {
+      long start = 1, end = 0;
+      if ((colon = strrchr(token, ':')) != NULL) {
+	*colon = 0;
+	sscanf(colon + 1, "%ld-%ld", &start, &end);
+      }
+      filter_regions_add(token, start, end, header, p);
+    }
+    free(list);
+  } else {
+    // seqname, source, feature, start, end, ...
+    FILE *f = fopen(gff_filename, "r");
+    if (!f) {
+      LOG_FATAL_F("Could not open GFF region file %s\n", gff_filename);
+    }
+    char line[4096], chr[1024];
+    long start, end;
+    while (fgets(line, sizeof(line), f)) {
+      if (line[0] == '#' || line[0] == '\n') continue;
+      if (sscanf(line, "%1023s %*s %*s %ld %ld", chr, &start, &end) == 3) {
+	filter_regions_add(chr, start, end, header, p);
+      }
+    }
+    fclose(f);
+  }
+
+  // sort and merge overlapping regions
+  qsort(p->regions, p->num_regions, sizeof(filter_region_t), filter_region_cmp);
+  size_t n = 0;
+  for (size_t i = 0; i < p->num_regions; i++) {
+    if (n > 0 && p->regions[n - 1].tid == p->regions[i].tid &&
+	p->regions[i].start <= p->regions[n - 1].end) {
+      if (p->regions[i].end > p->regions[n - 1].end) {
+	p->regions[n - 1].end = p->regions[i].end;
+      }
+    } else {
+      p->regions[n++] = p->regions[i];
+    }
+  }
+  p->num_regions = n;
+
+  p->num_targets = header->n_targets;
+  p->first = (size_t *) calloc(p->num_targets + 1, sizeof(size_t));
+  for (size_t i = 0; i < n; i++) {
+    p->first[p->regions[i].tid + 1]++;
+  }
+  for (int t = 0; t < p->num_targets; t++) {
+    p->first[t + 1] += p->first[t];
+  }
+
+  return p;
+}
+
+//------------------------------------------------------------------------
+
+void filter_regions_free(filter_regions_t *regions) {
+  if (regions) {
+    if (regions->regions) free(regions->regions);
+    if (regions->first) free(regions->first);
+    free(regions);
+  }
+}
+
+//------------------------------------------------------------------------
+// predicates
+//------------------------------------------------------------------------
+
+// min: flag mask, max: expected value
+static int op_flags(const bam1_t *bam1, const filter_op_t *op) {
+  return (bam1->core.flag & op->min) == op->max;
+}
+
+static int op_quality(const bam1_t *bam1, const filter_op_t *op) {
+  return bam1->core.qual >= op->min && bam1->core.qual <= op->max;
+}
+
+static int op_length(const bam1_t *bam1, const filter_op_t *op) {
+  return bam1->core.l_qseq >= op->min && bam1->core.l_qseq <= op->max;
+}
+
+//------------------------------------------------------------------------
+
+static int op_region(const bam1_t *bam1, const filter_op_t *op) {
+  const filter_regions_t *regions = op->regions;
+  int tid = bam1->core.tid, pos = bam1->core.pos;
+
+  if (tid < 0 || tid >= regions->num_targets) return 0;
+
+  // first region ending after pos
+  size_t lo = regions->first[tid], hi = regions->first[tid + 1];
+  while (lo < hi) {
+    size_t mid = (lo + hi) >> 1;
+    if (regions->regions[mid].end <= pos) lo = mid + 1;
+    else hi = mid;
+  }
+  if (lo == regions->first[tid + 1]) return 0;
+
+  const filter_region_t *r = &regions->regions[lo];
+  if (r->start <= pos) return 1;
+
+  // starts before the region, the CIGAR tells whether it reaches it
+  return r->start < (int) bam_calend(&bam1->core, bam1_cigar(bam1));
+}
+
+//------------------------------------------------------------------------
+
+static int op_num_errors(const bam1_t *bam1, const filter_op_t *op) {
+  uint8_t *nm = bam_aux_get(bam1, "NM");
+  if (!nm) return 0;
+  int32_t num_errors = bam_aux2i(nm);
+  return num_errors >= op->min && num_errors <= op->max;
+}
+
+static int op_unique(const bam1_t *bam1, const filter_op_t *op) {
+  uint8_t *nh = bam_aux_get(bam1, "NH");
+  if (nh) return bam_aux2i(nh) == 1;
+  return !(bam1->core.flag & BAM_FSECONDARY);
+}
+
+//------------------------------------------------------------------------
+// compiler
+//------------------------------------------------------------------------
+
+static void filter_prog_add(filter_op_func_t func, int min, int max, filter_prog_t *prog) {
+  filter_op_t *op = &prog->ops[prog->num_ops++];
+  op->func = func;
+  op->min = min;
+  op->max = max;
+  op->regions = prog->regions;
+}
+
+static inline int is_range(int min, int max) {
+  return min > MIN_VALUE || max < MAX_VALUE;
+}
+
+//------------------------------------------------------------------------
+
+filter_prog_t *filter_prog_new(filter_options_t *opts, const bam_header_t *header) {
+  filter_prog_t *p = (filter_prog_t *) calloc(1, sizeof(filter_prog_t));
+
+  p->regions = filter_regions_new(opts->region_list, opts->gff_region_filename, header);
+
+  // mapped reads, and proper pairs
+  int mask = BAM_FUNMAP, value = 0;
+  if (opts->proper_pairs) {
+    mask |= BAM_FPAIRED | BAM_FPROPER_PAIR;
+    value |= BAM_FPAIRED | BAM_FPROPER_PAIR;
+  }
+  filter_prog_add(op_flags, mask, value, p);
+
+  if (is_range(opts->min_quality, opts->max_quality)) {
+    filter_prog_add(op_quality, opts->min_quality, opts->max_quality, p);
+  }
+  if (is_range(opts->min_length, opts->max_length)) {
+    filter_prog_add(op_length, opts->min_length, opts->max_length, p);
+  }
+  if (p->regions) {
+    filter_prog_add(op_region, 0, 0, p);
+  }
+  if (is_range(opts->min_num_errors, opts->max_num_errors)) {
+    filter_prog_add(op_num_errors, opts->min_num_errors, opts->max_num_errors, p);
+  }
+  if (opts->unique) {
+    filter_prog_add(op_unique, 0, 0, p);
+  }
+
+  return p;
+}
+
+//------------------------------------------------------------------------
+
+void filter_prog_free(filter_prog_t *prog) {
+  if (prog) {
+    filter_regions_free(prog->regions);
+    free(prog);
+  }
+}
+
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
@@ -0,0 +1,94 @@
+#ifndef FILTER_PROG_H
+#define FILTER_PROG_H
+
+/*
+ * filter_prog.h
+ *
+ * Filter options compiled into a list of predicates over alignments
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "samtools/bam.h"
+
+#include "filter_options.h"
+
+//------------------------------------------------------------------------
+// Only the predicates the user asked for are compiled, sorted by cost:
+// flag masks first, then the fixed-offset core fields (quality, length,
+// position), then whatever needs the variable data (alignment end from
+// the CIGAR, NM and NH tags). An alignment fails at the first predicate
+// it does not satisfy.
+//
+// Regions are kept sorted by target and merged, so they can be read
+// directly from the BAM index and looked up by binary search.
+//------------------------------------------------------------------------
+
+#define FILTER_PROG_MAX_OPS  8
+
+//------------------------------------------------------------------------
+
+// [start, end), 0-based
+typedef struct filter_region {
+  int tid;
+  int start;
+  int end;
+} filter_region_t;
+
+typedef struct filter_regions {
+  size_t num_regions;
+  size_t max_regions;
+  filter_region_t *regions;
+
+  // regions of the target tid: [first[tid], first[tid + 1])
+  int num_targets;
+  size_t *first;
+} filter_regions_t;
+
+//------------------------------------------------------------------------
+
+struct filter_op;
+typedef int (*filter_op_func_t)(const bam1_t *bam1, const struct filter_op *op);
+
+typedef struct filter_op {
+  filter_op_func_t func;
+  int min;
+  int max;
+  const filter_regions_t *regions;
+} filter_op_t;
+
+typedef struct filter_prog {
+  int num_ops;
+  filter_op_t ops[FILTER_PROG_MAX_OPS];
+  filter_regions_t *regions;
+} filter_prog_t;
+
+//------------------------------------------------------------------------
+
+// parses the region list (chr, chr:start-end, 1-based) or the GFF
+// file, returns NULL if no region is given
+filter_regions_t *filter_regions_new(const char *region_list, const char *gff_filename,
+				     const bam_header_t *header);
+void filter_regions_free(filter_regions_t *regions);
+
+//------------------------------------------------------------------------
+
+// ranges must be already set (NO_VALUE replaced by MIN/MAX_VALUE)
+filter_prog_t *filter_prog_new(filter_options_t *opts, const bam_header_t *header);
+void filter_prog_free(filter_prog_t *prog);
+
+static inline int filter_prog_run(const bam1_t *bam1, const filter_prog_t *prog) {
+  for (int i = 0; i < prog->num_ops; i++) {
+    if (!prog->ops[i].func(bam1, &prog->ops[i])) return 0;
+  }
+  return 1;
+}
+
+//------------------------------------------------------------------------
+
+#endif // end of FILTER_PROG_H
+
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
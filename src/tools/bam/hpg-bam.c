@@ -20,10 +20,9 @@
 #include "filter_bam.h"
 #include "index_options.h"
 #include "sort_options.h"
+#include "aux/aux_sort.h"
 
 
-int bam_sort_core(int is_by_qname, const char *fn, const char *prefix, size_t max_mem);
-
 //bam_index_t *bam_index_core(bamFile fp);
 //void bam_index_save(const bam_index_t *idx, FILE *fp);
 //void bam_sort_core_ext(int is_by_qname, const char *fn, const char *prefix, size_t max_mem, int is_stdout);
@@ -42,11 +41,12 @@ void usage(char *exec_name) {
     printf("Usage: %s <command> [options]\n", exec_name);
     printf("\n");
     printf("Command: stats\t\tstatistics summary\n");
+    printf("         stats-query\tquery a stats store: stats-query <store-file> [chr[:start-end]]\n");
     printf("         filter\t\tfilter a BAM file by using advanced criteria\n");
     printf("         recalibrate\tbase quality recalibrate from a BAM file\n");
     printf("         realign\tlocal realign from BAM file\n");
     printf("         index\t\tindex a BAM file (using the samtools)\n");
-    printf("         sort\t\tsort a BAM file (using the samtools)\n");
+    printf("         sort\t\tsort a BAM file\n");
 
     //    printf("         compare\tcompare two BAM files\n");
     //    printf("         realignment\trealign locally a BAM file\n");
@@ -75,6 +75,9 @@ int main (int argc, char *argv[]) {
 
   char *command_name = argv[1];  
 
+  // HPG_PROFILE=<file> profiles the run
+  profiler_init(exec_name);
+
   argc--;
   argv++;
 
@@ -99,6 +102,20 @@ int main (int argc, char *argv[]) {
     // free memory
     stats_options_free(opts);
 
+  } else if (strcmp(command_name, "stats-query") == 0) {
+
+    //--------------------------------------------------------------------
+    //          S T A T S   Q U E R Y     C O M M A N D
+    //--------------------------------------------------------------------
+
+    if (argc < 2) {
+      usage(exec_name);
+    }
+
+    size_t num_rows = stats_store_query(argv[1], (argc > 2 ? argv[2] : NULL), stdout);
+    fprintf(stderr, "%lu alignments found\n", num_rows);
+    exit(0);
+
   } else if (strcmp(command_name, "filter" ) == 0) {
 
     //--------------------------------------------------------------------
@@ -265,9 +282,25 @@ int main (int argc, char *argv[]) {
     }
 
     // run sort
-    bam_sort_core(is_by_qname, opts->in_filename, path, opts->max_memory);
+    bam_file_t *in_file = bam_fopen(opts->in_filename);
+    if (!in_file) {
+      LOG_FATAL_F("Could not open BAM file %s\n", opts->in_filename);
+    }
+    bam_sorter_t *sorter = bam_sorter_new(in_file->bam_header_p, path, is_by_qname,
+					  opts->max_memory, opts->num_threads);
+    bam1_t *bam1 = bam_init1();
+    while (bam_read1(in_file->bam_fd, bam1) > 0) {
+      bam_sorter_add(bam1, sorter);
+      bam1 = bam_init1();
+    }
+    bam_destroy1(bam1);
+
+    strcat(path, ".bam");
+    bam_sorter_finish(path, sorter);
+    bam_sorter_free(sorter);
+    bam_fclose(in_file);
 
-    printf("Sorted BAM file in %s.bam\n", path);
+    printf("Sorted BAM file in %s\n", path);
 
     // free memory
     sort_options_free(opts);
@@ -277,27 +277,26 @@ recal_recalibrate_alignment(bam1_t* alig, const recal_info_t *bam_info, recal_re
 	return NO_ERROR;
 }
 
+//Dinucleotide index of a 4 bit BAM nucleotide (A, G, C, T order as DINUC enum), -1 if not ACGT
+static const int8_t recal_nt4_dinuc[16] = { -1, 0, 2, -1, 1, -1, -1, -1, 3, -1, -1, -1, -1, -1, -1, -1 };
+
 //Function for library internal use
 static INLINE void
 recal_recalibrate_alignment_priv(bam1_t* alig, const recal_info_t *bam_info, recal_recalibration_env_t *recalibration_env)
 {
 	U_QUALS qual_index;
-	unsigned int matrix_index;
 	unsigned int i;
 	U_DINUC dinuc;
+	int8_t prev_nt, curr_nt;
 
 	//Sequence
-	char *bam_seq;
-	char *bam_quals;
-	char *res_quals;
+	uint8_t *bam_seq;
+	uint8_t *bam_quals;
 	U_CYCLES bam_seq_l;
-	U_CYCLES bam_seq_max_l;
 
 	//Recalibration
-	double delta_r, delta_rc, delta_rd;
-
-
-
+	const char *qual_table;
+	size_t cycle_ldim, qual_ldim;
 
 	//CHECK ARGUMENTS (Assuming this function is called always from recal_recalibrate_batch)
 	{
@@ -305,104 +304,46 @@ recal_recalibrate_alignment_priv(bam1_t* alig, const recal_info_t *bam_info, rec
 		ASSERT(alig);
 		ASSERT(bam_info);
 		ASSERT(recalibration_env);
-	}
-
-	//FILTERS
-	{
-
-	}
-
-	//SET VARS
-	{
-		bam_quals = recalibration_env->bam_quals;
-		bam_seq_l = 0;
-		bam_seq_max_l = recalibration_env->bam_seq_max_l;
+		ASSERT(bam_info->qual_table);
 	}
 
 	//Get sequence length
 	bam_seq_l = alig->core.l_qseq;
 
 	//Sequence length check
-	ASSERT(alig->core.l_qseq <= bam_seq_max_l);
+	ASSERT(alig->core.l_qseq <= recalibration_env->bam_seq_max_l);
 	ASSERT(bam_seq_l != 0);
 
-	//Get sequence
-	bam_seq = new_sequence_from_bam((bam1_t *)alig);
+	//Work directly on packed sequence and qualities
+	bam_seq = bam1_seq(alig);
+	bam_quals = bam1_qual(alig);
 
-	//Get quals
-	new_quality_from_bam_ref((bam1_t *)alig, 0, bam_quals, bam_seq_max_l);
+	//Table dimensions
+	qual_table = bam_info->qual_table;
+	cycle_ldim = bam_info->num_dinuc;
+	qual_ldim = bam_info->num_cycles * cycle_ldim;
 
-	//Allocate for result
-	res_quals = (char *)malloc(bam_seq_l * sizeof(char));
-	memcpy(res_quals, bam_quals, bam_seq_l * sizeof(char));
-
-	//Iterates nucleotides in this read
-	dinuc = 0;
+	//Iterates nucleotides in this read, qualities are replaced in place from table
+	prev_nt = -1;
 	for(i = 0; i < bam_seq_l; i++)
 	{
+		curr_nt = recal_nt4_dinuc[bam1_seqi(bam_seq, i)];
+
 		//Compare only if the nucleotide is not "N"
 		#ifdef NOT_COUNT_NUCLEOTIDE_N
-		if(bam_seq[i] != 'N')
+		if(bam1_seqi(bam_seq, i) != 15)
 		#endif
 		{
-			//Recalibrate quality
 			qual_index = bam_quals[i] - bam_info->min_qual;
-			delta_r = bam_info->qual_delta[qual_index];
-
-			matrix_index = qual_index * bam_info->num_cycles + i;
-			delta_rc = bam_info->qual_cycle_delta[matrix_index];
-
-			//dont take prev dinuc in first cycle (delta = 0)
-			if(i > 0)
+			if(qual_index < bam_info->num_quals)
 			{
-				recal_get_dinuc(bam_seq[i-1], bam_seq[i], &dinuc);
-				matrix_index = qual_index * bam_info->num_dinuc + i;
-				delta_rd = bam_info->qual_dinuc_delta[matrix_index];
+				//First cycle and non ACGT pairs use unknown dinuc
+				dinuc = (prev_nt < 0 || curr_nt < 0) ? d_X : (prev_nt << 2) + curr_nt;
+				bam_quals[i] = qual_table[qual_index * qual_ldim + i * cycle_ldim + dinuc];
 			}
-			else
-			{
-				delta_rd = 0.0;
-			}
-
-			//Recalibration formula
-
-			double calidad = (double)bam_quals[i];
-			if(calidad > MIN_QUALITY_TO_STAT)
-			{
-				double res = bam_info->total_estimated_Q + bam_info->total_delta + delta_r + delta_rc + delta_rd;
-				res_quals[i] = (char)res;
-			}
-			/*else
-			{
-				res_quals[i] = (char)calidad;
-			}*/
 		}
-	}
 
-	//Convert bam1_t to alignment_t
-	//aux_alig = alignment_new_by_bam(alig, 0);
-
-	//Set qualities in alignment
-	//memcpy(aux_alig->quality, res_quals, bam_seq_l);
-
-	//Fix reads in alignment (sequence conversion to string is bug)
-	//memcpy(aux_alig->sequence, bam_seq, bam_seq_l);
-
-	//Convert alig to bam1 format
-	//aux_alig1 = convert_to_bam(aux_alig, 0);
-
-	//Overwrite batch readings
-	//free(alig->data);
-	//memcpy(alig, aux_alig1, sizeof(bam1_t));
-
-	memcpy(bam1_qual(alig), res_quals, bam_seq_l);
-
-	//Memory free
-#ifdef __SSE2__
-	_mm_free(bam_seq);
-#else
-	free(bam_seq);
-#endif
-	free(res_quals);
+		prev_nt = curr_nt;
+	}
 }
 
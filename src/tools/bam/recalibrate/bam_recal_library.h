@@ -66,6 +66,8 @@ struct recal_info {
     double* qual_dinuc_miss;		//Misses per quality-dinuc pair
     U_BASES* qual_dinuc_bases;		//Bases per quality-dinuc pair
     double* qual_dinuc_delta;		//Deltas per quality-dinuc pair
+
+    char* qual_table;				//Recalibrated quality per quality-cycle-dinuc, from deltas
 };
 
 /**
@@ -209,6 +211,16 @@ EXTERNC ERROR_CODE recal_add_base_v(recal_info_t *data, const char *seq, const c
  */
 EXTERNC ERROR_CODE recal_calc_deltas(recal_info_t* data);
 
+/**
+ * \brief Compute recalibrated qualities table from deltas.
+ *
+ * Table is indexed by quality, cycle and dinucleotide ((q * num_cycles + c) * num_dinuc + d)
+ * and already applies the recalibration formula. Called by recal_calc_deltas.
+ *
+ * \param data Data with deltas computed.
+ */
+EXTERNC ERROR_CODE recal_calc_qual_table(recal_info_t* data);
+
 
 /***********************************************
  * DINUC ENUM OPERATIONS
@@ -68,6 +68,9 @@ recal_init_info(const U_CYCLES cycles, recal_info_t *out_data)
 	data->qual_dinuc_bases = (U_BASES *)malloc(vector_size * NUM_DINUC * sizeof(U_BASES));
 	new_vector_double(vector_size * NUM_DINUC, 0.0, &(data->qual_dinuc_delta));
 
+	//Recalibrated qualities table, computed with deltas
+	data->qual_table = NULL;
+
 	//Initialize vector values
 	memset(data->qual_bases, 0, vector_size * sizeof(U_BASES));
 	memset(data->qual_cycle_bases, 0, vector_size * cycles * sizeof(U_BASES));
@@ -99,6 +102,10 @@ recal_destroy_info(recal_info_t *data)
 	free(d->qual_dinuc_bases);
 	free(d->qual_dinuc_delta);
 
+	//Free qualities table
+	if(d->qual_table)
+		free(d->qual_table);
+
 	return NO_ERROR;
 }
 
@@ -307,49 +314,90 @@ recal_add_base_v(recal_info_t *data, const char *seq, const char *quals, const U
 {
 	U_CYCLES i;
 	U_CYCLES cycles;
-	ERROR_CODE err;
-
+	int qual_index;
+	int qual_cycle_index;
+	int qual_dinuc_index;
+	uint8_t miss;
+	size_t errors;
+
+	//Counters
+	double *qual_miss, *qual_cycle_miss, *qual_dinuc_miss;
+	U_BASES *qual_bases, *qual_cycle_bases, *qual_dinuc_bases;
+	double total_miss;
+	U_BASES total_bases;
+
+	//Cycles are checked once for the whole read
 	cycles = num_cycles;
+	if(init_cycle + cycles > data->num_cycles)
+	{
+		printf("add_base: ERROR, cycle must be positive and minor than NUM_CYCLES (%d), Cycle: %d\n", data->num_cycles, init_cycle + cycles - 1);
+		cycles = init_cycle < data->num_cycles ? data->num_cycles - init_cycle : 0;
+	}
+
+	//Matrix handles
+	qual_miss = data->qual_miss;
+	qual_bases = data->qual_bases;
+	qual_cycle_miss = data->qual_cycle_miss + init_cycle;
+	qual_cycle_bases = data->qual_cycle_bases + init_cycle;
+	qual_dinuc_miss = data->qual_dinuc_miss;
+	qual_dinuc_bases = data->qual_dinuc_bases;
+	total_miss = 0.0;
+	total_bases = 0;
+	errors = 0;
 
 	//Iterates cycles
-	//for(i = init_cycle; i <= end_cycle; i++)
 	for(i = 0; i < cycles; i++)
 	{
 		//Check if count this nucleotide
-		if(mask == NULL || mask[i])
+		if(mask != NULL && !mask[i])
+			continue;
+
+		switch(seq[i])
 		{
-			switch(seq[i])
-			{
-			case 'A':
-			case 'C':
-			case 'G':
-			case 'T':
-			#ifndef NOT_COUNT_NUCLEOTIDE_N
-			case 'N':
-			#endif
-				err = recal_add_base(data, quals[i], i + init_cycle, dinuc[i], misses[i]);
-				if(err)
-				{
-					switch(err)
-					{
-					case INVALID_INPUT_QUAL:
-						printf("Error INVALID_INPUT_QUAL Base: %c\n", seq[i]);
-						break;
-					case INVALID_INPUT_DINUC:
-						printf("Error INVALID_INPUT_DINUC Base: %c\n", seq[i]);
-						break;
-					default:
-						printf("Error UNKNOWN Base: %c\n", seq[i]);
-						break;
-					}
-				}
-				break;
+		case 'A':
+		case 'C':
+		case 'G':
+		case 'T':
+		#ifndef NOT_COUNT_NUCLEOTIDE_N
+		case 'N':
+		#endif
+			break;
 
-			default:
-				//printf("ERROR: Corrupted nucleotide read = %c\n", seq[i]);
-				break;
-			}
+		default:
+			continue;
+		}
+
+		if(quals[i] < MIN_QUALITY_TO_STAT)
+			continue;
+
+		//Covariates
+		qual_index = quals[i] - data->min_qual;
+		if(qual_index >= data->num_quals || qual_index < 0 || dinuc[i] < 0 || dinuc[i] >= data->num_dinuc)
+		{
+			errors++;
+			continue;
 		}
+		qual_cycle_index = qual_index * data->num_cycles + i;
+		qual_dinuc_index = qual_index * data->num_dinuc + dinuc[i];
+		miss = misses[i] != 0;
+
+		//Increase counters without branching on misses
+		total_miss += miss;
+		total_bases++;
+		qual_miss[qual_index] += miss;
+		qual_bases[qual_index]++;
+		qual_cycle_miss[qual_cycle_index] += miss;
+		qual_cycle_bases[qual_cycle_index]++;
+		qual_dinuc_miss[qual_dinuc_index] += miss;
+		qual_dinuc_bases[qual_dinuc_index]++;
+	}
+
+	data->total_miss += total_miss;
+	data->total_bases += total_bases;
+
+	if(errors)
+	{
+		printf("add_base: ERROR, %lu bases with invalid quality or dinucleotide\n", errors);
 	}
 
 	return NO_ERROR;
@@ -449,6 +497,58 @@ recal_calc_deltas(recal_info_t* data)
 		}
 	}
 
+	//Recalibrated qualities table
+	recal_calc_qual_table(data);
+
+	return NO_ERROR;
+}
+
+/**
+ * Compute recalibrated qualities table from deltas.
+ */
+ERROR_CODE
+recal_calc_qual_table(recal_info_t* data)
+{
+	int i, j, k;
+	size_t index;
+	double base_Q;
+
+	if(!data)
+		return INVALID_INPUT_PARAMS_NULL;
+
+	//Allocate table
+	if(data->qual_table == NULL)
+	{
+		data->qual_table = (char *)malloc(data->num_quals * data->num_cycles * data->num_dinuc * sizeof(char));
+	}
+
+	index = 0;
+	for(i = 0; i < data->num_quals; i++)
+	{
+		for(j = 0; j < data->num_cycles; j++)
+		{
+			base_Q = data->total_estimated_Q + data->total_delta + data->qual_delta[i] + data->qual_cycle_delta[i * data->num_cycles + j];
+
+			for(k = 0; k < data->num_dinuc; k++, index++)
+			{
+				if(i + data->min_qual <= MIN_QUALITY_TO_STAT)
+				{
+					//Low qualities are not recalibrated
+					data->qual_table[index] = (char)(i + data->min_qual);
+				}
+				else if(j == 0)
+				{
+					//No previous nucleotide in first cycle (dinuc delta = 0)
+					data->qual_table[index] = (char)base_Q;
+				}
+				else
+				{
+					data->qual_table[index] = (char)(base_Q + data->qual_dinuc_delta[i * data->num_dinuc + k]);
+				}
+			}
+		}
+	}
+
 	return NO_ERROR;
 }
 
@@ -737,6 +837,9 @@ recal_load_recal_info(const char *path, recal_info_t *data)
 
 	fclose(fp);
 
+	//Recalibrated qualities table from loaded deltas
+	recal_calc_qual_table(data);
+
 	return NO_ERROR;
 }
 
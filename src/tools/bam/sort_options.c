@@ -19,6 +19,7 @@ sort_options_t *sort_options_new(char *exec_name, char *command_name) {
   opts->help = 0;
 
   opts->max_memory = 500000000;
+  opts->num_threads = 2;
   opts->criteria = NULL; //strdup("coord");
 
   opts->in_filename = NULL;
@@ -97,6 +98,12 @@ void sort_options_validate(sort_options_t *opts) {
     usage_sort_options(opts);
   }
 
+  if (opts->num_threads <= 0) {
+    printf("\nError: Invalid number of threads (%i), it must be greater than 0 !\n\n",
+	   opts->num_threads);
+    usage_sort_options(opts);
+  }
+
   if (!opts->criteria) {
     opts->criteria = strdup("coord");
   }
@@ -128,6 +135,7 @@ void sort_options_display(sort_options_t *opts) {
 
   printf("Architecture options\n");
   printf("\tMax. memory: %lu\n", opts->max_memory);
+  printf("\tNum. threads: %i\n", opts->num_threads);
   printf("=================================================\n");
 }
 
@@ -140,6 +148,7 @@ sort_options_t *read_cli_sort_options(void **argtable, sort_options_t *opts) {
   if (((struct arg_file*)argtable[2])->count) { opts->out_dirname = strdup(*(((struct arg_file*)argtable[2])->filename)); }
   if (((struct arg_int*)argtable[3])->count) { opts->max_memory = *(((struct arg_int*)argtable[3])->ival); }
   if (((struct arg_str*)argtable[4])->count) { opts->criteria = strdup(*(((struct arg_str*)argtable[4])->sval)); }
+  if (((struct arg_int*)argtable[5])->count) { opts->num_threads = *(((struct arg_int*)argtable[5])->ival); }
   
   return opts;
 }
@@ -163,6 +172,7 @@ void** new_argtable_sort_options() {
   argtable[2] = arg_file0("o", "outdir", NULL, "Output file name (BAM format)");
   argtable[3] = arg_int0(NULL, "max-memory", NULL, "Approximately the maximum required memory [500000000]");
   argtable[4] = arg_str0("c", "criteria", NULL, "Sorting criteria: 'coord' to sort by chromosomal coordinates, and 'name' by read names [coord]");
+  argtable[5] = arg_int0("t", "num-threads", NULL, "Number of threads to sort and compress in parallel [2]");
   
   argtable[NUM_SORT_OPTIONS] = arg_end(20);
   
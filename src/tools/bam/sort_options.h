@@ -21,7 +21,7 @@
 
 //------------------------------------------------------------------------
 
-#define NUM_SORT_OPTIONS	5
+#define NUM_SORT_OPTIONS	6
 
 //------------------------------------------------------------------------
 
@@ -29,6 +29,7 @@ typedef struct sort_options {
   int help;
 
   size_t max_memory;
+  int num_threads;
   char *criteria;
 
   char* in_filename;
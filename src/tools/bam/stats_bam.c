@@ -65,6 +65,11 @@ typedef struct bam_stats_wf_batch {
   stats_counters_t *counters;
   array_list_t *passed_bam1s;
   array_list_t *failed_bam1s;
+
+  // reading order and coordinate key of the last read, to release
+  // the coverage of finished regions
+  size_t id;
+  uint64_t last_key;
 } bam_stats_wf_batch_t;
 
 //--------------------------------------------------------------------
@@ -113,9 +118,12 @@ void bam_stats_wf_batch_free(bam_stats_wf_batch_t *p) {
 // workflow producer
 //--------------------------------------------------------------------
 
+size_t num_produced_batches = 0;
+
 void *bam_stats_producer(void *input) {
   bam_stats_wf_input_t *wf_input = (bam_stats_wf_input_t *) input;
   bam_stats_wf_batch_t *new_batch = NULL;
+  uint64_t prof_time = profiler_start(PROF_READER);
   int max_num_bam1s = wf_input->options->batch_size;
 
   bamFile bam_file = wf_input->in_file->bam_fd;
@@ -132,6 +140,7 @@ void *bam_stats_producer(void *input) {
 	LOG_INFO_F("%i reads extracting from disk...\n", read_progress);
       }
 
+      stats_coverage_check_order(bam1, wf_input->counters->coverage);
       array_list_insert(bam1, bam1_list);
     } else {
       bam_destroy1(bam1);
@@ -149,8 +158,12 @@ void *bam_stats_producer(void *input) {
 				       bam1_list,  
 				       NULL,
 				       wf_input->counters);				      
+    new_batch->id = num_produced_batches++;
+    new_batch->last_key = stats_coverage_key(array_list_get(num_items - 1, bam1_list));
   }
 
+  profiler_stop(PROF_READER, prof_time);
+
   return new_batch;
 }
 
@@ -160,6 +173,8 @@ void *bam_stats_producer(void *input) {
 
 int bam_stats_worker(void *data) {
   bam_stats_wf_batch_t *batch = (bam_stats_wf_batch_t *) data;
+  array_list_t *bam1s = batch->bam1s;
+  uint64_t prof_time = profiler_start(PROF_STATISTICS);
 
   //  printf("worker: active items = %i of %i\n", workflow_get_num_items(workflow), workflow->max_num_work_items);
 
@@ -184,6 +199,7 @@ int bam_stats_worker(void *data) {
     bam_filter(batch->bam1s, batch->passed_bam1s, 
 	       batch->failed_bam1s, opts);
 
+    bam1s = batch->passed_bam1s;
     if ((num_items = array_list_size(batch->passed_bam1s)) > 0) {
       // compute statistics for those reads that passed the filters
       batch->bam_stats = array_list_new(num_items,
@@ -210,6 +226,35 @@ int bam_stats_worker(void *data) {
     
   }
 
+  // coverage addition and stats store block, in parallel with the
+  // other workers
+  bam1_t *bam1;
+  bam_stats_t *stats;
+  size_t num_items = array_list_size(batch->bam_stats);
+  stats_store_block_t *block = NULL;
+  if (batch->options->store) {
+    block = stats_store_block_new(num_items);
+  }
+
+  for (size_t i = 0; i < num_items; i++) {
+    stats = array_list_get(i, batch->bam_stats);
+    if (!stats || !stats->mapped) continue;
+
+    bam1 = array_list_get(i, bam1s);
+    stats_coverage_add(bam1->core.tid, bam1->core.pos, bam1->core.pos + bam1->core.l_qseq,
+		       batch->counters->coverage);
+    if (block) {
+      stats_store_block_add(bam1, stats, block);
+    }
+  }
+
+  if (block) {
+    stats_store_write_block(batch->id, block, batch->options->store);
+    stats_store_block_free(block);
+  }
+
+  profiler_stop(PROF_STATISTICS, prof_time);
+
   return CONSUMER_STAGE;
 }
 
@@ -222,43 +267,17 @@ int bam_stats_consumer(void *data) {
 
   //  printf("consumer: active items = %i of %i\n", workflow_get_num_items(workflow), workflow->max_num_work_items);
 
-  bam1_t *bam1;
   bam_stats_wf_batch_t *batch = (bam_stats_wf_batch_t *) data;
   
   bam_stats_t *stats;
   stats_counters_t *counters = batch->counters;
 
-  int strand, seq_id, start, end, len, quality, gc;
+  int strand, len, quality, gc;
   size_t num_items = array_list_size(batch->bam_stats);
 
-  array_list_t *bam1s = batch->bam1s;
-
   if (batch->options->region_table) {
     counters->num_passed += array_list_size(batch->passed_bam1s);
     counters->num_failed += array_list_size(batch->failed_bam1s);
-    bam1s = batch->passed_bam1s;
-  }
-
-  // variables for storint stats in db
-  int db_on = batch->options->db_on;
-  sqlite3 *db = NULL;
-  sqlite3_stmt* stmt;
-  bam_query_fields_t *fields;
-  char* errorMessage;
-  khash_t(stats_chunks) *hash = NULL;
-  size_t *sequence_lengths = NULL;
-  char **sequence_labels = NULL;
-
-  if (db_on) {
-    db = batch->options->db;
-    hash = batch->options->hash;
-
-    sequence_labels = counters->sequence_labels;
-    sequence_lengths = counters->sequence_lengths;
-
-    prepare_statement_bam_query_fields(db, &stmt);
-
-    sqlite3_exec(db, "BEGIN TRANSACTION", NULL, NULL, &errorMessage);
   }
 
   for (int i = 0; i < num_items; i++) {
@@ -319,41 +338,14 @@ int bam_stats_consumer(void *data) {
     counters->quality_acc += quality;
     counters->quality[quality]++;
     
-    // coverage addition
-    bam1 = array_list_get(i, bam1s);
-
-    seq_id = bam1->core.tid;
-    start = bam1->core.pos;
-    end = start + bam1->core.l_qseq;
-
-    for (int p = start; p < end; p++) {
-      counters->sequence_depths_per_nt[seq_id][p]++;
-    }
-
-    // save into db: bam query fields
-    if (db_on) {
-      fields = bam_query_fields_new(bam1_qname(bam1), sequence_labels[seq_id], 
-				    sequence_lengths[seq_id], strand, start + 1, end + 1, 
-				    (uint32_t) bam1->core.flag, stats->quality, 
-				    stats->num_errors, stats->num_indels, stats->indels_length,
-				    stats->isize);
-      insert_statement_bam_query_fields(fields, stmt, db);
-
-      update_chunks_hash(fields->chr, fields->chr_length, BAM_CHUNKSIZE,
-			 fields->start, fields->end, hash);
-      bam_query_fields_free(fields);
-    } 
   } // for each item
 
   //  if (bam_progress % 500000 == 0) {
   //    LOG_INFO_F("%i reads processed !\n", bam_progress);
   //  }
 
-  if (db_on) {
-    sqlite3_exec(db, "COMMIT TRANSACTION", NULL, NULL, &errorMessage);
-
-    sqlite3_finalize(stmt);
-  }
+  // coverage of the regions already read by all the batches is final
+  stats_coverage_batch_done(batch->id, batch->last_key, counters->coverage);
 
   // free memory
   bam_stats_wf_batch_free(batch);
@@ -362,6 +354,46 @@ int bam_stats_consumer(void *data) {
 
 }
 
+//--------------------------------------------------------------------
+// SQLite export: bulk load of the stats store in a single transaction
+//--------------------------------------------------------------------
+
+void stats_store_load_db(char *store_filename, stats_options_t *opts) {
+  sqlite3 *db = opts->db;
+  sqlite3_stmt* stmt;
+  bam_query_fields_t *fields;
+  char* errorMessage;
+
+  stats_store_t *store = stats_store_open(store_filename);
+  stats_store_block_t *block = stats_store_block_new(opts->batch_size);
+
+  prepare_statement_bam_query_fields(db, &stmt);
+  sqlite3_exec(db, "BEGIN TRANSACTION", NULL, NULL, &errorMessage);
+
+  while (stats_store_read_block(block, store)) {
+    for (size_t i = 0; i < block->num_rows; i++) {
+      fields = bam_query_fields_new(block->names + block->name_offsets[i],
+				    store->target_names[block->tid[i]],
+				    store->target_lengths[block->tid[i]],
+				    block->strand[i], block->start[i] + 1, block->end[i] + 1,
+				    (uint32_t) block->flag[i], block->quality[i],
+				    block->num_errors[i], block->num_indels[i],
+				    block->indels_length[i], block->isize[i]);
+      insert_statement_bam_query_fields(fields, stmt, db);
+
+      update_chunks_hash(fields->chr, fields->chr_length, BAM_CHUNKSIZE,
+			 fields->start, fields->end, opts->hash);
+      bam_query_fields_free(fields);
+    }
+  }
+
+  sqlite3_exec(db, "COMMIT TRANSACTION", NULL, NULL, &errorMessage);
+  sqlite3_finalize(stmt);
+
+  stats_store_block_free(block);
+  stats_store_free(store);
+}
+
 //--------------------------------------------------------------------
 // workflow description
 //--------------------------------------------------------------------
@@ -376,8 +408,11 @@ void stats_bam(stats_options_t *opts) {
   stats_counters_t *counters = stats_counters_new();
 
   counters->sequence_labels = (char **) calloc(num_targets, sizeof(char *));
-  counters->sequence_depths_per_nt = (uint16_t **) calloc(num_targets, sizeof(uint16_t *));
-  //  counters->sequence_depths_per_nt = (int **) calloc(num_targets, sizeof(int *));
+  // an index is only built for coordinate sorted inputs
+  char idx_filename[strlen(opts->in_filename) + 5];
+  sprintf(idx_filename, "%s.bai", opts->in_filename);
+  counters->coverage = stats_coverage_new(bam_file->bam_header_p,
+					  access(idx_filename, R_OK) == 0);
   counters->sequence_lengths = (size_t *) calloc(num_targets, sizeof(size_t));
   counters->depth_per_sequence = (double *) calloc(num_targets, sizeof(size_t));
 
@@ -386,17 +421,15 @@ void stats_bam(stats_options_t *opts) {
     ref_length += bam_file->bam_header_p->target_len[i];
 
     counters->sequence_labels[i] = strdup(bam_file->bam_header_p->target_name[i]);
-    counters->sequence_depths_per_nt[i] = (uint16_t *) calloc(bam_file->bam_header_p->target_len[i], sizeof(uint16_t));
     counters->sequence_lengths[i] = bam_file->bam_header_p->target_len[i];
   }
 
   counters->ref_length = ref_length;
   counters->num_sequences = num_targets;
 
-  if (opts->db_on) {
-    // create db table and hash
-    opts->hash = kh_init(stats_chunks);
-    create_stats_db(opts->out_dbname, BAM_CHUNKSIZE, create_bam_query_fields, &opts->db);                
+  if (opts->out_storename) {
+    // stats workers write per-alignment stats to the store
+    opts->store = stats_store_new(opts->out_storename, bam_file->bam_header_p, BAM_CHUNKSIZE);
   }
 
   // bam_stats_options
@@ -436,32 +469,33 @@ void stats_bam(stats_options_t *opts) {
   //  bam_stats_options_free(bam_stats_options);
 
   // compute coverage  
-  size_t nt_depth, unmapped_nts = 0;
-  size_t seq_len, acc_per_sequence = 0, acc = 0;
+  stats_coverage_t *coverage = counters->coverage;
+  size_t acc = 0;
+
+  stats_coverage_finish(coverage);
   for (int i = 0; i < num_targets; i++) {
-    seq_len = counters->sequence_lengths[i];
-    acc_per_sequence = 0;
-    for (int j = 0; j < seq_len; j++) {
-      nt_depth = ((int) counters->sequence_depths_per_nt[i][j]);
-      if (nt_depth) {
-	acc_per_sequence += nt_depth;
-      } else {
-	unmapped_nts++;
-      }
-    }
-    acc += acc_per_sequence;
-    counters->depth_per_sequence[i] = 1.0f * acc_per_sequence / counters->sequence_lengths[i];
+    acc += coverage->depth_acc[i];
+    counters->depth_per_sequence[i] = 1.0f * coverage->depth_acc[i] / counters->sequence_lengths[i];
   }
   
   counters->depth = 1.0f * acc / ref_length;
-  counters->unmapped_nts = unmapped_nts;
+  counters->unmapped_nts = coverage->uncovered_nts;
 
   counters->num_nucleotides = counters->num_As + counters->num_Cs + 
     counters->num_Gs + counters->num_Ts + counters->num_Ns;
 
+  if (opts->store) {
+    stats_store_close(opts->store);
+    stats_store_free(opts->store);
+    opts->store = NULL;
+  }
+
   if (opts->db_on) {
-    // after all records insertions, insert touched chunks from hash,
-    // and after all inserts then create index
+    // create db table and hash, bulk load the stats store, insert
+    // touched chunks from hash, and after all inserts then create index
+    opts->hash = kh_init(stats_chunks);
+    create_stats_db(opts->out_dbname, BAM_CHUNKSIZE, create_bam_query_fields, &opts->db);                
+    stats_store_load_db(opts->out_storename, opts);
     insert_chunk_hash(BAM_CHUNKSIZE, opts->hash, opts->db);
     create_stats_index(create_bam_index, opts->db);
   }
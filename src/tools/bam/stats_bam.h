@@ -10,6 +10,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 //#include "argtable2.h"
 //#include "libconfig.h"
@@ -30,6 +31,7 @@
 #include "bioformats/bam/bam_stats.h"
 #include "bioformats/bam/bam_filter.h"
 
+#include "aux/aux_profiler.h"
 
 #include "stats_options.h"
 #include "stats_report.h"
@@ -0,0 +1,251 @@
+/*
+ * stats_coverage.c
+ *
+ * Sparse coverage accumulator for BAM statistics
+ */
+
+#include "stats_coverage.h"
+
+#include "commons/log.h"
+
+//------------------------------------------------------------------------
+
+// SO:coordinate in the @HD line, other lines (@PG command lines) may
+// quote it too
+static int stats_coverage_header_sorted(const char *text, int l_text) {
+  if (!text || l_text < 3 || strncmp(text, "@HD", 3)) return 0;
+
+  const char *end = memchr(text, '\n', l_text);
+  if (!end) end = text + l_text;
+
+  for (const char *tag = text; tag + 13 <= end; tag++) {
+    if (*tag == '\t' && !strncmp(tag + 1, "SO:coordinate", 13)) {
+      return (tag + 14 == end || tag[14] == '\t' || tag[14] == '\r');
+    }
+  }
+  return 0;
+}
+
+//------------------------------------------------------------------------
+
+stats_coverage_t *stats_coverage_new(bam_header_t *header, int indexed) {
+  stats_coverage_t *p = (stats_coverage_t *) calloc(1, sizeof(stats_coverage_t));
+  int num_targets = header->n_targets;
+
+  p->num_targets = num_targets;
+  p->lengths = (size_t *) calloc(num_targets, sizeof(size_t));
+  p->num_chunks = (size_t *) calloc(num_targets, sizeof(size_t));
+  p->chunks = (coverage_chunk_t ***) calloc(num_targets, sizeof(coverage_chunk_t **));
+  p->depth_acc = (size_t *) calloc(num_targets, sizeof(size_t));
+
+  for (int i = 0; i < num_targets; i++) {
+    p->lengths[i] = header->target_len[i];
+    p->num_chunks[i] = (p->lengths[i] + COVERAGE_CHUNK_SIZE - 1) >> COVERAGE_CHUNK_SHIFT;
+    p->chunks[i] = (coverage_chunk_t **) calloc(p->num_chunks[i] + 1, sizeof(coverage_chunk_t *));
+  }
+
+  p->streaming = indexed || stats_coverage_header_sorted(header->text, header->l_text);
+  if (p->streaming) {
+    LOG_INFO("Coordinate sorted input, coverage is summed while reading\n");
+  } else {
+    LOG_INFO("Input not known to be coordinate sorted, coverage is summed at the end\n");
+  }
+
+  p->max_batches = 1024;
+  p->batch_done = (char *) calloc(p->max_batches, sizeof(char));
+  p->batch_keys = (uint64_t *) calloc(p->max_batches, sizeof(uint64_t));
+
+  return p;
+}
+
+//------------------------------------------------------------------------
+
+void stats_coverage_free(stats_coverage_t *cov) {
+  if (cov) {
+    for (int i = 0; i < cov->num_targets; i++) {
+      for (size_t c = 0; c < cov->num_chunks[i]; c++) {
+	if (cov->chunks[i][c]) {
+	  free(cov->chunks[i][c]->overflow);
+	  free(cov->chunks[i][c]);
+	}
+      }
+      free(cov->chunks[i]);
+    }
+    free(cov->chunks);
+    free(cov->num_chunks);
+    free(cov->lengths);
+    free(cov->depth_acc);
+    free(cov->batch_done);
+    free(cov->batch_keys);
+    free(cov);
+  }
+}
+
+//------------------------------------------------------------------------
+
+void stats_coverage_check_order(const bam1_t *bam1, stats_coverage_t *cov) {
+  uint64_t key = stats_coverage_key(bam1);
+
+  if (cov->streaming && key < cov->last_key) {
+    LOG_FATAL_F("Input is coordinate sorted (header or index), but read %s is out of order\n",
+		bam1_qname(bam1));
+  }
+  cov->last_key = key;
+}
+
+//------------------------------------------------------------------------
+
+static inline void stats_coverage_inc(int tid, size_t pos, int32_t value, stats_coverage_t *cov) {
+  coverage_chunk_t **slot = &cov->chunks[tid][pos >> COVERAGE_CHUNK_SHIFT];
+  coverage_chunk_t *chunk = *(coverage_chunk_t * volatile *) slot;
+
+  if (!chunk) {
+    coverage_chunk_t *new_chunk = (coverage_chunk_t *) calloc(1, sizeof(coverage_chunk_t));
+    if (!__sync_bool_compare_and_swap(slot, NULL, new_chunk)) {
+      free(new_chunk);
+    }
+    chunk = *(coverage_chunk_t * volatile *) slot;
+  }
+
+  size_t j = pos & (COVERAGE_CHUNK_SIZE - 1);
+  int16_t *cell = &chunk->diff[j];
+  int16_t old = *(volatile int16_t *) cell;
+  int32_t sum;
+
+  while ((sum = old + value) >= INT16_MIN && sum <= INT16_MAX) {
+    int16_t cur = __sync_val_compare_and_swap(cell, old, (int16_t) sum);
+    if (cur == old) return;
+    old = cur;
+  }
+
+  // the cell is full, promote the chunk
+  int32_t *overflow = *(int32_t * volatile *) &chunk->overflow;
+  if (!overflow) {
+    int32_t *new_overflow = (int32_t *) calloc(COVERAGE_CHUNK_SIZE, sizeof(int32_t));
+    if (!__sync_bool_compare_and_swap(&chunk->overflow, NULL, new_overflow)) {
+      free(new_overflow);
+    }
+    overflow = *(int32_t * volatile *) &chunk->overflow;
+  }
+  __sync_fetch_and_add(&overflow[j], value);
+}
+
+//------------------------------------------------------------------------
+
+void stats_coverage_add(int tid, size_t start, size_t end, stats_coverage_t *cov) {
+  if (tid < 0 || tid >= cov->num_targets) return;
+
+  size_t len = cov->lengths[tid];
+  if (start >= len || end <= start) return;
+
+  stats_coverage_inc(tid, start, 1, cov);
+  if (end < len) {
+    stats_coverage_inc(tid, end, -1, cov);
+  }
+}
+
+//------------------------------------------------------------------------
+// prefix-sum pass over the chunk at the cursor
+//------------------------------------------------------------------------
+
+static void stats_coverage_sum_chunk(stats_coverage_t *cov) {
+  int tid = cov->cur_tid;
+  size_t c = cov->cur_chunk;
+  size_t beg = c << COVERAGE_CHUNK_SHIFT;
+  size_t len = cov->lengths[tid] - beg;
+  int64_t depth = cov->depth;
+  size_t acc = 0, uncovered = 0;
+  coverage_chunk_t *chunk = cov->chunks[tid][c];
+
+  if (len > COVERAGE_CHUNK_SIZE) len = COVERAGE_CHUNK_SIZE;
+
+  if (chunk) {
+    int32_t *overflow = chunk->overflow;
+    for (size_t j = 0; j < len; j++) {
+      depth += chunk->diff[j];
+      if (overflow) depth += overflow[j];
+      acc += depth;
+      uncovered += (depth == 0);
+      cov->histogram[depth < COVERAGE_HISTOGRAM_SIZE ? depth : COVERAGE_HISTOGRAM_SIZE - 1]++;
+    }
+    free(overflow);
+    free(chunk);
+    cov->chunks[tid][c] = NULL;
+  } else {
+    // no alignment starts or ends here, depth is constant
+    acc = depth * len;
+    uncovered = depth ? 0 : len;
+    cov->histogram[depth < COVERAGE_HISTOGRAM_SIZE ? depth : COVERAGE_HISTOGRAM_SIZE - 1] += len;
+  }
+
+  cov->depth_acc[tid] += acc;
+  cov->uncovered_nts += uncovered;
+  cov->depth = depth;
+
+  if (++cov->cur_chunk >= cov->num_chunks[tid]) {
+    cov->cur_tid++;
+    cov->cur_chunk = 0;
+    cov->depth = 0;
+  }
+}
+
+//------------------------------------------------------------------------
+
+// sums every chunk ending before (tid, pos)
+static void stats_coverage_sum_until(int tid, size_t pos, stats_coverage_t *cov) {
+  while (cov->cur_tid < cov->num_targets) {
+    if (cov->num_chunks[cov->cur_tid] == 0) {
+      cov->cur_tid++;
+      continue;
+    }
+    if (cov->cur_tid > tid ||
+	(cov->cur_tid == tid && ((cov->cur_chunk + 1) << COVERAGE_CHUNK_SHIFT) > pos)) {
+      break;
+    }
+    stats_coverage_sum_chunk(cov);
+  }
+}
+
+//------------------------------------------------------------------------
+
+void stats_coverage_batch_done(size_t batch_id, uint64_t last_key, stats_coverage_t *cov) {
+  if (!cov->streaming) return;
+
+  if (batch_id >= cov->max_batches) {
+    size_t max_batches = cov->max_batches;
+    while (batch_id >= max_batches) max_batches *= 2;
+    cov->batch_done = (char *) realloc(cov->batch_done, max_batches * sizeof(char));
+    cov->batch_keys = (uint64_t *) realloc(cov->batch_keys, max_batches * sizeof(uint64_t));
+    memset(cov->batch_done + cov->max_batches, 0, max_batches - cov->max_batches);
+    cov->max_batches = max_batches;
+  }
+
+  cov->batch_done[batch_id] = 1;
+  cov->batch_keys[batch_id] = last_key;
+
+  // every read after the done batches starts at or after last_key
+  uint64_t key = 0;
+  int advanced = 0;
+  while (cov->next_batch < cov->max_batches && cov->batch_done[cov->next_batch]) {
+    key = cov->batch_keys[cov->next_batch];
+    cov->next_batch++;
+    advanced = 1;
+  }
+
+  if (advanced) {
+    if ((key >> 32) >= (uint64_t) cov->num_targets) {
+      stats_coverage_sum_until(cov->num_targets, 0, cov);
+    } else {
+      stats_coverage_sum_until((int) (key >> 32), (uint32_t) key, cov);
+    }
+  }
+}
+
+//------------------------------------------------------------------------
+
+void stats_coverage_finish(stats_coverage_t *cov) {
+  stats_coverage_sum_until(cov->num_targets, 0, cov);
+}
+
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
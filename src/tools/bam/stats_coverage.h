@@ -0,0 +1,106 @@
+#ifndef STATS_COVERAGE_H
+#define STATS_COVERAGE_H
+
+/*
+ * stats_coverage.h
+ *
+ * Sparse coverage accumulator for BAM statistics
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "samtools/bam.h"
+
+//------------------------------------------------------------------------
+// Coverage is kept as difference arrays (+1 at the alignment start, -1
+// at its end) split in fixed-size chunks, allocated only when touched
+// and updated atomically, so the stats workers add coverage in parallel.
+// A prefix-sum pass turns every chunk into depths, accumulated into the
+// per-target depth, the uncovered positions and the coverage histogram,
+// and the chunk is released.
+//
+// Difference cells are 16-bit, as the old per-base depth arrays. A cell
+// that would overflow leaves the excess in a 32-bit array allocated for
+// its chunk on demand, so depths never saturate and only chunks with
+// thousands of alignments starting at one base pay 4 more bytes a base.
+//
+// For coordinate sorted inputs (SO:coordinate in the @HD line, or an
+// index next to the input) chunks are summed as soon as every batch read
+// before them is done, so only the chunks around the reads in flight are
+// kept in memory. Otherwise the chunks are kept until
+// stats_coverage_finish.
+//------------------------------------------------------------------------
+
+#define COVERAGE_CHUNK_SHIFT     16
+#define COVERAGE_CHUNK_SIZE      (1 << COVERAGE_CHUNK_SHIFT)
+#define COVERAGE_HISTOGRAM_SIZE  100
+
+//------------------------------------------------------------------------
+
+typedef struct coverage_chunk {
+  int16_t diff[COVERAGE_CHUNK_SIZE];
+  int32_t *overflow;
+} coverage_chunk_t;
+
+//------------------------------------------------------------------------
+
+typedef struct stats_coverage {
+  int num_targets;
+  size_t *lengths;
+  size_t *num_chunks;
+  coverage_chunk_t ***chunks;
+
+  // input sorted by coordinate, chunks are summed while reading
+  int streaming;
+  uint64_t last_key;
+
+  // prefix-sum cursor
+  int cur_tid;
+  size_t cur_chunk;
+  int64_t depth;
+
+  // batches done, in reading order
+  size_t next_batch;
+  size_t max_batches;
+  char *batch_done;
+  uint64_t *batch_keys;
+
+  // results
+  size_t uncovered_nts;
+  size_t *depth_acc;
+  size_t histogram[COVERAGE_HISTOGRAM_SIZE];
+} stats_coverage_t;
+
+//------------------------------------------------------------------------
+
+// indexed: the input has a BAM index, so it is coordinate sorted
+// whatever its header says
+stats_coverage_t *stats_coverage_new(bam_header_t *header, int indexed);
+void stats_coverage_free(stats_coverage_t *cov);
+
+// coordinate key to order reads: unmapped reads go last
+static inline uint64_t stats_coverage_key(const bam1_t *bam1) {
+  return ((uint64_t) (uint32_t) bam1->core.tid << 32) | (uint32_t) bam1->core.pos;
+}
+
+// producer side: checks the reading order of a streaming input
+void stats_coverage_check_order(const bam1_t *bam1, stats_coverage_t *cov);
+
+// workers side: thread-safe, adds the coverage of [start, end)
+void stats_coverage_add(int tid, size_t start, size_t end, stats_coverage_t *cov);
+
+// consumer side: batch_id-th batch read from the input is done, its
+// last read has the coordinate key last_key
+void stats_coverage_batch_done(size_t batch_id, uint64_t last_key, stats_coverage_t *cov);
+
+// sums all the remaining chunks
+void stats_coverage_finish(stats_coverage_t *cov);
+
+//------------------------------------------------------------------------
+
+#endif // end of STATS_COVERAGE_H
+
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
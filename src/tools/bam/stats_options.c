@@ -17,15 +17,18 @@ stats_options_t *stats_options_new(char *exec_name, char *command_name) {
   opts->verbose = 0;
   opts->help = 0;
   opts->db_on = 0;
+  opts->store_on = 0;
   opts->num_threads = 2;
   opts->batch_size = 100000;
 
   opts->hash = NULL;
   opts->db = NULL;
+  opts->store = NULL;
   opts->region_table = NULL;
 
   opts->in_filename = NULL;
   opts->out_dbname = NULL;
+  opts->out_storename = NULL;
   opts->out_dirname = NULL;
   opts->gff_region_filename = NULL;
   opts->region_list = NULL;
@@ -47,6 +50,7 @@ void stats_options_free(stats_options_t *opts) {
 
   if (opts->in_filename) { free(opts->in_filename); }
   if (opts->out_dbname) { free(opts->out_dbname); }
+  if (opts->out_storename) { free(opts->out_storename); }
   if (opts->out_dirname) { free(opts->out_dirname); }
   if (opts->gff_region_filename) { free(opts->gff_region_filename); }
   if (opts->region_list) { free(opts->region_list); }
@@ -117,6 +121,16 @@ void stats_options_validate(stats_options_t *opts) {
     opts->out_dbname = strdup(dbname);
   }
 
+  // the DB is bulk loaded from the stats store
+  if (opts->db_on || opts->store_on) {
+    int len = strlen(opts->out_dirname) + strlen(opts->in_filename) + 10;
+    char storename[len], bam_filename[len], *p;
+    sprintf(bam_filename, "%s", ((p = strrchr(opts->in_filename, '/')) ? (p+1) : opts->in_filename));
+    sprintf(storename, "%s/%s.stats", opts->out_dirname, bam_filename);
+
+    opts->out_storename = strdup(storename);
+  }
+
 }
 
 //------------------------------------------------------------------------
@@ -132,6 +146,9 @@ void stats_options_display(stats_options_t *opts) {
   } else {
     printf("\tDB storage          : Disabled\n");
   }
+  if (opts->out_storename) {
+    printf("\tStats store         : Enabled (%s)\n", opts->out_storename);
+  }
 
   if (opts->region_list) {
     printf("\tRegions             : %s\n", opts->region_list);
@@ -165,6 +182,7 @@ stats_options_t *read_cli_stats_options(void **argtable, stats_options_t *opts)
   if (((struct arg_int*)argtable[7])->count) { opts->db_on = ((struct arg_int*)argtable[7])->count; }
   if (((struct arg_file*)argtable[8])->count) { opts->gff_region_filename = strdup(*(((struct arg_file*)argtable[8])->filename)); }
   if (((struct arg_str*)argtable[9])->count) { opts->region_list = strdup(*(((struct arg_str*)argtable[9])->sval)); }
+  if (((struct arg_int*)argtable[10])->count) { opts->store_on = ((struct arg_int*)argtable[10])->count; }
 
   return opts;
 }
@@ -193,6 +211,7 @@ void** new_argtable_stats_options() {
   argtable[7] = arg_lit0(NULL, "db", "Flag to save stats in a DB filename");
   argtable[8] = arg_file0(NULL, "gff-refion-file", NULL, "Region file name (GFF format)");
   argtable[9] = arg_str0(NULL, "region-list", NULL, "Regions (e.g., 1:3000-3200,4:100-200,...)");
+  argtable[10] = arg_lit0(NULL, "store", "Flag to save per-alignment stats in a columnar store file (query it with the stats-query command)");
   
   argtable[NUM_STATS_OPTIONS] = arg_end(20);
   
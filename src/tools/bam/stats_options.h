@@ -20,12 +20,13 @@
 #include "bioformats/db/db_utils.h"
 
 #include "commons_bam.h"
+#include "stats_store.h"
 
 //============================ DEFAULT VALUES ============================
 
 //------------------------------------------------------------------------
 
-#define NUM_STATS_OPTIONS	10
+#define NUM_STATS_OPTIONS	11
 
 //------------------------------------------------------------------------
 
@@ -36,14 +37,17 @@ typedef struct stats_options {
   int num_threads;
   int batch_size;
   int db_on;
+  int store_on;
 
   khash_t(stats_chunks) *hash;
   sqlite3 *db;
+  stats_store_t *store;
   region_table_t *region_table;
 
   char* in_filename;
   char* out_dirname;
   char* out_dbname;
+  char* out_storename;
   char* gff_region_filename;
   char* region_list;
 
@@ -73,7 +73,7 @@ stats_counters_t *stats_counters_new() {
   // coverage (depth): global and per chromosome
   p->unmapped_nts = 0;
   p->sequence_labels = NULL;
-  p->sequence_depths_per_nt = NULL;
+  p->coverage = NULL;
   p->sequence_lengths = NULL;
   p->depth_per_sequence = NULL;
   p->depth = 0.0f;
@@ -91,11 +91,8 @@ void stats_counters_free(stats_counters_t *p) {
       free(p->sequence_labels);
     } 
     
-    if (p->sequence_depths_per_nt) {
-      for(int i = 0; i < p->num_sequences; i++) {
-	if (p->sequence_depths_per_nt[i]) free(p->sequence_depths_per_nt[i]);
-      }
-      free(p->sequence_depths_per_nt);
+    if (p->coverage) {
+      stats_coverage_free(p->coverage);
     }
     
     if (p->sequence_lengths) {
@@ -552,23 +549,10 @@ void report_coverage(char *prefix, stats_counters_t *output) {
   char data_filename[name_length];
   char img_prefix[name_length];
 
-  int num_cols = 100;
-
-  // coverage histogram
-  int hist[num_cols];
-  memset(hist, 0, num_cols * sizeof(int));
+  int num_cols = COVERAGE_HISTOGRAM_SIZE;
 
-  size_t index, len;
-  for (int i = 0; i < output->num_sequences; i++) {
-    len = output->sequence_lengths[i];
-    for (int j = 0; j < len; j++) {
-      index = output->sequence_depths_per_nt[i][j];
-      if (index >= num_cols) {
-	index = num_cols - 1;
-      }
-      hist[index]++;
-    }
-  }
+  // coverage histogram, computed by the coverage accumulator
+  size_t *hist = output->coverage->histogram;
 
   // coverage histogram data
   sprintf(data_filename, "%s.coverage.histogram.data", prefix);
@@ -577,7 +561,7 @@ void report_coverage(char *prefix, stats_counters_t *output) {
   }
 
   for (int i = 0; i < num_cols; i++) {
-    fprintf(f, "%i\t%i\n", i, hist[i]);
+    fprintf(f, "%i\t%lu\n", i, hist[i]);
   }
   fclose(f);
 
@@ -23,6 +23,7 @@
 //#include "bioformats/features/region/region_table.h"
 
 #include "stats_bam.h"
+#include "stats_coverage.h"
 
 //------------------------------------------------------------------------
 
@@ -92,8 +93,7 @@ typedef struct stats_counters {
   size_t unmapped_nts;
   double depth;
   char** sequence_labels;
-  //int **sequence_depths_per_nt;
-  uint16_t **sequence_depths_per_nt;
+  stats_coverage_t *coverage;
   size_t* sequence_lengths;
   double* depth_per_sequence;
 
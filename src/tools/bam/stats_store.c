@@ -0,0 +1,477 @@
+/*
+ * stats_store.c
+ *
+ * Column-oriented store for per-alignment BAM statistics
+ */
+
+#include "stats_store.h"
+
+#include "commons/log.h"
+
+//------------------------------------------------------------------------
+// blocks
+//------------------------------------------------------------------------
+
+stats_store_block_t *stats_store_block_new(size_t max_rows) {
+  stats_store_block_t *p = (stats_store_block_t *) calloc(1, sizeof(stats_store_block_t));
+
+  if (max_rows < 16) max_rows = 16;
+  p->max_rows = max_rows;
+
+  p->tid = (int32_t *) malloc(max_rows * sizeof(int32_t));
+  p->start = (int32_t *) malloc(max_rows * sizeof(int32_t));
+  p->end = (int32_t *) malloc(max_rows * sizeof(int32_t));
+  p->strand = (uint8_t *) malloc(max_rows * sizeof(uint8_t));
+  p->flag = (uint16_t *) malloc(max_rows * sizeof(uint16_t));
+  p->quality = (uint8_t *) malloc(max_rows * sizeof(uint8_t));
+  p->num_errors = (int32_t *) malloc(max_rows * sizeof(int32_t));
+  p->num_indels = (int32_t *) malloc(max_rows * sizeof(int32_t));
+  p->indels_length = (int32_t *) malloc(max_rows * sizeof(int32_t));
+  p->isize = (int32_t *) malloc(max_rows * sizeof(int32_t));
+
+  p->name_offsets = (uint32_t *) malloc((max_rows + 1) * sizeof(uint32_t));
+  p->name_offsets[0] = 0;
+  p->max_names_size = max_rows * 32;
+  p->names = (char *) malloc(p->max_names_size);
+
+  return p;
+}
+
+//------------------------------------------------------------------------
+
+void stats_store_block_free(stats_store_block_t *block) {
+  if (block) {
+    free(block->tid);
+    free(block->start);
+    free(block->end);
+    free(block->strand);
+    free(block->flag);
+    free(block->quality);
+    free(block->num_errors);
+    free(block->num_indels);
+    free(block->indels_length);
+    free(block->isize);
+    free(block->name_offsets);
+    free(block->names);
+    free(block);
+  }
+}
+
+//------------------------------------------------------------------------
+
+static void stats_store_block_reserve(size_t num_rows, size_t names_size, stats_store_block_t *block) {
+  if (num_rows > block->max_rows) {
+    size_t n = block->max_rows;
+    while (n < num_rows) n *= 2;
+    block->tid = (int32_t *) realloc(block->tid, n * sizeof(int32_t));
+    block->start = (int32_t *) realloc(block->start, n * sizeof(int32_t));
+    block->end = (int32_t *) realloc(block->end, n * sizeof(int32_t));
+    block->strand = (uint8_t *) realloc(block->strand, n * sizeof(uint8_t));
+    block->flag = (uint16_t *) realloc(block->flag, n * sizeof(uint16_t));
+    block->quality = (uint8_t *) realloc(block->quality, n * sizeof(uint8_t));
+    block->num_errors = (int32_t *) realloc(block->num_errors, n * sizeof(int32_t));
+    block->num_indels = (int32_t *) realloc(block->num_indels, n * sizeof(int32_t));
+    block->indels_length = (int32_t *) realloc(block->indels_length, n * sizeof(int32_t));
+    block->isize = (int32_t *) realloc(block->isize, n * sizeof(int32_t));
+    block->name_offsets = (uint32_t *) realloc(block->name_offsets, (n + 1) * sizeof(uint32_t));
+    block->max_rows = n;
+  }
+  if (names_size > block->max_names_size) {
+    size_t n = block->max_names_size;
+    while (n < names_size) n *= 2;
+    block->names = (char *) realloc(block->names, n);
+    block->max_names_size = n;
+  }
+}
+
+//------------------------------------------------------------------------
+
+void stats_store_block_add(bam1_t *bam1, bam_stats_t *stats, stats_store_block_t *block) {
+  size_t i = block->num_rows;
+  size_t name_len = bam1->core.l_qname;	// includes '\0'
+
+  stats_store_block_reserve(i + 1, block->names_size + name_len, block);
+
+  block->tid[i] = bam1->core.tid;
+  block->start[i] = bam1->core.pos;
+  block->end[i] = bam1->core.pos + bam1->core.l_qseq;
+  block->strand[i] = stats->strand;
+  block->flag[i] = bam1->core.flag;
+  block->quality[i] = stats->quality;
+  block->num_errors[i] = stats->num_errors;
+  block->num_indels[i] = stats->num_indels;
+  block->indels_length[i] = stats->indels_length;
+  block->isize[i] = stats->isize;
+
+  memcpy(block->names + block->names_size, bam1_qname(bam1), name_len);
+  block->names_size += name_len;
+  block->name_offsets[i + 1] = block->names_size;
+
+  block->num_rows++;
+}
+
+//------------------------------------------------------------------------
+// writing
+//------------------------------------------------------------------------
+
+stats_store_t *stats_store_new(const char *filename, bam_header_t *header, size_t chunk_size) {
+  stats_store_t *p = (stats_store_t *) calloc(1, sizeof(stats_store_t));
+  int32_t len;
+
+  p->filename = strdup(filename);
+  if ((p->file = fopen(filename, "wb")) == NULL) {
+    LOG_FATAL_F("Could not create stats store %s\n", filename);
+  }
+  pthread_mutex_init(&p->lock, NULL);
+
+  p->num_targets = header->n_targets;
+  p->chunk_size = chunk_size;
+  p->target_names = (char **) calloc(p->num_targets, sizeof(char *));
+  p->target_lengths = (size_t *) calloc(p->num_targets, sizeof(size_t));
+  p->num_chunks = (size_t *) calloc(p->num_targets, sizeof(size_t));
+  p->chunk_counts = (uint32_t **) calloc(p->num_targets, sizeof(uint32_t *));
+
+  fwrite(STATS_STORE_MAGIC, 1, 8, p->file);
+  fwrite(&p->num_targets, sizeof(int32_t), 1, p->file);
+  fwrite(&p->chunk_size, sizeof(uint64_t), 1, p->file);
+
+  for (int i = 0; i < p->num_targets; i++) {
+    p->target_names[i] = strdup(header->target_name[i]);
+    p->target_lengths[i] = header->target_len[i];
+    p->num_chunks[i] = p->target_lengths[i] / chunk_size + 1;
+    p->chunk_counts[i] = (uint32_t *) calloc(p->num_chunks[i], sizeof(uint32_t));
+
+    len = strlen(p->target_names[i]);
+    fwrite(&len, sizeof(int32_t), 1, p->file);
+    fwrite(p->target_names[i], 1, len, p->file);
+    fwrite(&p->target_lengths[i], sizeof(uint64_t), 1, p->file);
+  }
+
+  return p;
+}
+
+//------------------------------------------------------------------------
+
+void stats_store_write_block(size_t batch_id, stats_store_block_t *block, stats_store_t *store) {
+  size_t n = block->num_rows;
+  uint32_t magic = STATS_STORE_BLOCK_MAGIC, num_rows = n;
+  uint64_t names_size = block->names_size;
+  stats_store_block_info_t info = { 0, batch_id, UINT64_MAX, 0 };
+  uint64_t key;
+
+  if (!n) return;
+
+  // chunk aggregates and block span, computed out of the lock
+  for (size_t i = 0; i < n; i++) {
+    int32_t tid = block->tid[i];
+    if (tid < 0 || tid >= store->num_targets) continue;
+    key = ((uint64_t) tid << 32) | (uint32_t) block->start[i];
+    if (key < info.first_key) info.first_key = key;
+    key = ((uint64_t) tid << 32) | (uint32_t) block->end[i];
+    if (key > info.last_key) info.last_key = key;
+    size_t last = (block->end[i] > block->start[i] ? block->end[i] - 1 : block->start[i]) / store->chunk_size;
+    if (last >= store->num_chunks[tid]) last = store->num_chunks[tid] - 1;
+    for (size_t c = block->start[i] / store->chunk_size; c <= last; c++) {
+      __sync_fetch_and_add(&store->chunk_counts[tid][c], 1);
+    }
+  }
+
+  pthread_mutex_lock(&store->lock);
+  if (store->num_blocks == store->max_blocks) {
+    store->max_blocks = store->max_blocks ? 2 * store->max_blocks : 1024;
+    store->blocks = (stats_store_block_info_t *) realloc(store->blocks, store->max_blocks *
+							  sizeof(stats_store_block_info_t));
+  }
+  info.offset = ftello(store->file);
+  store->blocks[store->num_blocks] = info;
+
+  fwrite(&magic, sizeof(uint32_t), 1, store->file);
+  fwrite(&num_rows, sizeof(uint32_t), 1, store->file);
+  fwrite(&names_size, sizeof(uint64_t), 1, store->file);
+
+  fwrite(block->tid, sizeof(int32_t), n, store->file);
+  fwrite(block->start, sizeof(int32_t), n, store->file);
+  fwrite(block->end, sizeof(int32_t), n, store->file);
+  fwrite(block->strand, sizeof(uint8_t), n, store->file);
+  fwrite(block->flag, sizeof(uint16_t), n, store->file);
+  fwrite(block->quality, sizeof(uint8_t), n, store->file);
+  fwrite(block->num_errors, sizeof(int32_t), n, store->file);
+  fwrite(block->num_indels, sizeof(int32_t), n, store->file);
+  fwrite(block->indels_length, sizeof(int32_t), n, store->file);
+  fwrite(block->isize, sizeof(int32_t), n, store->file);
+  fwrite(block->name_offsets, sizeof(uint32_t), n + 1, store->file);
+  fwrite(block->names, 1, block->names_size, store->file);
+
+  store->num_rows += n;
+  store->num_blocks++;
+  pthread_mutex_unlock(&store->lock);
+}
+
+//------------------------------------------------------------------------
+
+void stats_store_close(stats_store_t *store) {
+  uint32_t magic = STATS_STORE_CHUNK_MAGIC;
+  uint64_t trailer_offset = ftello(store->file), num_blocks = store->num_blocks;
+
+  fwrite(&magic, sizeof(uint32_t), 1, store->file);
+  for (int i = 0; i < store->num_targets; i++) {
+    fwrite(store->chunk_counts[i], sizeof(uint32_t), store->num_chunks[i], store->file);
+  }
+
+  magic = STATS_STORE_INDEX_MAGIC;
+  fwrite(&magic, sizeof(uint32_t), 1, store->file);
+  fwrite(&num_blocks, sizeof(uint64_t), 1, store->file);
+  fwrite(store->blocks, sizeof(stats_store_block_info_t), num_blocks, store->file);
+
+  // footer
+  fwrite(&trailer_offset, sizeof(uint64_t), 1, store->file);
+  fwrite(&magic, sizeof(uint32_t), 1, store->file);
+
+  fclose(store->file);
+  store->file = NULL;
+}
+
+//------------------------------------------------------------------------
+
+void stats_store_free(stats_store_t *store) {
+  if (store) {
+    if (store->file) fclose(store->file);
+    for (int i = 0; i < store->num_targets; i++) {
+      if (store->target_names[i]) free(store->target_names[i]);
+      if (store->chunk_counts[i]) free(store->chunk_counts[i]);
+    }
+    free(store->target_names);
+    free(store->target_lengths);
+    free(store->num_chunks);
+    free(store->chunk_counts);
+    free(store->blocks);
+    free(store->filename);
+    pthread_mutex_destroy(&store->lock);
+    free(store);
+  }
+}
+
+//------------------------------------------------------------------------
+// reading
+//------------------------------------------------------------------------
+
+#define STATS_STORE_READ(ptr, size, n, f) do {				\
+    if (fread((ptr), (size), (n), (f)) != (size_t) (n)) {		\
+      LOG_FATAL_F("Corrupted stats store %s\n", store->filename);	\
+    }									\
+  } while (0)
+
+static int stats_store_block_info_cmp(const void *a, const void *b) {
+  uint64_t id_a = ((const stats_store_block_info_t *) a)->batch_id;
+  uint64_t id_b = ((const stats_store_block_info_t *) b)->batch_id;
+  return (id_a > id_b) - (id_a < id_b);
+}
+
+//------------------------------------------------------------------------
+
+static void stats_store_read_trailer(stats_store_t *store) {
+  uint64_t trailer_offset, num_blocks;
+  uint32_t magic;
+
+  if (fseeko(store->file, -(off_t) (sizeof(uint64_t) + sizeof(uint32_t)), SEEK_END)) {
+    LOG_FATAL_F("Corrupted stats store %s\n", store->filename);
+  }
+  STATS_STORE_READ(&trailer_offset, sizeof(uint64_t), 1, store->file);
+  STATS_STORE_READ(&magic, sizeof(uint32_t), 1, store->file);
+  if (magic != STATS_STORE_INDEX_MAGIC) {
+    LOG_FATAL_F("Stats store %s was not closed, its trailer is missing\n", store->filename);
+  }
+
+  fseeko(store->file, trailer_offset, SEEK_SET);
+  STATS_STORE_READ(&magic, sizeof(uint32_t), 1, store->file);
+  if (magic != STATS_STORE_CHUNK_MAGIC) {
+    LOG_FATAL_F("Corrupted stats store %s\n", store->filename);
+  }
+  for (int i = 0; i < store->num_targets; i++) {
+    store->chunk_counts[i] = (uint32_t *) malloc(store->num_chunks[i] * sizeof(uint32_t));
+    STATS_STORE_READ(store->chunk_counts[i], sizeof(uint32_t), store->num_chunks[i], store->file);
+  }
+
+  STATS_STORE_READ(&magic, sizeof(uint32_t), 1, store->file);
+  if (magic != STATS_STORE_INDEX_MAGIC) {
+    LOG_FATAL_F("Corrupted stats store %s\n", store->filename);
+  }
+  STATS_STORE_READ(&num_blocks, sizeof(uint64_t), 1, store->file);
+  store->num_blocks = num_blocks;
+  store->max_blocks = num_blocks;
+  store->blocks = (stats_store_block_info_t *) malloc(num_blocks * sizeof(stats_store_block_info_t));
+  STATS_STORE_READ(store->blocks, sizeof(stats_store_block_info_t), num_blocks, store->file);
+
+  // blocks were written as the workers finished, read them in input order
+  qsort(store->blocks, num_blocks, sizeof(stats_store_block_info_t), stats_store_block_info_cmp);
+  store->next_block = 0;
+}
+
+//------------------------------------------------------------------------
+
+stats_store_t *stats_store_open(const char *filename) {
+  stats_store_t *store = (stats_store_t *) calloc(1, sizeof(stats_store_t));
+  char magic[8];
+  int32_t len;
+
+  store->filename = strdup(filename);
+  if ((store->file = fopen(filename, "rb")) == NULL) {
+    LOG_FATAL_F("Could not open stats store %s\n", filename);
+  }
+  pthread_mutex_init(&store->lock, NULL);
+
+  STATS_STORE_READ(magic, 1, 8, store->file);
+  if (memcmp(magic, STATS_STORE_MAGIC, 8)) {
+    LOG_FATAL_F("%s is not a stats store\n", filename);
+  }
+  STATS_STORE_READ(&store->num_targets, sizeof(int32_t), 1, store->file);
+  STATS_STORE_READ(&store->chunk_size, sizeof(uint64_t), 1, store->file);
+
+  store->target_names = (char **) calloc(store->num_targets, sizeof(char *));
+  store->target_lengths = (size_t *) calloc(store->num_targets, sizeof(size_t));
+  store->num_chunks = (size_t *) calloc(store->num_targets, sizeof(size_t));
+  store->chunk_counts = (uint32_t **) calloc(store->num_targets, sizeof(uint32_t *));
+
+  for (int i = 0; i < store->num_targets; i++) {
+    STATS_STORE_READ(&len, sizeof(int32_t), 1, store->file);
+    store->target_names[i] = (char *) calloc(len + 1, sizeof(char));
+    STATS_STORE_READ(store->target_names[i], 1, len, store->file);
+    STATS_STORE_READ(&store->target_lengths[i], sizeof(uint64_t), 1, store->file);
+    store->num_chunks[i] = store->target_lengths[i] / store->chunk_size + 1;
+  }
+
+  stats_store_read_trailer(store);
+
+  return store;
+}
+
+//------------------------------------------------------------------------
+
+static void stats_store_read_block_at(size_t b, stats_store_block_t *block, stats_store_t *store) {
+  uint32_t magic = 0, num_rows;
+  uint64_t names_size;
+  size_t n;
+
+  fseeko(store->file, store->blocks[b].offset, SEEK_SET);
+  STATS_STORE_READ(&magic, sizeof(uint32_t), 1, store->file);
+  if (magic != STATS_STORE_BLOCK_MAGIC) {
+    LOG_FATAL_F("Corrupted stats store %s\n", store->filename);
+  }
+
+  STATS_STORE_READ(&num_rows, sizeof(uint32_t), 1, store->file);
+  STATS_STORE_READ(&names_size, sizeof(uint64_t), 1, store->file);
+  n = num_rows;
+  stats_store_block_reserve(n, names_size, block);
+
+  STATS_STORE_READ(block->tid, sizeof(int32_t), n, store->file);
+  STATS_STORE_READ(block->start, sizeof(int32_t), n, store->file);
+  STATS_STORE_READ(block->end, sizeof(int32_t), n, store->file);
+  STATS_STORE_READ(block->strand, sizeof(uint8_t), n, store->file);
+  STATS_STORE_READ(block->flag, sizeof(uint16_t), n, store->file);
+  STATS_STORE_READ(block->quality, sizeof(uint8_t), n, store->file);
+  STATS_STORE_READ(block->num_errors, sizeof(int32_t), n, store->file);
+  STATS_STORE_READ(block->num_indels, sizeof(int32_t), n, store->file);
+  STATS_STORE_READ(block->indels_length, sizeof(int32_t), n, store->file);
+  STATS_STORE_READ(block->isize, sizeof(int32_t), n, store->file);
+  STATS_STORE_READ(block->name_offsets, sizeof(uint32_t), n + 1, store->file);
+  STATS_STORE_READ(block->names, 1, names_size, store->file);
+
+  block->num_rows = n;
+  block->names_size = names_size;
+}
+
+//------------------------------------------------------------------------
+
+int stats_store_read_block(stats_store_block_t *block, stats_store_t *store) {
+  block->num_rows = 0;
+  block->names_size = 0;
+
+  if (store->next_block >= store->num_blocks) return 0;
+
+  stats_store_read_block_at(store->next_block++, block, store);
+  return 1;
+}
+
+//------------------------------------------------------------------------
+// query
+//------------------------------------------------------------------------
+
+size_t stats_store_query(const char *filename, const char *region, FILE *out) {
+  stats_store_t *store = stats_store_open(filename);
+  stats_store_block_t *block = stats_store_block_new(1024);
+  int tid = -1;
+  int64_t start = 0, end = INT64_MAX;
+  size_t num_rows = 0;
+
+  if (region) {
+    char chr[strlen(region) + 1], *colon;
+    strcpy(chr, region);
+    if ((colon = strrchr(chr, ':')) != NULL) {
+      *colon = 0;
+      sscanf(colon + 1, "%ld-%ld", &start, &end);
+      start--; // 1-based to 0-based
+    }
+    for (int i = 0; i < store->num_targets; i++) {
+      if (strcmp(chr, store->target_names[i]) == 0) {
+	tid = i;
+	break;
+      }
+    }
+    if (tid < 0) {
+      LOG_FATAL_F("Chromosome %s not found in stats store %s\n", chr, filename);
+    }
+  }
+
+  // region span as block keys, and whether its chunks have any alignment
+  uint64_t first_key = 0, last_key = UINT64_MAX;
+  int empty = 0;
+  if (tid >= 0) {
+    if (start < 0) start = 0;
+    if (end > UINT32_MAX) end = UINT32_MAX;
+    first_key = ((uint64_t) tid << 32) | (uint64_t) start;
+    last_key = ((uint64_t) tid << 32) | (uint64_t) end;
+
+    empty = 1;
+    size_t last = (end > start ? end - 1 : start) / store->chunk_size;
+    if (last >= store->num_chunks[tid]) last = store->num_chunks[tid] - 1;
+    for (size_t c = start / store->chunk_size; c <= last; c++) {
+      if (store->chunk_counts[tid][c]) {
+	empty = 0;
+	break;
+      }
+    }
+  }
+
+  fprintf(out, "#id\tchr\tstart\tend\tstrand\tflag\tquality\tnum_errors\tnum_indels\tindels_length\tisize\n");
+  for (size_t b = 0; !empty && b < store->num_blocks; b++) {
+    // blocks in batch order, skipped when their span misses the region
+    if (tid >= 0 && (store->blocks[b].first_key >= last_key ||
+		     store->blocks[b].last_key <= first_key)) {
+      continue;
+    }
+    stats_store_read_block_at(b, block, store);
+
+    for (size_t i = 0; i < block->num_rows; i++) {
+      // only the position columns are checked to skip rows
+      if (tid >= 0 && (block->tid[i] != tid || block->end[i] <= start || block->start[i] >= end)) {
+	continue;
+      }
+      fprintf(out, "%s\t%s\t%i\t%i\t%i\t%u\t%u\t%i\t%i\t%i\t%i\n",
+	      block->names + block->name_offsets[i],
+	      store->target_names[block->tid[i]],
+	      block->start[i] + 1, block->end[i],
+	      block->strand[i], block->flag[i], block->quality[i],
+	      block->num_errors[i], block->num_indels[i],
+	      block->indels_length[i], block->isize[i]);
+      num_rows++;
+    }
+  }
+
+  stats_store_block_free(block);
+  stats_store_free(store);
+
+  return num_rows;
+}
+
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
@@ -0,0 +1,139 @@
+#ifndef STATS_STORE_H
+#define STATS_STORE_H
+
+/*
+ * stats_store.h
+ *
+ * Column-oriented store for per-alignment BAM statistics
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "samtools/bam.h"
+#include "bioformats/bam/bam_stats.h"
+
+//------------------------------------------------------------------------
+// The store file is a header (targets and chunk size) followed by
+// blocks, one per stats batch, written by the stats workers. Every block
+// keeps its rows column by column:
+//
+//   tid, start, end (int32), strand (uint8), flag (uint16), quality
+//   (uint8), num_errors, num_indels, indels_length, isize (int32) and
+//   the read names as offsets (uint32, num_rows + 1) plus characters
+//
+// and a trailer with the number of alignments per chunk of chunk_size
+// nucleotides, per target, and the block index: for every block its
+// file offset, the id of its stats batch (reading order of the input)
+// and the span of its rows. The file ends with the trailer offset.
+//
+// Blocks are appended in the order the workers finish them, readers go
+// through the index sorted by batch id, so rows come back in the input
+// order, and skip the blocks whose span misses the region queried. The
+// SQLite database is optionally bulk loaded from the store at the end
+// of the run.
+//------------------------------------------------------------------------
+
+#define STATS_STORE_MAGIC        "HPGSTS2"
+#define STATS_STORE_BLOCK_MAGIC  0x314B4C42 // BLK1
+#define STATS_STORE_CHUNK_MAGIC  0x314B4843 // CHK1
+#define STATS_STORE_INDEX_MAGIC  0x31584449 // IDX1
+
+//------------------------------------------------------------------------
+
+typedef struct stats_store_block {
+  size_t num_rows;
+  size_t max_rows;
+
+  int32_t *tid;
+  int32_t *start;
+  int32_t *end;
+  uint8_t *strand;
+  uint16_t *flag;
+  uint8_t *quality;
+  int32_t *num_errors;
+  int32_t *num_indels;
+  int32_t *indels_length;
+  int32_t *isize;
+
+  uint32_t *name_offsets;
+  size_t names_size;
+  size_t max_names_size;
+  char *names;
+} stats_store_block_t;
+
+//------------------------------------------------------------------------
+
+// keys are (tid << 32 | position), first_key is the lowest start and
+// last_key the highest end of the block rows
+typedef struct stats_store_block_info {
+  uint64_t offset;
+  uint64_t batch_id;
+  uint64_t first_key;
+  uint64_t last_key;
+} stats_store_block_info_t;
+
+//------------------------------------------------------------------------
+
+typedef struct stats_store {
+  FILE *file;
+  char *filename;
+  pthread_mutex_t lock;
+
+  int num_targets;
+  char **target_names;
+  size_t *target_lengths;
+
+  size_t chunk_size;
+  size_t *num_chunks;
+  uint32_t **chunk_counts;
+
+  size_t num_rows;
+  size_t num_blocks;
+  size_t max_blocks;
+  stats_store_block_info_t *blocks;
+
+  // reading cursor in the block index
+  size_t next_block;
+} stats_store_t;
+
+//------------------------------------------------------------------------
+
+stats_store_block_t *stats_store_block_new(size_t max_rows);
+void stats_store_block_free(stats_store_block_t *block);
+
+void stats_store_block_add(bam1_t *bam1, bam_stats_t *stats, stats_store_block_t *block);
+
+//------------------------------------------------------------------------
+
+stats_store_t *stats_store_new(const char *filename, bam_header_t *header, size_t chunk_size);
+
+// thread-safe, called by the stats workers, batch_id is the reading
+// order of the batch the block comes from
+void stats_store_write_block(size_t batch_id, stats_store_block_t *block, stats_store_t *store);
+
+// writes the trailer (chunk counts and block index) and closes the store
+void stats_store_close(stats_store_t *store);
+void stats_store_free(stats_store_t *store);
+
+//------------------------------------------------------------------------
+
+// opens a store to read, loads its trailer
+stats_store_t *stats_store_open(const char *filename);
+
+// reads the next block in batch order, returns 0 when there are no more
+int stats_store_read_block(stats_store_block_t *block, stats_store_t *store);
+
+// prints as tab-separated text the rows overlapping a region
+// (chr, chr:start-end or NULL for all), in the input order
+size_t stats_store_query(const char *filename, const char *region, FILE *out);
+
+//------------------------------------------------------------------------
+
+#endif // end of STATS_STORE_H
+
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
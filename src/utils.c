@@ -13,21 +13,7 @@
 
 
 void revcomp_seq(char* seq) {
-  extern char convert_ASCII[128];
-
-  char temp;
-  int i, j = 0;
-  
-  i = 0;
-  j = strlen(seq) - 1;
-  
-  while (i < j) {
-    temp = seq[i];
-    seq[i] = convert_ASCII[(int)seq[j]];
-    seq[j] = convert_ASCII[(int)temp];
-    i++;
-    j--;
-  }
+  simd_nt_revcomp_inplace(seq, strlen(seq));
 }
 
 //----------------------------------------------------------------------
@@ -87,18 +73,7 @@ char *bam1_get_sequence(bam1_t *bam1, char *sequence_string) {
    * *****************************************************/
   uint8_t* sequence_p = bam1_seq(bam1); //sam_tools: each base is encoded in 4 bits
   int sequence_length = (int32_t)bam1->core.l_qseq;
-  unsigned char ta_lut[16];
-  for (int i = 0; i < 16; i++){
-    ta_lut [i] = 0;
-  }
-  ta_lut[1] = 'A';
-  ta_lut[2] = 'C';
-  ta_lut[4] = 'G';
-  ta_lut[8] = 'T';
-  ta_lut[15] = 'N';
-  for (int i = 0; i < sequence_length; i++) {
-    sequence_string[i] = ta_lut[bam1_seqi(sequence_p, i)];
-  }
+  simd_bam_unpack(sequence_p, sequence_length, sequence_string);
   sequence_string[sequence_length] = '\0';
 
   return sequence_string;
@@ -11,6 +11,8 @@
 #include "bioformats/bam/bam_file.h"
 #include "samtools/bam.h"
 
+#include "aux/aux_nt_simd.h"
+
 //------------------------------------------------------------------------
 
 void revcomp_seq(char* seq);
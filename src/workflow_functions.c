@@ -52,7 +52,7 @@ void *fastq_reader(void *input) {
 
      extern size_t fd_read_bytes;
      size_t read_bytes;
-     //if (time_on) { start_timer(start); }
+     uint64_t prof_time = profiler_start(PROF_READER);
 
      wf_input_t *wf_input = (wf_input_t *) input;
      batch_t *new_batch = NULL;
@@ -94,7 +94,7 @@ void *fastq_reader(void *input) {
 				batch->mapping_mode, mapping_batch);
      }
 
-     //if (time_on) { stop_timer(start, end, time); timing_add(time, FASTQ_READER, timing); }
+     profiler_stop(PROF_READER, prof_time);
      //printf("Read batch %i\n", num_reads);
      
      return new_batch;
@@ -338,6 +338,7 @@ int file_alignment_fill(size_t num_items, array_list_t *list,
 */
 void *file_reader(void *input) {
   wf_input_file_t *wf_input = (wf_input_file_t *) input;
+  uint64_t prof_time = profiler_start(PROF_READER);
   FILE *fd = wf_input->file;
   batch_t *batch = wf_input->batch;
 
@@ -414,6 +415,7 @@ void *file_reader(void *input) {
   extern size_t reads_w2;
   reads_w2 += num_reads;
 
+  profiler_stop(PROF_READER, prof_time);
 
   return new_batch;
 
@@ -421,6 +423,7 @@ void *file_reader(void *input) {
 
 void *file_reader_2(void *input) {
   wf_input_file_t *wf_input = (wf_input_file_t *) input;
+  uint64_t prof_time = profiler_start(PROF_READER);
   FILE *fd = wf_input->file;
   batch_t *batch = wf_input->batch;
 
@@ -495,6 +498,8 @@ void *file_reader_2(void *input) {
   extern size_t reads_w3;
   reads_w3 += num_reads;
 
+  profiler_stop(PROF_READER, prof_time);
+
   return new_batch;
 
 }
@@ -510,6 +515,8 @@ void write_unmapped_read(fastq_read_t *fq_read, bam_file_t *bam_file);
 //--------------------------------------------------------------------
 
 int sam_writer(void *data) {
+  uint64_t prof_time = profiler_start(PROF_WRITER);
+
   batch_t *batch = (batch_t *) data;
   batch_writer_input_t *writer_input = batch->writer_input;
   //bam_file_t *bam_file = writer_input->bam_file;    
@@ -528,20 +535,20 @@ int sam_writer(void *data) {
   int flag, pnext = 0, tlen = 0;
   char rnext[4] = "*\0";
 
-  extern st_bwt_t st_bwt;
-  st_bwt.total_reads += num_reads;
+  thread_stats_add(ST_BWT_TOTAL_READS, num_reads);
 
   for (size_t i = 0; i < num_reads; i++) {
     read = (fastq_read_t *) array_list_get(i, read_list);
     mapping_list = mapping_batch->mapping_lists[i];
     num_mappings = array_list_size(mapping_list);
     total_mappings += num_mappings;
+    thread_stats_add_mappings(num_mappings);
     //printf("%i.Read %s (num_mappings %i)\n", i, read->id, num_mappings);    
     if (num_mappings > 0) {
       if (num_mappings == 1) {
-	st_bwt.single_alig++;
+	thread_stats_inc(ST_BWT_SINGLE_ALIG);
       } else {
-	st_bwt.multi_alig++;
+	thread_stats_inc(ST_BWT_MULTI_ALIG);
       }
 
       num_mapped_reads++;
@@ -587,13 +594,13 @@ int sam_writer(void *data) {
 
   basic_statistics_add(num_reads, num_mapped_reads, total_mappings, 0, basic_st);
 
+  profiler_stop(PROF_WRITER, prof_time);
+
   return 0;
 
 }
 
 int bam_writer(void *data) {  
-  //if (time_on) { start_timer(start); }
-  
   batch_t *batch = (batch_t *) data;
   fastq_read_t *fq_read;
 
@@ -613,8 +620,7 @@ int bam_writer(void *data) {
 
   writer_input->total_batches++;
    
-  extern st_bwt_t st_bwt;
-  st_bwt.total_reads += num_reads_b;
+  thread_stats_add(ST_BWT_TOTAL_READS, num_reads_b);
 
   free(mapping_batch->histogram_sw);
   //
@@ -623,6 +629,7 @@ int bam_writer(void *data) {
   for (size_t i = 0; i < num_reads_b; i++) {
     num_items = array_list_size(mapping_batch->mapping_lists[i]);
     total_mappings += num_items;
+    thread_stats_add_mappings(num_items);
     fq_read = (fastq_read_t *) array_list_get(i, mapping_batch->fq_batch);
     
     // mapped or not mapped ?	 
@@ -636,9 +643,9 @@ int bam_writer(void *data) {
       num_mapped_reads++;
 
       if (array_list_size(mapping_batch->mapping_lists[i]) == 1) {
-	st_bwt.single_alig++;
+	thread_stats_inc(ST_BWT_SINGLE_ALIG);
       } else {
-	st_bwt.multi_alig++;
+	thread_stats_inc(ST_BWT_MULTI_ALIG);
       }
       
       write_mapped_read(mapping_batch->mapping_lists[i], bam_file);
@@ -661,6 +668,7 @@ void write_mapped_read(array_list_t *array_list, bam_file_t *bam_file) {
   size_t num_items = array_list_size(array_list);
   alignment_t *alig;
   bam1_t *bam1;
+  uint64_t prof_time;
   for (size_t j = 0; j < num_items; j++) {
     alig = (alignment_t *) array_list_get(j, array_list);
 
@@ -673,8 +681,13 @@ void write_mapped_read(array_list_t *array_list, bam_file_t *bam_file) {
     //alignment_print(alig);
     //exit(-1);
     if (alig != NULL) {
+      prof_time = profiler_start(PROF_CONVERT_TO_BAM);
       bam1 = convert_to_bam(alig, 33);
+      profiler_stop(PROF_CONVERT_TO_BAM, prof_time);
+
+      prof_time = profiler_start(PROF_COMPRESSION);
       bam_fwrite(bam1, bam_file);
+      profiler_stop(PROF_COMPRESSION, prof_time);
       bam_destroy1(bam1);	 
       alignment_free(alig);
     } else {
@@ -705,8 +718,13 @@ void write_unmapped_read(fastq_read_t *fq_read, bam_file_t *bam_file) {
   alignment_init_single_end(strdup(fq_read->id), fq_read->sequence, fq_read->quality,
 			    0, -1, -1, /*strdup(aux)*/"", 0, 0, 0, 0, 0, NULL, alig);
   
+  uint64_t prof_time = profiler_start(PROF_CONVERT_TO_BAM);
   bam1 = convert_to_bam(alig, 33);
+  profiler_stop(PROF_CONVERT_TO_BAM, prof_time);
+
+  prof_time = profiler_start(PROF_COMPRESSION);
   bam_fwrite(bam1, bam_file);
+  profiler_stop(PROF_COMPRESSION, prof_time);
   bam_destroy1(bam1);
 	       
   alig->sequence = NULL;
@@ -725,11 +743,18 @@ void write_unmapped_read(fastq_read_t *fq_read, bam_file_t *bam_file) {
 int bwt_stage(void *data) {
   batch_t *batch = (batch_t *) data;
 
+  uint64_t prof_time = profiler_start(PROF_BWT);
+  int ret;
+
   if (batch->mapping_mode == DNA_MODE) {
-    return apply_bwt(batch->bwt_input, batch);     
+    ret = apply_bwt(batch->bwt_input, batch);     
   } else {
-    return apply_bwt_rna(batch->bwt_input, batch);     
+    ret = apply_bwt_rna(batch->bwt_input, batch);     
   }
+
+  profiler_stop(PROF_BWT, prof_time);
+
+  return ret;
 }
 
 //--------------------------------------------------------------------
@@ -738,7 +763,11 @@ int bwt_stage(void *data) {
 int seeding_stage(void *data) {
   batch_t *batch = (batch_t *) data;
 
-  return apply_seeding(batch->region_input, batch);
+  uint64_t prof_time = profiler_start(PROF_SEEDING);
+  int ret = apply_seeding(batch->region_input, batch);
+  profiler_stop(PROF_SEEDING, prof_time);
+
+  return ret;
 }
 
 //--------------------------------------------------------------------
@@ -747,7 +776,11 @@ int seeding_stage(void *data) {
 int cal_stage(void *data) {
   batch_t *batch = (batch_t *) data;
 
-  return apply_caling_rna(batch->cal_input, batch);
+  uint64_t prof_time = profiler_start(PROF_CAL);
+  int ret = apply_caling_rna(batch->cal_input, batch);
+  profiler_stop(PROF_CAL, prof_time);
+
+  return ret;
 }
 
 
@@ -756,7 +789,11 @@ int cal_stage(void *data) {
 int pre_pair_stage(void *data) {
   batch_t *batch = (batch_t *) data;
 
-  return apply_pair(batch->pair_input, batch);
+  uint64_t prof_time = profiler_start(PROF_PAIRING);
+  int ret = apply_pair(batch->pair_input, batch);
+  profiler_stop(PROF_PAIRING, prof_time);
+
+  return ret;
 }
 
 //---------------------------------------------------------------------
@@ -764,12 +801,19 @@ int pre_pair_stage(void *data) {
 
 int sw_stage(void *data) {
   batch_t *batch = (batch_t *) data;
+
+  uint64_t prof_time = profiler_start(PROF_SW);
+  int ret;
      
   if (batch->mapping_mode == RNA_MODE) {
-    return apply_sw_rna(batch->sw_input, batch);
+    ret = apply_sw_rna(batch->sw_input, batch);
   } else {
-    return apply_sw(batch->sw_input, batch);
+    ret = apply_sw(batch->sw_input, batch);
   }
+
+  profiler_stop(PROF_SW, prof_time);
+
+  return ret;
 }
 
 //--------------------------------------------------------------------
@@ -777,21 +821,36 @@ int sw_stage(void *data) {
 
 int rna_last_stage(void *data) {
    batch_t *batch = (batch_t *) data;
-   return apply_rna_last(batch->sw_input, batch);
+
+   uint64_t prof_time = profiler_start(PROF_RNA_LAST);
+   int ret = apply_rna_last(batch->sw_input, batch);
+   profiler_stop(PROF_RNA_LAST, prof_time);
+
+   return ret;
 }
 
 //--------------------------------------------------------------------
 
 int rna_last_hc_stage(void *data) {
    batch_t *batch = (batch_t *) data;
-   return apply_rna_last_hc(batch->sw_input, batch);
+
+   uint64_t prof_time = profiler_start(PROF_RNA_LAST);
+   int ret = apply_rna_last_hc(batch->sw_input, batch);
+   profiler_stop(PROF_RNA_LAST, prof_time);
+
+   return ret;
 }
 
 //--------------------------------------------------------------------
 
 int post_pair_stage(void *data) {
   batch_t *batch = (batch_t *) data;
-  return prepare_alignments(batch->pair_input, batch);
+
+  uint64_t prof_time = profiler_start(PROF_PAIRING);
+  int ret = prepare_alignments(batch->pair_input, batch);
+  profiler_stop(PROF_PAIRING, prof_time);
+
+  return ret;
 }
 
 //--------------------------------------------------------------------
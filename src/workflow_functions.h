@@ -22,6 +22,8 @@
 #include "sw_server.h"
 #include "batch_writer.h"
 
+#include "aux/aux_profiler.h"
+
 #define MAX_READS_RNA 200
 
 extern int global_status;